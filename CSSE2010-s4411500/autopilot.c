@@ -0,0 +1,188 @@
+/*
+ * autopilot.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdio.h>
+
+#include "autopilot.h"
+#include "fieldsim.h"
+#include "game.h"
+#include "terminalio.h"
+
+// The first moves the planner considers, in order of preference when
+// several get into a hole equally quickly or survive equally long
+#define NUM_CHOICES 5
+static const int8_t choice_move[NUM_CHOICES] PROGMEM = {
+	AUTOPILOT_FORWARD, AUTOPILOT_LEFT, AUTOPILOT_RIGHT, AUTOPILOT_STAY, AUTOPILOT_BACKWARD
+};
+static const int8_t choice_row_change[NUM_CHOICES] PROGMEM = { 1, 0, 0, 0, -1 };
+static const int8_t choice_column_change[NUM_CHOICES] PROGMEM = { 0, -1, 1, 0, 0 };
+
+#define RIVERBANK_ROW 7
+#define TIMER1_PRESCALE 8
+
+static uint8_t enabled;
+static uint16_t crossings;
+static uint16_t deaths;
+static uint32_t last_cycles;
+static uint32_t max_cycles;
+// TIMER1 overflows seen during the decision being timed
+static uint8_t overflows;
+
+void init_autopilot(void) {
+	// TIMER1 free runs at clock/8 and is only read, never interrupts
+	TCCR1A = 0;
+	TCCR1B = (1<<CS11);
+	enabled = 0;
+}
+
+void toggle_autopilot(void) {
+	enabled = !enabled;
+}
+
+uint8_t autopilot_enabled(void) {
+	return enabled;
+}
+
+// Count a TIMER1 overflow if there has been one since the last call. This
+// is called at least once per search step (far less than the 65ms it takes
+// TIMER1 to overflow) so none are missed.
+static void count_overflow(void) {
+	if(TIFR1 & (1<<TOV1)) {
+		TIFR1 = (1<<TOV1);
+		if(overflows < UINT8_MAX) {
+			overflows++;
+		}
+	}
+}
+
+// Return the TIMER1 ticks since start_time, including the overflows. An
+// overflow flagged but not yet counted happened before TCNT1 was read if
+// TCNT1 has only just started again, otherwise after it.
+static uint32_t ticks_since(uint16_t start_time) {
+	uint16_t now = TCNT1;
+	
+	if((TIFR1 & (1<<TOV1)) && now < 0x8000) {
+		count_overflow();
+	}
+	if(overflows == UINT8_MAX) {
+		return UINT32_MAX / TIMER1_PRESCALE;
+	}
+	return ((uint32_t)overflows << 16) + now - start_time;
+}
+
+// Return the first choice (in order of preference) whose reach set has got
+// into a riverbank hole, or -1 if none has
+static int8_t choice_in_hole(Reach* reach) {
+	for(uint8_t i = 0; i < NUM_CHOICES; i++) {
+		if(reach[i][RIVERBANK_ROW]) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+int8_t autopilot_next_move(void) {
+	uint16_t start_time;
+	FieldSim sim;
+	Reach reach[NUM_CHOICES];
+	Reach safe;
+	uint8_t lifetime[NUM_CHOICES];
+	uint8_t frog_row = get_frog_row();
+	uint8_t frog_column = get_frog_column();
+	int8_t best;
+	
+	TIFR1 = (1<<TOV1);
+	overflows = 0;
+	start_time = TCNT1;
+	
+	get_field_prediction(&sim);
+	fieldsim_safe_rows(&sim, safe);
+	
+	// Make each first move now (it has to land somewhere safe)
+	for(uint8_t i = 0; i < NUM_CHOICES; i++) {
+		int8_t row = frog_row + (int8_t)pgm_read_byte(&choice_row_change[i]);
+		int8_t column = frog_column + (int8_t)pgm_read_byte(&choice_column_change[i]);
+		for(uint8_t y = 0; y < FIELD_ROWS; y++) {
+			reach[i][y] = 0;
+		}
+		if(row >= 0 && row < FIELD_ROWS && column >= 0 && column < 16) {
+			reach[i][row] = (1 << column) & safe[row];
+		}
+		lifetime[i] = 0;
+	}
+	
+	// Then sweep forward, one move per step, until a hole is reached
+	best = choice_in_hole(reach);
+	for(uint8_t step = 0; step < AUTOPILOT_HORIZON && best < 0; step++) {
+		uint8_t any_alive = 0;
+		
+		count_overflow();
+		fieldsim_advance(&sim, AUTOPILOT_STEP_MS, reach, NUM_CHOICES);
+		fieldsim_safe_rows(&sim, safe);
+		for(uint8_t i = 0; i < NUM_CHOICES; i++) {
+			uint16_t anywhere = 0;
+			fieldsim_expand(safe, reach[i]);
+			for(uint8_t y = 0; y < FIELD_ROWS; y++) {
+				anywhere |= reach[i][y];
+			}
+			if(anywhere) {
+				lifetime[i]++;
+				any_alive = 1;
+			}
+		}
+		if(!any_alive) {
+			break;
+		}
+		best = choice_in_hole(reach);
+	}
+	
+	if(best < 0) {
+		// No hole within the horizon - stay alive as long as possible
+		best = 0;
+		for(uint8_t i = 1; i < NUM_CHOICES; i++) {
+			if(lifetime[i] > lifetime[best]) {
+				best = i;
+			}
+		}
+	}
+	
+	last_cycles = ticks_since(start_time) * TIMER1_PRESCALE;
+	if(last_cycles > max_cycles) {
+		max_cycles = last_cycles;
+	}
+	return (int8_t)pgm_read_byte(&choice_move[best]);
+}
+
+void autopilot_frog_crossed(void) {
+	crossings++;
+}
+
+void autopilot_frog_died(void) {
+	deaths++;
+}
+
+uint32_t autopilot_last_cycles(void) {
+	return last_cycles;
+}
+
+uint32_t autopilot_max_cycles(void) {
+	return max_cycles;
+}
+
+void print_autopilot_stats(void) {
+	move_cursor(55,21);
+	if(enabled) {
+		printf_P(PSTR("Autopilot: ON "));
+	} else {
+		printf_P(PSTR("Autopilot: OFF"));
+	}
+	move_cursor(55,22);
+	printf_P(PSTR("Crossed:%5u died:%5u"), crossings, deaths);
+	move_cursor(55,23);
+	printf_P(PSTR("Plan cyc:%6lu max:%6lu"), last_cycles, max_cycles);
+}
@@ -0,0 +1,64 @@
+/*
+ * autopilot.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Demo/autopilot mode. Every AUTOPILOT_STEP_MS the planner takes a copy of
+ * the current field (see fieldsim.h) and searches forward in time for the
+ * quickest safe way into a riverbank hole, assuming the frog can make one
+ * move every AUTOPILOT_STEP_MS. Each of the five possible first moves
+ * (forward, left, right, stay, backward) gets its own reach set and all
+ * five are swept together over the same prediction, so the first move
+ * whose reach set gets into a hole first is the move to make. The lanes
+ * and logs are rotated in place as the prediction advances (they are
+ * periodic with widths of at most 64 and 32 columns) so no per-step state
+ * is stored - the search uses 5 x 16 bytes of reach sets whatever the
+ * horizon.
+ *
+ * Each decision looks at most AUTOPILOT_HORIZON steps ahead which bounds
+ * the cost. The cost of every decision is measured in CPU cycles with
+ * TIMER1 (prescaler 8, so to the nearest 8 cycles; interrupts which occur
+ * during the search are included). TIMER1 overflows every 65ms so the
+ * overflows are counted as the search goes; a decision taking more than
+ * 255 of them is reported as UINT32_MAX cycles.
+ */
+
+#ifndef AUTOPILOT_H_
+#define AUTOPILOT_H_
+
+#include <stdint.h>
+
+#define AUTOPILOT_STEP_MS 250
+#define AUTOPILOT_HORIZON 40
+
+// Moves returned by autopilot_next_move(). These use the same numbers as
+// the push buttons (see buttons.h).
+#define AUTOPILOT_RIGHT 0
+#define AUTOPILOT_BACKWARD 1
+#define AUTOPILOT_FORWARD 2
+#define AUTOPILOT_LEFT 3
+#define AUTOPILOT_STAY -1
+
+// Set up TIMER1 for measuring the planner. Autopilot starts off.
+void init_autopilot(void);
+
+void toggle_autopilot(void);
+uint8_t autopilot_enabled(void);
+
+// Plan from the current game state and return the move to make now.
+// Must only be called when the frog is alive and not in the riverbank.
+int8_t autopilot_next_move(void);
+
+// Record the outcome of a frog for the soak test statistics
+void autopilot_frog_crossed(void);
+void autopilot_frog_died(void);
+
+// Planner cost of the last decision and the worst so far, in CPU cycles
+uint32_t autopilot_last_cycles(void);
+uint32_t autopilot_max_cycles(void);
+
+// Print the autopilot state, crossings, deaths and planner cost to the
+// serial terminal
+void print_autopilot_stats(void);
+
+#endif /* AUTOPILOT_H_ */
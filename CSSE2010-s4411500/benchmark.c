@@ -0,0 +1,577 @@
+/*
+ * benchmark.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#ifdef BENCHMARK
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <util/delay_basic.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "benchmark.h"
+#include "game.h"
+#include "level.h"
+#include "serialio.h"
+#include "timer0.h"
+#include "pixel_colour.h"
+#include "scrolling_char_display.h"
+#include "ledmatrix.h"
+#include "spi.h"
+#include "framebuffer.h"
+#include "versus.h"
+#include "log.h"
+#include "statebus.h"
+#include "compositor.h"
+#include "motion.h"
+#include "lanegen.h"
+
+// Number of bytes queued for the uart_put_char benchmarks
+#define UART_BENCH_BYTES 8
+
+// Number of events sent by each of the log benchmarks
+#define LOG_BENCH_EVENTS 4
+
+// Length of the windows used to measure interrupt handlers. _delay_loop_2()
+// takes 4 cycles per loop. The TIMER0 window (12000 cycles) always contains
+// exactly one 1ms tick (8000 cycles); the UART window (40000 cycles) is long
+// enough for UART_BENCH_BYTES bytes to be sent at 19200 baud.
+#define TIMER0_WINDOW_LOOPS 3000
+#define UART_WINDOW_LOOPS 10000
+
+// Used to calibrate the cost of a TIMER1 overflow. 80000 cycles - i.e. the
+// count passes 65536 exactly once.
+#define OVERFLOW_WINDOW_LOOPS 20000
+
+typedef void (*BenchFunction)(void);
+
+// Number of times TIMER1 has overflowed during the current measurement
+static volatile uint16_t timer1_overflows;
+
+// Cycles counted when timing an empty function (the cost of the call and
+// reading the timer)
+static uint16_t measure_overhead;
+
+// Cycles taken by the TIMER1 overflow interrupt (entry, handler and return)
+static uint16_t overflow_cost;
+
+// Arguments and results for the benchmarked functions that take them
+static int8_t bench_row;
+static uint8_t bench_result;
+
+// A row's motion and a dividend for the motion benchmarks (volatile so
+// the calls can't be worked out when compiling)
+static RowMotion bench_motion;
+static volatile uint32_t bench_dividend;
+static volatile uint32_t bench_quotient;
+static MatrixRow bench_matrix_row;
+
+static void measure_setup(void);
+static void wait_for_quiet(void);
+static uint32_t time_call(BenchFunction function);
+static uint16_t time_window(uint16_t loops);
+static void report(const char* name, uint32_t cycles);
+static void bench_timer0_isr(const char* name);
+static void bench_uart(void);
+
+ISR(TIMER1_OVF_vect) {
+	timer1_overflows++;
+}
+
+//////////////////////////// Benchmarked functions /////////////////////////////
+// Each of these is called through a function pointer by time_call(). The
+// empty function has the same shape so its cost cancels out the call.
+
+static void __attribute__ ((noinline)) empty_target(void) {
+}
+
+static void bench_empty(void) {
+	empty_target();
+}
+
+static void bench_long_delay(void) {
+	_delay_loop_2(OVERFLOW_WINDOW_LOOPS);
+}
+
+// Drawing only marks rows (see compositor.h) - the benches that draw
+// include sending them, as the play loop does
+static void bench_redraw_whole_display(void) {
+	redraw_whole_display();
+	compositor_update();
+}
+
+static void bench_ledmatrix_update_row(void) {
+	ledmatrix_update_row(1, bench_matrix_row);
+}
+
+static void bench_framebuffer_show_row(void) {
+	framebuffer_show_row(1);
+}
+
+static void bench_palette_swap(void) {
+	framebuffer_set_palette(1, COLOUR_RED);
+	framebuffer_show_all();
+}
+
+// The whole frame until its last byte has been sent. With SPI_USART1
+// (see spi.h) palette_swap is only the time the CPU is held up, and the
+// difference is sent while the program carries on.
+static void bench_frame_sent(void) {
+	framebuffer_show_all();
+	spi_flush();
+}
+
+static void bench_scroll_vehicle_lane(void) {
+	scroll_vehicle_lane(0);
+	compositor_update();
+}
+
+static void bench_scroll_river_channel(void) {
+	scroll_river_channel(0);
+	compositor_update();
+}
+
+static void bench_compositor_update(void) {
+	compositor_update();
+}
+
+static void bench_move_frog_forward(void) {
+	move_frog_forward();
+}
+
+static void bench_move_frog_backward(void) {
+	move_frog_backward();
+}
+
+static void bench_move_frog_to_left(void) {
+	move_frog_to_left();
+}
+
+static void bench_move_frog_to_right(void) {
+	move_frog_to_right();
+}
+
+static void bench_state_dispatch(void) {
+	state_dispatch();
+}
+
+static void bench_move_frog_shown(void) {
+	move_frog_forward();
+	state_dispatch();
+	compositor_update();
+}
+
+static void bench_will_frog_die(void) {
+	bench_result = benchmark_will_frog_die_at_position(bench_row, 7);
+}
+
+static void bench_divider_divide(void) {
+	uint16_t remainder;
+	bench_quotient = divider_divide(&bench_motion.period, bench_dividend, &remainder);
+}
+
+static void bench_motion_steps_at(void) {
+	bench_quotient = motion_steps_at(&bench_motion, bench_dividend);
+}
+
+// Generating a level past the end of the table (see lanegen.h), with
+// the speeds of the last level in it as tools/lanegen_bench.c
+static void bench_lanegen_generate(void) {
+	RowMotion motion[5];
+	uint64_t lanes[3];
+	uint32_t logs[2];
+
+	motion_init(&motion[0], 1500, 1, 0, 1, 1);
+	motion_init(&motion[1], 1350, 1, 0, 1, -1);
+	motion_init(&motion[2], 1050, 1, 0, 1, 1);
+	motion_init(&motion[3], 1150, 1, 0, 1, -1);
+	motion_init(&motion[4], 1400, 1, 0, 1, 1);
+	lanegen_set_seed(0x12345678UL);
+	bench_result = lanegen_generate(6, motion, 0xDDDD, lanes, logs);
+}
+
+static void bench_scroll_display(void) {
+	bench_result = scroll_display();
+}
+
+static void bench_set_scrolling_display_text(void) {
+	set_scrolling_display_text("FROGGER 44115001", COLOUR_GREEN);
+}
+
+static void bench_queue_scrolling_text(void) {
+	bench_result = queue_scrolling_text("LEVEL 10", COLOUR_YELLOW);
+}
+
+static void bench_queue_scrolling_text_P(void) {
+	bench_result = queue_scrolling_text_P(PSTR("+10"), COLOUR_LIGHT_YELLOW);
+}
+
+static void bench_update_scrolling_display(void) {
+	update_scrolling_display(0);
+}
+
+#ifdef VERSUS_ENABLED
+// A rollback of one tick and the deepest rollback allowed
+static void bench_versus_rollback_1(void) {
+	benchmark_versus_rollback(1);
+}
+
+static void bench_versus_rollback_max(void) {
+	benchmark_versus_rollback(VERSUS_MAX_ROLLBACK);
+}
+#endif
+
+#ifdef LOG_ENABLED
+// Send a LANE_STEP event, then the same text through printf_P(), each
+// LOG_BENCH_EVENTS times with interrupts off (as bench_uart_put_char())
+static void bench_log(void) {
+	uint8_t i;
+	cli();
+	for(i = 0; i < LOG_BENCH_EVENTS; i++) {
+		LOG(LANE_STEP, i, 12345);
+	}
+}
+
+static void bench_log_printf(void) {
+	uint8_t i;
+	cli();
+	for(i = 0; i < LOG_BENCH_EVENTS; i++) {
+		printf_P(PSTR("lane %u step %lu\n"), i, 12345UL);
+	}
+}
+#endif
+
+// Queue UART_BENCH_BYTES bytes with interrupts off so that the UART data
+// register empty handler doesn't run inside the measurement. time_call()
+// turns interrupts back on afterwards, which starts the bytes sending.
+static void bench_uart_put_char(void) {
+	uint8_t i;
+	cli();
+	for(i = 0; i < UART_BENCH_BYTES; i++) {
+		benchmark_uart_put_char('.');
+	}
+}
+
+// Queue the same escape sequence (as clear_terminal() and hide_cursor()
+// send) by stdout and straight from flash, interrupts off as above
+static void bench_uart_printf_P(void) {
+	cli();
+	printf_P(PSTR("\x1b[2J\x1b[?25l"));
+}
+
+static void bench_uart_put_P(void) {
+	cli();
+	serial_puts_P("\x1b[2J\x1b[?25l");
+}
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+void run_benchmarks(void) {
+	uint32_t cycles;
+	uint32_t worst;
+
+	measure_setup();
+
+#ifdef LOG_ENABLED
+	// The game's own events would get in the way of the results (the
+	// log is timed on its own below)
+	log_set_enabled(0);
+#endif
+
+	printf_P(PSTR("\n# benchmark begin\n"));
+	report(PSTR("measure_overhead"), measure_overhead);
+	report(PSTR("timer1_overflow"), overflow_cost);
+
+	// Level 1 with the frog at the start
+	init_level();
+	add_level();
+	stop_counting();
+	count_clear();
+	initialise_game();
+
+	report(PSTR("redraw_whole_display"), time_call(bench_redraw_whole_display));
+	// The same row sent from 8 bit colours and from the framebuffer (the
+	// difference is the cost of looking the indices up in the palette),
+	// and a change to the whole screen's colours
+	set_matrix_row_to_colour(bench_matrix_row, COLOUR_LIGHT_GREEN);
+	report(PSTR("ledmatrix_update_row"), time_call(bench_ledmatrix_update_row));
+	report(PSTR("framebuffer_show_row"), time_call(bench_framebuffer_show_row));
+	report(PSTR("palette_swap"), time_call(bench_palette_swap));
+	report(PSTR("frame_sent"), time_call(bench_frame_sent));
+	initialise_game();
+	report(PSTR("scroll_vehicle_lane"), time_call(bench_scroll_vehicle_lane));
+	report(PSTR("scroll_river_channel"), time_call(bench_scroll_river_channel));
+
+	put_frog_in_start_position();
+	report(PSTR("move_frog_forward"), time_call(bench_move_frog_forward));
+	report(PSTR("move_frog_backward"), time_call(bench_move_frog_backward));
+	put_frog_in_start_position();
+	report(PSTR("move_frog_to_left"), time_call(bench_move_frog_to_left));
+	put_frog_in_start_position();
+	report(PSTR("move_frog_to_right"), time_call(bench_move_frog_to_right));
+	put_frog_in_start_position();
+
+	// The moves above only publish the frog (see statebus.h) - the outputs
+	// are updated by the dispatch, which costs next to nothing when none
+	// of them have changed
+	state_dispatch();
+	report(PSTR("state_dispatch_idle"), time_call(bench_state_dispatch));
+	report(PSTR("move_frog_shown"), time_call(bench_move_frog_shown));
+	put_frog_in_start_position();
+	state_dispatch();
+
+	bench_row = 1;
+	report(PSTR("will_frog_die_lane"), time_call(bench_will_frog_die));
+	bench_row = 5;
+	report(PSTR("will_frog_die_log"), time_call(bench_will_frog_die));
+	bench_row = 7;
+	report(PSTR("will_frog_die_riverbank"), time_call(bench_will_frog_die));
+
+	// The divisions behind every lane position (see motion.h), ten minutes
+	// into a level
+	motion_init(&bench_motion, 700, 3, 0, 3, 1);
+	bench_dividend = 600000UL * 3;
+	report(PSTR("divider_divide"), time_call(bench_divider_divide));
+	bench_dividend = 600000UL;
+	report(PSTR("motion_steps_at"), time_call(bench_motion_steps_at));
+	report(PSTR("lanegen_generate"), time_call(bench_lanegen_generate));
+
+	// Working out the columns of the longest message, then the worst
+	// case of one step of a scrolling message on a blank matrix, at the
+	// normal and fastest speeds
+	compositor_clear();
+	report(PSTR("set_scrolling_display_text"),
+			time_call(bench_set_scrolling_display_text));
+	set_scrolling_display_text("FROGGER", COLOUR_GREEN);
+	worst = 0;
+	do {
+		cycles = time_call(bench_scroll_display);
+		if(cycles > worst) {
+			worst = cycles;
+		}
+	} while(bench_result);
+	report(PSTR("scroll_display"), worst);
+	set_scrolling_display_speed(SCROLL_MAX_SPEED);
+	set_scrolling_display_text("FROGGER", COLOUR_GREEN);
+	worst = 0;
+	do {
+		cycles = time_call(bench_scroll_display);
+		if(cycles > worst) {
+			worst = cycles;
+		}
+	} while(bench_result);
+	report(PSTR("scroll_display_fastest"), worst);
+	set_scrolling_display_speed(SCROLL_SPEED_NORMAL);
+
+	// Queuing messages to scroll in the background, and the play loop's
+	// call when there are none
+	report(PSTR("update_scrolling_display_idle"),
+			time_call(bench_update_scrolling_display));
+	report(PSTR("queue_scrolling_text"), time_call(bench_queue_scrolling_text));
+	report(PSTR("queue_scrolling_text_P"), time_call(bench_queue_scrolling_text_P));
+	// (Setting a message empties the queue)
+	set_scrolling_display_text("", COLOUR_GREEN);
+
+	// The same message scrolling over the game (see compositor.h)
+	initialise_game();
+	compositor_update();
+	report(PSTR("compositor_update_idle"), time_call(bench_compositor_update));
+	set_scrolling_display_text("FROGGER", COLOUR_GREEN);
+	worst = 0;
+	do {
+		cycles = time_call(bench_scroll_display);
+		if(cycles > worst) {
+			worst = cycles;
+		}
+	} while(bench_result);
+	report(PSTR("scroll_display_over_game"), worst);
+
+#ifdef VERSUS_ENABLED
+	// Re-simulating the other board's frog (see versus.h). Only in builds
+	// with VERSUS_ENABLED (run_bench.sh -D VERSUS_ENABLED).
+	versus_start(0);
+	report(PSTR("versus_rollback_1"), time_call(bench_versus_rollback_1));
+	report(PSTR("versus_rollback_max"), time_call(bench_versus_rollback_max));
+	versus_finish();
+	initialise_game();
+#endif
+
+	bench_uart();
+
+#ifdef LOG_ENABLED
+	// An event sent by LOG() and the same thing printed (see log.h). Only
+	// in builds with LOG_ENABLED (run_bench.sh -D LOG_ENABLED).
+	log_set_enabled(1);
+	wait_for_quiet();
+	cycles = time_call(bench_log) / LOG_BENCH_EVENTS;
+	log_set_enabled(0);
+	// (The frames go on a line of their own, away from the results)
+	printf_P(PSTR("\n"));
+	report(PSTR("log_event"), cycles);
+	wait_for_quiet();
+	cycles = time_call(bench_log_printf) / LOG_BENCH_EVENTS;
+	report(PSTR("log_event_printf"), cycles);
+#endif
+
+	// The 1ms tick, with and without the seven segment countdown
+	bench_timer0_isr(PSTR("timer0_isr_idle"));
+	count_set(30);
+	start_counting();
+	bench_timer0_isr(PSTR("timer0_isr_counting"));
+	stop_counting();
+	count_clear();
+
+	printf_P(PSTR("# benchmark end\n"));
+
+	// Stop once the results have been sent. (simavr also stops here since
+	// the CPU can never wake up.)
+	wait_for_quiet();
+	cli();
+	sleep_enable();
+	while(1) {
+		sleep_cpu();
+	}
+}
+
+/////////////////////////////// Private Functions //////////////////////////////
+
+// Run TIMER1 at the CPU clock and work out the measurement costs
+static void measure_setup(void) {
+	uint32_t with_interrupt;
+
+	// The 1ms tick is turned off except while it is being measured
+	TIMSK0 &= ~(1<<OCIE0A);
+
+	TCCR1A = 0;
+	TCCR1B = (1<<CS10);
+	TIMSK1 = 0;
+
+	measure_overhead = 0;
+	overflow_cost = 0;
+	measure_overhead = time_call(bench_empty);
+
+	// Time a delay that overflows the timer once, with the overflow
+	// interrupt on and off. The difference is the cost of the interrupt.
+	TIMSK1 = (1<<TOIE1);
+	with_interrupt = time_call(bench_long_delay);
+	TIMSK1 = 0;
+	overflow_cost = with_interrupt - time_call(bench_long_delay);
+	TIMSK1 = (1<<TOIE1);
+}
+
+// Wait for the serial output to finish (the UART data register empty
+// interrupt turns itself off once the buffer is empty), and the LED
+// matrix output
+static void wait_for_quiet(void) {
+	spi_flush();
+	while(UCSR0B & (1<<UDRIE0)) {
+		;
+	}
+}
+
+// Return the number of cycles taken by a call to function. Counts longer
+// than 16 bits are made up from the TIMER1 overflows, less the time taken
+// by the overflow interrupt.
+static uint32_t time_call(BenchFunction function) {
+	uint16_t low;
+	uint32_t cycles;
+
+	wait_for_quiet();
+
+	cli();
+	timer1_overflows = 0;
+	TIFR1 = (1<<TOV1);
+	TCNT1 = 0;
+	sei();
+	function();
+	cli();
+	low = TCNT1;
+	cycles = ((uint32_t)timer1_overflows << 16) + low;
+	cycles -= (uint32_t)timer1_overflows * overflow_cost;
+	if((TIFR1 & (1<<TOV1)) && low < 0x8000) {
+		// Overflowed but the interrupt hasn't run yet (so has cost nothing)
+		cycles += 0x10000;
+	}
+	sei();
+
+	return cycles - measure_overhead;
+}
+
+// Return the number of cycles taken by a busy wait of the given number of
+// loops, including any interrupts that happen during it. The caller sets up
+// which interrupts can happen.
+static uint16_t time_window(uint16_t loops) {
+	uint16_t cycles;
+
+	cli();
+	TCNT1 = 0;
+	sei();
+	_delay_loop_2(loops);
+	cli();
+	cycles = TCNT1;
+	sei();
+
+	return cycles;
+}
+
+static void report(const char* name, uint32_t cycles) {
+	printf_P(PSTR("bench,%S,%lu\n"), name, cycles);
+}
+
+// Report the worst case time taken by the TIMER0 interrupt. The digit
+// shown on the seven segment display changes every 2 ticks so we take the
+// worst of 4.
+static void bench_timer0_isr(const char* name) {
+	uint8_t i;
+	uint16_t with_tick, without_tick;
+	uint16_t worst = 0;
+
+	for(i = 0; i < 4; i++) {
+		wait_for_quiet();
+
+		without_tick = time_window(TIMER0_WINDOW_LOOPS);
+
+		cli();
+		TCNT0 = 0;
+		TIFR0 = (1<<OCF0A);
+		TIMSK0 |= (1<<OCIE0A);
+		sei();
+		with_tick = time_window(TIMER0_WINDOW_LOOPS);
+		TIMSK0 &= ~(1<<OCIE0A);
+
+		if(with_tick - without_tick > worst) {
+			worst = with_tick - without_tick;
+		}
+	}
+	report(name, worst);
+}
+
+// Report the cost of queueing a byte for output and the cost per byte
+// of the interrupt handler which sends it (including the share of the
+// final interrupt that finds the buffer empty and turns itself off)
+static void bench_uart(void) {
+	uint16_t with_output, without_output;
+
+	report(PSTR("uart_put_char"),
+			time_call(bench_uart_put_char) / UART_BENCH_BYTES);
+
+	wait_for_quiet();
+	without_output = time_window(UART_WINDOW_LOOPS);
+	cli();
+	bench_uart_put_char();
+	with_output = time_window(UART_WINDOW_LOOPS);
+	report(PSTR("uart_udre_isr"),
+			(with_output - without_output) / UART_BENCH_BYTES);
+
+	wait_for_quiet();
+	report(PSTR("uart_printf_P"), time_call(bench_uart_printf_P));
+	wait_for_quiet();
+	report(PSTR("uart_put_P"), time_call(bench_uart_put_P));
+}
+
+#endif /* BENCHMARK */
@@ -0,0 +1,32 @@
+/*
+ * benchmark.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Cycle counting benchmarks for the time critical game functions. This
+ * module is only compiled into the firmware when BENCHMARK is defined
+ * (see tools/bench/run_bench.sh). The benchmark build runs every
+ * benchmark once at start-up instead of the game and prints one line
+ * per benchmark to the serial port:
+ *
+ *     bench,<name>,<cycles>
+ *
+ * between a "# benchmark begin" and a "# benchmark end" line. Cycles are
+ * counted with TIMER1 running at the CPU clock, with the cost of the
+ * measurement itself subtracted, so they are exact when run under
+ * simavr (tools/bench/simavr_bench.c).
+ */
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#ifdef BENCHMARK
+
+// Run all the benchmarks and report the results. Never returns.
+// Must be called after the hardware has been initialised with interrupts
+// enabled. TIMER1 is taken over (so the autopilot can't be used).
+void run_benchmarks(void);
+
+#endif /* BENCHMARK */
+
+#endif /* BENCHMARK_H_ */
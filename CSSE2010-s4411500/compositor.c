@@ -0,0 +1,211 @@
+/*
+ * compositor.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "compositor.h"
+#include "framebuffer.h"
+#include "ledmatrix.h"
+
+// SPI bytes to shift the matrix a column and send the new column, and to
+// send a row or a pixel (see ledmatrix.c)
+#define SHIFT_COLUMN_BYTES (2 + 2 + MATRIX_NUM_ROWS)
+#define ROW_COMMAND_BYTES (2 + MATRIX_NUM_COLUMNS)
+#define PIXEL_COMMAND_BYTES 3
+
+typedef struct {
+	uint16_t columns;	// 0 if hidden
+	uint8_t y;
+	uint8_t index;
+} Sprite;
+
+// The scenery and lanes layers (see compositor.h)
+static MatrixPackedData background;
+static Sprite sprites[COMPOSITOR_SPRITES];
+// The text layer - a bit a column (bit 0 is column 0) for each row
+static uint16_t text[MATRIX_NUM_ROWS];
+
+// Rows changed since the last update (bit y for row y), and those to be
+// sent in full (their colours have changed but not their indices)
+static uint8_t dirty_rows;
+static uint8_t resend_rows;
+
+// Set while nothing has been drawn in the background since it was cleared
+static uint8_t background_empty;
+
+static void compose_row(uint8_t y, uint8_t* row);
+static void put_columns(uint8_t* row, uint16_t columns, uint8_t index);
+static uint8_t only_text_shown(void);
+static uint8_t text_rows(void);
+static uint8_t bits_set(uint16_t bits);
+
+void compositor_clear(void) {
+	memset(background, 0, sizeof(background));
+	memset(sprites, 0, sizeof(sprites));
+	memset(text, 0, sizeof(text));
+	dirty_rows = 0;
+	resend_rows = 0;
+	background_empty = 1;
+	framebuffer_clear();
+	ledmatrix_clear();
+}
+
+uint8_t* compositor_background_row(uint8_t y) {
+	return background[y];
+}
+
+void compositor_mark_row(uint8_t y) {
+	dirty_rows |= (1 << y);
+	background_empty = 0;
+}
+
+void compositor_set_sprite(uint8_t sprite, uint8_t y, uint16_t columns, uint8_t index) {
+	Sprite* s = &sprites[sprite];
+
+	if(s->columns == columns && s->y == y && s->index == index) {
+		return;
+	}
+	if(s->columns) {
+		dirty_rows |= (1 << s->y);
+	}
+	if(columns) {
+		dirty_rows |= (1 << y);
+	}
+	s->columns = columns;
+	s->y = y;
+	s->index = index;
+}
+
+void compositor_hide_sprite(uint8_t sprite) {
+	compositor_set_sprite(sprite, sprites[sprite].y, 0, sprites[sprite].index);
+}
+
+void compositor_set_text_colour(PixelColour colour) {
+	if(framebuffer_get_palette(COMPOSITOR_TEXT_INDEX) != colour) {
+		framebuffer_set_palette(COMPOSITOR_TEXT_INDEX, colour);
+		dirty_rows |= text_rows();
+		resend_rows |= text_rows();
+	}
+}
+
+void compositor_scroll_text(const uint8_t* columns, uint8_t count) {
+	uint8_t changed = text_rows();
+	uint16_t before;
+	uint16_t row;
+	uint16_t row_bytes;
+	uint16_t resend_bytes = 0;
+
+	for(uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+		before = text[y];
+		row = before;
+		for(uint8_t i = 0; i < count; i++) {
+			row = (row >> 1) | ((uint16_t)((columns[i] >> y) & 1) << 15);
+		}
+		text[y] = row;
+		// What compositor_update() would send for the row if nothing but
+		// the text is shown (as framebuffer_update_row())
+		row_bytes = bits_set(before ^ row) * PIXEL_COMMAND_BYTES;
+		resend_bytes += (row_bytes < ROW_COMMAND_BYTES) ? row_bytes : ROW_COMMAND_BYTES;
+	}
+	changed |= text_rows();
+
+	if(only_text_shown() && count * SHIFT_COLUMN_BYTES < resend_bytes) {
+		// The matrix can shift what it shows itself - then only the new
+		// columns are sent. The frame is made to match.
+		MatrixColumn colours;
+		PixelColour colour = framebuffer_get_palette(COMPOSITOR_TEXT_INDEX);
+		for(uint8_t i = 0; i < count; i++) {
+			for(uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+				colours[y] = ((columns[i] >> y) & 1) ? colour : COLOUR_BLACK;
+			}
+			ledmatrix_shift_display_left();
+			ledmatrix_update_column(MATRIX_NUM_COLUMNS - 1, colours);
+		}
+		for(uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+			compose_row(y, framebuffer_row(y));
+		}
+	} else {
+		dirty_rows |= changed;
+	}
+}
+
+void compositor_clear_text(void) {
+	dirty_rows |= text_rows();
+	memset(text, 0, sizeof(text));
+}
+
+void compositor_update(void) {
+	MatrixPackedRow row;
+
+	for(uint8_t y = 0; dirty_rows; y++, dirty_rows >>= 1, resend_rows >>= 1) {
+		if(!(dirty_rows & 1)) {
+			continue;
+		}
+		compose_row(y, row);
+		if(resend_rows & 1) {
+			memcpy(framebuffer_row(y), row, sizeof(row));
+			framebuffer_show_row(y);
+		} else {
+			framebuffer_update_row(y, row);
+		}
+	}
+	resend_rows = 0;
+}
+
+// Combine the layers for a row into row
+static void compose_row(uint8_t y, uint8_t* row) {
+	memcpy(row, background[y], MATRIX_PACKED_ROW_BYTES);
+	for(int8_t sprite = COMPOSITOR_SPRITES - 1; sprite >= 0; sprite--) {
+		if(sprites[sprite].columns && sprites[sprite].y == y) {
+			put_columns(row, sprites[sprite].columns, sprites[sprite].index);
+		}
+	}
+	put_columns(row, text[y], COMPOSITOR_TEXT_INDEX);
+}
+
+static void put_columns(uint8_t* row, uint16_t columns, uint8_t index) {
+	for(uint8_t x = 0; columns; x++, columns >>= 1) {
+		if(columns & 1) {
+			framebuffer_put(row, x, index);
+		}
+	}
+}
+
+// Whether the matrix shows nothing but the text (and nothing is waiting
+// to be sent)
+static uint8_t only_text_shown(void) {
+	if(!background_empty || dirty_rows) {
+		return 0;
+	}
+	for(uint8_t sprite = 0; sprite < COMPOSITOR_SPRITES; sprite++) {
+		if(sprites[sprite].columns) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static uint8_t bits_set(uint16_t bits) {
+	uint8_t count = 0;
+
+	for(; bits; bits &= bits - 1) {
+		count++;
+	}
+	return count;
+}
+
+// The rows with any text in them (bit y for row y)
+static uint8_t text_rows(void) {
+	uint8_t rows = 0;
+
+	for(uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+		if(text[y]) {
+			rows |= (1 << y);
+		}
+	}
+	return rows;
+}
@@ -0,0 +1,74 @@
+/*
+ * compositor.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * The LED matrix is made up of layers, from the bottom:
+ *
+ *     scenery       the roadside rows and the riverbank (game.c)
+ *     lanes         the traffic lanes and river channels (game.c)
+ *     sprites       the frog, a dead frog, the versus ghost and the frogs
+ *                   home in the riverbank (game.c)
+ *     text          a scrolling message (scrolling_char_display.c)
+ *
+ * The scenery and the lanes are never on the same row, so they share one
+ * background of palette indices (see framebuffer.h) - each row is drawn
+ * by the layer it belongs to. A sprite is a set of pixels in one row in
+ * one palette index; lower numbered sprites are on top. The text is a
+ * bit a pixel, shown in COMPOSITOR_TEXT_INDEX where it is set and
+ * transparent elsewhere, so a message can scroll over a running game.
+ *
+ * Drawing only marks the rows changed. compositor_update() combines the
+ * layers for those rows and hands them to framebuffer_update_row(), which
+ * sends only what differs from the matrix. So a row changed by several
+ * layers between updates is sent once, and nothing is sent for a row that
+ * comes out the same.
+ */
+
+#ifndef COMPOSITOR_H_
+#define COMPOSITOR_H_
+
+#include <stdint.h>
+#include "ledmatrix.h"
+#include "pixel_colour.h"
+
+// Sprites (in the order they are drawn over each other - lowest on top)
+#define SPRITE_FROG			0
+#define SPRITE_DEAD_FROG	1
+#define SPRITE_GHOST		2
+#define SPRITE_HOME_FROGS	3
+#define COMPOSITOR_SPRITES	4
+
+// Palette index of the text (the other indices belong to the game)
+#define COMPOSITOR_TEXT_INDEX 15
+
+// Empty every layer and clear the matrix
+void compositor_clear(void);
+
+// The background row y (of the scenery or lanes layer, see above) to draw
+// into, and mark it changed after drawing
+uint8_t* compositor_background_row(uint8_t y);
+void compositor_mark_row(uint8_t y);
+
+// Show a sprite in the given row at the columns set in columns (bit 0 is
+// column 0), or hide it. Only rows it leaves or enters are marked changed.
+void compositor_set_sprite(uint8_t sprite, uint8_t y, uint16_t columns, uint8_t index);
+void compositor_hide_sprite(uint8_t sprite);
+
+// Set the colour of the text. If text is showing it is sent again in the
+// new colour.
+void compositor_set_text_colour(PixelColour colour);
+
+// Move the text count columns to the left and put the given columns in
+// at the right, leftmost first (bit 7 is row 7, bit 0 row 0). While the
+// other layers are empty the matrix is shifted a column at a time if
+// that is fewer bytes than sending the changed rows again.
+void compositor_scroll_text(const uint8_t* columns, uint8_t count);
+
+// Remove the text
+void compositor_clear_text(void);
+
+// Send the changed rows to the matrix
+void compositor_update(void);
+
+#endif /* COMPOSITOR_H_ */
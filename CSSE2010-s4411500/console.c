@@ -0,0 +1,320 @@
+/*
+ * console.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "console.h"
+#include "terminalio.h"
+#include "serialio.h"
+#include "spi.h"
+#include "game.h"
+#include "timer0.h"
+#include "log.h"
+#include "scrolling_char_display.h"
+
+// Where the console is shown on the terminal - the command line, then the
+// results below it
+#define CONSOLE_X 10
+#define CONSOLE_Y 18
+
+#define NAME_SIZE 10		// including the terminating 0
+#define MAX_VALUE_DIGITS 9
+
+#define BACKSPACE 0x08
+#define DELETE 0x7F
+
+// A counter or tunable. get and set are passed index (e.g. the row of a
+// lane period). set is NULL for counters.
+typedef struct {
+	char name[NAME_SIZE];
+	uint32_t (*get)(uint8_t index);
+	void (*set)(uint8_t index, uint32_t setting);
+	uint8_t index;
+	uint16_t min;
+	uint16_t max;
+} ConsoleEntry;
+
+static uint32_t get_loops(uint8_t index);
+static uint32_t get_spi_bytes(uint8_t index);
+static uint32_t get_overruns(uint8_t index);
+static uint32_t get_missed(uint8_t index);
+static uint32_t get_spi_divider(uint8_t index);
+static void set_spi_divider(uint8_t index, uint32_t setting);
+static uint32_t get_period(uint8_t index);
+static void set_period(uint8_t index, uint32_t setting);
+static uint32_t get_time(uint8_t index);
+static void set_time(uint8_t index, uint32_t setting);
+static uint32_t get_scroll(uint8_t index);
+static void set_scroll(uint8_t index, uint32_t setting);
+#ifdef LOG_ENABLED
+static uint32_t get_log_dropped(uint8_t index);
+static uint32_t get_log(uint8_t index);
+static void set_log(uint8_t index, uint32_t setting);
+#endif
+
+static const ConsoleEntry entries[] PROGMEM = {
+	{"loops", get_loops, NULL, 0, 0, 0},
+	{"spi_tx", get_spi_bytes, NULL, 0, 0, 0},
+	{"overrun", get_overruns, NULL, 0, 0, 0},
+	{"missed", get_missed, NULL, 0, 0, 0},
+	{"spi_div", get_spi_divider, set_spi_divider, 0, 2, 128},
+	{"lane1", get_period, set_period, 0, 0, UINT16_MAX},
+	{"lane2", get_period, set_period, 1, 0, UINT16_MAX},
+	{"lane3", get_period, set_period, 2, 0, UINT16_MAX},
+	{"log1", get_period, set_period, 3, 0, UINT16_MAX},
+	{"log2", get_period, set_period, 4, 0, UINT16_MAX},
+	{"time", get_time, set_time, 0, 1, 32},
+	{"scroll", get_scroll, set_scroll, 0, 1, SCROLL_MAX_SPEED},
+#ifdef LOG_ENABLED
+	{"log_drop", get_log_dropped, NULL, 0, 0, 0},
+	{"log", get_log, set_log, 0, 0, 1},
+#endif
+};
+#define NUM_ENTRIES (sizeof(entries) / sizeof(entries[0]))
+
+// The command line so far - a name, then (after '=' or a space) a value
+static uint8_t console_open;
+static char name[NAME_SIZE];
+static uint8_t name_length;
+static uint8_t has_value;
+static uint32_t value;
+static uint8_t value_digits;
+static uint8_t bad_line;
+
+// Loop passes since the loops counter was last read, and when that was
+static uint32_t loops;
+static uint32_t loops_time;
+
+static void run_line(void);
+static void show_line(void);
+static void show_entry(const ConsoleEntry* entry, uint8_t y);
+static void clear_results(void);
+static void start_line(void);
+
+uint8_t console_input(char c) {
+	if(c == CONSOLE_KEY) {
+		console_open = !console_open;
+		if(console_open) {
+			loops = 0;
+			loops_time = get_current_time();
+			start_line();
+			show_line();
+		} else {
+			move_cursor(CONSOLE_X, CONSOLE_Y);
+			clear_to_end_of_line();
+			clear_results();
+		}
+		return 1;
+	}
+	if(!console_open) {
+		return 0;
+	}
+
+	if(c == '\n') {
+		run_line();
+		start_line();
+	} else if(c == BACKSPACE || c == DELETE) {
+		if(value_digits) {
+			value /= 10;
+			value_digits--;
+		} else if(has_value) {
+			has_value = 0;
+		} else if(name_length) {
+			name[--name_length] = 0;
+		}
+		bad_line = 0;
+	} else if(!has_value && (c == '=' || c == ' ')) {
+		has_value = 1;
+	} else if(!has_value && name_length < NAME_SIZE - 1 &&
+			((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_')) {
+		name[name_length++] = c;
+	} else if(!has_value && name_length < NAME_SIZE - 1 && c >= 'A' && c <= 'Z') {
+		name[name_length++] = c - 'A' + 'a';
+	} else if(has_value && c >= '0' && c <= '9' && value_digits < MAX_VALUE_DIGITS) {
+		value = value * 10 + (c - '0');
+		value_digits++;
+	} else {
+		bad_line = 1;
+	}
+	if(console_open) {
+		show_line();
+	}
+	return 1;
+}
+
+void console_count_loop(void) {
+	loops++;
+}
+
+// Run the command on the line
+static void run_line(void) {
+	ConsoleEntry entry;
+	uint8_t i;
+
+	clear_results();
+	move_cursor(CONSOLE_X, CONSOLE_Y + 1);
+	if(bad_line) {
+		printf_P(PSTR("bad command"));
+		return;
+	}
+	if(!name_length) {
+		return;
+	}
+	if(!has_value && strcmp_P(name, PSTR("ls")) == 0) {
+		for(i = 0; i < NUM_ENTRIES; i++) {
+			memcpy_P(&entry, &entries[i], sizeof(entry));
+			show_entry(&entry, CONSOLE_Y + 1 + i);
+		}
+		return;
+	}
+	if(!has_value && strcmp_P(name, PSTR("q")) == 0) {
+		console_open = 0;
+		move_cursor(CONSOLE_X, CONSOLE_Y);
+		clear_to_end_of_line();
+		return;
+	}
+	for(i = 0; i < NUM_ENTRIES; i++) {
+		memcpy_P(&entry, &entries[i], sizeof(entry));
+		if(strcmp(name, entry.name) == 0) {
+			if(has_value) {
+				if(!entry.set) {
+					printf_P(PSTR("%s can't be changed"), name);
+					return;
+				}
+				if(!value_digits || value < entry.min || value > entry.max) {
+					printf_P(PSTR("%s must be %u to %u"), name, entry.min, entry.max);
+					return;
+				}
+				entry.set(entry.index, value);
+			}
+			show_entry(&entry, CONSOLE_Y + 1);
+			return;
+		}
+	}
+	printf_P(PSTR("no such name"));
+}
+
+static void start_line(void) {
+	memset(name, 0, sizeof(name));
+	name_length = 0;
+	has_value = 0;
+	value = 0;
+	value_digits = 0;
+	bad_line = 0;
+}
+
+// Show the command line as typed so far (the game moves the cursor
+// between characters, so the whole line is shown each time)
+static void show_line(void) {
+	move_cursor(CONSOLE_X, CONSOLE_Y);
+	printf_P(PSTR("> %s"), name);
+	if(has_value) {
+		putchar('=');
+		if(value_digits) {
+			printf_P(PSTR("%lu"), value);
+		}
+	}
+	clear_to_end_of_line();
+}
+
+static void show_entry(const ConsoleEntry* entry, uint8_t y) {
+	move_cursor(CONSOLE_X, y);
+	printf_P(PSTR("%-9s%10lu"), entry->name, entry->get(entry->index));
+	if(!entry->set) {
+		printf_P(PSTR(" (counter)"));
+	}
+	clear_to_end_of_line();
+}
+
+// Clear the lines below the command line that the results can take
+static void clear_results(void) {
+	for(uint8_t y = CONSOLE_Y + 1; y <= CONSOLE_Y + NUM_ENTRIES; y++) {
+		move_cursor(CONSOLE_X, y);
+		clear_to_end_of_line();
+	}
+}
+
+///////////////////////////// Counters and tunables ////////////////////////////
+
+static uint32_t get_loops(uint8_t index) {
+	uint32_t now = get_current_time();
+	uint32_t rate = 0;
+
+	if(now != loops_time) {
+		if(loops < UINT32_MAX / 1000) {
+			rate = loops * 1000 / (now - loops_time);
+		} else {
+			rate = loops / (now - loops_time) * 1000;
+		}
+	}
+	loops = 0;
+	loops_time = now;
+	return rate;
+}
+
+static uint32_t get_spi_bytes(uint8_t index) {
+	return spi_bytes_sent();
+}
+
+static uint32_t get_overruns(uint8_t index) {
+	return serial_input_overruns();
+}
+
+static uint32_t get_missed(uint8_t index) {
+	return get_missed_scrolls();
+}
+
+static uint32_t get_spi_divider(uint8_t index) {
+	return spi_clock_divider();
+}
+
+// (A divider that isn't a power of two gives the slowest, 128)
+static void set_spi_divider(uint8_t index, uint32_t setting) {
+	spi_setup_master(setting);
+}
+
+static uint32_t get_period(uint8_t index) {
+	return get_row_period(index);
+}
+
+static void set_period(uint8_t index, uint32_t setting) {
+	set_row_period(index, setting);
+}
+
+static uint32_t get_time(uint8_t index) {
+	return get_init_time();
+}
+
+static void set_time(uint8_t index, uint32_t setting) {
+	set_init_time(setting);
+}
+
+// Columns scrolled at a time by the LED matrix messages
+static uint32_t get_scroll(uint8_t index) {
+	return get_scrolling_display_speed();
+}
+
+static void set_scroll(uint8_t index, uint32_t setting) {
+	set_scrolling_display_speed(setting);
+}
+
+#ifdef LOG_ENABLED
+static uint32_t get_log_dropped(uint8_t index) {
+	return log_dropped();
+}
+
+static uint32_t get_log(uint8_t index) {
+	return log_is_enabled();
+}
+
+static void set_log(uint8_t index, uint32_t setting) {
+	log_set_enabled(setting);
+}
+#endif
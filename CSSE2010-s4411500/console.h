@@ -0,0 +1,59 @@
+/*
+ * console.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Command console on the serial terminal, for looking at and changing a
+ * running game. CONSOLE_KEY (Ctrl-]) opens it and closes it again. While
+ * it's open the serial characters go to the console instead of the game,
+ * which carries on (the buttons and joystick still play it). Commands are
+ * typed on a line and run by return:
+ *     ls              list every counter and tunable with its value
+ *     name            show one
+ *     name=value      change a tunable (or "name value")
+ *     q               close the console
+ *
+ * The counters and tunables are a table in flash (see console.c):
+ *     loops    passes of the play loop per second since it was last read
+ *     spi_tx   bytes sent to the LED matrix
+ *     overrun  serial characters lost to a full input buffer
+ *     missed   lane and log steps never shown (see get_missed_scrolls())
+ *     spi_div  SPI clock divider (2 to 128, a power of two)
+ *     lane1-3, log1-2
+ *              period (ms) of each row - 0 goes back to each level's own
+ *              (see set_row_period())
+ *     time     seconds each frog has to cross (1 to 32)
+ *     scroll   columns the LED matrix messages scroll at a time (1 to 4,
+ *              see set_scrolling_display_speed())
+ * and in LOG_ENABLED builds (see log.h):
+ *     log_drop log frames thrown away because the output buffer was full
+ *     log      1 to send log frames, 0 not to
+ *
+ * Each character is parsed as it arrives, without stdio, and nothing runs
+ * while the console is closed other than a comparison for each serial
+ * character and console_count_loop().
+ */
+
+#ifndef CONSOLE_H_
+#define CONSOLE_H_
+
+#include <stdint.h>
+
+// Ctrl-] (as telnet) - clear of the game's keys and of ESC, which starts
+// the cursor key sequences
+#define CONSOLE_KEY 0x1D
+
+// Give a serial character to the console. Returns 1 if the console took
+// it (so the game should ignore it) - i.e. the console is open or the
+// character is CONSOLE_KEY.
+uint8_t console_input(char c);
+
+// Count a pass of the play loop (for the loops counter)
+void console_count_loop(void);
+
+// Kept by project.c (which has no header of its own) - the seconds of
+// countdown each frog starts with
+uint8_t get_init_time(void);
+void set_init_time(uint8_t seconds);
+
+#endif /* CONSOLE_H_ */
@@ -0,0 +1,88 @@
+/*
+ * eewriter.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+
+#include "eewriter.h"
+
+static EewriterFill fill_functions[EEWRITER_CLIENTS];
+
+// Bit for each module with a save waiting
+static volatile uint8_t pending;
+
+// Block being written by the EEPROM ready interrupt, the EEPROM address it
+// is going to, its length and the next byte to be written
+static uint8_t write_buffer[EEWRITER_MAX_BLOCK];
+static uint16_t write_address;
+static uint8_t write_size;
+static uint8_t write_index;
+
+static uint8_t start_next_block(void);
+
+void eewriter_register(uint8_t client, EewriterFill fill) {
+	fill_functions[client] = fill;
+}
+
+void eewriter_request(uint8_t client) {
+	uint8_t interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	pending |= (1<<client);
+	if(!(EECR & (1<<EERIE)) && start_next_block()) {
+		EECR |= (1<<EERIE);
+	}
+	if(interrupts_on) {
+		sei();
+	}
+}
+
+uint8_t eewriter_busy(void) {
+	return (EECR & (1<<EERIE)) != 0;
+}
+
+// Take the block of the first module with a save waiting. Return 0 if
+// there are none. Called with interrupts off.
+static uint8_t start_next_block(void) {
+	uint8_t client;
+
+	for(client = 0; client < EEWRITER_CLIENTS; client++) {
+		if(pending & (1<<client)) {
+			pending &= ~(1<<client);
+			write_address = fill_functions[client](write_buffer, &write_size);
+			write_index = 0;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// The EEPROM is ready for the next byte
+ISR(EE_READY_vect) {
+	// Skip bytes which already hold the right value, moving on to the next
+	// block if this one is finished
+	while(1) {
+		while(write_index < write_size) {
+			EEAR = write_address + write_index;
+			EECR |= (1<<EERE);
+			if(EEDR != write_buffer[write_index]) {
+				// Start writing the byte (EEPE must be set within 4
+				// cycles of EEMPE, which is why this is done with
+				// interrupts off)
+				EEDR = write_buffer[write_index++];
+				EECR |= (1<<EEMPE);
+				EECR |= (1<<EEPE);
+				return;
+			}
+			write_index++;
+		}
+		if(!start_next_block()) {
+			// All done
+			EECR &= ~(1<<EERIE);
+			return;
+		}
+	}
+}
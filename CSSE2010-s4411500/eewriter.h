@@ -0,0 +1,47 @@
+/*
+ * eewriter.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Background EEPROM writer shared by the modules which save to EEPROM
+ * (see hiscore.h and snapshot.h). A module asks for a save with
+ * eewriter_request(). When the writer is free it calls the module's fill
+ * function (with interrupts off) to copy the block to be saved into the
+ * writer's buffer and give its EEPROM address. The block is then written
+ * one byte at a time from the EEPROM ready interrupt, so the 3.4ms each
+ * byte takes happens while the game carries on. Bytes which already hold
+ * the right value aren't rewritten.
+ *
+ * Since the block is only copied when the writer gets to it, a request
+ * made while an earlier one from the same module is still waiting just
+ * saves the latest data.
+ */
+
+#ifndef EEWRITER_H_
+#define EEWRITER_H_
+
+#include <stdint.h>
+
+// Modules which save to EEPROM
+#define EEWRITER_HISCORE 0
+#define EEWRITER_SNAPSHOT 1
+#define EEWRITER_CLIENTS 2
+
+// Largest block which can be saved
+#define EEWRITER_MAX_BLOCK 48
+
+// Copy the block to be saved into buffer (at most EEWRITER_MAX_BLOCK
+// bytes), set size to its length and return its EEPROM address. Called
+// with interrupts off.
+typedef uint16_t (*EewriterFill)(uint8_t* buffer, uint8_t* size);
+
+// Set the fill function of a module
+void eewriter_register(uint8_t client, EewriterFill fill);
+
+// Ask for the module's block to be saved
+void eewriter_request(uint8_t client);
+
+// Return 1 if anything is still being written or waiting to be
+uint8_t eewriter_busy(void);
+
+#endif /* EEWRITER_H_ */
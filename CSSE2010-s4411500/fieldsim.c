@@ -0,0 +1,162 @@
+/*
+ * fieldsim.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include <stdint.h>
+
+#include "fieldsim.h"
+
+// Rows on the display of each moving row
+#define FIRST_VEHICLE_ROW 1
+#define FIRST_RIVER_ROW 5
+#define RIVERBANK_ROW 7
+
+static uint8_t display_row(uint8_t index) {
+	return (index < 3) ? index + FIRST_VEHICLE_ROW : index - 3 + FIRST_RIVER_ROW;
+}
+
+// The 16 visible columns of a row (bit 0 = column 0). Patterns narrower
+// than the display repeat across it.
+static uint16_t visible_window(const PredictedRow* row) {
+	if(row->width >= 16) {
+		return (uint16_t)row->pattern;
+	}
+	uint32_t window = (uint16_t)row->pattern;
+	for(uint8_t filled = row->width; filled < 16; filled <<= 1) {
+		window |= window << filled;
+	}
+	return (uint16_t)window;
+}
+
+// Move the row one column in its direction of travel. Moving right means
+// the pattern bit in the last column comes around to column 0.
+static void rotate_row(PredictedRow* row) {
+	if(row->motion.direction > 0) {
+		uint8_t carry = (row->pattern & row->top_bit) != 0;
+		row->pattern = (row->pattern & ~row->top_bit) << 1;
+		if(carry) {
+			row->pattern |= 1;
+		}
+	} else {
+		uint8_t carry = row->pattern & 1;
+		row->pattern >>= 1;
+		if(carry) {
+			row->pattern |= row->top_bit;
+		}
+	}
+}
+
+void fieldsim_init_row(FieldSim* sim, uint8_t index, uint64_t pattern, uint8_t width,
+		uint8_t position, const RowMotion* motion, uint32_t time, uint32_t steps) {
+	PredictedRow* row = &sim->rows[index];
+	row->width = width;
+	row->top_bit = (uint64_t)1 << (width - 1);
+	row->motion = *motion;
+	row->time = time;
+	row->steps = steps;
+	row->next_step_time = motion_step_time(motion, steps + 1);
+	if(position) {
+		pattern = (pattern >> position) | (pattern << (width - position));
+	}
+	row->pattern = pattern & (row->top_bit | (row->top_bit - 1));
+}
+
+uint16_t fieldsim_safe_columns(const FieldSim* sim, uint8_t row) {
+	switch(row) {
+		case 0:
+		case 4:
+			return FIELD_ALL_COLUMNS;
+		case 1:
+		case 2:
+		case 3:
+			return ~visible_window(&sim->rows[row - FIRST_VEHICLE_ROW]);
+		case 5:
+		case 6:
+			return visible_window(&sim->rows[row - FIRST_RIVER_ROW + 3]);
+		case 7:
+			return ~sim->riverbank_status;
+	}
+	return 0;
+}
+
+void fieldsim_safe_rows(const FieldSim* sim, Reach safe) {
+	for(uint8_t row = 0; row < FIELD_ROWS; row++) {
+		safe[row] = fieldsim_safe_columns(sim, row);
+	}
+}
+
+void fieldsim_expand(const Reach safe, Reach reach) {
+	uint16_t below = 0;
+	for(uint8_t row = 0; row < FIELD_ROWS; row++) {
+		uint16_t here = reach[row];
+		uint16_t moves = here | (here << 1) | (here >> 1) | below;
+		// A frog in the riverbank has left the game so can't move back down
+		if(row + 1 < RIVERBANK_ROW) {
+			moves |= reach[row + 1];
+		}
+		below = here;
+		reach[row] = moves & safe[row];
+	}
+}
+
+void fieldsim_advance(FieldSim* sim, uint16_t elapsed, Reach* reaches, uint8_t count) {
+	for(uint8_t index = 0; index < FIELD_MOVING_ROWS; index++) {
+		PredictedRow* row = &sim->rows[index];
+		uint8_t y = display_row(index);
+		
+		row->time += elapsed;
+		while(row->next_step_time <= row->time) {
+			row->steps++;
+			row->next_step_time = motion_step_time(&row->motion, row->steps + 1);
+			rotate_row(row);
+			if(index < 3) {
+				// Vehicles run over any frog in their way
+				uint16_t road = ~visible_window(row);
+				for(uint8_t i = 0; i < count; i++) {
+					reaches[i][y] &= road;
+				}
+			} else {
+				// Frogs ride the log, falling off the edge of the field
+				for(uint8_t i = 0; i < count; i++) {
+					if(row->motion.direction > 0) {
+						reaches[i][y] <<= 1;
+					} else {
+						reaches[i][y] >>= 1;
+					}
+				}
+			}
+		}
+	}
+}
+
+uint16_t fieldsim_reachable_holes(FieldSim* sim, uint8_t row, uint8_t column,
+		uint16_t step_ms, uint8_t steps) {
+	Reach reach = { 0 };
+	Reach safe;
+	uint16_t holes = 0;
+	uint16_t all_holes = ~sim->riverbank_status;
+	
+	reach[row] = 1 << column;
+	while(steps--) {
+		fieldsim_safe_rows(sim, safe);
+		fieldsim_expand(safe, reach);
+		holes |= reach[RIVERBANK_ROW];
+		reach[RIVERBANK_ROW] = 0;
+		if(holes == all_holes) {
+			break;
+		}
+		fieldsim_advance(sim, step_ms, &reach, 1);
+		
+		uint16_t anywhere = 0;
+		for(uint8_t y = 0; y < RIVERBANK_ROW; y++) {
+			anywhere |= reach[y];
+		}
+		if(!anywhere) {
+			// Every possible frog has died
+			break;
+		}
+	}
+	return holes;
+}
@@ -0,0 +1,77 @@
+/*
+ * fieldsim.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Prediction of the game field over time, used to check that a level can
+ * be crossed. Each moving row keeps its own copy of the lane pattern,
+ * rotated so that bit 0 is the pattern bit currently in column 0, its own
+ * copy of the row's motion (see motion.h) and its own count of time and
+ * steps, so predicting the field does not disturb the game.
+ *
+ * The places the frog could be are kept as a bit set of columns for each
+ * row (a Reach). fieldsim_expand() lets the frog make one move and
+ * fieldsim_advance() lets time pass for one or more reach sets at once - vehicles which move onto a possible
+ * frog position remove it and frogs on logs are carried along (or off the
+ * edge). Sweeping these over time gives every (row, column, time) the frog
+ * can reach using 16 bytes of RAM for the reach sets.
+ */
+
+#ifndef FIELDSIM_H_
+#define FIELDSIM_H_
+
+#include <stdint.h>
+#include "motion.h"
+
+#define FIELD_ROWS 8
+#define FIELD_MOVING_ROWS 5		// lanes 0-2 (rows 1-3) then channels 0-1 (rows 5-6)
+#define FIELD_ALL_COLUMNS 0xFFFF
+
+typedef uint16_t Reach[FIELD_ROWS];
+
+typedef struct {
+	uint64_t pattern;	// rotated so bit 0 is in column 0
+	uint64_t top_bit;	// bit (width - 1)
+	RowMotion motion;
+	uint32_t time;		// ms since the start of the level
+	uint32_t steps;		// steps made
+	uint32_t next_step_time;
+	uint8_t width;
+} PredictedRow;
+
+typedef struct {
+	PredictedRow rows[FIELD_MOVING_ROWS];
+	// Bit set where the riverbank (row 7) is an edge or an occupied hole
+	uint16_t riverbank_status;
+} FieldSim;
+
+// Set up moving row number index (0 to 4) of the prediction. position is
+// the bit of the pattern currently in column 0 (as in game.c), time the ms
+// since the start of the level and steps the number the row has made.
+void fieldsim_init_row(FieldSim* sim, uint8_t index, uint64_t pattern, uint8_t width,
+		uint8_t position, const RowMotion* motion, uint32_t time, uint32_t steps);
+
+// Return the columns of the given display row (0 to 7) where the frog can
+// currently stand without dying
+uint16_t fieldsim_safe_columns(const FieldSim* sim, uint8_t row);
+
+// Fill in the safe columns of every row (so they can be shared by several
+// calls to fieldsim_expand())
+void fieldsim_safe_rows(const FieldSim* sim, Reach safe);
+
+// Let the frog make one move (or stay still) from every position in reach,
+// given the safe columns of each row. Positions reached in row 7 are holes
+// in the riverbank.
+void fieldsim_expand(const Reach safe, Reach reach);
+
+// Let elapsed ms pass, moving the lanes and logs and updating each of the
+// count reach sets.
+void fieldsim_advance(FieldSim* sim, uint16_t elapsed, Reach* reaches, uint8_t count);
+
+// Return the riverbank holes (bit per column) the frog can get into when
+// starting at the given position, making one move every step_ms, within
+// the given number of steps. The prediction is advanced by the search.
+uint16_t fieldsim_reachable_holes(FieldSim* sim, uint8_t row, uint8_t column,
+		uint16_t step_ms, uint8_t steps);
+
+#endif /* FIELDSIM_H_ */
@@ -0,0 +1,192 @@
+/*
+ * flightrec.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/wdt.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "flightrec.h"
+#include "timer0.h"
+#include "buttons.h"
+#include "terminalio.h"
+
+// Marks a record left by a previous run (rather than the random contents
+// of the RAM at power on)
+#define FLIGHT_MAGIC 0xF17E
+
+typedef struct {
+	uint8_t type;
+	uint8_t data;
+	uint16_t time;		// ms (the low 16 bits of get_current_time())
+} FlightEvent;
+
+typedef struct {
+	uint16_t magic;
+	uint8_t next;				// where the next event goes
+	uint8_t count;				// events kept (up to FLIGHT_EVENTS)
+	FlightEvent events[FLIGHT_EVENTS];
+	// Set by the watchdog interrupt
+	uint16_t hang_address;		// byte address in flash
+	uint32_t hang_time;
+	uint8_t hang_zone;
+} FlightRecord;
+
+// Not cleared by the C start-up code, so they survive a reset
+static FlightRecord record __attribute__ ((section (".noinit")));
+volatile uint8_t flight_current_zone __attribute__ ((section (".noinit")));
+
+// MCUSR at reset (cleared by read_reset_cause())
+static uint8_t reset_cause __attribute__ ((section (".noinit")));
+
+// Set if the record is to be reported (see flight_report_crash())
+static uint8_t crashed;
+
+static const char zone_names[FLIGHT_NUM_ZONES][12] PROGMEM = {
+	"start-up", "splash", "level intro", "input", "commands", "traffic",
+	"autopilot", "outputs", "game over", "snapshot", "versus"
+};
+
+static const char type_names[FLIGHT_NUM_TYPES][10] PROGMEM = {
+	"start", "input", "autopilot", "death", "crossed", "level", "slow loop",
+	"pause", "rewind", "game over", "watchdog"
+};
+
+static void clear_record(void);
+
+// After a watchdog reset the watchdog is left running with the shortest
+// time-out, so it's stopped here, at the very start of the start-up code
+// (.init3), before it can reset the board again. (See the avr-libc
+// documentation of <avr/wdt.h>.)
+void read_reset_cause(void) __attribute__ ((naked, used, section (".init3")));
+void read_reset_cause(void) {
+	reset_cause = MCUSR;
+	MCUSR = 0;
+	wdt_disable();
+}
+
+void init_flight_recorder(void) {
+	crashed = (reset_cause & (1<<WDRF)) && record.magic == FLIGHT_MAGIC &&
+			record.next < FLIGHT_EVENTS && record.count <= FLIGHT_EVENTS;
+	if(!crashed) {
+		clear_record();
+	}
+	flight_zone(FLIGHT_ZONE_STARTUP);
+}
+
+void flight_report_crash(void) {
+	uint32_t start_time;
+	uint8_t index;
+	FlightEvent* event;
+
+	if(!crashed) {
+		return;
+	}
+	clear_terminal();
+	move_cursor(1,1);
+	printf_P(PSTR("Watchdog reset - stuck at 0x%04X in %S, %lu ms after start-up\n"),
+			record.hang_address, zone_names[record.hang_zone < FLIGHT_NUM_ZONES ?
+			record.hang_zone : FLIGHT_ZONE_STARTUP], record.hang_time);
+	printf_P(PSTR("Last %u events (ms before the watchdog, event, data):\n"), record.count);
+	index = (record.next - record.count) & (FLIGHT_EVENTS - 1);
+	for(uint8_t i = 0; i < record.count; i++) {
+		event = &record.events[(index + i) & (FLIGHT_EVENTS - 1)];
+		printf_P(PSTR("%8u  %-10S"), (uint16_t)((uint16_t)record.hang_time - event->time),
+				type_names[event->type < FLIGHT_NUM_TYPES ? event->type : FLIGHT_START]);
+		if(event->type == FLIGHT_DEATH) {
+			printf_P(PSTR("row %u column %u\n"), event->data >> 4, event->data & 0x0F);
+		} else {
+			printf_P(PSTR("%u\n"), event->data);
+		}
+	}
+	printf_P(PSTR("Press a button to carry on\n"));
+
+	start_time = get_current_time();
+	(void)button_pushed();
+	while(button_pushed() == NO_BUTTON_PUSHED &&
+			get_current_time() - start_time < FLIGHT_REPORT_WAIT) {
+		;
+	}
+	crashed = 0;
+	clear_record();
+}
+
+void flight_watchdog_start(void) {
+	wdt_enable(WDTO_2S);
+	// Interrupt at the first time-out, reset at the next
+	WDTCSR |= (1<<WDIE);
+}
+
+void flight_watchdog_stop(void) {
+	wdt_disable();
+}
+
+void flight_record(uint8_t type, uint8_t data) {
+	uint16_t now = get_current_time();
+	uint8_t interrupts_on = bit_is_set(SREG, SREG_I);
+	FlightEvent* event;
+
+	cli();
+	event = &record.events[record.next];
+	record.next = (record.next + 1) & (FLIGHT_EVENTS - 1);
+	if(record.count < FLIGHT_EVENTS) {
+		record.count++;
+	}
+	event->type = type;
+	event->data = data;
+	event->time = now;
+	if(interrupts_on) {
+		sei();
+	}
+}
+
+// Start a new record, beginning with the reset cause
+static void clear_record(void) {
+	record.magic = FLIGHT_MAGIC;
+	record.next = 0;
+	record.count = 0;
+	record.hang_address = 0;
+	record.hang_time = 0;
+	record.hang_zone = FLIGHT_ZONE_STARTUP;
+	flight_record(FLIGHT_START, reset_cause);
+}
+
+// Watchdog time-out - the program has stopped calling flight_heartbeat().
+// Record where it was interrupted (a byte address - look it up in the .lss
+// listing or with avr-addr2line). This doesn't return - it waits for the
+// watchdog to reset the board.
+static void watchdog_timeout(uint16_t return_address) __attribute__ ((noreturn));
+
+static void watchdog_timeout(uint16_t return_address) {
+	record.hang_address = return_address << 1;
+	record.hang_time = get_current_time();
+	record.hang_zone = flight_current_zone;
+	flight_record(FLIGHT_WATCHDOG, flight_current_zone);
+	while(1) {
+		;
+	}
+}
+
+// The handler is naked so that nothing has been pushed when it runs and
+// the return address (a word address, high byte first) is just above the
+// stack pointer. No C may run in a naked function, so it is read in
+// assembly into r25:r24 (the first argument) and watchdog_timeout() is
+// jumped to. It never returns, so no registers need keeping. The function
+// is passed as an operand (%x0 prints its name without gs()) so that the
+// compiler knows it is used and names it however it has to.
+ISR(WDT_vect, ISR_NAKED) {
+	asm volatile (
+		"    clr __zero_reg__\n"
+		"    in r30, __SP_L__\n"
+		"    in r31, __SP_H__\n"
+		"    ldd r25, Z+1\n"
+		"    ldd r24, Z+2\n"
+		"    jmp %x0\n"
+		:
+		: "i" (watchdog_timeout));
+}
@@ -0,0 +1,99 @@
+/*
+ * flightrec.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Flight recorder. The last FLIGHT_EVENTS events (inputs, moves made by
+ * the autopilot, deaths, crossings, levels, slow passes of the play loop
+ * and so on) are kept in a ring, and the current zone - the part of the
+ * program running - in a byte. Both are in the .noinit section, so they
+ * survive a reset.
+ *
+ * The play loop (and anything else that waits) calls flight_heartbeat()
+ * to reset the watchdog. If nothing does for FLIGHT_WATCHDOG_MS - e.g.
+ * the program is stuck waiting for room in the serial output buffer or
+ * in a delay loop - the watchdog interrupt records the address it
+ * interrupted and the zone, and the watchdog resets the board at the next
+ * time-out. On start-up after that reset, flight_report_crash() prints
+ * the record on the serial terminal before the splash screen.
+ *
+ * Recording an event takes a few tens of cycles and setting the zone a
+ * single store, so the recorder is always on.
+ */
+
+#ifndef FLIGHTREC_H_
+#define FLIGHTREC_H_
+
+#include <stdint.h>
+#include <avr/wdt.h>
+
+// Number of events kept (a power of two)
+#define FLIGHT_EVENTS 16
+
+// Watchdog time-out - the interrupt comes after this long without a
+// heartbeat and the reset after twice this long
+#define FLIGHT_WATCHDOG_MS 2000
+
+// Passes of the play loop at least this far apart (ms) are recorded
+#define FLIGHT_SLOW_LOOP_MS 20
+
+// Event types and what their data is
+#define FLIGHT_START		0	// reset cause (MCUSR)
+#define FLIGHT_INPUT		1	// input, as a journal token (see journal.h)
+#define FLIGHT_AUTOPILOT	2	// move (numbered as the push buttons)
+#define FLIGHT_DEATH		3	// frog row * 16 + column
+#define FLIGHT_CROSSED		4	// frog column
+#define FLIGHT_LEVEL		5	// level number
+#define FLIGHT_SLOW_LOOP	6	// ms since the last pass (up to 255)
+#define FLIGHT_PAUSE		7	// 1 paused, 0 carried on
+#define FLIGHT_REWIND		8	// 1 started, 0 stopped
+#define FLIGHT_GAME_OVER	9	// level reached
+#define FLIGHT_WATCHDOG		10	// zone the watchdog interrupted
+#define FLIGHT_NUM_TYPES	11
+
+// Zones
+#define FLIGHT_ZONE_STARTUP		0
+#define FLIGHT_ZONE_SPLASH		1
+#define FLIGHT_ZONE_LEVEL_INTRO	2
+#define FLIGHT_ZONE_INPUT		3	// reading the inputs
+#define FLIGHT_ZONE_COMMANDS	4	// moving the frog, serial commands
+#define FLIGHT_ZONE_TRAFFIC		5	// moving the lanes and logs, rewinding
+#define FLIGHT_ZONE_AUTOPILOT	6
+#define FLIGHT_ZONE_OUTPUTS		7	// updating the outputs (see statebus.h)
+#define FLIGHT_ZONE_GAME_OVER	8
+#define FLIGHT_ZONE_SNAPSHOT	9	// reading a snapshot command
+#define FLIGHT_ZONE_VERSUS		10
+#define FLIGHT_NUM_ZONES		11
+
+// (Kept in .noinit - use flight_zone())
+extern volatile uint8_t flight_current_zone;
+
+// Set up the recorder from what survived the reset (if anything). Must be
+// called before interrupts are turned on.
+void init_flight_recorder(void);
+
+// If the last reset was by the watchdog, print the record of what led up
+// to it on the serial terminal and wait for a button push (or
+// FLIGHT_REPORT_WAIT ms)
+#define FLIGHT_REPORT_WAIT 30000
+void flight_report_crash(void);
+
+// Start or stop the watchdog (it is stopped e.g. before the CPU is put to
+// sleep for good)
+void flight_watchdog_start(void);
+void flight_watchdog_stop(void);
+
+// Record an event (one of FLIGHT_*). Can be used in interrupt handlers.
+void flight_record(uint8_t type, uint8_t data);
+
+// Say which part of the program is running (one of FLIGHT_ZONE_*)
+static inline void flight_zone(uint8_t zone) {
+	flight_current_zone = zone;
+}
+
+// Tell the watchdog the program is still running
+static inline void flight_heartbeat(void) {
+	wdt_reset();
+}
+
+#endif /* FLIGHTREC_H_ */
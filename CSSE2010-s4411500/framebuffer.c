@@ -0,0 +1,86 @@
+/*
+ * framebuffer.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "framebuffer.h"
+#include "ledmatrix.h"
+
+// SPI bytes to send a row and to send a pixel (see ledmatrix.c)
+#define ROW_COMMAND_BYTES (2 + MATRIX_NUM_COLUMNS)
+#define PIXEL_COMMAND_BYTES 3
+
+static MatrixPackedData frame;
+static PixelColour palette[FRAMEBUFFER_PALETTE_SIZE];
+
+void framebuffer_clear(void) {
+	memset(frame, 0, sizeof(frame));
+}
+
+void framebuffer_set_palette(uint8_t index, PixelColour colour) {
+	palette[index & (FRAMEBUFFER_PALETTE_SIZE - 1)] = colour;
+}
+
+PixelColour framebuffer_get_palette(uint8_t index) {
+	return palette[index & (FRAMEBUFFER_PALETTE_SIZE - 1)];
+}
+
+uint8_t* framebuffer_row(uint8_t y) {
+	return frame[y];
+}
+
+uint8_t framebuffer_get(uint8_t x, uint8_t y) {
+	uint8_t pair = frame[y][x >> 1];
+	return (x & 1) ? pair >> 4 : pair & 0x0F;
+}
+
+void framebuffer_draw_pixel(uint8_t x, uint8_t y, uint8_t index) {
+	if(x >= MATRIX_NUM_COLUMNS || y >= MATRIX_NUM_ROWS) {
+		return;
+	}
+	framebuffer_put(frame[y], x, index);
+	ledmatrix_update_pixel(x, y, palette[index]);
+}
+
+void framebuffer_show_row(uint8_t y) {
+	ledmatrix_update_row_packed(y, frame[y], palette);
+}
+
+void framebuffer_show_all(void) {
+	ledmatrix_update_all_packed(frame, palette);
+}
+
+void framebuffer_update_row(uint8_t y, const MatrixPackedRow row) {
+	uint16_t changed = 0;
+	uint8_t count = 0;
+	uint8_t difference;
+
+	for(uint8_t i = 0; i < MATRIX_PACKED_ROW_BYTES; i++) {
+		difference = frame[y][i] ^ row[i];
+		if(difference & 0x0F) {
+			changed |= ((uint16_t)1 << (2 * i));
+			count++;
+		}
+		if(difference & 0xF0) {
+			changed |= ((uint16_t)1 << (2 * i + 1));
+			count++;
+		}
+	}
+	if(!count) {
+		return;
+	}
+	memcpy(frame[y], row, MATRIX_PACKED_ROW_BYTES);
+	if(count * PIXEL_COMMAND_BYTES < ROW_COMMAND_BYTES) {
+		for(uint8_t x = 0; changed; x++, changed >>= 1) {
+			if(changed & 1) {
+				ledmatrix_update_pixel(x, y, palette[framebuffer_get(x, y)]);
+			}
+		}
+	} else {
+		ledmatrix_update_row_packed(y, frame[y], palette);
+	}
+}
@@ -0,0 +1,67 @@
+/*
+ * framebuffer.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Palette indexed copy of what the game has drawn on the LED matrix. Each
+ * pixel is a 4 bit index into a palette of 16 PixelColours, two pixels to
+ * a byte, so the frame takes 64 bytes and the palette 16 - 80 bytes in
+ * place of the 128 of a MatrixData. (2 bits a pixel would halve the frame
+ * again, but the game uses 10 colours.)
+ *
+ * The indices are only looked up in the palette as they are sent to the
+ * matrix (see ledmatrix_update_row_packed()), so nothing is expanded to
+ * PixelColours in RAM. Changing the colour of everything drawn with an
+ * index - a level's colours, or a flash of the whole screen - is a
+ * framebuffer_set_palette() and a framebuffer_show_all().
+ *
+ * A row is drawn by putting indices into framebuffer_row(y) with
+ * framebuffer_put() and then sent with framebuffer_show_row(y), or made
+ * up elsewhere and given to framebuffer_update_row() (see compositor.h).
+ */
+
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+#include <stdint.h>
+#include "ledmatrix.h"
+#include "pixel_colour.h"
+
+#define FRAMEBUFFER_PALETTE_SIZE 16
+
+// Clear the frame to index 0 (the matrix isn't changed)
+void framebuffer_clear(void);
+
+// Set or get the colour shown for a palette index. The matrix isn't
+// changed until the pixels using the index are sent again.
+void framebuffer_set_palette(uint8_t index, PixelColour colour);
+PixelColour framebuffer_get_palette(uint8_t index);
+
+// The given row of the frame (y must be < MATRIX_NUM_ROWS)
+uint8_t* framebuffer_row(uint8_t y);
+
+// Put a palette index into a row from framebuffer_row()
+static inline void framebuffer_put(uint8_t* row, uint8_t x, uint8_t index) {
+	if(x & 1) {
+		row[x >> 1] = (row[x >> 1] & 0x0F) | (index << 4);
+	} else {
+		row[x >> 1] = (row[x >> 1] & 0xF0) | index;
+	}
+}
+
+// The palette index of a pixel
+uint8_t framebuffer_get(uint8_t x, uint8_t y);
+
+// Put a palette index into the frame and send just that pixel to the
+// matrix. Positions off the matrix are ignored.
+void framebuffer_draw_pixel(uint8_t x, uint8_t y, uint8_t index);
+
+// Send a row, or the whole frame, to the matrix
+void framebuffer_show_row(uint8_t y);
+void framebuffer_show_all(void);
+
+// Change row y of the frame to the given row, sending only what has
+// changed - nothing, the changed pixels, or the row if that is fewer bytes
+void framebuffer_update_row(uint8_t y, const MatrixPackedRow row);
+
+#endif /* FRAMEBUFFER_H_ */
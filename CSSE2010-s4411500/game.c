@@ -13,8 +13,15 @@
 #include "game.h"
 #include "score.h"
 #include "ledmatrix.h"
+#include "framebuffer.h"
+#include "compositor.h"
 #include "pixel_colour.h"
 #include "terminalio.h"
+#include "level.h"
+#include "motion.h"
+#include "lanegen.h"
+#include "log.h"
+#include "statebus.h"
 
 
 
@@ -27,36 +34,41 @@ static int8_t frog_column;
 // Boolean flag to indicate whether the frog is alive or dead
 static uint8_t frog_dead;
 
-// Vehicle data - 64 bits in each lane which we loop continuously. A 1
-// indicates the presence of a vehicle, 0 is empty.
-// Index 0 to 2 corresponds to lanes 1 to 3 respectively. Lanes 1 and 3
-// will move to the right; lane 2 will move to the left.
-#define LANE_DATA_WIDTH 64	// must be power of 2
-static uint64_t lane_data[3] = {
-		0b1100001100011000110000011001100011000011000110001100000110011000,
-		0b0011100000111000011100000111000011100001110001110000111000011100,
-		0b0000111100001111000011110000111100001111000001111100001111000111
-};
+// Row of the frog which last died, if it is still shown on the display
+// (until the row is next redrawn), or -1
+static int8_t dead_frog_row;
+
+// Vehicle data - up to 64 bits in each lane which we loop continuously. A 1
+// indicates the presence of a vehicle, 0 is empty. lane_width gives the
+// number of bits used in each lane.
+// Index 0 to 2 corresponds to lanes 1 to 3 respectively. The data, widths,
+// colours, directions and speeds of every lane and log channel come from
+// the level descriptor (see level.h) and are loaded by initialise_game().
+static uint64_t lane_data[3];
+static uint8_t lane_width[3];
 		
-// Log data - 32 bits for each log channel which we loop continuously.
+// Log data - up to 32 bits for each log channel which we loop continuously.
 // A 1 indicates the presence of a log, 0 is empty.
-// Index 0 to 1 corresponds to rows 5 and 6 respectively. Row 5 will move
-// to the left; row 6 will move to the right
-#define LOG_DATA_WIDTH 32 // must be power of 2
-static uint32_t log_data[2] = {
-		0b11110001100111000111100011111000,
-		0b11100110111101100001110110011100
-};
-
-// Lane positions. The bit position (0 to 63) of the lane_data above that is
-// currently in column 0 of the display (left hand side). (Bit position
-// 0 is the least significant bit.) For a lane position of N, the display
-// will show bits N to N+15 from left to right (wrapping around if N+15 
-// exceeds 63). 
-static int8_t lane_position[3];
-
-// Log positions. Same principle as lane positions.
-static int8_t log_position[2];
+// Index 0 to 1 corresponds to rows 5 and 6 respectively.
+static uint32_t log_data[2];
+static uint8_t log_width[2];
+
+// Speed and direction of each row (see motion.h). Index 0 to 2 are the 
+// traffic lanes, 3 and 4 the log channels.
+#define NUM_MOVING_ROWS 5
+static RowMotion row_motion[NUM_MOVING_ROWS];
+
+// Width of each row's pattern, for finding its position without dividing
+static Divider row_width[NUM_MOVING_ROWS];
+
+// Milliseconds of play since the level started, the number of steps each
+// row has made and the time its next step is due. A row's position is
+// worked out from the number of steps it has made (see row_position()).
+// This is normally the number due by level_time (motion_steps_at()) but
+// steps due when the frog is killed are left until the next update.
+static uint32_t level_time;
+static uint32_t steps_made[NUM_MOVING_ROWS];
+static uint32_t next_step_time[NUM_MOVING_ROWS];
 
 // Colours
 #define COLOUR_FROG			COLOUR_GREEN
@@ -64,8 +76,20 @@ static int8_t log_position[2];
 #define COLOUR_EDGES		COLOUR_LIGHT_GREEN
 #define COLOUR_WATER		COLOUR_BLACK
 #define COLOUR_ROAD			COLOUR_BLACK
-#define COLOUR_LOGS			COLOUR_ORANGE
-PixelColour vehicle_colours[3] = { COLOUR_RED, COLOUR_YELLOW, COLOUR_RED }; // by lane
+
+// The display is drawn in the layers of the compositor with these palette
+// indices (see compositor.h and framebuffer.h). The vehicle and log
+// colours are set by the level.
+#define PALETTE_EMPTY		0	// empty holes in the riverbank
+#define PALETTE_EDGES		1
+#define PALETTE_FROG		2
+#define PALETTE_DEAD_FROG	3
+#define PALETTE_ROAD		4
+#define PALETTE_WATER		5
+#define PALETTE_VEHICLES	6	// 6 to 8, by lane
+#define PALETTE_LOGS		9	// 9 and 10, by channel
+#define PALETTE_GHOST		11	// the other board's frog (see versus.h)
+#define COLOUR_GHOST		COLOUR_LIGHT_ORANGE
 
 // Rows
 #define START_ROW 0	// row position where the frog starts
@@ -77,19 +101,33 @@ PixelColour vehicle_colours[3] = { COLOUR_RED, COLOUR_YELLOW, COLOUR_RED }; // b
 #define SECOND_RIVER_ROW 6
 #define RIVERBANK_ROW 7 // row position where the frog finishes
 
-// River bank pattern. Note that the least significant bit in this
-// pattern (RHS) corresponds to column 0 on the display (LHS).
-#define RIVERBANK 0b1101110111011101
+// River bank pattern (from the level descriptor). Note that the least 
+// significant bit in this pattern (RHS) corresponds to column 0 on the
+// display (LHS).
 static uint16_t riverbank;
 // riverbank_status is a bit pattern similar to riverbank but will
 // only have zeroes where there are unoccupied holes. When this is all 1's
 // then the game/level is complete
 static uint16_t riverbank_status;
 
+// GAME_QUIET_* bits (see set_game_quiet())
+static uint8_t game_quiet;
+
+// Row periods set from the console (see set_row_period()), 0 where the
+// level's own is used
+static uint16_t period_override[NUM_MOVING_ROWS];
+
+// Steps made by update_traffic() which were never shown (see
+// get_missed_scrolls())
+static uint32_t missed_scrolls;
+
 
 /////////////////////////////// Function Prototypes for Helper Functions ///////
 // These functions are defined after the public functions. Comments are with the
 // definitions.
+static void load_level_layout(uint8_t level_number);
+static uint8_t row_position(uint8_t row);
+static void set_level_time(uint32_t time);
 static uint8_t will_frog_die_at_position(int8_t row, int8_t column);
 // static void redraw_whole_display(void);
 static void redraw_row(uint8_t row);
@@ -98,28 +136,49 @@ static void redraw_traffic_lane(uint8_t lane);
 static void redraw_river_channel(uint8_t channel);
 static void redraw_riverbank(void);
 static void redraw_frog(void);
+static void redraw_home_frogs(void);
+static void row_redrawn(uint8_t row);
+static uint16_t column_bit(int8_t row, int8_t column);
+static void frog_changed(uint8_t changes);
 		
 /////////////////////////////// Public Functions ///////////////////////////////
 // These functions are defined in the same order as declared in game.h
 
 // Reset the game
 void initialise_game(void) {
-	// Initial lane and log positions
-	lane_position[0] = lane_position[1] = lane_position[2] = 0;
-	log_position[0] = log_position[1] = 0;
+	// Lane patterns, colours and speeds and the riverbank for this level
+	load_level_layout(get_level());
+	riverbank_status = riverbank;
 	
-	// Initial riverbank pattern
-	riverbank = RIVERBANK;
-	riverbank_status = RIVERBANK;
+	// Initial lane and log positions
+	level_time = 0;
+	for(uint8_t row = 0; row < NUM_MOVING_ROWS; row++) {
+		divider_init(&row_width[row], (row < 3) ? lane_width[row] : log_width[row - 3]);
+		steps_made[row] = 0;
+		next_step_time[row] = motion_step_time(&row_motion[row], 1);
+	}
 	
 	redraw_whole_display();
 	
-	// Add a frog to the roadside - this will redraw the frog
+	// The frog is shown on the display when it changes (see statebus.h)
+	statebus_subscribe(STATEBUS_MATRIX, STATE_FROG, frog_changed);
+	
+	// Add a frog to the roadside - this will redraw the frog. (No frog
+	// is left from the last level.)
+	frog_dead = 0;
 	put_frog_in_start_position();
 }
 
 // Add a frog to the game
 void put_frog_in_start_position(void) {
+	// A frog which died is left on the display until its row is next
+	// redrawn (and one which crossed is among the home frogs)
+	if(frog_dead && !(game_quiet & GAME_QUIET_DISPLAY)) {
+		compositor_set_sprite(SPRITE_DEAD_FROG, frog_row, column_bit(frog_row, frog_column),
+				PALETTE_DEAD_FROG);
+		dead_frog_row = frog_row;
+	}
+	
 	// Initial starting position of frog (7,0)
 	frog_row = 0;
 	frog_column = 7;
@@ -128,47 +187,43 @@ void put_frog_in_start_position(void) {
 	frog_dead = 0;
 	
 	// Show the frog
-	redraw_frog();
+	state_changed(STATE_FROG);
 }
 
 // This function assumes that the frog is not in row 7 (the top row). A frog in row 7 is out
 // of the game.
 void move_frog_forward(void) {
-	// Redraw the row the frog is currently on (this will remove the frog)
-	redraw_row(frog_row);
-	
 	// Check whether this move will cause the frog to die or not
 	frog_dead = will_frog_die_at_position(frog_row+1, frog_column);
 	
-	// Move the frog position forward and show the frog. 
-	// We do this whether the frog is alive or not. 
+	// Move the frog position forward and publish it (the frog is shown
+	// there whether it is alive or not - see redraw_frog())
 	frog_row++;
-	redraw_frog();
+	state_changed(STATE_FROG);
 	
-	if(!frog_dead) {
+	if(!frog_dead && !(game_quiet & GAME_QUIET_SCORE)) {
 		add_to_score(1);
 	}
 
 	// If the frog has ended up successfully in row 7 - add it to the riverbank_status flag
 	if(!frog_dead && frog_row == RIVERBANK_ROW) {
 		riverbank_status |= (1<<frog_column);
+		redraw_home_frogs();
 	}
 }
 
 void move_frog_backward(void) {
-	// Redraw the row the frog is currently on (this will remove the frog)
-	redraw_row(frog_row);
-		
 	// Check whether this move will cause the frog to die or not
 	frog_dead = will_frog_die_at_position(frog_row-1, frog_column);
-	// Move the frog position forward and show the frog.
-	// We do this whether the frog is alive or not.
+	// Move the frog position and publish it (the frog is shown there
+	// whether it is alive or not - see redraw_frog())
 	frog_row--;
-	redraw_frog();
+	state_changed(STATE_FROG);
 		
 	// If the frog has ended up successfully in row 7 - add it to the riverbank_status flag
 	if(!frog_dead && frog_row == RIVERBANK_ROW) {
 		riverbank_status |= (1<<frog_column);
+		redraw_home_frogs();
 	}
 }
 
@@ -179,36 +234,32 @@ void move_frog_to_left(void) {
 	// whether the frog will live or not, update the frog position (if the position 
 	// is not the leftmost column) then and redraw the frog.
 	
-	// Redraw the row the frog is currently on (this will remove the frog)
-	redraw_row(frog_row);
-		
 	// Check whether this move will cause the frog to die or not
 	frog_dead = will_frog_die_at_position(frog_row, frog_column-1);
-	// Move the frog position forward and show the frog.
-	// We do this whether the frog is alive or not.
+	// Move the frog position and publish it (the frog is shown there
+	// whether it is alive or not - see redraw_frog())
 	frog_column--;
-	redraw_frog();
+	state_changed(STATE_FROG);
 		
 	// If the frog has ended up successfully in row 7 - add it to the riverbank_status flag
 	if(!frog_dead && frog_row == RIVERBANK_ROW) {
 		riverbank_status |= (1<<frog_column);
+		redraw_home_frogs();
 	}
 }
 
 void move_frog_to_right(void) {
-	// Redraw the row the frog is currently on (this will remove the frog)
-	redraw_row(frog_row);
-		
 	// Check whether this move will cause the frog to die or not
 	frog_dead = will_frog_die_at_position(frog_row, frog_column+1);
-	// Move the frog position forward and show the frog.
-	// We do this whether the frog is alive or not.
+	// Move the frog position and publish it (the frog is shown there
+	// whether it is alive or not - see redraw_frog())
 	frog_column++;
-	redraw_frog();
+	state_changed(STATE_FROG);
 		
 	// If the frog has ended up successfully in row 7 - add it to the riverbank_status flag
 	if(!frog_dead && frog_row == RIVERBANK_ROW) {
 		riverbank_status |= (1<<frog_column);
+		redraw_home_frogs();
 	}
 }
 
@@ -234,23 +285,113 @@ uint8_t is_frog_dead(void) {
 
 void kill_frog(void) {
 	frog_dead = 1;
+	state_changed(STATE_FROG);
 }
 
-// Scroll the given lane of traffic. (lane value must be 0 to 2)
-void scroll_vehicle_lane(uint8_t lane, int8_t direction) {
-	uint8_t frog_is_in_this_row = (frog_row == lane + FIRST_VEHICLE_ROW);
-	// Work out the new lane position.
-	// Wrap numbers around if they go out of range
-	// A direction of -1 indicates movement to the left which means we
-	// start from a higher bit position in column 0
-	lane_position[lane] -= direction;
-	if(lane_position[lane] < 0) {
-		lane_position[lane] = LANE_DATA_WIDTH-1;
-	} else if(lane_position[lane] >= LANE_DATA_WIDTH) {
-		lane_position[lane] = 0;
+void get_field_prediction(FieldSim* sim) {
+	for(uint8_t row = 0; row < NUM_MOVING_ROWS; row++) {
+		if(row < 3) {
+			fieldsim_init_row(sim, row, lane_data[row], lane_width[row], row_position(row),
+					&row_motion[row], level_time, steps_made[row]);
+		} else {
+			fieldsim_init_row(sim, row, log_data[row - 3], log_width[row - 3],
+					row_position(row), &row_motion[row], level_time, steps_made[row]);
+		}
+	}
+	sim->riverbank_status = riverbank_status;
+}
+
+void get_field_state(FieldState* state) {
+	state->frog_row = frog_row;
+	state->frog_column = frog_column;
+	state->frog_dead = frog_dead;
+	state->riverbank_status = riverbank_status;
+	state->level_time = level_time;
+	for(uint8_t row = 0; row < NUM_MOVING_ROWS; row++) {
+		uint32_t behind = motion_steps_at(&row_motion[row], level_time) - steps_made[row];
+		state->steps_behind[row] = behind > UINT8_MAX ? UINT8_MAX : behind;
 	}
+}
+
+void set_field_state(const FieldState* state) {
+	frog_row = state->frog_row;
+	frog_column = state->frog_column;
+	frog_dead = state->frog_dead;
+	riverbank_status = state->riverbank_status;
+	
+	// Put the rows where they were at that time (less any steps they were
+	// behind, which are made at the next update)
+	set_level_time(state->level_time);
+	for(uint8_t row = 0; row < NUM_MOVING_ROWS; row++) {
+		if(steps_made[row] >= state->steps_behind[row]) {
+			steps_made[row] -= state->steps_behind[row];
+			next_step_time[row] = motion_step_time(&row_motion[row], steps_made[row] + 1);
+		}
+	}
+	
+	// Every row is redrawn in full so the display isn't cleared first
+	// (which would make it flicker when rewinding, see rewind.h)
+	for(uint8_t row = START_ROW; row <= RIVERBANK_ROW; row++) {
+		redraw_row(row);
+	}
+	redraw_frog();
+}
+
+uint32_t get_level_time(void) {
+	return level_time;
+}
+
+void seek_traffic(uint32_t time) {
+	set_level_time(time);
+	redraw_whole_display();
+	redraw_frog();
+}
+
+void copy_frog_context(FrogContext* context) {
+	context->level_time = level_time;
+	for(uint8_t row = 0; row < NUM_MOVING_ROWS; row++) {
+		context->steps_made[row] = steps_made[row];
+		context->next_step_time[row] = next_step_time[row];
+	}
+	context->riverbank_status = riverbank_status;
+	context->frog_row = frog_row;
+	context->frog_column = frog_column;
+	context->frog_dead = frog_dead;
+}
+
+void swap_frog_context(FrogContext* context) {
+	FrogContext game;
+	
+	copy_frog_context(&game);
+	level_time = context->level_time;
+	for(uint8_t row = 0; row < NUM_MOVING_ROWS; row++) {
+		steps_made[row] = context->steps_made[row];
+		next_step_time[row] = context->next_step_time[row];
+	}
+	riverbank_status = context->riverbank_status;
+	frog_row = context->frog_row;
+	frog_column = context->frog_column;
+	frog_dead = context->frog_dead;
+	*context = game;
+}
+
+void set_game_quiet(uint8_t quiet) {
+	game_quiet = quiet;
+}
+
+void show_ghost(int8_t row, int8_t column) {
+	compositor_set_sprite(SPRITE_GHOST, row < 0 ? 0 : row, column_bit(row, column),
+			PALETTE_GHOST);
+}
+
+// Show the given lane of traffic after a step. (lane value must be 0 to 2)
+void scroll_vehicle_lane(uint8_t lane) {
+	uint8_t frog_is_in_this_row = (frog_row == lane + FIRST_VEHICLE_ROW);
+	
+	LOG(LANE_STEP, lane, steps_made[lane]);
 	
-	// Show the lane on the display
+	// Show the lane on the display (at the position for the steps it has
+	// made)
 	redraw_traffic_lane(lane);
 	
 	// If the frog is in this row, show it
@@ -263,8 +404,9 @@ void scroll_vehicle_lane(uint8_t lane, int8_t direction) {
 }
 
 
-void scroll_river_channel(uint8_t channel, int8_t direction) {
+void scroll_river_channel(uint8_t channel) {
 	uint8_t frog_is_in_this_row = (frog_row == channel + FIRST_RIVER_ROW);
+	int8_t direction = row_motion[channel + 3].direction;
 	// Note, if the frog is in this row then it will be on a log
 	
 	if(frog_is_in_this_row) {
@@ -279,17 +421,10 @@ void scroll_river_channel(uint8_t channel, int8_t direction) {
 			frog_column += direction;
 		}
 	}
+	LOG(LOG_STEP, channel, steps_made[channel + 3], frog_is_in_this_row ? frog_column : -1);
 		
-	// Work out the new log position.
-	// Wrap numbers around if they go out of range
-	log_position[channel] -= direction;
-	if(log_position[channel] < 0) {
-		log_position[channel] = LOG_DATA_WIDTH-1;
-	} else if(log_position[channel] >= LOG_DATA_WIDTH) {
-		log_position[channel] = 0;
-	}
-		
-	// Work out the log data to send to the display
+	// Work out the log data to send to the display (at the position for
+	// the steps it has made)
 	redraw_river_channel(channel);
 		
 	// If the frog is in this row, put them on the log
@@ -298,8 +433,95 @@ void scroll_river_channel(uint8_t channel, int8_t direction) {
 	}
 }
 
+// Advance every lane and log channel by the given number of milliseconds,
+// scrolling each row as many steps as are due. If the frog is killed we 
+// stop scrolling - the steps still due are made on the next update (after
+// the frog has been dealt with).
+void update_traffic(uint16_t elapsed) {
+	uint8_t steps;
+	
+	level_time += elapsed;
+	for(uint8_t row = 0; row < NUM_MOVING_ROWS; row++) {
+		steps = 0;
+		while(!frog_dead && next_step_time[row] <= level_time) {
+			if(steps++) {
+				// More than one step due - the one before was never shown
+				missed_scrolls++;
+				LOG(MISSED_STEP, row, steps_made[row]);
+			}
+			steps_made[row]++;
+			next_step_time[row] = motion_step_time(&row_motion[row], steps_made[row] + 1);
+			if(row < 3) {
+				scroll_vehicle_lane(row);
+			} else {
+				scroll_river_channel(row - 3);
+			}
+		}
+	}
+}
+
+uint16_t get_row_period(uint8_t row) {
+	return row_motion[row].period.divisor;
+}
+
+void set_row_period(uint8_t row, uint16_t period) {
+	period_override[row] = period;
+	load_level_layout(get_level());
+	for(uint8_t i = 0; i < NUM_MOVING_ROWS; i++) {
+		divider_init(&row_width[i], (i < 3) ? lane_width[i] : log_width[i - 3]);
+	}
+	seek_traffic(level_time);
+}
+
+uint32_t get_missed_scrolls(void) {
+	return missed_scrolls;
+}
+
 /////////////////////////////// Private (Helper) Functions /////////////////////
 
+// Decode the level descriptor for the given level into the lane and log
+// data, widths and speeds above and the colours into the palette.
+static void load_level_layout(uint8_t level_number) {
+	LaneDescriptor lane;
+	const uint8_t* record = level_descriptor(level_number);
+	
+	framebuffer_set_palette(PALETTE_EMPTY, COLOUR_BLACK);
+	framebuffer_set_palette(PALETTE_EDGES, COLOUR_EDGES);
+	framebuffer_set_palette(PALETTE_FROG, COLOUR_FROG);
+	framebuffer_set_palette(PALETTE_DEAD_FROG, COLOUR_DEAD_FROG);
+	framebuffer_set_palette(PALETTE_ROAD, COLOUR_ROAD);
+	framebuffer_set_palette(PALETTE_WATER, COLOUR_WATER);
+	framebuffer_set_palette(PALETTE_GHOST, COLOUR_GHOST);
+	record = level_read_riverbank(record, &riverbank);
+	for(uint8_t row = 0; row < NUM_MOVING_ROWS; row++) {
+		record = level_read_lane(record, &lane);
+		if(row < 3) {
+			lane_data[row] = lane.pattern;
+			lane_width[row] = lane.width;
+			framebuffer_set_palette(PALETTE_VEHICLES + row, lane.colour);
+		} else {
+			log_data[row - 3] = lane.pattern;
+			log_width[row - 3] = lane.width;
+			framebuffer_set_palette(PALETTE_LOGS + row - 3, lane.colour);
+		}
+		if(period_override[row]) {
+			lane.period = period_override[row];
+		}
+		motion_init(&row_motion[row], lane.period, lane.rate, lane.accel,
+				lane.rate_limit, lane.direction);
+	}
+	
+	if(level_is_generated(level_number)) {
+		// Past the end of the level table - try for new (solvable) patterns. 
+		// If none can be found we keep the patterns of the last level.
+		if(lanegen_generate(level_number, row_motion, riverbank, lane_data, log_data)) {
+			lane_width[0] = lane_width[1] = lane_width[2] = LANEGEN_LANE_WIDTH;
+			log_width[0] = log_width[1] = LANEGEN_LOG_WIDTH;
+		}
+	}
+}
+
+
 // Return 1 if the frog will die at the given position. 
 // Return 0 if the frog CAN jump to the given position (i.e. it is not occupied by 
 // a vehicle), or, if in the river, then it IS occupied by a log, or, if the final
@@ -318,18 +540,18 @@ static uint8_t will_frog_die_at_position(int8_t row, int8_t column) {
 		case 2:
 		case 3:
 			lane = row - 1;
-			bit_position = lane_position[lane] + column;
-			if(bit_position >= LANE_DATA_WIDTH) {
-				bit_position -= LANE_DATA_WIDTH;
+			bit_position = row_position(lane) + column;
+			while(bit_position >= lane_width[lane]) {
+				bit_position -= lane_width[lane];
 			}
 			return (lane_data[lane] >> bit_position) & 1;
 			break;
 		case 5:
 		case 6:
 			channel = row - 5;
-			bit_position = log_position[channel] + column;
-			if(bit_position >= LOG_DATA_WIDTH) {
-				bit_position -= LOG_DATA_WIDTH;
+			bit_position = row_position(channel + 3) + column;
+			while(bit_position >= log_width[channel]) {
+				bit_position -= log_width[channel];
 			}
 			return !((log_data[channel] >> bit_position) & 1);
 			break;
@@ -341,10 +563,17 @@ static uint8_t will_frog_die_at_position(int8_t row, int8_t column) {
 	return 1;	
 }
 
+#ifdef BENCHMARK
+uint8_t benchmark_will_frog_die_at_position(int8_t row, int8_t column) {
+	return will_frog_die_at_position(row, column);
+}
+#endif
+
 // Redraw the rows on the game field. The frog is not redrawn.
 void redraw_whole_display(void) {
-	// Clear the display
-	ledmatrix_clear();
+	// Clear the display (and every layer)
+	compositor_clear();
+	dead_frog_row = -1;
 	
 	// Start with the starting and halfway rows
 	redraw_roadside(START_ROW);
@@ -393,80 +622,149 @@ static void redraw_row(uint8_t row) {
 
 // Redraw the given roadside row (0 or 4). The frog is not redrawn.
 static void redraw_roadside(uint8_t row) {
-	MatrixRow row_display_data;
+	uint8_t* row_display_data;
 	uint8_t i;
+	if(game_quiet & GAME_QUIET_DISPLAY) {
+		return;
+	}
+	row_display_data = compositor_background_row(row);
 	for(i=0;i<=15;i++) {
-		row_display_data[i] = COLOUR_EDGES;
+		framebuffer_put(row_display_data, i, PALETTE_EDGES);
+	}
+	row_redrawn(row);
+}
+
+// The bit of the given moving row's pattern (0 to width-1) which is in
+// column 0 of the display (left hand side). (Bit position 0 is the least
+// significant bit.) For a position of N, the display shows bits N to N+15
+// from left to right (wrapping around if N+15 exceeds the width).
+static uint8_t row_position(uint8_t row) {
+	return motion_position(&row_motion[row], &row_width[row], steps_made[row]);
+}
+
+// Set the level time and every row's steps to those due by then. Nothing
+// is redrawn.
+static void set_level_time(uint32_t time) {
+	level_time = time;
+	for(uint8_t row = 0; row < NUM_MOVING_ROWS; row++) {
+		steps_made[row] = motion_steps_at(&row_motion[row], time);
+		next_step_time[row] = motion_step_time(&row_motion[row], steps_made[row] + 1);
 	}
-	ledmatrix_update_row(row, row_display_data);
 }
 
 // Redraw the given traffic lane (0, 1, 2). The frog is not redrawn.
 static void redraw_traffic_lane(uint8_t lane) {
-	MatrixRow row_display_data;
+	uint8_t* row_display_data;
 	uint8_t i;
-	uint8_t bit_position = lane_position[lane];
+	uint8_t bit_position;
+	if(game_quiet & GAME_QUIET_DISPLAY) {
+		return;
+	}
+	row_display_data = compositor_background_row(lane+FIRST_VEHICLE_ROW);
+	bit_position = row_position(lane);
 	for(i=0; i<=15; i++) {
 		if((lane_data[lane] >> bit_position) & 1) {
-			row_display_data[i] = vehicle_colours[lane];
+			framebuffer_put(row_display_data, i, PALETTE_VEHICLES + lane);
 			} else {
-			row_display_data[i] = COLOUR_ROAD;
+			framebuffer_put(row_display_data, i, PALETTE_ROAD);
 		}
 		bit_position++;
-		if(bit_position >= LANE_DATA_WIDTH) {
+		if(bit_position >= lane_width[lane]) {
 			// Wrap around in our lane data
 			bit_position = 0;
 		}
 	}
-	ledmatrix_update_row(lane+FIRST_VEHICLE_ROW, row_display_data);
+	row_redrawn(lane+FIRST_VEHICLE_ROW);
 }
 
 // Redraw the given river channel (0 or 1). The frog is not redrawn.
 static void redraw_river_channel(uint8_t channel) {
-	MatrixRow row_display_data;
+	uint8_t* row_display_data;
 	uint8_t i;
-	uint8_t bit_position = log_position[channel];
+	uint8_t bit_position;
+	if(game_quiet & GAME_QUIET_DISPLAY) {
+		return;
+	}
+	row_display_data = compositor_background_row(channel+FIRST_RIVER_ROW);
+	bit_position = row_position(channel + 3);
 	for(i=0; i<=15; i++) {
 		if((log_data[channel] >> bit_position) & 1) {
-			row_display_data[i] = COLOUR_LOGS;
+			framebuffer_put(row_display_data, i, PALETTE_LOGS + channel);
 			} else {
-			row_display_data[i] = COLOUR_WATER;
+			framebuffer_put(row_display_data, i, PALETTE_WATER);
 		}
 		bit_position++;
-		if(bit_position >= LOG_DATA_WIDTH) {
+		if(bit_position >= log_width[channel]) {
 			bit_position = 0;
 		}
 	}
-	ledmatrix_update_row(channel+FIRST_RIVER_ROW, row_display_data);
+	row_redrawn(channel+FIRST_RIVER_ROW);
 }
 
 // Redraw the riverbank (top row). Previous frogs which have made it to a hole
 // at the top are shown.
 static void redraw_riverbank(void) {
-	MatrixRow row_display_data;
+	uint8_t* row_display_data;
 	uint8_t i;
-	// Blank out spaces in our rowdata where there are holes in the riverbank
+	if(game_quiet & GAME_QUIET_DISPLAY) {
+		return;
+	}
+	row_display_data = compositor_background_row(RIVERBANK_ROW);
+	// Blank out spaces in our rowdata where there are holes in the riverbank.
+	// (The frogs occupying holes are sprites.)
 	for(i=0; i<= 15; i++) {
 		if((riverbank >> i) & 1) {
 			// Riverbank edge
-			row_display_data[i] = COLOUR_EDGES;
-		} else if ((riverbank_status >> i) & 1) {
-			// Frog occupying a hole
-			row_display_data[i] = COLOUR_FROG;
+			framebuffer_put(row_display_data, i, PALETTE_EDGES);
 		} else {
-			// Empty hole
-			row_display_data[i] = 0;
+			// Hole
+			framebuffer_put(row_display_data, i, PALETTE_EMPTY);
 		}
 	}
 	// Output our riverbank to the display
-	ledmatrix_update_row(RIVERBANK_ROW, row_display_data);
+	row_redrawn(RIVERBANK_ROW);
+	redraw_home_frogs();
 }
 
-// Redraw the frog in its current position.
+// Redraw the frog in its current position (the frog sprite, see
+// compositor.h)
 static void redraw_frog(void) {
-	if(frog_dead) {
-		ledmatrix_update_pixel(frog_column, frog_row, COLOUR_DEAD_FROG);
-	} else {
-		ledmatrix_update_pixel(frog_column, frog_row, COLOUR_FROG);
+	if(game_quiet & GAME_QUIET_DISPLAY) {
+		return;
+	}
+	compositor_set_sprite(SPRITE_FROG, frog_row < 0 ? 0 : frog_row,
+			column_bit(frog_row, frog_column), frog_dead ? PALETTE_DEAD_FROG : PALETTE_FROG);
+}
+
+// Redraw the frogs which have made it to a hole in the riverbank
+static void redraw_home_frogs(void) {
+	if(game_quiet & GAME_QUIET_DISPLAY) {
+		return;
+	}
+	compositor_set_sprite(SPRITE_HOME_FROGS, RIVERBANK_ROW, riverbank_status & ~riverbank,
+			PALETTE_FROG);
+}
+
+// A row has been drawn in the background - mark it to be sent, and take
+// away the dead frog if it is in that row
+static void row_redrawn(uint8_t row) {
+	compositor_mark_row(row);
+	if(dead_frog_row == row) {
+		compositor_hide_sprite(SPRITE_DEAD_FROG);
+		dead_frog_row = -1;
 	}
+}
+
+// The bit for a column in a sprite, or 0 if the position is off the
+// display (a frog which has jumped off the edge)
+static uint16_t column_bit(int8_t row, int8_t column) {
+	if(row < 0 || row > RIVERBANK_ROW || column < 0 || column > 15) {
+		return 0;
+	}
+	return (uint16_t)1 << column;
+}
+
+// Subscriber to STATE_FROG (see statebus.h) - the frog has moved or died
+static void frog_changed(uint8_t changes) {
+	redraw_frog();
 }
\ No newline at end of file
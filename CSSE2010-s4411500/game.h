@@ -12,13 +12,15 @@
  * on the riverbank (row 7).
  *
  * The functions in this module will update the LED matrix
- * display as required. 
+ * display as required. (They draw in the layers of the compositor - the
+ * display changes at the next compositor_update(), see compositor.h.)
  */ 
 
 #ifndef GAME_H_
 #define GAME_H_
 
 #include <stdint.h>
+#include "fieldsim.h"
 
 // Reset the game. Get the road and river ready and place a frog
 // on the roadside (bottom row)
@@ -72,21 +74,115 @@ uint8_t is_frog_dead(void);
 // Kill the frog immediately
 void kill_frog(void);
 
+// Set up sim as a copy of the current lanes, logs and riverbank (including
+// how far each row is through its current step) so that the field can be
+// predicted without changing the game.
+void get_field_prediction(FieldSim* sim);
+
+// Everything about the field which changes during a level (see snapshot.h).
+// The lanes and logs are where their motion puts them at level_time (ms of
+// play since the level started, see motion.h) less steps_behind - steps
+// which were due when the frog was killed and are made at the next update.
+// Index 0 to 2 of steps_behind are the traffic lanes, 3 and 4 the log
+// channels.
+typedef struct {
+	int8_t frog_row;
+	int8_t frog_column;
+	uint8_t frog_dead;
+	uint16_t riverbank_status;
+	uint32_t level_time;
+	uint8_t steps_behind[5];
+} FieldState;
+
+// Copy the field state out of the game
+void get_field_state(FieldState* state);
+
+// Put the field back into a saved state and redraw it. The layout of the
+// current level must already have been loaded by initialise_game().
+void set_field_state(const FieldState* state);
+
+// Milliseconds of play since the level started (the time the lanes and
+// logs are at)
+uint32_t get_level_time(void);
+
+// Put the lanes and logs straight where they are at the given level time
+// (without going through the steps in between) and redraw the field. The
+// frog isn't moved or checked.
+void seek_traffic(uint32_t time);
+
+// Everything that changes as one frog plays a level - the frog, its
+// riverbank and the lane and log steps made (which fall behind when the
+// frog is killed, see update_traffic()). Two frogs can race on the same
+// level by swapping contexts (see versus.h).
+typedef struct {
+	uint32_t level_time;
+	uint32_t steps_made[5];
+	uint32_t next_step_time[5];
+	uint16_t riverbank_status;
+	int8_t frog_row;
+	int8_t frog_column;
+	uint8_t frog_dead;
+} FrogContext;
+
+// Copy the game's frog context out to context
+void copy_frog_context(FrogContext* context);
+
+// Exchange the game's frog context with context. Nothing is redrawn.
+void swap_frog_context(FrogContext* context);
+
+// Set what the game leaves out, as GAME_QUIET_* bits - GAME_QUIET_SCORE
+// stops moves adding to the score (and printing it) and GAME_QUIET_DISPLAY
+// stops anything being drawn, so a frog that isn't on the display can be
+// played (e.g. to re-simulate it, see versus.h). 0 is normal play.
+#define GAME_QUIET_SCORE	0x01
+#define GAME_QUIET_DISPLAY	0x02
+void set_game_quiet(uint8_t quiet);
+
+// Show the other board's frog in a race (see versus.h) at the given
+// position, or take it away if row is -1. This board's frog is shown over
+// it.
+void show_ghost(int8_t row, int8_t column);
+
 /////////////////////// UPDATE FUNCTIONS /////////////////////////////////////
-// Scroll the given lane of traffic in the given direction. 
+// Redraw the given lane of traffic after it has made a step (its position
+// follows from the number of steps it has made). 
 // Check is_frog_dead() to determine whether the frog was killed or not.
 // lane argument is 0, 1 or 2 corresponding to rows 1, 2 and 3 on the display.
-// direction argument is -1 for left, 1 for right, 0 for no scroll (just redraw)
-void scroll_vehicle_lane(uint8_t lane, int8_t direction);
+void scroll_vehicle_lane(uint8_t lane);
 
-// Scroll the given log channel (and the frog if the frog is on a log) in
-// the given direction.
+// Redraw the given log channel after it has made a step, moving the frog
+// with it if the frog is on a log.
 // Check is_frog_dead() to determine whether the frog was killed or not.
 // (Frog dies if it hits the edge of the game field whilst on a log.)
 // log argument is 0 or 1 (corresponding to rows 5 and 6 on the display).
-// direction argument is -1 for left, 1 for right, 0 for no scroll (just redraw)
-void scroll_river_channel (uint8_t channel, int8_t direction);
+void scroll_river_channel (uint8_t channel);
+
+// Advance the lanes and log channels by the given number of milliseconds,
+// scrolling any which are due to move (possibly several steps if a lot of 
+// time has passed). The speed and direction of each row come from the 
+// current level's descriptor.
+// Check is_frog_dead() to determine whether the frog was killed or not.
+void update_traffic(uint16_t elapsed);
 
 void redraw_whole_display(void);
 
+// Period (ms) of the given moving row (0 to 2 the traffic lanes, 3 and 4
+// the log channels) - it moves its rate of columns every period.
+// set_row_period() keeps the given period for that row from now on, on
+// every level (0 goes back to each level's own). The rows are put where
+// their new speeds have them at the current level time, and generated
+// levels are generated again for the new speeds.
+uint16_t get_row_period(uint8_t row);
+void set_row_period(uint8_t row, uint16_t period);
+
+// Number of lane and log steps that were never shown because more than
+// one step of the row was due at an update (i.e. the play loop was late)
+uint32_t get_missed_scrolls(void);
+
+#ifdef BENCHMARK
+// Calls the (private) check of whether the frog can move to the given
+// position so that it can be timed by benchmark.c
+uint8_t benchmark_will_frog_die_at_position(int8_t row, int8_t column);
+#endif
+
 #endif /* GAME_H_ */
\ No newline at end of file
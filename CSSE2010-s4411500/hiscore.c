@@ -0,0 +1,116 @@
+/*
+ * hiscore.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "hiscore.h"
+#include "eewriter.h"
+#include "terminalio.h"
+
+// The table as it is now (sequence is that of the last save)
+static HighScoreRecord table;
+
+// Slot the next save will be written to
+static uint8_t next_slot;
+
+static uint16_t record_crc(const HighScoreRecord* record);
+static uint16_t fill_save(uint8_t* buffer, uint8_t* size);
+
+void init_high_scores(void) {
+	HighScoreRecord record;
+	uint8_t slot;
+	uint8_t found = 0;
+
+	// One pass over the slots, keeping the valid record with the latest
+	// sequence number. (The sequence number wraps around, so "later" is
+	// a difference of less than half the range.)
+	memset(&table, 0, sizeof(table));
+	next_slot = 0;
+	for(slot = 0; slot < HISCORE_SLOTS; slot++) {
+		eeprom_read_block(&record,
+				(const void*)(HISCORE_EEPROM_START + slot * HISCORE_SLOT_SIZE),
+				sizeof(record));
+		if(record.crc == record_crc(&record) &&
+				(!found || (int16_t)(record.sequence - table.sequence) > 0)) {
+			table = record;
+			next_slot = (slot + 1) % HISCORE_SLOTS;
+			found = 1;
+		}
+	}
+	eewriter_register(EEWRITER_HISCORE, fill_save);
+}
+
+uint8_t add_high_score(uint16_t score, uint8_t level) {
+	uint8_t position;
+	uint8_t interrupts_on;
+
+	if(score == 0 || score <= table.entries[HISCORE_ENTRIES - 1].score) {
+		return 0;
+	}
+	// The table may be copied by the EEPROM writer's interrupt handler, so
+	// it mustn't run while the table is being changed
+	interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	
+	// Move the lower scores down to make room
+	position = HISCORE_ENTRIES - 1;
+	while(position > 0 && table.entries[position - 1].score < score) {
+		table.entries[position] = table.entries[position - 1];
+		position--;
+	}
+	table.entries[position].score = score;
+	table.entries[position].level = level;
+	if(interrupts_on) {
+		sei();
+	}
+	
+	eewriter_request(EEWRITER_HISCORE);
+	return position + 1;
+}
+
+void print_high_scores(int x, int y) {
+	uint8_t i;
+
+	move_cursor(x, y);
+	printf_P(PSTR("High scores"));
+	for(i = 0; i < HISCORE_ENTRIES && table.entries[i].score; i++) {
+		move_cursor(x, y + 1 + i);
+		printf_P(PSTR("%u. %5u  level %u"), i + 1, table.entries[i].score,
+				table.entries[i].level);
+	}
+}
+
+// CRC of the record up to (not including) the CRC itself
+static uint16_t record_crc(const HighScoreRecord* record) {
+	const uint8_t* byte = (const uint8_t*)record;
+	uint16_t crc = HISCORE_CRC_INIT;
+	uint8_t i;
+
+	for(i = 0; i < offsetof(HighScoreRecord, crc); i++) {
+		crc = _crc16_update(crc, byte[i]);
+	}
+	return crc;
+}
+
+// Copy the table (with the next sequence number) for the EEPROM writer to
+// save in the next slot. Called with interrupts off.
+static uint16_t fill_save(uint8_t* buffer, uint8_t* size) {
+	uint16_t address = HISCORE_EEPROM_START + next_slot * HISCORE_SLOT_SIZE;
+	
+	table.sequence++;
+	table.crc = record_crc(&table);
+	memcpy(buffer, &table, sizeof(HighScoreRecord));
+	*size = sizeof(HighScoreRecord);
+	next_slot = (next_slot + 1) % HISCORE_SLOTS;
+	return address;
+}
@@ -0,0 +1,59 @@
+/*
+ * hiscore.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * High score table kept in EEPROM. The table is saved as a record with a
+ * sequence number and a CRC. Each save goes to the next of HISCORE_SLOTS
+ * slots in turn (so each slot is written 1/HISCORE_SLOTS as often) and
+ * at start-up the valid record with the latest sequence number is used.
+ * A save which is cut short (e.g. by a reset or power loss) leaves a
+ * record which fails its CRC, and the previous table is found instead.
+ *
+ * Saves don't wait for the EEPROM - the record is written in the
+ * background by the EEPROM writer (see eewriter.h).
+ */
+
+#ifndef HISCORE_H_
+#define HISCORE_H_
+
+#include <stdint.h>
+
+// Number of scores in the table
+#define HISCORE_ENTRIES 5
+
+// EEPROM used - HISCORE_SLOTS records of HISCORE_SLOT_SIZE bytes from
+// HISCORE_EEPROM_START
+#define HISCORE_EEPROM_START 0
+#define HISCORE_SLOT_SIZE 32
+#define HISCORE_SLOTS 8
+
+// First value of the CRC (CRC-16, as _crc16_update() in util/crc16.h)
+#define HISCORE_CRC_INIT 0xFFFF
+
+typedef struct {
+	uint16_t score;
+	uint8_t level;
+} __attribute__ ((packed)) HighScore;
+
+// Entries are in order, highest score first. Unused entries have a score
+// and level of 0. The CRC covers everything before it.
+typedef struct {
+	uint16_t sequence;
+	HighScore entries[HISCORE_ENTRIES];
+	uint16_t crc;
+} __attribute__ ((packed)) HighScoreRecord;
+
+// Load the latest valid table from EEPROM (an empty table if there is
+// none). Reads the EEPROM directly so must be called before any save has
+// been started, e.g. while initialising the hardware.
+void init_high_scores(void);
+
+// Add a score to the table if it is high enough and queue a save. Returns
+// the position it was added at (1 to HISCORE_ENTRIES) or 0 if it wasn't.
+uint8_t add_high_score(uint16_t score, uint8_t level);
+
+// Print the table on the terminal starting at the given position
+void print_high_scores(int x, int y);
+
+#endif /* HISCORE_H_ */
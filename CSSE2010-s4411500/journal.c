@@ -0,0 +1,215 @@
+/*
+ * journal.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include "journal.h"
+
+#ifdef JOURNAL_ENABLED
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "score.h"
+#include "live.h"
+#include "level.h"
+#include "flightrec.h"
+
+// Longest entry - a 32 bit time difference (5 bytes) and the token
+#define MAX_ENTRY_SIZE 6
+
+// Start of the game and time of the last input (milliseconds)
+static uint32_t start_time;
+static uint32_t last_time;
+
+// Passes of the game loop since the start of the game
+static uint32_t loops;
+
+#ifdef JOURNAL_REPLAY
+// Generated by tools/journal/jnltool
+extern const uint8_t journal_replay_data[] PROGMEM;
+
+// Next entry to be read, and the time and token of the next input
+static const uint8_t* replay_position;
+static uint32_t next_time;
+static uint8_t next_token;
+
+// The journal's clock, the real time when it was last moved on (see
+// journal_replay_target()) and whether that has been done since it was
+// started or synced
+static uint32_t replay_time;
+static uint32_t replay_real_time;
+static uint8_t replay_running;
+
+static void read_entry(void);
+#else
+static void send_bytes(char type, const uint8_t* bytes, uint8_t count);
+#endif
+
+void journal_start(uint32_t now, uint32_t* seed) {
+	start_time = now;
+	last_time = now;
+	loops = 0;
+#ifdef JOURNAL_REPLAY
+	replay_position = journal_replay_data;
+	next_time = now;
+	replay_time = now;
+	replay_running = 0;
+	if(pgm_read_byte(&replay_position[0]) != 'J' ||
+			pgm_read_byte(&replay_position[1]) != JOURNAL_VERSION) {
+		// Not a journal - finish straight away
+		next_token = JOURNAL_END;
+		return;
+	}
+	*seed = pgm_read_dword(&replay_position[2]);
+	replay_position += JOURNAL_HEADER_SIZE;
+	read_entry();
+#else
+	uint8_t header[JOURNAL_HEADER_SIZE] = {
+		'J', JOURNAL_VERSION, *seed, *seed >> 8, *seed >> 16, *seed >> 24
+	};
+	send_bytes('S', header, JOURNAL_HEADER_SIZE);
+#endif
+}
+
+void journal_record(uint32_t now, uint8_t token) {
+#ifndef JOURNAL_REPLAY
+	uint8_t entry[MAX_ENTRY_SIZE];
+	uint8_t size = 0;
+	uint32_t delta = now - last_time;
+
+	// 7 bits at a time, top bit set if there's more to follow
+	while(delta > 0x7F) {
+		entry[size++] = (delta & 0x7F) | 0x80;
+		delta >>= 7;
+	}
+	entry[size++] = delta;
+	entry[size++] = token;
+	last_time = now;
+	send_bytes('J', entry, size);
+#endif
+}
+
+void journal_sync(uint32_t now) {
+#ifdef JOURNAL_REPLAY
+	// Anything before the start of the level (i.e. a button push to skip
+	// the level number) has done its job
+	while(next_token != JOURNAL_SYNC && next_token != JOURNAL_END) {
+		read_entry();
+	}
+	if(next_token == JOURNAL_SYNC) {
+		next_time = now;
+		read_entry();
+	}
+	replay_time = now;
+	replay_running = 0;
+#else
+	journal_record(now, JOURNAL_SYNC);
+#endif
+}
+
+int16_t journal_replay_next(uint32_t now, uint8_t first, uint8_t last) {
+#ifdef JOURNAL_REPLAY
+	uint8_t token = next_token;
+	if(token != JOURNAL_END && now >= next_time && token >= first && token <= last) {
+		read_entry();
+		return token;
+	}
+#endif
+	return JOURNAL_NO_INPUT;
+}
+
+#ifdef JOURNAL_REPLAY
+uint32_t journal_replay_time(void) {
+	return replay_time;
+}
+
+uint32_t journal_replay_target(uint32_t now) {
+	uint32_t target = replay_time;
+	uint32_t limit;
+
+	if(replay_running) {
+		target += now - replay_real_time;
+	}
+	replay_real_time = now;
+	replay_running = 1;
+	// An input which was due but not taken on the last pass (it waited for
+	// another input at the same time) is taken on the next one, a
+	// millisecond later
+	limit = next_time > replay_time ? next_time : replay_time + 1;
+	if(target > limit) {
+		target = limit;
+	}
+	return target;
+}
+
+void journal_replay_played(uint32_t time) {
+	replay_time = time;
+}
+#endif
+
+uint8_t journal_replay_finished(uint32_t now) {
+#ifdef JOURNAL_REPLAY
+	return next_token == JOURNAL_END && now >= next_time;
+#else
+	return 0;
+#endif
+}
+
+void journal_finish(uint32_t now) {
+#ifdef JOURNAL_REPLAY
+	// Summary: game time, loops, score, lives and level. Comparing these
+	// between builds shows whether the replay followed the same game.
+	printf_P(PSTR("\x1b_R%lu,%lu,%lu,%u,%u\x1b\\"), now - start_time, loops,
+			get_score(), get_lives(), get_level());
+
+	// Stop once the summary has been sent (simavr stops here too)
+	while(UCSR0B & (1<<UDRIE0)) {
+		;
+	}
+	flight_watchdog_stop();
+	cli();
+	sleep_enable();
+	while(1) {
+		sleep_cpu();
+	}
+#else
+	journal_record(now, JOURNAL_END);
+#endif
+}
+
+void journal_count_loop(void) {
+	loops++;
+}
+
+#ifdef JOURNAL_REPLAY
+static void read_entry(void) {
+	uint32_t delta = 0;
+	uint8_t shift = 0;
+	uint8_t byte;
+
+	do {
+		byte = pgm_read_byte(replay_position++);
+		delta |= (uint32_t)(byte & 0x7F) << shift;
+		shift += 7;
+	} while(byte & 0x80);
+	next_time += delta;
+	next_token = pgm_read_byte(replay_position++);
+}
+#else
+// Send bytes (as hex) inside a terminal APC string of the given type
+static void send_bytes(char type, const uint8_t* bytes, uint8_t count) {
+	printf_P(PSTR("\x1b_%c"), type);
+	while(count--) {
+		printf_P(PSTR("%02X"), *bytes++);
+	}
+	printf_P(PSTR("\x1b\\"));
+}
+#endif
+
+#endif /* JOURNAL_ENABLED */
@@ -0,0 +1,112 @@
+/*
+ * journal.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Input journal. Every input consumed by the game (push button, serial
+ * character, joystick or button auto-repeat) can be recorded with the
+ * time it was consumed, and the recording played back later in place of
+ * the real inputs. Together with the lane generator seed this makes a
+ * game session repeatable, so different builds can be compared on exactly
+ * the same gameplay.
+ *
+ * Journal format: a 6 byte header ('J', version, 32 bit little-endian
+ * seed) then one entry per input - the number of milliseconds since the
+ * previous input (or the start of the game) as a variable length number
+ * (7 bits per byte, least significant first, top bit set if more bytes
+ * follow) and then a token byte. The last entry has the JOURNAL_END
+ * token.
+ *
+ * Build with JOURNAL_RECORD defined to record. The journal is sent on the
+ * serial port inside terminal APC strings (ESC _ ... ESC \), which
+ * terminals don't display, so the game can be played as normal while a
+ * serial log (or the simavr UART) is captured. tools/journal/jnltool
+ * extracts the journal from the log.
+ *
+ * Build with JOURNAL_REPLAY defined (and journal_replay_data.c generated
+ * by jnltool) to replay. Inputs then only come from the journal. When it
+ * ends, a summary is sent (see journal_finish()) and the CPU stops.
+ *
+ * A replay is played by the journal's clock rather than the real one. The
+ * clock follows the real time but never runs past the next input, and the
+ * play loop moves the game on to it a millisecond at a time (see
+ * play_game()), so every input is made at exactly the point in the game it
+ * was recorded at however long a pass of the loop takes.
+ */
+
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include <stdint.h>
+
+#define JOURNAL_VERSION 1
+#define JOURNAL_HEADER_SIZE 6
+
+// Tokens. Serial characters (0x00 to 0x7F) are recorded as themselves.
+// Button, joystick and repeat tokens include the number of the button or
+// direction (0 to 3).
+#define JOURNAL_SERIAL_MAX 0x7F
+#define JOURNAL_BUTTON 0x80
+#define JOURNAL_JOYSTICK 0x84
+#define JOURNAL_REPEAT 0x88
+#define JOURNAL_SYNC 0xFE
+#define JOURNAL_END 0xFF
+
+// Value returned when there is no input
+#define JOURNAL_NO_INPUT (-1)
+
+#if defined(JOURNAL_RECORD) || defined(JOURNAL_REPLAY)
+#define JOURNAL_ENABLED
+#endif
+
+#ifdef JOURNAL_ENABLED
+
+// Start a journal for a new game at time now (milliseconds). When
+// recording the seed is written to the journal; when replaying it is
+// replaced by the recorded seed.
+void journal_start(uint32_t now, uint32_t* seed);
+
+// Record that the given token was consumed at time now
+void journal_record(uint32_t now, uint8_t token);
+
+// Mark the start of play on a level. The time until the next input is
+// measured from here when replaying, so a build which takes longer to get
+// to this point (e.g. scrolling the level number) still replays the
+// inputs at the same points in the game.
+void journal_sync(uint32_t now);
+
+// When replaying, return the next input if it is due at time now and is
+// between first and last (inclusive, e.g. JOURNAL_BUTTON to
+// JOURNAL_BUTTON+3 for a button push), otherwise JOURNAL_NO_INPUT.
+// Inputs must be asked for in the same order as they were recorded. When
+// replaying, now is the journal's clock (journal_replay_time()).
+int16_t journal_replay_next(uint32_t now, uint8_t first, uint8_t last);
+
+#ifdef JOURNAL_REPLAY
+// The journal's clock - the time the game has been played to (ms)
+uint32_t journal_replay_time(void);
+
+// Return the time the game can be played to on this pass of the play loop,
+// given the real time now: on from journal_replay_time() by the real time
+// since the last call, but no further than the next input (or a
+// millisecond on if it is already due). No real time passes across
+// journal_start() and journal_sync().
+uint32_t journal_replay_target(uint32_t now);
+
+// Set the journal's clock to the time the game has been played to
+void journal_replay_played(uint32_t time);
+#endif
+
+// Return 1 once the end of a replayed journal is due at time now
+uint8_t journal_replay_finished(uint32_t now);
+
+// Record the end of the game. When replaying, send a summary of the
+// session and stop the CPU (never returns).
+void journal_finish(uint32_t now);
+
+// Count one pass of the game loop (reported in the summary)
+void journal_count_loop(void);
+
+#endif /* JOURNAL_ENABLED */
+
+#endif /* JOURNAL_H_ */
@@ -0,0 +1,156 @@
+/*
+ * lanegen.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include <stdint.h>
+
+#include "lanegen.h"
+#include "fieldsim.h"
+
+static uint32_t game_seed;
+static uint32_t random_state;
+static uint8_t attempts;
+
+// Density settings for one kind of row: the length of runs (vehicles or
+// logs) and of the gaps between them
+typedef struct {
+	uint8_t min_run;
+	uint8_t max_run;
+	uint8_t min_gap;
+	uint8_t max_gap;
+} RowDensity;
+
+void lanegen_set_seed(uint32_t seed) {
+	game_seed = seed;
+}
+
+uint32_t lanegen_get_seed(void) {
+	return game_seed;
+}
+
+uint8_t lanegen_attempts(void) {
+	return attempts;
+}
+
+// xorshift32 pseudo random number generator
+static uint32_t next_random(void) {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+// Random number from min to max inclusive (max - min < 256)
+static uint8_t random_between(uint8_t min, uint8_t max) {
+	return min + (uint8_t)next_random() % (uint8_t)(max - min + 1);
+}
+
+// Vehicles get longer and closer together as the levels go on. Logs get
+// shorter (but the gaps between them stay jumpable).
+static void density_for_level(uint8_t level, RowDensity* vehicles, RowDensity* logs) {
+	uint8_t step = (level > 24) ? 6 : level / 4;
+	
+	vehicles->min_run = 2;
+	vehicles->max_run = 3 + (step >> 1);
+	vehicles->min_gap = (step < 3) ? 3 : 2;
+	vehicles->max_gap = 9 - step;
+	
+	logs->min_run = 2;
+	logs->max_run = 6 - (step >> 1);
+	logs->min_gap = 1;
+	logs->max_gap = 3;
+}
+
+// Build a pattern of alternating runs and gaps, starting at a random
+// column. Once the space left is no more than one run and gap, the last
+// run and gap are sized to fill it exactly so the gap which wraps around
+// from the end to the start also meets the density settings. Returns 0 if
+// that isn't possible. (Bits are set in a byte array since variable 64 bit
+// shifts are slow on the AVR.)
+static uint8_t generate_pattern(uint8_t width, const RowDensity* density, uint64_t* pattern) {
+	uint8_t bits[8] = { 0 };
+	uint8_t offset = random_between(0, width - 1);
+	uint8_t position = 0;
+	uint8_t ok = 1;
+	
+	while(position < width) {
+		uint8_t left = width - position;
+		uint8_t run = random_between(density->min_run, density->max_run);
+		uint8_t gap = random_between(density->min_gap, density->max_gap);
+		if(left <= density->max_run + density->max_gap) {
+			// Last run and gap - make them fill the rest of the row
+			if(left < run + density->min_gap) {
+				run = left - density->min_gap;
+			} else if(left > run + density->max_gap) {
+				run = left - density->max_gap;
+			}
+			gap = left - run;
+			ok = run >= density->min_run && run <= density->max_run;
+		} else if(left - run - gap < density->min_run + density->min_gap) {
+			// Leave room for at least one more run and gap
+			run = density->min_run;
+			gap = density->min_gap;
+		}
+		for(uint8_t i = 0; i < run; i++) {
+			uint8_t bit = offset + position + i;
+			if(bit >= width) {
+				bit -= width;
+			}
+			bits[bit >> 3] |= 1 << (bit & 7);
+		}
+		position += run + gap;
+	}
+	
+	*pattern = 0;
+	for(uint8_t i = 0; i < 8; i++) {
+		*pattern |= (uint64_t)bits[i] << (i * 8);
+	}
+	return ok;
+}
+
+uint8_t lanegen_solvable(const RowMotion motion[5], uint16_t riverbank,
+		const uint64_t patterns[5]) {
+	FieldSim sim;
+	// Every hole not yet filled must be reachable
+	uint16_t open_holes = ~riverbank;
+	
+	// Sweep from the start position
+	for(uint8_t row = 0; row < 5; row++) {
+		fieldsim_init_row(&sim, row, patterns[row],
+				(row < 3) ? LANEGEN_LANE_WIDTH : LANEGEN_LOG_WIDTH, 0, &motion[row], 0, 0);
+	}
+	sim.riverbank_status = riverbank;
+	return fieldsim_reachable_holes(&sim, 0, 7, LANEGEN_STEP_MS, LANEGEN_STEPS) == open_holes;
+}
+
+uint8_t lanegen_generate(uint8_t level, const RowMotion motion[5], uint16_t riverbank,
+		uint64_t lanes[3], uint32_t logs[2]) {
+	RowDensity vehicle_density, log_density;
+	uint64_t candidate[5];
+	
+	density_for_level(level, &vehicle_density, &log_density);
+	random_state = (game_seed ^ ((uint32_t)level * 0x9E3779B9UL)) | 1;
+	
+	for(attempts = 1; attempts <= LANEGEN_MAX_ATTEMPTS; attempts++) {
+		uint8_t ok = 1;
+		for(uint8_t row = 0; row < 5 && ok; row++) {
+			if(row < 3) {
+				ok = generate_pattern(LANEGEN_LANE_WIDTH, &vehicle_density, &candidate[row]);
+			} else {
+				ok = generate_pattern(LANEGEN_LOG_WIDTH, &log_density, &candidate[row]);
+			}
+		}
+		if(ok && lanegen_solvable(motion, riverbank, candidate)) {
+			for(uint8_t lane = 0; lane < 3; lane++) {
+				lanes[lane] = candidate[lane];
+			}
+			logs[0] = (uint32_t)candidate[3];
+			logs[1] = (uint32_t)candidate[4];
+			return 1;
+		}
+	}
+	attempts = LANEGEN_MAX_ATTEMPTS;
+	return 0;
+}
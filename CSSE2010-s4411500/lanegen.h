@@ -0,0 +1,53 @@
+/*
+ * lanegen.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Procedural lane generator for the levels beyond the end of the level
+ * table. Vehicle and log patterns are built from a seeded pseudo random
+ * number generator as alternating runs (vehicles or logs) and gaps whose
+ * lengths are limited by the level's density settings. Each candidate is
+ * then checked with a reachability sweep (see fieldsim.h) and rejected
+ * unless every riverbank hole can be reached before the countdown runs
+ * out. The same seed and level always give the same patterns.
+ */
+
+#ifndef LANEGEN_H_
+#define LANEGEN_H_
+
+#include <stdint.h>
+#include "motion.h"
+
+// Generated lanes are 64 bits wide and log channels 32 bits
+#define LANEGEN_LANE_WIDTH 64
+#define LANEGEN_LOG_WIDTH 32
+
+// The solvability check assumes the frog moves once every LANEGEN_STEP_MS
+// and must reach a hole within LANEGEN_STEPS moves (the 30 second
+// countdown). Generation gives up after LANEGEN_MAX_ATTEMPTS candidates.
+#define LANEGEN_STEP_MS 200
+#define LANEGEN_STEPS 150
+#define LANEGEN_MAX_ATTEMPTS 8
+
+// Set the seed used for the following levels (e.g. once per game)
+void lanegen_set_seed(uint32_t seed);
+uint32_t lanegen_get_seed(void);
+
+// Generate lane and log patterns for the given level. motion gives the
+// speed and direction of the 3 lanes then the 2 log channels and
+// riverbank the riverbank pattern. Returns 1 if solvable patterns were
+// written to lanes and logs, 0 if every attempt failed (in which case
+// lanes and logs are unchanged).
+uint8_t lanegen_generate(uint8_t level, const RowMotion motion[5], uint16_t riverbank,
+		uint64_t lanes[3], uint32_t logs[2]);
+
+// Return 1 if every riverbank hole not already filled can be reached with
+// the given patterns (3 lanes then 2 log channels, the widths above) -
+// the check each candidate must pass
+uint8_t lanegen_solvable(const RowMotion motion[5], uint16_t riverbank,
+		const uint64_t patterns[5]);
+
+// Number of candidate patterns tried by the last call to lanegen_generate()
+uint8_t lanegen_attempts(void);
+
+#endif /* LANEGEN_H_ */
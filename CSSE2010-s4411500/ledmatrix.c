@@ -17,11 +17,18 @@
 #define CMD_SHIFT_DISPLAY 0x04
 #define CMD_CLEAR_SCREEN 0x0F
 
+// Can be given at build time to try other speeds (see spi.h)
+#ifndef SPI_CLOCK_DIVIDER
+#define SPI_CLOCK_DIVIDER 128
+#endif
+
+static void send_packed_row(const MatrixPackedRow row, const PixelColour* palette);
+
 void ledmatrix_setup(void) {
 	// Setup SPI - we divide the clock by 128.
 	// (This speed guarantees the SPI buffer will never overflow on
 	// the LED matrix.)
-	spi_setup_master(128);
+	spi_setup_master(SPI_CLOCK_DIVIDER);
 }
 
 void ledmatrix_update_all(MatrixData data) {
@@ -91,6 +98,24 @@ void ledmatrix_clear(void) {
 	(void)spi_send_byte(CMD_CLEAR_SCREEN);
 }
 
+void ledmatrix_update_row_packed(uint8_t y, const MatrixPackedRow row,
+		const PixelColour* palette) {
+	if(y >= MATRIX_NUM_ROWS) {
+		// y value is too large - we ignore the request
+		return;
+	}
+	(void)spi_send_byte(CMD_UPDATE_ROW);
+	(void)spi_send_byte(y & 0x07);	// row number
+	send_packed_row(row, palette);
+}
+
+void ledmatrix_update_all_packed(const MatrixPackedData data, const PixelColour* palette) {
+	(void)spi_send_byte(CMD_UPDATE_ALL);
+	for(uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+		send_packed_row(data[y], palette);
+	}
+}
+
 void copy_matrix_column(MatrixColumn from, MatrixColumn to) {
 	for(uint8_t row = 0; row <MATRIX_NUM_ROWS; row++) {
 		to[row] = from[row];
@@ -114,3 +139,13 @@ void set_matrix_row_to_colour(MatrixRow matrix_row, PixelColour colour) {
 		matrix_row[column] = colour;
 	}
 }
+
+// Send the colours of a packed row, left to right. Each pair of indices
+// is only looked up in the palette as it is sent.
+static void send_packed_row(const MatrixPackedRow row, const PixelColour* palette) {
+	for(uint8_t i = 0; i < MATRIX_PACKED_ROW_BYTES; i++) {
+		uint8_t pair = row[i];
+		(void)spi_send_byte(palette[pair & 0x0F]);
+		(void)spi_send_byte(palette[pair >> 4]);
+	}
+}
@@ -21,6 +21,12 @@ typedef PixelColour MatrixData[MATRIX_NUM_COLUMNS][MATRIX_NUM_ROWS];
 typedef PixelColour MatrixRow[MATRIX_NUM_COLUMNS];
 typedef PixelColour MatrixColumn[MATRIX_NUM_ROWS];
 
+// Rows of 4 bit palette indices, two pixels to a byte (the even column in
+// the low 4 bits). Unlike MatrixData, MatrixPackedData is stored by row.
+#define MATRIX_PACKED_ROW_BYTES (MATRIX_NUM_COLUMNS / 2)
+typedef uint8_t MatrixPackedRow[MATRIX_PACKED_ROW_BYTES];
+typedef MatrixPackedRow MatrixPackedData[MATRIX_NUM_ROWS];
+
 // Setup SPI communication with the LED matrix.
 // This function must be called before the LED matrix functions
 // below are used.
@@ -40,6 +46,12 @@ void ledmatrix_shift_display_up(void);
 void ledmatrix_shift_display_down(void);
 void ledmatrix_clear(void);
 
+// Send a packed row, or all of the rows, looking each index up in the
+// given palette (of 16 colours) as it is sent
+void ledmatrix_update_row_packed(uint8_t y, const MatrixPackedRow row,
+		const PixelColour* palette);
+void ledmatrix_update_all_packed(const MatrixPackedData data, const PixelColour* palette);
+
 // Functions to operate on rows and columns
 void copy_matrix_column(MatrixColumn from, MatrixColumn to);
 void copy_matrix_row(MatrixRow from, MatrixRow to);
@@ -11,6 +11,8 @@
 #include <stdio.h>
 
 #include "level.h"
+#include "statebus.h"
+#include "level_data.h"
 #include "live.h"
 #include "score.h"
 #include "buttons.h"
@@ -27,12 +29,58 @@ uint8_t level;
 
 void init_level(void) {
 	level = 0;
+	state_changed(STATE_LEVEL);
 }
 
 void add_level(void) {
 	level++;
+	state_changed(STATE_LEVEL);
 }
 
 uint8_t get_level(void) {
 	return level;
-}
\ No newline at end of file
+}
+
+void set_level(uint8_t value) {
+	level = value;
+	state_changed(STATE_LEVEL);
+}
+
+const uint8_t* level_descriptor(uint8_t level_number) {
+	// Level numbers start at 1. (Level 0 - before the first level has
+	// started - uses the first descriptor.)
+	if(level_number > NUM_LEVEL_DESCRIPTORS) {
+		level_number = NUM_LEVEL_DESCRIPTORS;
+	} else if(level_number == 0) {
+		level_number = 1;
+	}
+	return &level_table[pgm_read_word(&level_offsets[level_number - 1])];
+}
+
+uint8_t level_is_generated(uint8_t level_number) {
+	return level_number > NUM_LEVEL_DESCRIPTORS;
+}
+
+const uint8_t* level_read_riverbank(const uint8_t* record, uint16_t* riverbank) {
+	*riverbank = pgm_read_word(record);
+	return record + 2;
+}
+
+const uint8_t* level_read_lane(const uint8_t* record, LaneDescriptor* lane) {
+	uint8_t width_and_direction = pgm_read_byte(record++);
+	lane->width = width_and_direction & 0x7F;
+	lane->direction = (width_and_direction & 0x80) ? 1 : -1;
+	lane->period = pgm_read_word(record);
+	record += 2;
+	lane->rate = pgm_read_byte(record++);
+	lane->accel = (int8_t)pgm_read_byte(record++);
+	lane->rate_limit = pgm_read_byte(record++);
+	lane->colour = pgm_read_byte(record++);
+	
+	// Pattern bytes are stored least significant first
+	lane->pattern = 0;
+	for(uint8_t bit = 0; bit < lane->width; bit += 8) {
+		lane->pattern |= (uint64_t)pgm_read_byte(record++) << bit;
+	}
+	return record;
+}
@@ -8,9 +8,41 @@
 #define LEVEL_H_
 
 #include <stdint.h>
+#include "pixel_colour.h"
 
 void init_level(void);
 void add_level(void);
 uint8_t get_level(void);
+void set_level(uint8_t value);
+
+// Decoded description of one traffic lane or log channel. The pattern
+// is width bits long (bit 0 is in column 0 at the start of the level) and
+// the row moves rate columns in the given direction every period ms.
+// If accel is not zero, rate changes by accel every 1024ms until it
+// reaches rate_limit.
+typedef struct {
+	uint64_t pattern;
+	uint16_t period;
+	uint8_t rate;
+	int8_t accel;
+	uint8_t rate_limit;
+	uint8_t width;
+	int8_t direction;
+	PixelColour colour;
+} LaneDescriptor;
+
+// The level descriptors are stored packed in flash (see level_data.c,
+// generated by tools/levelc from the files in levels/). Levels beyond the
+// end of the table reuse the speeds and colours of the last descriptor.
+// level_descriptor() returns the flash address of the given level's
+// record. The read functions decode one part of the record and return the
+// address of the next part: the riverbank comes first, followed by the
+// three traffic lanes (rows 1 to 3) then the two log channels (rows 5, 6).
+// Levels beyond the end of the table also get procedurally generated 
+// lane patterns (see lanegen.h) - level_is_generated() returns 1 for these.
+const uint8_t* level_descriptor(uint8_t level_number);
+uint8_t level_is_generated(uint8_t level_number);
+const uint8_t* level_read_riverbank(const uint8_t* record, uint16_t* riverbank);
+const uint8_t* level_read_lane(const uint8_t* record, LaneDescriptor* lane);
 
 #endif /* LEVEL_H_ */
\ No newline at end of file
@@ -0,0 +1,50 @@
+/*
+ * level_data.c
+ *
+ * Generated by tools/levelc - do not edit.
+ */
+
+#include <avr/pgmspace.h>
+
+#include "level_data.h"
+#include "pixel_colour.h"
+
+const uint8_t level_table[] PROGMEM = {
+	// Level 1 (level1.txt), 69 bytes
+	0xDD, 0xDD,
+	0xC0, 0x4C, 0x04, 0x01, 0x00, 0x01, COLOUR_RED, 0x98, 0xC1, 0x18, 0xC3, 0x98, 0xC1, 0x18, 0xC3,
+	0x40, 0x7E, 0x04, 0x01, 0x00, 0x01, COLOUR_YELLOW, 0x1C, 0x0E, 0xC7, 0xE1, 0x70, 0x70, 0x38, 0x38,
+	0xC0, 0x52, 0x03, 0x01, 0x00, 0x01, COLOUR_RED, 0xC7, 0xC3, 0x07, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+	0x20, 0xB6, 0x03, 0x01, 0x00, 0x01, COLOUR_ORANGE, 0xF8, 0x78, 0x9C, 0xF1,
+	0xA0, 0xB0, 0x04, 0x01, 0x00, 0x01, COLOUR_ORANGE, 0x9C, 0x1D, 0xF6, 0xE6,
+	// Level 2 (level2.txt), 69 bytes
+	0xDD, 0xDD,
+	0xC0, 0xB0, 0x04, 0x01, 0x00, 0x01, COLOUR_RED, 0x98, 0xC1, 0x18, 0xC3, 0x98, 0xC1, 0x18, 0xC3,
+	0x40, 0xB0, 0x04, 0x01, 0x00, 0x01, COLOUR_YELLOW, 0x1C, 0x0E, 0xC7, 0xE1, 0x70, 0x70, 0x38, 0x38,
+	0xC0, 0x84, 0x03, 0x01, 0x00, 0x01, COLOUR_RED, 0xC7, 0xC3, 0x07, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+	0x20, 0xE8, 0x03, 0x01, 0x00, 0x01, COLOUR_ORANGE, 0xF8, 0x78, 0x9C, 0xF1,
+	0xA0, 0xE2, 0x04, 0x01, 0x00, 0x01, COLOUR_ORANGE, 0x9C, 0x1D, 0xF6, 0xE6,
+	// Level 3 (level3.txt), 69 bytes
+	0xDD, 0xDD,
+	0xC0, 0x14, 0x05, 0x01, 0x00, 0x01, COLOUR_RED, 0x98, 0xC1, 0x18, 0xC3, 0x98, 0xC1, 0x18, 0xC3,
+	0x40, 0xE2, 0x04, 0x01, 0x00, 0x01, COLOUR_YELLOW, 0x1C, 0x0E, 0xC7, 0xE1, 0x70, 0x70, 0x38, 0x38,
+	0xC0, 0xB6, 0x03, 0x01, 0x00, 0x01, COLOUR_RED, 0xC7, 0xC3, 0x07, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+	0x20, 0x1A, 0x04, 0x01, 0x00, 0x01, COLOUR_ORANGE, 0xF8, 0x78, 0x9C, 0xF1,
+	0xA0, 0x14, 0x05, 0x01, 0x00, 0x01, COLOUR_ORANGE, 0x9C, 0x1D, 0xF6, 0xE6,
+	// Level 4 (level4.txt), 69 bytes
+	0xDD, 0xDD,
+	0xC0, 0x78, 0x05, 0x01, 0x00, 0x01, COLOUR_RED, 0x98, 0xC1, 0x18, 0xC3, 0x98, 0xC1, 0x18, 0xC3,
+	0x40, 0x14, 0x05, 0x01, 0x00, 0x01, COLOUR_YELLOW, 0x1C, 0x0E, 0xC7, 0xE1, 0x70, 0x70, 0x38, 0x38,
+	0xC0, 0xE8, 0x03, 0x01, 0x00, 0x01, COLOUR_RED, 0xC7, 0xC3, 0x07, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+	0x20, 0x4C, 0x04, 0x01, 0x00, 0x01, COLOUR_ORANGE, 0xF8, 0x78, 0x9C, 0xF1,
+	0xA0, 0x46, 0x05, 0x01, 0x00, 0x01, COLOUR_ORANGE, 0x9C, 0x1D, 0xF6, 0xE6,
+	// Level 5 (level5.txt), 69 bytes
+	0xDD, 0xDD,
+	0xC0, 0xDC, 0x05, 0x01, 0x00, 0x01, COLOUR_RED, 0x98, 0xC1, 0x18, 0xC3, 0x98, 0xC1, 0x18, 0xC3,
+	0x40, 0x46, 0x05, 0x01, 0x00, 0x01, COLOUR_YELLOW, 0x1C, 0x0E, 0xC7, 0xE1, 0x70, 0x70, 0x38, 0x38,
+	0xC0, 0x1A, 0x04, 0x01, 0x00, 0x01, COLOUR_RED, 0xC7, 0xC3, 0x07, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+	0x20, 0x7E, 0x04, 0x01, 0x00, 0x01, COLOUR_ORANGE, 0xF8, 0x78, 0x9C, 0xF1,
+	0xA0, 0x78, 0x05, 0x01, 0x00, 0x01, COLOUR_ORANGE, 0x9C, 0x1D, 0xF6, 0xE6,
+};
+
+const uint16_t level_offsets[NUM_LEVEL_DESCRIPTORS] PROGMEM = { 0, 69, 138, 207, 276 };
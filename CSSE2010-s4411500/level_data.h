@@ -0,0 +1,19 @@
+/*
+ * level_data.h
+ *
+ * Generated by tools/levelc - do not edit.
+ */
+
+#ifndef LEVEL_DATA_H_
+#define LEVEL_DATA_H_
+
+#include <stdint.h>
+
+#define NUM_LEVEL_DESCRIPTORS 5
+
+// Packed level records (see tools/levelc.c for the format) and the
+// offset of each level's record in the table. Both live in flash.
+extern const uint8_t level_table[];
+extern const uint16_t level_offsets[NUM_LEVEL_DESCRIPTORS];
+
+#endif /* LEVEL_DATA_H_ */
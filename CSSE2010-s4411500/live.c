@@ -11,41 +11,41 @@
 #include <stdio.h>
 
 #include "live.h"
-#include "terminalio.h"
+#include "statebus.h"
 
 
 uint8_t lives = 0;
 uint8_t initial_lives = 3;
 uint8_t max_lives = 4;
 
+// Subscriber to STATE_LIVES (see statebus.h)
+static void show_lives(uint8_t changes) {
+	displayLED_lives();
+}
+
 void init_lives_display(void) {
 	DDRA |= 0x0F;
 	PORTA &= 0xF0;
+	statebus_subscribe(STATEBUS_LIVES_LEDS, STATE_LIVES, show_lives);
 }
 
 void init_lives(void) {
 	lives = initial_lives;
-	
-	displayLED_lives();
+	state_changed(STATE_LIVES);
 }
 
 void add_lives(void) {
 	if(lives < max_lives) {
 		lives++;
+		state_changed(STATE_LIVES);
 	}
-	
-	displayLED_lives();
 }
 
 void reduce_lives(void) {
 	if(lives > 0) {
 		lives--;
+		state_changed(STATE_LIVES);
 	}
-	
-	move_cursor(55,15);
-	printf_P(PSTR("Lives:%10d"), get_lives());
-	
-	displayLED_lives();
 }
 
 uint8_t no_more_live(void) {
@@ -56,6 +56,16 @@ uint8_t get_lives(void) {
 	return lives;
 }
 
+void set_lives(uint8_t value) {
+	if(value > max_lives) {
+		value = max_lives;
+	}
+	if(value != lives) {
+		lives = value;
+		state_changed(STATE_LIVES);
+	}
+}
+
 void displayLED_lives(void) {
 	
 	/* A0 - A3 are outputs
@@ -65,9 +75,6 @@ void displayLED_lives(void) {
 	 * A3 -> L3
 	 */
 	
-	PORTA &= 0xF0;
-	
-	for(uint8_t i = 0; i < lives;  i++) {
-		PORTA |= (1 << i);
-	}
+	// (One write, so the LEDs don't all go off for a moment)
+	PORTA = (PORTA & 0xF0) | ((1 << lives) - 1);
 }
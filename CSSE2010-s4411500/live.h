@@ -15,6 +15,7 @@ void add_lives(void);
 void reduce_lives(void);
 uint8_t no_more_live(void);
 uint8_t get_lives(void);
+void set_lives(uint8_t value);
 void displayLED_lives(void);
 
 #endif /* LIVES_H_ */
\ No newline at end of file
@@ -0,0 +1,46 @@
+/*
+ * log.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#ifdef LOG_ENABLED
+
+#include <stdint.h>
+#include <util/atomic.h>
+
+#include "log.h"
+#include "serialio.h"
+
+// Read by interrupt handlers as they log
+static volatile uint8_t log_on = 1;
+static volatile uint16_t dropped;
+
+void log_send(const void* frame, uint8_t size) {
+	if(log_on && !serial_put_bytes(frame, size)) {
+		// (Interrupt handlers log too)
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			if(dropped < UINT16_MAX) {
+				dropped++;
+			}
+		}
+	}
+}
+
+void log_set_enabled(uint8_t enabled) {
+	log_on = enabled;
+}
+
+uint8_t log_is_enabled(void) {
+	return log_on;
+}
+
+uint16_t log_dropped(void) {
+	uint16_t count;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		count = dropped;
+	}
+	return count;
+}
+
+#endif /* LOG_ENABLED */
@@ -0,0 +1,110 @@
+/*
+ * log.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Binary event log on the serial port. LOG(name, args...) sends a frame of
+ * LOG_FRAME_START, the event number and the arguments as they are in
+ * memory (least significant byte first) - e.g. 7 bytes for LANE_STEP
+ * rather than the 20 or so characters printf_P() would format. The events
+ * and their formats are listed in log_events.h; the formats stay on the
+ * host, where tools/log/logdec turns a capture of the serial port back
+ * into text.
+ *
+ * Frames go straight into the serial output buffer as a whole, or not at
+ * all if there isn't room (counted by log_dropped()), so LOG() never waits
+ * and can be used in interrupt handlers. Terminal text never contains
+ * LOG_FRAME_START, so logdec can pick the frames out of it (and pass the
+ * text through if asked).
+ *
+ * Build with LOG_ENABLED defined to send the events. Otherwise LOG()
+ * does nothing (and its arguments aren't evaluated). The frames would be
+ * taken for bad frames by the other board in a versus race (versus.h) and
+ * could be mixed into the middle of a recorded journal (journal.h), so
+ * LOG_ENABLED can't be used with VERSUS_ENABLED or JOURNAL_RECORD.
+ */
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <stdint.h>
+
+// First byte of every frame - not a character the terminal text uses
+#define LOG_FRAME_START 0xFF
+
+// The event numbers (LOG_LANE_STEP and so on), in the order of
+// log_events.h
+#define LOG_EVENT0(name, format) LOG_##name,
+#define LOG_EVENT1(name, format, t1) LOG_##name,
+#define LOG_EVENT2(name, format, t1, t2) LOG_##name,
+#define LOG_EVENT3(name, format, t1, t2, t3) LOG_##name,
+enum {
+#include "log_events.h"
+	LOG_NUM_EVENTS
+};
+#undef LOG_EVENT0
+#undef LOG_EVENT1
+#undef LOG_EVENT2
+#undef LOG_EVENT3
+
+#ifdef LOG_ENABLED
+
+#if defined(VERSUS_ENABLED) || defined(JOURNAL_RECORD)
+#error "LOG_ENABLED can't be used with VERSUS_ENABLED or JOURNAL_RECORD"
+#endif
+
+// Send a frame (LOG_FRAME_START, the event number and the arguments) if
+// logging is on and there is room for all of it in the serial output
+// buffer. Used by the functions below.
+void log_send(const void* frame, uint8_t size);
+
+// Turn the log on or off (it starts on)
+void log_set_enabled(uint8_t enabled);
+uint8_t log_is_enabled(void);
+
+// Number of frames thrown away because the output buffer was full (up to
+// 65535)
+uint16_t log_dropped(void);
+
+// A function for each event, log_LANE_STEP() and so on, which converts
+// the arguments to the event's types and sends the frame
+#define LOG_EVENT0(name, format) \
+	static inline void log_##name(void) { \
+		struct __attribute__((packed)) {uint8_t start, event;} \
+				frame = {LOG_FRAME_START, LOG_##name}; \
+		log_send(&frame, sizeof(frame)); \
+	}
+#define LOG_EVENT1(name, format, t1) \
+	static inline void log_##name(t1 a1) { \
+		struct __attribute__((packed)) {uint8_t start, event; t1 a1;} \
+				frame = {LOG_FRAME_START, LOG_##name, a1}; \
+		log_send(&frame, sizeof(frame)); \
+	}
+#define LOG_EVENT2(name, format, t1, t2) \
+	static inline void log_##name(t1 a1, t2 a2) { \
+		struct __attribute__((packed)) {uint8_t start, event; t1 a1; t2 a2;} \
+				frame = {LOG_FRAME_START, LOG_##name, a1, a2}; \
+		log_send(&frame, sizeof(frame)); \
+	}
+#define LOG_EVENT3(name, format, t1, t2, t3) \
+	static inline void log_##name(t1 a1, t2 a2, t3 a3) { \
+		struct __attribute__((packed)) {uint8_t start, event; t1 a1; t2 a2; t3 a3;} \
+				frame = {LOG_FRAME_START, LOG_##name, a1, a2, a3}; \
+		log_send(&frame, sizeof(frame)); \
+	}
+#include "log_events.h"
+#undef LOG_EVENT0
+#undef LOG_EVENT1
+#undef LOG_EVENT2
+#undef LOG_EVENT3
+
+// Log an event, e.g. LOG(LANE_STEP, lane, steps)
+#define LOG(name, ...) log_##name(__VA_ARGS__)
+
+#else
+
+#define LOG(...)
+
+#endif /* LOG_ENABLED */
+
+#endif /* LOG_H_ */
@@ -0,0 +1,30 @@
+/*
+ * log_events.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * The binary log events (see log.h) - one line for each, with its name,
+ * format and the types of its arguments:
+ *     LOG_EVENTn(name, format, type1, ... typen)
+ * This file is included more than once with LOG_EVENT0 to LOG_EVENT3
+ * defined differently each time: by log.h for the event numbers and the
+ * functions that send them (where the formats are thrown away), and by
+ * tools/log/logdec for its table of formats. So the formats are never in
+ * the firmware, and the decoder is always built from the same list.
+ *
+ * Only fixed width types (uint8_t to int32_t) can be used as the argument
+ * types, since they're the same size on the host as on the AVR. The
+ * formats are printf formats with a conversion for each argument - the
+ * length modifiers (l, h) aren't needed but are allowed. Add new events at
+ * the end so that the numbers of the others stay the same.
+ *
+ * No include guard - it's meant to be included more than once.
+ */
+
+LOG_EVENT2(LANE_STEP, "lane %u step %lu", uint8_t, uint32_t)
+LOG_EVENT3(LOG_STEP, "log %u step %lu, frog column %d", uint8_t, uint32_t, int8_t)
+LOG_EVENT2(MISSED_STEP, "row %u missed step %lu", uint8_t, uint32_t)
+LOG_EVENT3(FROG_DIED, "frog died at row %u column %d, %u lives left", uint8_t, int8_t, uint8_t)
+LOG_EVENT2(FROG_CROSSED, "frog crossed at column %d, score %lu", int8_t, uint32_t)
+LOG_EVENT2(LEVEL_START, "level %u, seed 0x%08lx", uint8_t, uint32_t)
+LOG_EVENT1(SERIAL_OVERRUN, "serial input overrun (%u so far)", uint8_t)
@@ -0,0 +1,137 @@
+/*
+ * motion.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "motion.h"
+
+static uint32_t phase_at(const RowMotion* motion, uint32_t time);
+static uint32_t accelerating_phase(const RowMotion* motion, uint32_t time);
+
+void divider_init(Divider* divider, uint16_t divisor) {
+	// The only division - done once when the level is set up
+	divider->divisor = divisor;
+	divider->inverse = divisor ? 0xFFFFFFFFUL / divisor : 0;
+}
+
+uint32_t divider_divide(const Divider* divider, uint32_t n, uint16_t* remainder) {
+	// The top 32 bits of n x inverse, from three 16 x 16 bit multiplies
+	// (a 64 bit multiply is a long library routine on the AVR). The low
+	// halves' product is left out, which can only make the result 1 less.
+	uint16_t n_high = n >> 16;
+	uint16_t n_low = n;
+	uint16_t inverse_high = divider->inverse >> 16;
+	uint16_t inverse_low = divider->inverse;
+	uint32_t cross = (uint32_t)n_high * inverse_low;
+	uint32_t quotient;
+	uint32_t left;
+	
+	cross = (cross >> 16) + (((cross & 0xFFFF) + ((uint32_t)n_low * inverse_high)) >> 16);
+	quotient = (uint32_t)n_high * inverse_high + cross;
+	
+	// inverse is at most 1 less than 2^32 / divisor, so this is n / divisor
+	// or up to 2 less
+	left = n - quotient * divider->divisor;
+	while(left >= divider->divisor) {
+		quotient++;
+		left -= divider->divisor;
+	}
+	if(remainder) {
+		*remainder = left;
+	}
+	return quotient;
+}
+
+void motion_init(RowMotion* motion, uint16_t period, uint8_t rate, int8_t accel,
+		uint8_t rate_limit, int8_t direction) {
+	uint32_t intervals = 0;
+	int16_t final_rate = rate;
+	
+	divider_init(&motion->period, period);
+	motion->rate = rate;
+	motion->accel = accel;
+	motion->direction = direction;
+	
+	if(accel) {
+		// Count the intervals until the rate reaches the limit. The rate
+		// changes at the end of each interval, and is set to the limit
+		// once the change would reach (or pass) it.
+		do {
+			intervals++;
+			final_rate += accel;
+		} while(!((accel > 0 && final_rate >= rate_limit) ||
+				(accel < 0 && final_rate <= rate_limit)));
+		final_rate = rate_limit;
+	}
+	motion->accel_end = intervals << MOTION_ACCEL_SHIFT;
+	motion->accel_phase = accelerating_phase(motion, motion->accel_end);
+	divider_init(&motion->final_rate, final_rate);
+}
+
+uint32_t motion_steps_at(const RowMotion* motion, uint32_t time) {
+	return divider_divide(&motion->period, phase_at(motion, time), NULL);
+}
+
+uint32_t motion_step_time(const RowMotion* motion, uint32_t step) {
+	uint32_t phase = step * motion->period.divisor;
+	uint32_t low, high, middle;
+	
+	if(phase > motion->accel_phase) {
+		// After any acceleration - the first ms at the final rate which
+		// gets the phase needed
+		if(motion->final_rate.divisor == 0) {
+			return MOTION_NEVER;
+		}
+		return motion->accel_end + divider_divide(&motion->final_rate,
+				phase - motion->accel_phase - 1, NULL) + 1;
+	}
+	
+	// While accelerating - search for the first ms with the phase needed
+	low = 0;
+	high = motion->accel_end;
+	while(low < high) {
+		middle = low + ((high - low) >> 1);
+		if(phase_at(motion, middle) >= phase) {
+			high = middle;
+		} else {
+			low = middle + 1;
+		}
+	}
+	return low;
+}
+
+uint8_t motion_position(const RowMotion* motion, const Divider* width_divider, uint32_t steps) {
+	uint16_t offset;
+	
+	divider_divide(width_divider, steps, &offset);
+	if(motion->direction > 0 && offset) {
+		offset = width_divider->divisor - offset;
+	}
+	return offset;
+}
+
+// Rate x ms accumulated by the given time
+static uint32_t phase_at(const RowMotion* motion, uint32_t time) {
+	if(time >= motion->accel_end) {
+		return motion->accel_phase +
+				(uint32_t)motion->final_rate.divisor * (time - motion->accel_end);
+	}
+	return accelerating_phase(motion, time);
+}
+
+// Rate x ms accumulated by the given time (no later than accel_end). The
+// rate in interval i is rate + i x accel, so the complete intervals add up
+// to an arithmetic series.
+static uint32_t accelerating_phase(const RowMotion* motion, uint32_t time) {
+	uint32_t intervals = time >> MOTION_ACCEL_SHIFT;
+	uint32_t rest = time & (MOTION_ACCEL_INTERVAL - 1);
+	int32_t complete = (int32_t)intervals * motion->rate +
+			(int32_t)((intervals * (intervals - 1)) >> 1) * motion->accel;
+	
+	return ((uint32_t)complete << MOTION_ACCEL_SHIFT) +
+			(uint32_t)(motion->rate + (int32_t)intervals * motion->accel) * rest;
+}
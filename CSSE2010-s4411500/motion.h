@@ -0,0 +1,78 @@
+/*
+ * motion.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Movement of a traffic lane or log channel as a function of time. A row
+ * moves rate columns every period ms, so after t ms of a level it has
+ * moved (rate x t) / period columns - fractional speeds are possible and
+ * the long run speed is exact. If accel is non-zero, rate changes by
+ * accel every MOTION_ACCEL_INTERVAL ms until it reaches rate_limit; the
+ * distance moved is then an arithmetic series up to the limit plus a
+ * constant rate after it.
+ *
+ * Nothing in a RowMotion changes during a level. The number of steps
+ * made by any time, and the time of any step, are worked out directly
+ * (closed form), so the field can be put at any time of the level without
+ * going through the steps before it. The divisions by period and rate
+ * are done by multiplying by reciprocals found by motion_init() (see
+ * Divider), so there is no division once the level has started.
+ * Times are limited to 2^32 / rate ms (4.6 hours at the fastest rate).
+ *
+ * This module has no hardware dependencies so it can also be used to
+ * predict future lane positions (see lanegen.c).
+ */
+
+#ifndef MOTION_H_
+#define MOTION_H_
+
+#include <stdint.h>
+
+#define MOTION_ACCEL_INTERVAL 1024
+#define MOTION_ACCEL_SHIFT 10		// log2(MOTION_ACCEL_INTERVAL)
+
+// Returned by motion_step_time() for a step which is never made
+#define MOTION_NEVER UINT32_MAX
+
+// Division by a number fixed at the start of a level. inverse is
+// (2^32 - 1) / divisor, found once by divider_init(); divider_divide()
+// then takes three 16 x 16 bit multiplies and at most two corrections.
+typedef struct {
+	uint32_t inverse;
+	uint16_t divisor;
+} Divider;
+
+typedef struct {
+	Divider period;
+	Divider final_rate;		// rate once any acceleration has finished
+	uint32_t accel_end;		// ms at which acceleration finishes (0 if none)
+	uint32_t accel_phase;	// rate x ms accumulated by accel_end
+	uint8_t rate;
+	int8_t accel;
+	int8_t direction;
+} RowMotion;
+
+void divider_init(Divider* divider, uint16_t divisor);
+
+// Return n / divisor, setting remainder (if not NULL) to n % divisor
+uint32_t divider_divide(const Divider* divider, uint32_t n, uint16_t* remainder);
+
+// Set up the motion of a row
+void motion_init(RowMotion* motion, uint16_t period, uint8_t rate, int8_t accel,
+		uint8_t rate_limit, int8_t direction);
+
+// Return the number of steps the row has made time ms after the start of
+// the level
+uint32_t motion_steps_at(const RowMotion* motion, uint32_t time);
+
+// Return the time (ms after the start of the level) at which the row
+// makes the given step (numbered from 1), or MOTION_NEVER if it stops
+// before then
+uint32_t motion_step_time(const RowMotion* motion, uint32_t step);
+
+// Return the bit of a pattern width bits wide (width_divider) which is in
+// column 0 once the row has made the given number of steps. (Moving right
+// brings lower bits into column 0.)
+uint8_t motion_position(const RowMotion* motion, const Divider* width_divider, uint32_t steps);
+
+#endif /* MOTION_H_ */
@@ -24,6 +24,20 @@
 #include "level.h"
 #include "timer0.h"
 #include "joystick.h"
+#include "ramstats.h"
+#include "lanegen.h"
+#include "autopilot.h"
+#include "benchmark.h"
+#include "journal.h"
+#include "hiscore.h"
+#include "snapshot.h"
+#include "rewind.h"
+#include "versus.h"
+#include "console.h"
+#include "log.h"
+#include "flightrec.h"
+#include "statebus.h"
+#include "compositor.h"
 
 #define F_CPU 8000000L
 #include <util/delay.h>
@@ -34,25 +48,74 @@ void initialise_hardware(void);
 void splash_screen(void);
 void new_game(void);
 void play_game(void);
+void make_move(int8_t move);
 void next_level(void);
 void handle_time_limit(void);
 void handle_game_over(void);
+int8_t read_button(void);
+int16_t read_serial(void);
+int8_t read_joystick(void);
+int8_t read_button_repeat(void);
+void read_snapshot_command(void);
+#ifdef VERSUS_ENABLED
+void play_versus(void);
+#endif
+static void show_status(uint8_t changes);
+static uint32_t game_time(void);
+#ifdef JOURNAL_REPLAY
+static uint32_t replay_play_on(uint32_t time, uint32_t target, uint8_t moving,
+		uint32_t last_autopilot_time);
+#endif
 
 // ASCII code for Escape character
 #define ESCAPE_CHAR 27
 #define INIT_TIME 30
 
+// A snapshot command is abandoned if no character comes for this long (ms)
+#define SNAPSHOT_TIMEOUT 1000
+
+// Rewinding stops when the rewind key hasn't come for this long (ms).
+// Terminals repeat a held key only after a delay of up to half a second.
+#define REWIND_HOLD_TIME 600
+
 static uint8_t game_over;
 
+// Seconds each frog has to cross (a console tunable, see console.h)
+static uint8_t init_time = INIT_TIME;
+
+// Set if the game saved in EEPROM is being carried on (see snapshot.h)
+static uint8_t resuming;
+static Snapshot resume_snapshot;
+
 /////////////////////////////// main //////////////////////////////////
 int main(void) {
 	// Setup hardware and call backs. This will turn on 
 	// interrupts.
 	initialise_hardware();
 	
+#ifdef BENCHMARK
+	// Benchmark build - time the game functions instead of playing
+	run_benchmarks();
+#endif
+	
+	// If the watchdog reset the board, show what led up to it (see
+	// flightrec.h). The watchdog then runs from here on.
+	flight_report_crash();
+	flight_watchdog_start();
+	
+#ifndef JOURNAL_ENABLED
+	// Carry on the game that was being played when the board was reset or
+	// lost power, if there was one
+	resuming = snapshot_load_saved(&resume_snapshot);
+#endif
+	
+#ifndef JOURNAL_REPLAY
 	// Show the splash screen message. Returns when display
 	// is complete
-	splash_screen();
+	if(!resuming) {
+		splash_screen();
+	}
+#endif
 	
 	while(1) {
 		new_game();
@@ -68,6 +131,7 @@ int main(void) {
 }
 
 void initialise_hardware(void) {
+	init_flight_recorder();
 	ledmatrix_setup();
 	init_button_interrupts();
 	// Setup serial port for 19200 baud communication with no echo
@@ -80,6 +144,16 @@ void initialise_hardware(void) {
 	
 	init_lives_display();
 	
+	// Show the score, lives and level on the terminal when they change
+	statebus_subscribe(STATEBUS_TERMINAL,
+			STATE_SCORE | STATE_LIVES | STATE_LEVEL | STATE_TERMINAL, show_status);
+	
+	init_autopilot();
+	
+	init_high_scores();
+	
+	init_snapshots();
+	
 	// Turn on global interrupts
 	sei();
 }
@@ -88,18 +162,21 @@ void splash_screen(void) {
 	// Clear terminal screen and output a message
 	clear_terminal();
 	move_cursor(10,10);
-	printf_P(PSTR("Frogger"));
+	flight_zone(FLIGHT_ZONE_SPLASH);
+	serial_puts_P("Frogger");
 	move_cursor(10,12);
-	printf_P(PSTR("CSSE2010/7201 project by Wu Lai Yin 44115001"));
+	serial_puts_P("CSSE2010/7201 project by Wu Lai Yin 44115001");
+	print_high_scores(10,14);
 	
 	// Output the scrolling message to the LED matrix
 	// and wait for a push button to be pushed.
-	ledmatrix_clear();
+	compositor_clear();
 	while(1) {
 		set_scrolling_display_text("FROGGER 44115001", COLOUR_GREEN);
 		// Scroll the message until it has scrolled off the 
 		// display or a button is pushed
 		while(scroll_display()) {
+			flight_heartbeat();
 			_delay_ms(150);
 			if(button_pushed() != NO_BUTTON_PUSHED) {
 				return;
@@ -109,6 +186,7 @@ void splash_screen(void) {
 }
 
 void new_game(void) {
+	uint32_t seed;
 	
 	game_over = 0;
 	
@@ -118,8 +196,14 @@ void new_game(void) {
 	// Clear the serial terminal
 	clear_terminal();
 	
-	// Initialise the level
+	// Initialise the level. The time taken to start the game seeds the
+	// patterns of the generated levels (unless a journal is replayed).
 	init_level();
+	seed = get_current_time();
+#ifdef JOURNAL_ENABLED
+	journal_start(get_current_time(), &seed);
+#endif
+	lanegen_set_seed(seed);
 	
 	// Initialise the score
 	init_score();
@@ -138,45 +222,75 @@ void new_game(void) {
 	(void)button_pushed();
 	clear_serial_input_buffer();
 	
-	move_cursor(55,14);
-	printf_P(PSTR("Score:%10d"), get_score());
-	
-	move_cursor(55,15);
-	printf_P(PSTR("Lives:%10d"), get_lives());
-	
-	move_cursor(55,16);
-	printf_P(PSTR("Level:%10d"), get_level());
+	// The terminal was cleared - show the score, lives and level again
+	state_changed(STATE_TERMINAL);
 }
 
 void play_game(void) {
-	uint32_t current_time;
+	uint32_t current_time, last_move_time, last_autopilot_time;
+	uint32_t last_rewind_key_time = 0, last_rewind_time = 0;
 	
 	int8_t joystick;
 	int8_t button;
+	int8_t move;
+	int16_t serial_read;
 	char serial_input, escape_sequence_char;
 	uint8_t characters_into_escape_sequence = 0;
 	uint8_t game_paused = 0;
+	uint8_t rewinding = 0;
 	
 	// Get the current time and remember this as the last time the vehicles
 	// and logs were moved.
-	current_time = get_current_time();
+	last_move_time = game_time();
+	last_autopilot_time = last_move_time;
 	
 	redraw_whole_display();
 	
-	put_frog_in_start_position();
+	if(resuming) {
+		// Carry on from where the saved game was
+		snapshot_restore_field(&resume_snapshot);
+		resuming = 0;
+	} else {
+		put_frog_in_start_position();
+		count_set(init_time);
+	}
+	snapshot_save();
+	rewind_clear();
 	
-	count_set(INIT_TIME);
+#ifdef JOURNAL_ENABLED
+	journal_sync(last_move_time);
+#endif
 	
 	// We play the game while the frog is alive and we haven't filled up the 
 	// far riverbank
 	while(!no_more_live() && !is_riverbank_full()) {
+		flight_heartbeat();
+		flight_zone(FLIGHT_ZONE_INPUT);
+		console_count_loop();
+#ifdef JOURNAL_ENABLED
+		journal_count_loop();
+		if(journal_replay_finished(game_time())) {
+			journal_finish(game_time());
+		}
+#endif
+		
 		if(!is_frog_dead() && frog_has_reached_riverbank()) {
 			// Frog reached the other side successfully but the
 			// riverbank isn't full, put a new frog at the start
 			
 			add_to_score(10);
+			// Only a flourish - if the queue is full it is dropped (the
+			// score shows it anyway)
+			(void)queue_scrolling_text_P(PSTR("+10"), COLOUR_LIGHT_YELLOW);
+			LOG(FROG_CROSSED, get_frog_column(), get_score());
+			flight_record(FLIGHT_CROSSED, get_frog_column());
+			if(autopilot_enabled()) {
+				autopilot_frog_crossed();
+				print_autopilot_stats();
+			}
 			put_frog_in_start_position();
-			count_set(INIT_TIME);
+			count_set(init_time);
+			snapshot_save();
 		}
 		
 		if(count_end()) {
@@ -184,8 +298,20 @@ void play_game(void) {
 		}
 		
 		if(is_frog_dead()) {
+			if(autopilot_enabled()) {
+				autopilot_frog_died();
+				print_autopilot_stats();
+			}
 			reduce_lives();
+			LOG(FROG_DIED, get_frog_row(), get_frog_column(), get_lives());
+			flight_record(FLIGHT_DEATH, get_frog_row() * 16 + get_frog_column());
 			put_frog_in_start_position();
+			snapshot_save();
+		}
+		
+		if(!game_paused && !rewinding) {
+			// Record the game for rewinding (see rewind.h)
+			rewind_capture();
 		}
 		
 		// Check for input - which could be a button push or serial input.
@@ -198,13 +324,18 @@ void play_game(void) {
 		// we'll retrieve the serial input the next time through this loop
 		serial_input = -1;
 		escape_sequence_char = -1;
-		button = button_pushed();
+		button = read_button();
 		
 		if(button == NO_BUTTON_PUSHED) {
 			// No push button was pushed, see if there is any serial input
-			if(serial_input_available()) {
-				// Serial data was available - read the data from standard input
-				serial_input = fgetc(stdin);
+			serial_read = read_serial();
+			if(serial_read != JOURNAL_NO_INPUT && console_input(serial_read)) {
+				// Taken by the console (see console.h)
+				serial_read = JOURNAL_NO_INPUT;
+			}
+			if(serial_read != JOURNAL_NO_INPUT) {
+				// Serial data was available
+				serial_input = serial_read;
 				// Check if the character is part of an escape sequence
 				if(characters_into_escape_sequence == 0 && serial_input == ESCAPE_CHAR) {
 					// We've hit the first character in an escape sequence (escape)
@@ -229,148 +360,524 @@ void play_game(void) {
 			}
 		}
 		
-		joystick = joystick_direction();
+		joystick = read_joystick();
 		
-		if(!game_paused) {
-			// Process the input. 
-			if(button==3 || escape_sequence_char=='D' || serial_input=='L' || serial_input=='l' || joystick==3) {
-				// Attempt to move left
-				move_frog_to_left();
-			} else if(button==2 || escape_sequence_char=='A' || serial_input=='U' || serial_input=='u' || joystick==0) {
-				// Attempt to move forward
-				move_frog_forward();
-			} else if(button==1 || escape_sequence_char=='B' || serial_input=='D' || serial_input=='d' || joystick==2) {
-				// Attempt to move down
-				move_frog_backward();
-			} else if(button==0 || escape_sequence_char=='C' || serial_input=='R' || serial_input=='r' || joystick==1) {
-				// Attempt to move right
-				move_frog_to_right();
-			} else {
-				switch (can_button_repeat()) {
-					case 3:
-						move_frog_to_left();
-						break;
-					case 2:
-						move_frog_forward();
-						break;
-					case 1:
-						move_frog_backward();
-						break;
-					case 0:
-						move_frog_to_right();
-						break;
-				}
-			}
+		// Work out which move (if any) was asked for. Moves are numbered
+		// as the push buttons are: 3 left, 2 forward, 1 backward, 0 right.
+		if(button==3 || escape_sequence_char=='D' || serial_input=='L' || serial_input=='l' || joystick==3) {
+			move = 3;
+		} else if(button==2 || escape_sequence_char=='A' || serial_input=='U' || serial_input=='u' || joystick==0) {
+			move = 2;
+		} else if(button==1 || escape_sequence_char=='B' || serial_input=='D' || serial_input=='d' || joystick==2) {
+			move = 1;
+		} else if(button==0 || escape_sequence_char=='C' || serial_input=='R' || serial_input=='r' || joystick==1) {
+			move = 0;
+		} else {
+			move = read_button_repeat();
 		}
 		
+		flight_zone(FLIGHT_ZONE_COMMANDS);
+		if(!game_paused && !rewinding) {
+			make_move(move);
+		}
 		
-		if(serial_input == 'p' || serial_input == 'P') {
+		
+		if((serial_input == 'p' || serial_input == 'P') && !rewinding) {
 			// Pause/unpause the game until 'p' or 'P' is pressed again
 			if(game_paused) {
 					game_paused = 0;
 					clear_terminal();
-					
-					move_cursor(55,14);
-					printf_P(PSTR("Score:%10d"), get_score());
-					
-					move_cursor(55,15);
-					printf_P(PSTR("Lives:%10d"), get_lives());
-					
-					move_cursor(55,16);
-					printf_P(PSTR("Level:%10d"), get_level());
+					state_changed(STATE_TERMINAL);
 					
 					start_counting();
+					flight_record(FLIGHT_PAUSE, 0);
 					
 				} else {
 					game_paused = 1;
+					flight_record(FLIGHT_PAUSE, 1);
 					move_cursor(10,14);
-					printf_P(PSTR("GAME PAUSED"));
+					serial_puts_P("GAME PAUSED");
 					
 					stop_counting();
+					snapshot_save();
 				}
 		}
+		
+		if(serial_input == 'm' || serial_input == 'M') {
+			// Report static RAM usage and the stack high-water mark
+			print_ram_usage();
+		}
+		
+		if(serial_input == 'a' || serial_input == 'A') {
+			// Turn the autopilot (demo mode) on or off
+			toggle_autopilot();
+			print_autopilot_stats();
+		}
+		
+		if(serial_input == '#') {
+			// Send a snapshot of the game (see snapshot.h)
+			snapshot_send();
+		}
+		
+		if(serial_input == '!') {
+			// Load a snapshot sent in hex (see snapshot.h)
+			read_snapshot_command();
+		}
+		
+		if((serial_input == 'b' || serial_input == 'B') && !game_paused) {
+			// Run the game backwards while the key is held (see rewind.h)
+			if(!rewinding) {
+				rewinding = 1;
+				stop_counting();
+				flight_record(FLIGHT_REWIND, 1);
+			}
+			last_rewind_key_time = game_time();
+		}
+#ifdef VERSUS_ENABLED
+		if((serial_input == 'v' || serial_input == 'V') && !game_paused && !rewinding) {
+			// Race another board over the serial port (see versus.h), then
+			// carry on from here
+			play_versus();
+			rewind_clear();
+			last_move_time = game_time();
+		}
+#endif
 		// else - invalid input or we're part way through an escape sequence -
 		// do nothing
 		
+		flight_zone(FLIGHT_ZONE_TRAFFIC);
+#ifdef JOURNAL_REPLAY
+		// Play on as far as the journal's clock allows (see journal.h), but
+		// no further than the next rewind step or the end of rewinding
+		current_time = journal_replay_target(get_current_time());
+		if(rewinding) {
+			if(current_time > last_rewind_time + REWIND_TICK_MS) {
+				current_time = last_rewind_time + REWIND_TICK_MS;
+			}
+			if(current_time > last_rewind_key_time + REWIND_HOLD_TIME) {
+				current_time = last_rewind_key_time + REWIND_HOLD_TIME;
+			}
+		}
+		current_time = replay_play_on(last_move_time, current_time,
+				!game_paused && !rewinding, last_autopilot_time);
+#else
 		current_time = get_current_time();
+		if(current_time - last_move_time >= FLIGHT_SLOW_LOOP_MS) {
+			flight_record(FLIGHT_SLOW_LOOP, current_time - last_move_time > UINT8_MAX ?
+					UINT8_MAX : current_time - last_move_time);
+		}
+#endif
 		
-		if(!is_frog_dead() && !game_paused) {
-			if(current_time % (1000 + (100 * get_level())) == 0) {
-				// 1000ms (1 second) has passed since the last time we moved
-				// the vehicles and logs - move them again and keep track of
-				// the time when we did this.
-				scroll_vehicle_lane(0, 1);
-				//last_move_time = current_time;
-			} else if(current_time % (1100 + (50 * get_level())) == 0) {
-				scroll_vehicle_lane(1, -1);
-				//last_move_time1 = current_time;
-			} else if(current_time % (800 + (50 * get_level())) == 0) {
-				scroll_vehicle_lane(2, 1);
-				//last_move_time2 = current_time;
-			} else if(current_time % (900 + (50 * get_level())) == 0) {
-				scroll_river_channel(0, -1);
-				//last_move_time3 = current_time;
-			} else if(current_time % (1150 + (50 * get_level())) == 0) {
-				scroll_river_channel(1, 1);
-				//last_move_time4 = current_time;
+		if(rewinding) {
+			if(current_time - last_rewind_key_time >= REWIND_HOLD_TIME) {
+				// Key released - play on from here
+				rewinding = 0;
+				start_counting();
+				flight_record(FLIGHT_REWIND, 0);
+			} else if(current_time - last_rewind_time >= REWIND_TICK_MS) {
+				last_rewind_time = current_time;
+				// (The score and lives it puts back are published)
+				(void)rewind_step();
 			}
+		} else if(!game_paused) {
+			// Move the vehicles and logs by however much time has passed 
+			// since we last moved them. (Time spent paused is skipped.
+			// A replay has moved them already.)
+#ifndef JOURNAL_REPLAY
+			update_traffic(current_time - last_move_time);
+#endif
+		}
+		last_move_time = current_time;
+		
+		flight_zone(FLIGHT_ZONE_AUTOPILOT);
+		if(autopilot_enabled() && !game_paused && !rewinding && !is_frog_dead() && 
+				!frog_has_reached_riverbank() &&
+				current_time - last_autopilot_time >= AUTOPILOT_STEP_MS) {
+			// Plan from the field as it is now (after the traffic has moved)
+			last_autopilot_time = current_time;
+			move = autopilot_next_move();
+			flight_record(FLIGHT_AUTOPILOT, move);
+			make_move(move);
 		}
-		displayLED_lives();
+		// Update the outputs whose state has changed (see statebus.h),
+		// scroll any message and send the matrix rows that have changed
+		// (see compositor.h)
+		flight_zone(FLIGHT_ZONE_OUTPUTS);
+		state_dispatch();
+		update_scrolling_display(current_time);
+		compositor_update();
 	}
 	// We get here if the frog is dead or the riverbank is full
 	// The game is over.
 }
 
+// Move the frog in the given direction (numbered as the push buttons are).
+// Any other value leaves the frog where it is.
+void make_move(int8_t move) {
+	switch(move) {
+		case 3:
+			move_frog_to_left();
+			break;
+		case 2:
+			move_frog_forward();
+			break;
+		case 1:
+			move_frog_backward();
+			break;
+		case 0:
+			move_frog_to_right();
+			break;
+	}
+}
+
 void next_level(void) {
 	count_clear();
-	add_level();
-	if(get_level() > 1) {
-		add_lives();
+	if(resuming) {
+		// Carry on the saved game at its level
+		snapshot_restore_game(&resume_snapshot);
+	} else {
+		add_level();
+		if(get_level() > 1) {
+			add_lives();
+		}
 	}
 	
+	flight_zone(FLIGHT_ZONE_LEVEL_INTRO);
+	flight_record(FLIGHT_LEVEL, get_level());
 	clear_terminal();
-	move_cursor(55,16);
-	printf_P(PSTR("Level:%10d"), get_level());
-	
-	move_cursor(55,15);
-	printf_P(PSTR("Lives:%10d"), get_lives());
-	
-	move_cursor(55,14);
-	printf_P(PSTR("Score:%10d"), get_score());
-	
-	ledmatrix_clear();
+	state_changed(STATE_TERMINAL);
+	state_dispatch();
 	
-	char level_txt[8];
-	sprintf(level_txt, "LEVEL %i", get_level());
-	set_scrolling_display_text(level_txt, COLOUR_YELLOW);
-	
-	while(scroll_display()) {
-		if (button_pushed() != NO_BUTTON_PUSHED) {
-			initialise_game();
-			break;
-		}
-		_delay_ms(150);
-	}
+	// Load the lanes and riverbank for the new level. The level number
+	// scrolls over the start of it (see play_game()).
+	initialise_game();
+	char level_txt[SCROLL_MESSAGE_SIZE];
+	snprintf_P(level_txt, sizeof(level_txt), PSTR("LEVEL %u"), get_level());
+	// Any "+10"s still waiting from the last level are dropped, so the
+	// level number is never lost and comes next
+	replace_queued_scrolling_text(level_txt, COLOUR_YELLOW);
+	LOG(LEVEL_START, get_level(), lanegen_get_seed());
 }
 
 
 void handle_game_over() {
+#ifdef JOURNAL_ENABLED
+	// End of the recording (or of the replay - which doesn't return)
+	journal_finish(game_time());
+#endif
+	
 	game_over = 1;
+	flight_zone(FLIGHT_ZONE_GAME_OVER);
+	flight_record(FLIGHT_GAME_OVER, get_level());
 	count_clear();
-	ledmatrix_clear();
+	// Save the finished game so that it isn't resumed after a reset
+	snapshot_save();
+	state_dispatch();
+	compositor_clear();
 	
 	move_cursor(10,14);
-	printf_P(PSTR("GAME OVER"));
+	serial_puts_P("GAME OVER");
 	move_cursor(10,15);
-	printf_P(PSTR("Press a button to start again"));
+	serial_puts_P("Press a button to start again");
+	
+	// The table is saved in the background while the message scrolls
+	if(add_high_score(get_score(), get_level())) {
+		move_cursor(10,16);
+		serial_puts_P("New high score!");
+	}
+	print_high_scores(10,18);
 
 	while(1) {
 		set_scrolling_display_text("GAME OVER", COLOUR_GREEN);
 		while(scroll_display()) {
+			flight_heartbeat();
 			_delay_ms(170);
 			if(button_pushed() != NO_BUTTON_PUSHED) {
 				return;
 			}
 		}
+		if(autopilot_enabled()) {
+			// Soak testing - start the next game without waiting
+			return;
+		}
+	}
+}
+// The inputs used while playing. When an input journal is being recorded
+// every input consumed is added to it; when one is being replayed the
+// inputs come from the journal instead. Each returns -1 if there's no
+// input.
+int8_t read_button(void) {
+#ifdef JOURNAL_REPLAY
+	int16_t token = journal_replay_next(game_time(), JOURNAL_BUTTON, JOURNAL_BUTTON + 3);
+	return token == JOURNAL_NO_INPUT ? NO_BUTTON_PUSHED : token - JOURNAL_BUTTON;
+#else
+	int8_t button = button_pushed();
+#ifdef JOURNAL_RECORD
+	if(button != NO_BUTTON_PUSHED) {
+		journal_record(get_current_time(), JOURNAL_BUTTON + button);
+	}
+#endif
+	if(button != NO_BUTTON_PUSHED) {
+		flight_record(FLIGHT_INPUT, JOURNAL_BUTTON + button);
+	}
+	return button;
+#endif
+}
+
+int16_t read_serial(void) {
+#ifdef JOURNAL_REPLAY
+	return journal_replay_next(game_time(), 0, JOURNAL_SERIAL_MAX);
+#else
+	int16_t serial_input = JOURNAL_NO_INPUT;
+	if(serial_input_available()) {
+		// Read the data from standard input
+		serial_input = (uint8_t)fgetc(stdin);
+#ifdef JOURNAL_RECORD
+		// (Only 7 bit characters can be journalled)
+		serial_input &= JOURNAL_SERIAL_MAX;
+		journal_record(get_current_time(), serial_input);
+#endif
+		flight_record(FLIGHT_INPUT, serial_input & JOURNAL_SERIAL_MAX);
+	}
+	return serial_input;
+#endif
+}
+
+int8_t read_joystick(void) {
+#ifdef JOURNAL_REPLAY
+	int16_t token = journal_replay_next(game_time(), JOURNAL_JOYSTICK, JOURNAL_JOYSTICK + 3);
+	return token == JOURNAL_NO_INPUT ? -1 : token - JOURNAL_JOYSTICK;
+#else
+	int8_t joystick = joystick_direction();
+#ifdef JOURNAL_RECORD
+	if(joystick != -1) {
+		journal_record(get_current_time(), JOURNAL_JOYSTICK + joystick);
+	}
+#endif
+	if(joystick != -1) {
+		flight_record(FLIGHT_INPUT, JOURNAL_JOYSTICK + joystick);
+	}
+	return joystick;
+#endif
+}
+
+int8_t read_button_repeat(void) {
+#ifdef JOURNAL_REPLAY
+	int16_t token = journal_replay_next(game_time(), JOURNAL_REPEAT, JOURNAL_REPEAT + 3);
+	return token == JOURNAL_NO_INPUT ? -1 : token - JOURNAL_REPEAT;
+#else
+	int8_t repeat = can_button_repeat();
+#ifdef JOURNAL_RECORD
+	if(repeat != -1) {
+		journal_record(get_current_time(), JOURNAL_REPEAT + repeat);
+	}
+#endif
+	if(repeat != -1) {
+		flight_record(FLIGHT_INPUT, JOURNAL_REPEAT + repeat);
+	}
+	return repeat;
+#endif
+}
+
+uint8_t get_init_time(void) {
+	return init_time;
+}
+
+void set_init_time(uint8_t seconds) {
+	init_time = seconds;
+}
+
+// Read the rest of a snapshot command - the snapshot in hex then return -
+// and put the game into that state. The characters are read as any other
+// serial input so a journal records (and replays) them.
+void read_snapshot_command(void) {
+	char hex[SNAPSHOT_HEX_LENGTH];
+	uint8_t length = 0;
+	int16_t serial_read;
+	uint32_t last_input_time = game_time();
+	Snapshot snapshot;
+	
+	flight_zone(FLIGHT_ZONE_SNAPSHOT);
+	while(game_time() - last_input_time < SNAPSHOT_TIMEOUT) {
+		flight_heartbeat();
+#ifdef JOURNAL_REPLAY
+		// Nothing moves while a snapshot is typed, but the journal's clock
+		// has to run for the rest of it to come
+		journal_replay_played(journal_replay_target(get_current_time()));
+#endif
+		serial_read = read_serial();
+		if(serial_read == JOURNAL_NO_INPUT) {
+			continue;
+		}
+		last_input_time = game_time();
+		if(serial_read == '\r' || serial_read == '\n') {
+			break;
+		}
+		if(length < SNAPSHOT_HEX_LENGTH) {
+			hex[length++] = serial_read;
+		}
 	}
-}
\ No newline at end of file
+	
+	if(length == SNAPSHOT_HEX_LENGTH && snapshot_from_hex(hex, &snapshot)) {
+		snapshot_restore(&snapshot);
+		rewind_clear();
+		clear_terminal();
+		state_changed(STATE_TERMINAL);
+	} else {
+		move_cursor(10,14);
+		serial_puts_P("BAD SNAPSHOT");
+	}
+}
+
+#ifdef VERSUS_ENABLED
+// Race against another board until one of the frogs fills its riverbank
+// (or the link fails), then report the result and put the game back the
+// way it was. A button push while waiting for the other board gives up.
+// The terminal can't be used during the race - the serial port carries
+// the race frames.
+void play_versus(void) {
+	uint16_t score = get_score();
+	uint8_t level = get_level();
+	FieldState field;
+	VersusStats stats;
+	int8_t button;
+	int8_t joystick;
+	uint8_t state;
+	
+	get_field_state(&field);
+	stop_counting();
+	clear_terminal();
+	move_cursor(10,14);
+	serial_puts_P("VERSUS - waiting for the other board");
+	
+	flight_zone(FLIGHT_ZONE_VERSUS);
+	versus_start(get_current_time());
+	do {
+		flight_heartbeat();
+		button = read_button();
+		joystick = read_joystick();
+		state = versus_run(get_current_time());
+		state_dispatch();
+		compositor_update();
+		// Moves as in play_game(). While waiting a button push gives up.
+		if(state == VERSUS_WAITING) {
+			if(button != NO_BUTTON_PUSHED) {
+				break;
+			}
+		} else if(button != NO_BUTTON_PUSHED) {
+			versus_move(button);
+		} else if(joystick == 3) {
+			versus_move(3);
+		} else if(joystick == 0) {
+			versus_move(2);
+		} else if(joystick == 2) {
+			versus_move(1);
+		} else if(joystick == 1) {
+			versus_move(0);
+		} else {
+			versus_move(read_button_repeat());
+		}
+	} while(state <= VERSUS_RACING);
+	versus_finish();
+	versus_get_stats(&stats);
+	
+	clear_terminal();
+	move_cursor(10,14);
+	switch(state) {
+		case VERSUS_WAITING:
+			serial_puts_P("VERSUS - given up");
+			break;
+		case VERSUS_WON:
+			serial_puts_P("VERSUS - you won!");
+			break;
+		case VERSUS_LOST:
+			serial_puts_P("VERSUS - you lost");
+			break;
+		case VERSUS_DRAW:
+			serial_puts_P("VERSUS - draw");
+			break;
+		case VERSUS_DESYNC:
+			serial_puts_P("VERSUS - the boards disagree (desync)");
+			break;
+		default:
+			serial_puts_P("VERSUS - link failed");
+			break;
+	}
+	move_cursor(10,15);
+	printf_P(PSTR("%lu ticks, %u rollbacks (deepest %u ticks, %lu re-simulated), %u stalls"),
+			stats.ticks, stats.rollbacks, stats.max_depth, stats.resimulated, stats.stalls);
+	move_cursor(10,16);
+	printf_P(PSTR("Rollback cycles: worst %lu, average %lu"), stats.max_rollback_cycles,
+			stats.rollbacks ? stats.rollback_cycles / stats.rollbacks : 0);
+	
+	// Back to the game as it was
+	set_score(score);
+	set_level(level);
+	initialise_game();
+	set_field_state(&field);
+	state_changed(STATE_TERMINAL);
+	
+	(void)button_pushed();
+	clear_serial_input_buffer();
+	start_counting();
+}
+#endif
+
+// Subscriber to the score, lives and level (see statebus.h) - show those
+// which have changed on the terminal, or all of them if it was cleared
+static void show_status(uint8_t changes) {
+	if(changes & STATE_TERMINAL) {
+		changes |= STATE_SCORE | STATE_LIVES | STATE_LEVEL;
+	}
+	if(changes & STATE_SCORE) {
+		move_cursor(55,14);
+		printf_P(PSTR("Score:%10lu"), get_score());
+	}
+	if(changes & STATE_LIVES) {
+		move_cursor(55,15);
+		printf_P(PSTR("Lives:%10d"), get_lives());
+	}
+	if(changes & STATE_LEVEL) {
+		move_cursor(55,16);
+		printf_P(PSTR("Level:%10d"), get_level());
+	}
+}
+
+// The time the game is played by - the real time, or the journal's clock
+// when a journal is replayed (see journal.h)
+static uint32_t game_time(void) {
+#ifdef JOURNAL_REPLAY
+	return journal_replay_time();
+#else
+	return get_current_time();
+#endif
+}
+
+#ifdef JOURNAL_REPLAY
+// Play a replay on from time (the last pass of the play loop) towards
+// target a millisecond at a time - the countdown and, if moving, the
+// traffic - stopping after the first millisecond which leaves the loop
+// something to do: a death, a crossing, the countdown running out, the end
+// of the game or an autopilot move. Nothing else in the loop changes the game while no
+// input is due, so the replay goes through the same states as it would
+// with one pass of the loop per millisecond, whatever a pass takes.
+// Returns the time played to.
+static uint32_t replay_play_on(uint32_t time, uint32_t target, uint8_t moving,
+		uint32_t last_autopilot_time) {
+	while(time < target) {
+		time++;
+		count_tick();
+		if(moving) {
+			update_traffic(1);
+			if(is_frog_dead() || frog_has_reached_riverbank() || count_end() || no_more_live() ||
+					(autopilot_enabled() && time - last_autopilot_time >= AUTOPILOT_STEP_MS)) {
+				break;
+			}
+			// As at the top of the loop
+			(void)rewind_capture();
+		}
+	}
+	journal_replay_played(time);
+	return time;
+}
+#endif
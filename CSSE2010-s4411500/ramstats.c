@@ -0,0 +1,79 @@
+/*
+ * ramstats.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdio.h>
+
+#include "ramstats.h"
+#include "terminalio.h"
+
+// Symbols provided by the linker script. _end is the first byte after
+// the static data (.data, .bss and .noinit); __stack is the initial
+// stack pointer (RAMEND).
+extern uint8_t __data_start;
+extern uint8_t __data_end;
+extern uint8_t __bss_start;
+extern uint8_t __bss_end;
+extern uint8_t _end;
+extern uint8_t __stack;
+
+// Fill the unused RAM with STACK_CANARY. This is placed in the .init1
+// section so it runs straight after reset, before the stack pointer is
+// set up and before .data and .bss are initialised. It is written in
+// assembly since no C code may run at that point (r1 is not yet
+// guaranteed to be zero and there is no stack frame).
+void paint_stack(void) __attribute__ ((naked, used, section(".init1")));
+
+void paint_stack(void) {
+	__asm__ volatile (
+		"    ldi r30, lo8(_end)\n"
+		"    ldi r31, hi8(_end)\n"
+		"    ldi r24, %0\n"
+		"    ldi r25, hi8(__stack)\n"
+		"    rjmp 2f\n"
+		"1:\n"
+		"    st Z+, r24\n"
+		"2:\n"
+		"    cpi r30, lo8(__stack)\n"
+		"    cpc r31, r25\n"
+		"    brlo 1b\n"
+		"    breq 1b\n"
+		: : "i" (STACK_CANARY));
+}
+
+uint16_t ram_data_size(void) {
+	return &__data_end - &__data_start;
+}
+
+uint16_t ram_bss_size(void) {
+	return &__bss_end - &__bss_start;
+}
+
+uint16_t stack_current_free(void) {
+	return SP - (uint16_t)&_end;
+}
+
+uint16_t stack_unused_margin(void) {
+	const uint8_t* p = &_end;
+	uint16_t count = 0;
+	
+	// The stack grows down from __stack so the lowest painted bytes are
+	// the ones it has never reached. Stop at the first overwritten byte.
+	while(p <= &__stack && *p == STACK_CANARY) {
+		p++;
+		count++;
+	}
+	return count;
+}
+
+void print_ram_usage(void) {
+	move_cursor(55,18);
+	printf_P(PSTR("RAM data:%4u bss:%4u"), ram_data_size(), ram_bss_size());
+	move_cursor(55,19);
+	printf_P(PSTR("Stack free:%4u min:%4u"), stack_current_free(),
+			stack_unused_margin());
+}
@@ -0,0 +1,44 @@
+/*
+ * ramstats.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * SRAM budget reporting. The ATmega324A has 2KB of SRAM which is
+ * shared between static data (.data, .bss, .noinit) and the stack.
+ * Before main() runs, all RAM between the end of the static data and
+ * the top of the stack is painted with STACK_CANARY. Any byte that
+ * still holds the canary value has never been touched by the stack,
+ * so counting them gives the stack high-water mark.
+ *
+ * A per-module breakdown of the static data can be generated from the
+ * linker map file with tools/ram_report.c. tools/bench/run_stack.sh plays
+ * the game under simavr and fails if stack_unused_margin() ends up below
+ * a threshold.
+ */
+
+#ifndef RAMSTATS_H_
+#define RAMSTATS_H_
+
+#include <stdint.h>
+
+// Value written to unused RAM at start-up
+#define STACK_CANARY 0xC5
+
+// Size in bytes of the initialised (.data) and zeroed (.bss) static data
+uint16_t ram_data_size(void);
+uint16_t ram_bss_size(void);
+
+// Number of bytes between the end of static data and the current
+// stack pointer
+uint16_t stack_current_free(void);
+
+// Number of bytes of RAM that the stack has never reached since reset
+// (i.e. the worst case free margin so far). This walks up from the end
+// of the static data so takes longer the more RAM is unused - it should
+// not be called from time critical code.
+uint16_t stack_unused_margin(void);
+
+// Print the figures above to the serial terminal
+void print_ram_usage(void);
+
+#endif /* RAMSTATS_H_ */
@@ -0,0 +1,263 @@
+/*
+ * rewind.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include <stdint.h>
+
+#include "rewind.h"
+#include "game.h"
+#include "score.h"
+#include "live.h"
+#include "timer0.h"
+
+#define RING_MASK (REWIND_BUFFER_SIZE - 1)
+#define MOVING_ROWS 5
+
+// Largest delta - both headers, 2 bytes of time, 2 of countdown, frog,
+// 2 of riverbank, steps behind, 2 of score and lives
+#define MAX_DELTA_SIZE (12 + MOVING_ROWS)
+
+// Everything the deltas cover
+typedef struct {
+	FieldState field;
+	uint16_t countdown;
+	uint16_t score;
+	uint8_t lives;
+} RewindState;
+
+// The ring of deltas. oldest is the first byte of the oldest delta and
+// newest the byte after the latest one. history_ms is the level time the
+// deltas cover.
+static uint8_t ring[REWIND_BUFFER_SIZE];
+static uint8_t oldest;
+static uint8_t newest;
+static uint8_t used;
+static uint32_t history_ms;
+
+// The game as it was when the latest delta was recorded
+static RewindState last;
+
+static void take_state(RewindState* state);
+static uint8_t frog_byte(const FieldState* field);
+static uint8_t delta_size(uint8_t header);
+static uint16_t delta_time(uint8_t start);
+static uint8_t next_byte(uint8_t* index);
+
+void rewind_clear(void) {
+	oldest = newest = used = 0;
+	history_ms = 0;
+	take_state(&last);
+}
+
+uint8_t rewind_capture(void) {
+	RewindState now;
+	uint8_t delta[MAX_DELTA_SIZE];
+	uint8_t size = 1;
+	uint8_t header = 0;
+	uint32_t time;
+	uint16_t change;
+	uint8_t row;
+
+	time = get_level_time() - last.field.level_time;
+	if(time < REWIND_TICK_MS) {
+		return 0;
+	}
+	if(time > UINT16_MAX) {
+		// Too long a gap to record - start again from here
+		rewind_clear();
+		return 0;
+	}
+	take_state(&now);
+
+	delta[size++] = time;
+	if(time > UINT8_MAX) {
+		header |= REWIND_LONG_TIME;
+		delta[size++] = time >> 8;
+	}
+	if(now.countdown <= last.countdown && last.countdown - now.countdown <= UINT8_MAX) {
+		delta[size++] = last.countdown - now.countdown;
+	} else {
+		header |= REWIND_COUNT_SET;
+		change = last.countdown ^ now.countdown;
+		delta[size++] = change;
+		delta[size++] = change >> 8;
+	}
+	if(frog_byte(&now.field) != frog_byte(&last.field)) {
+		header |= REWIND_FROG;
+		delta[size++] = frog_byte(&now.field) ^ frog_byte(&last.field);
+	}
+	if(now.field.frog_dead != last.field.frog_dead) {
+		header |= REWIND_DEAD;
+	}
+	if(now.field.riverbank_status != last.field.riverbank_status) {
+		header |= REWIND_RIVERBANK;
+		change = last.field.riverbank_status ^ now.field.riverbank_status;
+		delta[size++] = change;
+		delta[size++] = change >> 8;
+	}
+	for(row = 0; row < MOVING_ROWS; row++) {
+		if(now.field.steps_behind[row] != last.field.steps_behind[row]) {
+			header |= REWIND_STEPS;
+		}
+	}
+	if(header & REWIND_STEPS) {
+		for(row = 0; row < MOVING_ROWS; row++) {
+			delta[size++] = now.field.steps_behind[row] ^ last.field.steps_behind[row];
+		}
+	}
+	if(now.score != last.score) {
+		header |= REWIND_SCORE;
+		change = last.score ^ now.score;
+		delta[size++] = change;
+		delta[size++] = change >> 8;
+	}
+	if(now.lives != last.lives) {
+		header |= REWIND_LIVES;
+		delta[size++] = last.lives ^ now.lives;
+	}
+	delta[0] = header;
+	delta[size++] = header;
+
+	// Make room by forgetting the oldest deltas
+	while(used + size > REWIND_BUFFER_SIZE) {
+		uint8_t oldest_size = delta_size(ring[oldest]);
+		history_ms -= delta_time(oldest);
+		oldest = (oldest + oldest_size) & RING_MASK;
+		used -= oldest_size;
+	}
+	for(uint8_t i = 0; i < size; i++) {
+		ring[newest] = delta[i];
+		newest = (newest + 1) & RING_MASK;
+	}
+	used += size;
+	history_ms += time;
+	last = now;
+	return 1;
+}
+
+uint8_t rewind_step(void) {
+	uint8_t header;
+	uint8_t index;
+	uint16_t time;
+	uint16_t change;
+	uint8_t frog;
+	uint8_t row;
+
+	if(!used) {
+		return 0;
+	}
+	header = ring[(newest - 1) & RING_MASK];
+	newest = (newest - delta_size(header)) & RING_MASK;
+	used -= delta_size(header);
+
+	// Undo the changes in the order they were recorded
+	time = delta_time(newest);
+	history_ms -= time;
+	last.field.level_time -= time;
+	index = newest + ((header & REWIND_LONG_TIME) ? 3 : 2);
+	if(header & REWIND_COUNT_SET) {
+		change = next_byte(&index);
+		change |= next_byte(&index) << 8;
+		last.countdown ^= change;
+	} else {
+		last.countdown += next_byte(&index);
+	}
+	if(header & REWIND_FROG) {
+		frog = frog_byte(&last.field) ^ next_byte(&index);
+		last.field.frog_row = frog >> 5;
+		last.field.frog_column = (int8_t)(frog & 0x1F) - 1;
+	}
+	if(header & REWIND_DEAD) {
+		last.field.frog_dead ^= 1;
+	}
+	if(header & REWIND_RIVERBANK) {
+		change = next_byte(&index);
+		change |= next_byte(&index) << 8;
+		last.field.riverbank_status ^= change;
+	}
+	if(header & REWIND_STEPS) {
+		for(row = 0; row < MOVING_ROWS; row++) {
+			last.field.steps_behind[row] ^= next_byte(&index);
+		}
+	}
+	if(header & REWIND_SCORE) {
+		change = next_byte(&index);
+		change |= next_byte(&index) << 8;
+		last.score ^= change;
+	}
+	if(header & REWIND_LIVES) {
+		last.lives ^= next_byte(&index);
+	}
+
+	set_score(last.score);
+	set_lives(last.lives);
+	count_set_ms(last.countdown);
+	set_field_state(&last.field);
+	return 1;
+}
+
+uint32_t rewind_history_ms(void) {
+	return history_ms;
+}
+
+uint8_t rewind_history_bytes(void) {
+	return used;
+}
+
+static void take_state(RewindState* state) {
+	get_field_state(&state->field);
+	state->countdown = count_get_ms();
+	state->score = get_score();
+	state->lives = get_lives();
+}
+
+static uint8_t frog_byte(const FieldState* field) {
+	return (field->frog_row << 5) | (field->frog_column + 1);
+}
+
+// Size of a delta (including both headers) from its header
+static uint8_t delta_size(uint8_t header) {
+	uint8_t size = 4;
+
+	if(header & REWIND_LONG_TIME) {
+		size++;
+	}
+	if(header & REWIND_COUNT_SET) {
+		size++;
+	}
+	if(header & REWIND_FROG) {
+		size++;
+	}
+	if(header & REWIND_RIVERBANK) {
+		size += 2;
+	}
+	if(header & REWIND_STEPS) {
+		size += MOVING_ROWS;
+	}
+	if(header & REWIND_SCORE) {
+		size += 2;
+	}
+	if(header & REWIND_LIVES) {
+		size++;
+	}
+	return size;
+}
+
+// Level time covered by the delta starting at the given byte of the ring
+static uint16_t delta_time(uint8_t start) {
+	uint8_t index = start + 1;
+	uint16_t time = next_byte(&index);
+
+	if(ring[start & RING_MASK] & REWIND_LONG_TIME) {
+		time |= next_byte(&index) << 8;
+	}
+	return time;
+}
+
+static uint8_t next_byte(uint8_t* index) {
+	uint8_t value = ring[*index & RING_MASK];
+	(*index)++;
+	return value;
+}
@@ -0,0 +1,73 @@
+/*
+ * rewind.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Rewind - while 'b' is held on the serial port the game runs backwards
+ * through the last few seconds. Every REWIND_TICK_MS of level time the
+ * play loop records how the game has changed since the last record (a
+ * delta) in a ring of REWIND_BUFFER_SIZE bytes, overwriting the oldest
+ * deltas when it's full. Rewinding undoes the deltas newest first and
+ * redraws the field through set_field_state().
+ *
+ * A delta is a header byte of REWIND_* bits saying which values changed,
+ * then the changes, then the header again (so the ring can be walked
+ * either way). Changes are stored as old XOR new unless noted:
+ *     level time    ms since the last delta, 1 byte (2 if REWIND_LONG_TIME)
+ *     countdown     ms it dropped, 1 byte (or if REWIND_COUNT_SET, because
+ *                   it was set or dropped more than 255 ms, 2 bytes)
+ *     frog          row << 5 | column + 1, 1 byte, if REWIND_FROG
+ *     riverbank     2 bytes, if REWIND_RIVERBANK
+ *     steps behind  1 byte for each moving row, if REWIND_STEPS
+ *     score         2 bytes, if REWIND_SCORE
+ *     lives         1 byte, if REWIND_LIVES
+ * The frog's death flag is a header bit. The lane and log steps made
+ * aren't stored - they follow from the level time (see motion.h) less the
+ * steps behind, which are only ever non-zero just after a death.
+ *
+ * A delta where only time passes takes 4 bytes and a frog move adds 1, so
+ * the history costs about 43 bytes per second of play and the 128 byte
+ * ring holds about 3 seconds (as measured by tools/rewind/rewind_check).
+ */
+
+#ifndef REWIND_H_
+#define REWIND_H_
+
+#include <stdint.h>
+
+// Size of the ring - a power of two, no more than 128
+#define REWIND_BUFFER_SIZE 128
+
+// Level time (ms) between deltas, and so each step of a rewind
+#define REWIND_TICK_MS 100
+
+// Delta header bits
+#define REWIND_FROG			0x01
+#define REWIND_DEAD			0x02
+#define REWIND_RIVERBANK	0x04
+#define REWIND_STEPS		0x08
+#define REWIND_LONG_TIME	0x10
+#define REWIND_COUNT_SET	0x20
+#define REWIND_SCORE		0x40
+#define REWIND_LIVES		0x80
+
+// Forget the history and start recording from the game as it is now.
+// Called at the start of each level and whenever the game is put into a
+// new state (e.g. a snapshot is loaded).
+void rewind_clear(void);
+
+// Record a delta if REWIND_TICK_MS of level time have passed since the
+// last one. Returns 1 if one was recorded. Call from the play loop at a
+// point where the frog's death or crossing has been dealt with.
+uint8_t rewind_capture(void);
+
+// Undo the latest delta, putting the game back the way it was when the
+// one before was recorded and redrawing the field. Returns 0 if there's
+// no history left.
+uint8_t rewind_step(void);
+
+// Amount of history held - level time covered (ms) and bytes used
+uint32_t rewind_history_ms(void);
+uint8_t rewind_history_bytes(void);
+
+#endif /* REWIND_H_ */
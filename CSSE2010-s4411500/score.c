@@ -10,21 +10,25 @@
 #include <stdio.h>
 
 #include "score.h"
-#include "terminalio.h"
+#include "statebus.h"
 
-uint8_t score;
+uint16_t score;
 
 void init_score(void) {
 	score = 0;
+	state_changed(STATE_SCORE);
 }
 
 void add_to_score(uint16_t value) {
 	score += value;
-	
-	move_cursor(55,14);
-	printf_P(PSTR("Score:%10d"), get_score());
+	state_changed(STATE_SCORE);
 }
 
 uint32_t get_score(void) {
 	return score;
 }
+
+void set_score(uint16_t value) {
+	score = value;
+	state_changed(STATE_SCORE);
+}
@@ -12,5 +12,6 @@
 void init_score(void);
 void add_to_score(uint16_t value);
 uint32_t get_score(void);
+void set_score(uint16_t value);
 
 #endif /* SCORE_H_ */
\ No newline at end of file
@@ -7,7 +7,7 @@
  * This program scrolls a message from right to left on the
  * board. The font used is defined below and is 7 dots high and
  * varies between 3 and 5 dots wide, depending on the character.
- * Letters and numbers can be handled (though lower case
+ * Letters, numbers and + can be handled (though lower case
  * letters are displayed as upper case). All other characters
  * display as a blank column.
  * 
@@ -21,9 +21,15 @@
  * constants can live just in the program memory and not be 
  * copied to RAM. (This saves several hundred bytes of RAM.)
  *
+ * A message is turned into columns of dots once, when it is set, so
+ * each step of the scrolling only takes the next columns from RAM.
+ * Messages can also be queued to follow each other, and scrolled in
+ * the background by update_scrolling_display().
+ *
  */
 
 #include "scrolling_char_display.h"
+#include "compositor.h"
 #include "ledmatrix.h"
 #include <avr/pgmspace.h>
 
@@ -89,6 +95,9 @@ static const uint8_t cols_7[] PROGMEM = {128, 158, 160, 193};
 static const uint8_t cols_8[] PROGMEM = {108, 146, 146, 109};
 static const uint8_t cols_9[] PROGMEM = {100, 146, 146, 125};
 
+/* Data for + */
+static const uint8_t cols_plus[] PROGMEM = {16, 56, 17};
+
 /* The following two arrays point to the font data above. 
  * We store pointers to the beginning of the column data
  * for each letter 
@@ -104,36 +113,109 @@ static const uint8_t* const numbers[10] PROGMEM = {
 		cols_0, cols_1, cols_2, cols_3, cols_4, 
 		cols_5, cols_6, cols_7, cols_8, cols_9 };
 
-/* Keep track of the pixel colour to be used */
-static PixelColour colour = COLOUR_RED;
+/* The message, worked out a column at a time when it is set (bit 7 of
+ * a column is row 7 etc., bit 0 is always 0). Each character is a blank
+ * column followed by its columns, and there is a blank column before the
+ * first. Columns past the end of the message are blank.
+ */
+static uint8_t text_columns[SCROLL_TEXT_COLUMNS];
+static uint8_t text_length = 0;
 
-/* Keep track of which column of data is next to be displayed. 
- * next_col_ptr points to that column, or is 0 if there is
- * no next column.
+/* Where the next column to be displayed is in text_columns[], and where
+ * the message will have scrolled off the display (0 if there is no
+ * message).
  */
-static volatile const uint8_t* next_col_ptr = 0;
+static uint8_t next_column = 0;
+static uint8_t end_column = 0;
+
+/* Number of columns to scroll each time scroll_display() is called */
+static uint8_t speed = SCROLL_SPEED_NORMAL;
 
-/* String to be displayed. 
- * next_char_to_display will be used to point to the next
- * character from this string to be displayed.
+/* Messages waiting to be displayed, oldest first, in a ring of
+ * SCROLL_QUEUE_SIZE. A message from RAM is copied into text; one in
+ * flash is only pointed to by flash_text (which is 0 otherwise).
  */
-static char* display_string;
+typedef struct {
+	char text[SCROLL_MESSAGE_SIZE];
+	const char* flash_text;
+	PixelColour colour;
+} Message;
 
-static volatile char* next_char_to_display = 0;
+static Message queue[SCROLL_QUEUE_SIZE];
+static uint8_t queue_first = 0;
+static uint8_t queue_length = 0;
+
+/* When update_scrolling_display() last scrolled the display */
+static uint32_t last_step_time = 0;
+
+static Message* queue_add(PixelColour colour);
+static uint8_t start_next_message(void);
+static void show_text(const char* string, uint8_t in_flash, PixelColour colour);
+static const uint8_t* font_columns(char c);
 
 /*
- * Set the message to be displayed - we just copy the 
- * pointer not the string it points to, so it is important
- * that the original string not change after this function
- * is called while the string is still being displayed.
- * We reset the pointers to ensure the next column to be displayed
- * comes from the first character of this string.
+ * Set the message to be displayed, in place of any message showing or
+ * waiting. The message is copied into text_columns[] straight away (so
+ * the string can change afterwards), and starts from the right of the
+ * display.
  */
 void set_scrolling_display_text(char* string_to_display, PixelColour c) {
-	colour = c;
-	display_string = string_to_display;
-	next_col_ptr = 0;
-	next_char_to_display = 0;
+	queue_length = 0;
+	show_text(string_to_display, 0, c);
+}
+
+uint8_t queue_scrolling_text(const char* string, PixelColour colour) {
+	Message* message = queue_add(colour);
+	uint8_t i;
+
+	if(!message) {
+		return 0;
+	}
+	for(i = 0; i < SCROLL_MESSAGE_SIZE - 1 && string[i]; i++) {
+		message->text[i] = string[i];
+	}
+	message->text[i] = 0;
+	return 1;
+}
+
+uint8_t queue_scrolling_text_P(const char* string, PixelColour colour) {
+	Message* message = queue_add(colour);
+
+	if(!message) {
+		return 0;
+	}
+	message->flash_text = string;
+	return 1;
+}
+
+void replace_queued_scrolling_text(const char* string, PixelColour colour) {
+	/* With the queue emptied there is always room */
+	queue_length = 0;
+	queue_scrolling_text(string, colour);
+}
+
+void update_scrolling_display(uint32_t time) {
+	/* Nothing to do (the usual case) is two comparisons */
+	if(next_column >= end_column && !queue_length) {
+		return;
+	}
+	if(time - last_step_time >= SCROLL_STEP_MS) {
+		last_step_time = time;
+		(void)scroll_display();
+	}
+}
+
+void set_scrolling_display_speed(uint8_t columns) {
+	if(columns < 1) {
+		columns = 1;
+	} else if(columns > SCROLL_MAX_SPEED) {
+		columns = SCROLL_MAX_SPEED;
+	}
+	speed = columns;
+}
+
+uint8_t get_scrolling_display_speed(void) {
+	return speed;
 }
 
 /*
@@ -142,106 +224,113 @@ void set_scrolling_display_text(char* string_to_display, PixelColour c) {
  * Returns 1 if still scrolling display.
  */
 uint8_t scroll_display(void) {
-	static uint8_t shift_countdown = 0;
-	uint8_t i;
-	uint8_t col_data;
-	char next_char;
-	uint8_t finished = 0;
+	uint8_t columns[SCROLL_MAX_SPEED];
+	uint8_t count;
+
+	if(next_column >= end_column && !start_next_message()) {
+		return 0;
+	}
 
-	/* Data to be displayed in the next column - by 
-	 * default we show a blank column. Bit 7 of this
-	 * column data corresponds to row 7 of the display
-	 * etc.
+	/* The next columns come from the message, or are blank once past its
+	 * end
 	 */
-	col_data = 0;
+	for(count = 0; count < speed && next_column < end_column; count++) {
+		columns[count] = (next_column < text_length) ? text_columns[next_column] : 0;
+		next_column++;
+	}
 
-	if(next_col_ptr) {
-		/* We're currently outputting a character and next_col_ptr
-		 * points to the display data for the next column. We
-		 * extract that data from program memory.
-		 */
-		col_data = pgm_read_byte(next_col_ptr);
-
-		if(col_data & 1) {
-			/* Least significant bit is set - this is the last
-			 * column of this character
-			 */
-			next_col_ptr = 0;
-		} else {
-			/* This is not the last column of this character - make
-			 * the pointer point to the data for the next column.
-			 */
-			next_col_ptr++;
-		}
-	} else if(next_char_to_display) {
-		/* We're not currently outputting a character, but we
-		 * do have more characters to display. We will output
-		 * a blank column this time (col_data value remains 0)
-		 * but we will set up our pointer (next_col_ptr) so that
-		 * it points to the data for the first column of dots for
-		 * the next character. We first get the next character to be 
-		 * displayed and advance our next character pointer 
-		 * (next_char_to_display) so that it points to the character 
-		 * after.
-		 */
-		next_char = *(next_char_to_display++);
-		if(next_char == 0) {
-			/* We reached the null character at the end of the string.
-			 * There is no next character, reset our pointer to 
-			 * the next character and set our countdown until the 
-			 * message disappears from the display.
-			 */
-			next_char_to_display = 0;
-			shift_countdown = 16;
-		} else if (next_char >= 'a' && next_char <= 'z') {
-			/* Character is a lower case letter - the next column to 
-			 * be displayed will be the first column of the letter
-			 * data for that letter
-			 */
-			next_col_ptr = (const uint8_t*)pgm_read_word(&letters[next_char - 'a']);
-		} else if (next_char >= 'A' && next_char <= 'Z') {
-			/* Upper case character */
-			next_col_ptr = (const uint8_t*)pgm_read_word(&letters[next_char - 'A']);
-		} else if (next_char >= '0' && next_char <= '9') {
-			/* Digit */
-			next_col_ptr = (const uint8_t*)pgm_read_word(&numbers[next_char - '0']);
-		}
+	/* Scroll the text over whatever else is on the display (see
+	 * compositor.h) and send what has changed
+	 */
+	compositor_scroll_text(columns, count);
+	compositor_update();
+	return next_column < end_column || queue_length;
+}
+
+/* The next free message in the queue (with flash_text 0), or 0 if the
+ * queue is full
+ */
+static Message* queue_add(PixelColour colour) {
+	Message* message;
+
+	if(queue_length == SCROLL_QUEUE_SIZE) {
+		return 0;
+	}
+	message = &queue[(queue_first + queue_length) % SCROLL_QUEUE_SIZE];
+	queue_length++;
+	message->flash_text = 0;
+	message->colour = colour;
+	return message;
+}
+
+/* Take the oldest message off the queue and start displaying it.
+ * Returns 0 if there wasn't one.
+ */
+static uint8_t start_next_message(void) {
+	Message* message;
+
+	if(!queue_length) {
+		return 0;
+	}
+	message = &queue[queue_first];
+	queue_first = (queue_first + 1) % SCROLL_QUEUE_SIZE;
+	queue_length--;
+	if(message->flash_text) {
+		show_text(message->flash_text, 1, message->colour);
 	} else {
-		/* We're not outputting a column of dots and there is 
-		 * no next character. Move on to the string that we
-		 * have stored (if any).
-		 */
-		if(!display_string) {
-			/* May be finished - flag this and adjust below if we're still
-			 * showing pixels
-			 */
-			finished = 1;
-		}
-		next_char_to_display = display_string;
-		display_string = 0;
+		show_text(message->text, 0, message->colour);
 	}
-	
-	/* Shift the current display one pixel to the left and insert the 
-	 * new column data at column 15.
-	 * Adjust our "finished" variable if we've finished scrolling the
-	 * message off the display
-	 */
-	ledmatrix_shift_display_left();
-	MatrixColumn column_colour_data;
-	for(i=7; i>=1; i--) {
-		// If the relevant font bit is set, we make this a red pixel, otherwise blank
-		if(col_data & 0x80) {
-			column_colour_data[i] = colour;
-		} else {
-			column_colour_data[i] = 0;
+	return 1;
+}
+
+/* Work out the columns of a message (in RAM, or in flash if in_flash is
+ * set) and start it from the right of the display
+ */
+static void show_text(const char* string, uint8_t in_flash, PixelColour colour) {
+	const uint8_t* font;
+	uint8_t col_data;
+	char c;
+
+	compositor_set_text_colour(colour);
+	text_length = 0;
+	text_columns[text_length++] = 0;
+	while((c = in_flash ? pgm_read_byte(string) : *string)) {
+		string++;
+		/* Characters we have no data for are just the blank column */
+		if(text_length < SCROLL_TEXT_COLUMNS) {
+			text_columns[text_length++] = 0;
 		}
-		col_data <<= 1;
+		font = font_columns(c);
+		if(!font) {
+			continue;
+		}
+		/* The least significant bit is set in the last column of a
+		 * character
+		 */
+		do {
+			col_data = pgm_read_byte(font++);
+			if(text_length < SCROLL_TEXT_COLUMNS) {
+				text_columns[text_length++] = col_data & 0xFE;
+			}
+		} while(!(col_data & 1));
 	}
-	column_colour_data[0] = 0;
-	ledmatrix_update_column(15, column_colour_data);
-	if(shift_countdown > 0) {
-		shift_countdown--;
+	next_column = 0;
+	end_column = text_length + MATRIX_NUM_COLUMNS;
+}
+
+/* The font data for a character, or 0 if there isn't any (lower case
+ * letters are shown as upper case). Only letters, digits and + have
+ * any.
+ */
+static const uint8_t* font_columns(char c) {
+	if(c >= 'a' && c <= 'z') {
+		return pgm_read_ptr(&letters[c - 'a']);
+	} else if(c >= 'A' && c <= 'Z') {
+		return pgm_read_ptr(&letters[c - 'A']);
+	} else if(c >= '0' && c <= '9') {
+		return pgm_read_ptr(&numbers[c - '0']);
+	} else if(c == '+') {
+		return cols_plus;
 	}
-	finished = finished && (shift_countdown == 0);
-	return !finished;
+	return 0;
 }
@@ -10,24 +10,78 @@
 #include <stdint.h>
 #include "pixel_colour.h"
 
+/* Columns of dots a message can take (5 or 6 a character). Any more of
+ * a message is left off.
+ */
+#define SCROLL_TEXT_COLUMNS 80
+
+/* Scroll speeds - the number of columns scrolled each time
+ * scroll_display() is called
+ */
+#define SCROLL_SPEED_NORMAL 1
+#define SCROLL_SPEED_FAST 2
+#define SCROLL_MAX_SPEED 4
+
+/* Queued messages - how many can wait, and the characters each can have
+ * (including the terminating 0) if it is copied from RAM
+ */
+#define SCROLL_QUEUE_SIZE 4
+#define SCROLL_MESSAGE_SIZE 10
+
+/* Time (ms) between steps of update_scrolling_display() */
+#define SCROLL_STEP_MS 150
+
 /* Sets the text to be displayed and the colour it will be
  * scrolled with. The message will start displaying immediately
  * so will overwrite/interfere with any currently scrolling
- * message. To avoid this, wait until the scroll_display()
- * function below has returned 0 to indicate the message scrolling
- * is complete. Note that this string is not 
- * copied, so it is important that this string not change
- * after this function is called while the string is still
- * being displayed.
+ * message, and any queued messages are dropped. To avoid this,
+ * wait until the scroll_display() function below has returned 0
+ * to indicate the message scrolling is complete, or queue the
+ * message instead. The string is turned into columns of dots
+ * straight away, so it can be changed after this function is
+ * called.
  */
 void set_scrolling_display_text(char* string, PixelColour colour);
 
+/* Add a message to be displayed once those showing and already
+ * queued have scrolled off. The string is copied (and cut short
+ * after SCROLL_MESSAGE_SIZE - 1 characters); with the _P version
+ * it is a string in flash (e.g. PSTR("+10")), which is only
+ * pointed to. Returns 0 (and drops the message) if the queue is
+ * full.
+ */
+uint8_t queue_scrolling_text(const char* string, PixelColour colour);
+uint8_t queue_scrolling_text_P(const char* string, PixelColour colour);
+
+/* Drop any queued messages and queue this one (copied, as above) to
+ * follow the message showing - for a message which mustn't be lost
+ * or come after stale ones. There is always room, so it can't fail.
+ */
+void replace_queued_scrolling_text(const char* string, PixelColour colour);
+
+/* Scroll the display if SCROLL_STEP_MS has passed since the last
+ * step and there is a message showing or queued - for calling each
+ * time through a loop with the current time, so messages scroll
+ * in the background.
+ */
+void update_scrolling_display(uint32_t time);
+
+/* Set the number of columns scrolled at a time (1 to
+ * SCROLL_MAX_SPEED), and get it
+ */
+void set_scrolling_display_speed(uint8_t columns);
+uint8_t get_scrolling_display_speed(void);
+
 /* Scroll the display. Should be called whenever the display
- * is to be scrolled one pixel to the left. It is recommended that
+ * is to be scrolled to the left (by the speed set above). The
+ * text scrolls over
+ * whatever else is on the display (see compositor.h), and anything
+ * else drawn is sent at the same time. It is recommended that
  * this function NOT be called from an interrupt service routine as
  * it will wait for SPI communication to be finished before returning. 
  * This could take over 1ms.
- * Returns 1 while a message is still scrolling, 0 when done.
+ * Returns 1 while a message is still scrolling (or one is
+ * queued), 0 when done.
  */
 uint8_t scroll_display(void);
 	
@@ -12,6 +12,8 @@
  * put method will either
  * (1) if interrupts are enabled, block until there is room in it, or
  * (2) if interrupts are disabled, will discard the character.
+ * Text in flash can also be queued with serial_put_P(), which queues
+ * only its address and length - the text is output straight from flash.
  * Input is blocking - requesting input from stdin will block
  * until a character is available. If interrupts are disabled when 
  * input is sought, then this will block forever.
@@ -25,6 +27,10 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "serialio.h"
+#include "log.h"
 
 /* System clock rate in Hz. (L at the end indicates this is a long constant) */
 #define SYSCLK 8000000L
@@ -46,6 +52,28 @@ volatile char out_buffer[OUTPUT_BUFFER_SIZE];
 volatile uint8_t out_insert_pos;
 volatile uint8_t bytes_in_out_buffer;
 
+/* Queue of text in flash waiting to be output (see serial_put_P()). The
+ * text isn't copied - the UDRE interrupt handler reads it straight from
+ * flash. So that output stays in order, each entry records how many of
+ * the bytes in out_buffer must go before it (bytes_before). Only the
+ * first entry's count goes down as bytes are output, so a new entry
+ * counts the bytes added since the entry before it was queued
+ * (bytes_since_flash_text), or the whole buffer if it is the only one.
+ * flash_next and flash_remaining are the text being output.
+ */
+#define FLASH_QUEUE_SIZE 8
+typedef struct {
+	const char* text;
+	uint8_t length;
+	uint8_t bytes_before;
+} FlashText;
+static volatile FlashText flash_queue[FLASH_QUEUE_SIZE];
+static volatile uint8_t flash_first;
+static volatile uint8_t flash_queued;
+static volatile uint8_t bytes_since_flash_text;
+static const char* volatile flash_next;
+static volatile uint8_t flash_remaining;
+
 /* Circular buffer to hold incoming characters. Works on same principle
  * as output buffer
  */
@@ -79,6 +107,9 @@ void init_serial_stdio(long baudrate, int8_t echo) {
 	*/
 	out_insert_pos = 0;
 	bytes_in_out_buffer = 0;
+	flash_first = 0;
+	flash_queued = 0;
+	flash_remaining = 0;
 	input_insert_pos = 0;
 	bytes_in_input_buffer = 0;
 	input_overrun = 0;
@@ -128,6 +159,79 @@ void clear_serial_input_buffer(void) {
 	bytes_in_input_buffer = 0;
 }
 
+uint8_t serial_input_overruns(void) {
+	return input_overrun;
+}
+
+uint8_t serial_put_bytes(const void* data, uint8_t length) {
+	const uint8_t* bytes = data;
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	
+	/* All or nothing - the bytes are only added if they all fit, and
+	 * we never wait (so this can be used by interrupt handlers). The
+	 * bytes aren't translated (no \r is added before \n).
+	 */
+	cli();
+	if(length > OUTPUT_BUFFER_SIZE - bytes_in_out_buffer) {
+		if(interrupts_enabled) {
+			sei();
+		}
+		return 0;
+	}
+	for(uint8_t i = 0; i < length; i++) {
+		out_buffer[out_insert_pos++] = bytes[i];
+		if(out_insert_pos == OUTPUT_BUFFER_SIZE) {
+			out_insert_pos = 0;
+		}
+	}
+	bytes_in_out_buffer += length;
+	bytes_since_flash_text += length;
+	UCSR0B |= (1 << UDRIE0);
+	if(interrupts_enabled) {
+		sei();
+	}
+	return 1;
+}
+
+void serial_put_P(const char* text, uint8_t length) {
+	volatile FlashText* entry;
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	
+	if(length == 0) {
+		return;
+	}
+	
+	/* As for uart_put_char() - if the queue is full we wait for the
+	 * interrupt handler to make room, unless interrupts are disabled,
+	 * in which case the text is discarded.
+	 */
+	while(flash_queued >= FLASH_QUEUE_SIZE) {
+		if(!interrupts_enabled) {
+			return;
+		}
+		/* else do nothing */
+	}
+	
+	cli();
+	entry = &flash_queue[(flash_first + flash_queued) % FLASH_QUEUE_SIZE];
+	entry->text = text;
+	entry->length = length;
+	entry->bytes_before = flash_queued ? bytes_since_flash_text
+			: bytes_in_out_buffer;
+	flash_queued++;
+	bytes_since_flash_text = 0;
+	UCSR0B |= (1 << UDRIE0);
+	if(interrupts_enabled) {
+		sei();
+	}
+}
+
+#ifdef BENCHMARK
+void benchmark_uart_put_char(char c) {
+	uart_put_char(c, stdout);
+}
+#endif
+
 static int uart_put_char(char c, FILE* stream) {
 	uint8_t interrupts_enabled;
 	
@@ -167,6 +271,7 @@ static int uart_put_char(char c, FILE* stream) {
 	cli();
 	out_buffer[out_insert_pos++] = c;
 	bytes_in_out_buffer++;
+	bytes_since_flash_text++;
 	if(out_insert_pos == OUTPUT_BUFFER_SIZE) {
 		/* Wrap around buffer pointer if necessary */
 		out_insert_pos = 0;
@@ -219,8 +324,22 @@ int uart_get_char(FILE* stream) {
  */
 ISR(USART0_UDRE_vect) 
 {
-	/* Check if we have data in our buffer */
-	if(bytes_in_out_buffer > 0) {
+	/* If the next text in flash has nothing in the buffer ahead of it,
+	 * start outputting it.
+	 */
+	if(flash_remaining == 0 && flash_queued > 0
+			&& flash_queue[flash_first].bytes_before == 0) {
+		flash_next = flash_queue[flash_first].text;
+		flash_remaining = flash_queue[flash_first].length;
+		flash_first = (flash_first + 1) % FLASH_QUEUE_SIZE;
+		flash_queued--;
+	}
+	
+	if(flash_remaining > 0) {
+		/* Output the next character of the text straight from flash */
+		UDR0 = pgm_read_byte(flash_next++);
+		flash_remaining--;
+	} else if(bytes_in_out_buffer > 0) {
 		/* Yes we do - remove the pending byte and output it
 		 * via the UART. The pending byte (character) is the
 		 * one which is "bytes_in_buffer" characters before the 
@@ -239,11 +358,14 @@ ISR(USART0_UDRE_vect)
 		 * buffer 
 		 */
 		bytes_in_out_buffer--;
+		if(flash_queued > 0) {
+			flash_queue[flash_first].bytes_before--;
+		}
 		
 		/* Output the character via the UART */
 		UDR0 = c;
 	} else {
-		/* No data in the buffer. We disable the UART Data
+		/* No data in the buffer or flash. We disable the UART Data
 		 * Register Empty interrupt because otherwise it 
 		 * will trigger again immediately this ISR exits. 
 		 * The interrupt is reenabled when a character is
@@ -275,13 +397,15 @@ ISR(USART0_RX_vect)
 	}
 	
 	/* 
-	 * Check if we have space in our buffer. If not, set the overrun
-	 * flag and throw away the character. (We never clear the 
-	 * overrun flag - it's up to the programmer to check/clear
-	 * this flag if desired.)
+	 * Check if we have space in our buffer. If not, count the overrun
+	 * and throw away the character. (The count stops at 255 and is
+	 * never cleared - see serial_input_overruns().)
 	 */
 	if(bytes_in_input_buffer >= INPUT_BUFFER_SIZE) {
-		input_overrun = 1;
+		if(input_overrun < UINT8_MAX) {
+			input_overrun++;
+		}
+		LOG(SERIAL_OVERRUN, input_overrun);
 	} else {
 		/* If the character is a carriage return, turn it into a
 		 * linefeed 
@@ -17,6 +17,7 @@
 #define SERIALIO_H_
 
 #include <stdint.h>
+#include <avr/pgmspace.h>
 
 /* Initialise serial IO using the UART. baudrate specifies the desired
  * baudrate (e.g. 19200) and echo determines whether incoming characters
@@ -36,4 +37,38 @@ int8_t serial_input_available(void);
  */
 void clear_serial_input_buffer(void);
 
+/* Return the number of characters thrown away because the input buffer
+ * was full (up to 255).
+ */
+uint8_t serial_input_overruns(void);
+
+/* Queue the given bytes for output exactly as they are, if there is room
+ * for all of them in the output buffer. Never waits, so can be used with
+ * interrupts off or in an interrupt handler. Returns 1 if they were
+ * queued, 0 if not.
+ */
+uint8_t serial_put_bytes(const void* data, uint8_t length);
+
+/* Queue length bytes of text in flash (program memory) for output. Only
+ * the address is queued - the text is output straight from flash, so it
+ * takes no room in the output buffer and isn't copied. It is output in
+ * order with everything else and exactly as it is (no \r is added before
+ * \n). Waits if too much text is already queued, unless interrupts are
+ * off, in which case the text is discarded (as stdout does when the
+ * output buffer is full).
+ */
+void serial_put_P(const char* text, uint8_t length);
+
+/* Queue a string literal from flash for output with serial_put_P(), e.g.
+ * serial_puts_P("\x1b[2J"). The length is known when compiling.
+ */
+#define serial_puts_P(s) serial_put_P(PSTR(s), sizeof(s) - 1)
+
+#ifdef BENCHMARK
+/* Queue a character for output on the UART (the function used by stdout)
+ * so that it can be timed by benchmark.c
+ */
+void benchmark_uart_put_char(char c);
+#endif
+
 #endif /* SERIALIO_H_ */
\ No newline at end of file
@@ -0,0 +1,301 @@
+/*
+ * snapshot.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "snapshot.h"
+#include "eewriter.h"
+#include "game.h"
+#include "level.h"
+#include "live.h"
+#include "motion.h"
+#include "score.h"
+#include "timer0.h"
+#include "lanegen.h"
+
+// Largest values of the fields which are limited to fewer bits than their
+// type has
+#define MAX_COUNTDOWN 0x7FFF
+#define MAX_STEPS_BEHIND 7
+
+#define RIVERBANK_ROW (FIELD_ROWS - 1)
+#define FIELD_COLUMNS 16
+
+// The latest snapshot saved (or found at start-up) and the slot the next
+// save will be written to
+static SnapshotRecord saved;
+static uint8_t saved_valid;
+static uint8_t next_slot;
+
+static uint16_t record_crc(const SnapshotRecord* record);
+static uint16_t fill_save(uint8_t* buffer, uint8_t* size);
+static uint8_t is_possible(const Snapshot* snapshot);
+static void put_bits(uint8_t* data, uint16_t* bit, uint32_t value, uint8_t width);
+static uint32_t get_bits(const uint8_t* data, uint16_t* bit, uint8_t width);
+static int8_t hex_digit(char c);
+
+void init_snapshots(void) {
+	SnapshotRecord record;
+	uint8_t slot;
+
+	// One pass over the slots, keeping the valid record with the latest
+	// sequence number (as init_high_scores())
+	saved_valid = 0;
+	next_slot = 0;
+	for(slot = 0; slot < SNAPSHOT_SLOTS; slot++) {
+		eeprom_read_block(&record,
+				(const void*)(SNAPSHOT_EEPROM_START + slot * SNAPSHOT_SLOT_SIZE),
+				sizeof(record));
+		if(record.crc == record_crc(&record) &&
+				(!saved_valid || (int16_t)(record.sequence - saved.sequence) > 0)) {
+			saved = record;
+			next_slot = (slot + 1) % SNAPSHOT_SLOTS;
+			saved_valid = 1;
+		}
+	}
+	if(!saved_valid) {
+		saved.sequence = 0;
+	}
+	eewriter_register(EEWRITER_SNAPSHOT, fill_save);
+}
+
+uint8_t snapshot_load_saved(Snapshot* snapshot) {
+	return saved_valid && snapshot_unpack(saved.data, snapshot) && snapshot->lives > 0;
+}
+
+void snapshot_take(Snapshot* snapshot) {
+	snapshot->seed = lanegen_get_seed();
+	snapshot->score = get_score();
+	snapshot->countdown = count_get_ms();
+	snapshot->level = get_level();
+	snapshot->lives = get_lives();
+	get_field_state(&snapshot->field);
+}
+
+void snapshot_restore_game(const Snapshot* snapshot) {
+	set_level(snapshot->level);
+	lanegen_set_seed(snapshot->seed);
+	set_score(snapshot->score);
+	set_lives(snapshot->lives);
+}
+
+void snapshot_restore_field(const Snapshot* snapshot) {
+	set_field_state(&snapshot->field);
+	count_set_ms(snapshot->countdown);
+}
+
+void snapshot_restore(const Snapshot* snapshot) {
+	snapshot_restore_game(snapshot);
+	initialise_game();
+	snapshot_restore_field(snapshot);
+}
+
+void snapshot_pack(const Snapshot* snapshot, uint8_t data[SNAPSHOT_SIZE]) {
+	const FieldState* field = &snapshot->field;
+	uint16_t bit = 0;
+	uint8_t row;
+
+	memset(data, 0, SNAPSHOT_SIZE);
+	put_bits(data, &bit, SNAPSHOT_VERSION, 8);
+	put_bits(data, &bit, snapshot->level, 8);
+	put_bits(data, &bit, snapshot->lives, 3);
+	put_bits(data, &bit, snapshot->score, 16);
+	put_bits(data, &bit, snapshot->countdown > MAX_COUNTDOWN ? MAX_COUNTDOWN :
+			snapshot->countdown, 15);
+	put_bits(data, &bit, snapshot->seed, 32);
+	put_bits(data, &bit, field->frog_row, 3);
+	put_bits(data, &bit, field->frog_column + 1, 5);
+	put_bits(data, &bit, field->frog_dead, 1);
+	put_bits(data, &bit, field->riverbank_status, 16);
+	put_bits(data, &bit, field->level_time, 32);
+	for(row = 0; row < 5; row++) {
+		put_bits(data, &bit, field->steps_behind[row] > MAX_STEPS_BEHIND ? MAX_STEPS_BEHIND :
+				field->steps_behind[row], 3);
+	}
+}
+
+uint8_t snapshot_unpack(const uint8_t data[SNAPSHOT_SIZE], Snapshot* snapshot) {
+	FieldState* field = &snapshot->field;
+	uint16_t bit = 0;
+	uint8_t row;
+
+	if(get_bits(data, &bit, 8) != SNAPSHOT_VERSION) {
+		return 0;
+	}
+	snapshot->level = get_bits(data, &bit, 8);
+	snapshot->lives = get_bits(data, &bit, 3);
+	snapshot->score = get_bits(data, &bit, 16);
+	snapshot->countdown = get_bits(data, &bit, 15);
+	snapshot->seed = get_bits(data, &bit, 32);
+	field->frog_row = get_bits(data, &bit, 3);
+	field->frog_column = (int8_t)get_bits(data, &bit, 5) - 1;
+	field->frog_dead = get_bits(data, &bit, 1);
+	field->riverbank_status = get_bits(data, &bit, 16);
+	field->level_time = get_bits(data, &bit, 32);
+	for(row = 0; row < 5; row++) {
+		field->steps_behind[row] = get_bits(data, &bit, 3);
+	}
+	// A corrupt EEPROM record or a mistyped '!' command mustn't put the
+	// game out of range
+	return is_possible(snapshot);
+}
+
+uint8_t snapshot_from_hex(const char* hex, Snapshot* snapshot) {
+	uint8_t data[SNAPSHOT_SIZE];
+	int8_t high, low;
+	uint8_t i;
+
+	for(i = 0; i < SNAPSHOT_SIZE; i++) {
+		high = hex_digit(hex[2 * i]);
+		low = hex_digit(hex[2 * i + 1]);
+		if(high < 0 || low < 0) {
+			return 0;
+		}
+		data[i] = (high << 4) | low;
+	}
+	return snapshot_unpack(data, snapshot);
+}
+
+void snapshot_save(void) {
+	Snapshot snapshot;
+	uint8_t data[SNAPSHOT_SIZE];
+	uint8_t interrupts_on;
+
+	snapshot_take(&snapshot);
+	snapshot_pack(&snapshot, data);
+
+	// The record may be copied by the EEPROM writer's interrupt handler,
+	// so it mustn't run while the record is being changed
+	interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	memcpy(saved.data, data, SNAPSHOT_SIZE);
+	saved_valid = 1;
+	if(interrupts_on) {
+		sei();
+	}
+	eewriter_request(EEWRITER_SNAPSHOT);
+}
+
+void snapshot_send(void) {
+	Snapshot snapshot;
+	uint8_t data[SNAPSHOT_SIZE];
+	uint8_t i;
+
+	snapshot_take(&snapshot);
+	snapshot_pack(&snapshot, data);
+	printf_P(PSTR("\x1b_Z"));
+	for(i = 0; i < SNAPSHOT_SIZE; i++) {
+		printf_P(PSTR("%02X"), data[i]);
+	}
+	printf_P(PSTR("\x1b\\"));
+}
+
+// Return 1 if the snapshot could have come from a game (see
+// snapshot_unpack() in snapshot.h)
+static uint8_t is_possible(const Snapshot* snapshot) {
+	const FieldState* field = &snapshot->field;
+	const uint8_t* record;
+	uint16_t riverbank;
+	LaneDescriptor lane;
+	RowMotion motion;
+	uint8_t row;
+
+	if(snapshot->level == 0) {
+		return 0;
+	}
+	if(field->frog_row < 0 || field->frog_row > RIVERBANK_ROW ||
+			field->frog_column < 0 || field->frog_column >= FIELD_COLUMNS) {
+		return 0;
+	}
+	// Holes are filled, never emptied, and a frog only gets into the
+	// riverbank by filling a hole (or dying on one filled already)
+	record = level_read_riverbank(level_descriptor(snapshot->level), &riverbank);
+	if((field->riverbank_status & riverbank) != riverbank) {
+		return 0;
+	}
+	if(field->frog_row == RIVERBANK_ROW &&
+			!((field->riverbank_status >> field->frog_column) & 1)) {
+		return 0;
+	}
+	// Rows only fall behind the steps due since the level started
+	for(row = 0; row < 5; row++) {
+		record = level_read_lane(record, &lane);
+		motion_init(&motion, lane.period, lane.rate, lane.accel, lane.rate_limit,
+				lane.direction);
+		if(field->steps_behind[row] > motion_steps_at(&motion, field->level_time)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// CRC of the record up to (not including) the CRC itself
+static uint16_t record_crc(const SnapshotRecord* record) {
+	const uint8_t* byte = (const uint8_t*)record;
+	uint16_t crc = SNAPSHOT_CRC_INIT;
+	uint8_t i;
+
+	for(i = 0; i < offsetof(SnapshotRecord, crc); i++) {
+		crc = _crc16_update(crc, byte[i]);
+	}
+	return crc;
+}
+
+// Copy the latest snapshot (with the next sequence number) for the EEPROM
+// writer to save in the next slot. Called with interrupts off.
+static uint16_t fill_save(uint8_t* buffer, uint8_t* size) {
+	uint16_t address = SNAPSHOT_EEPROM_START + next_slot * SNAPSHOT_SLOT_SIZE;
+
+	saved.sequence++;
+	saved.crc = record_crc(&saved);
+	memcpy(buffer, &saved, sizeof(SnapshotRecord));
+	*size = sizeof(SnapshotRecord);
+	next_slot = (next_slot + 1) % SNAPSHOT_SLOTS;
+	return address;
+}
+
+// Write the low width bits of value starting at the given bit of data
+// (which must start cleared) and move the bit on
+static void put_bits(uint8_t* data, uint16_t* bit, uint32_t value, uint8_t width) {
+	while(width--) {
+		if(value & 1) {
+			data[*bit >> 3] |= (1 << (*bit & 7));
+		}
+		value >>= 1;
+		(*bit)++;
+	}
+}
+
+static uint32_t get_bits(const uint8_t* data, uint16_t* bit, uint8_t width) {
+	uint32_t value = 0;
+	uint8_t i;
+
+	for(i = 0; i < width; i++) {
+		if(data[*bit >> 3] & (1 << (*bit & 7))) {
+			value |= ((uint32_t)1 << i);
+		}
+		(*bit)++;
+	}
+	return value;
+}
+
+static int8_t hex_digit(char c) {
+	if(c >= '0' && c <= '9') {
+		return c - '0';
+	} else if(c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	} else if(c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+	return -1;
+}
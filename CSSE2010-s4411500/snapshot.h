@@ -0,0 +1,113 @@
+/*
+ * snapshot.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Game state snapshots. A snapshot holds everything needed to carry on a
+ * game from where it was: the level, score, lives, countdown, lane
+ * generator seed and the field (see FieldState in game.h). It is packed
+ * into SNAPSHOT_SIZE bytes, each value taking only the bits its range
+ * needs. Packing and unpacking go through the same fixed list of values
+ * every time, so take the same time for any snapshot.
+ *
+ * A snapshot is saved to EEPROM (in the background, see eewriter.h) at
+ * the start of each level, whenever a frog crosses or dies, when the game
+ * is paused and at game over. Saves go round SNAPSHOT_SLOTS slots with a
+ * sequence number and CRC, as the high score table does (see hiscore.h).
+ * If the latest snapshot found at start-up is of a game still in
+ * progress, that game is resumed without the splash screen.
+ *
+ * For testing, '#' on the serial port sends the current snapshot in hex
+ * inside a terminal APC string (ESC _ Z <hex> ESC \, which terminals
+ * don't display) and '!' followed by a snapshot in hex and return loads
+ * one, so a test can jump straight to any state.
+ *
+ * Format version 2 - values in this order, each least significant bit
+ * first, starting from bit 0 of byte 0:
+ *     version 8, level 8, lives 3, score 16, countdown (ms) 15, seed 32,
+ *     frog row 3, frog column + 1 5, frog dead 1, riverbank status 16,
+ *     level time (ms) 32, then steps behind 3 for each moving row (lanes
+ *     1 to 3, logs 5 and 6)
+ * 154 bits in all. The lane and log positions aren't stored - they follow
+ * from the level time (see motion.h). (Version 1 stored each row's
+ * position and motion state in 315 bits.)
+ */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <stdint.h>
+#include "game.h"
+
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_SIZE 20
+#define SNAPSHOT_HEX_LENGTH (2 * SNAPSHOT_SIZE)
+
+// EEPROM used - SNAPSHOT_SLOTS records of SNAPSHOT_SLOT_SIZE bytes from
+// SNAPSHOT_EEPROM_START (after the high score table). A slot is a record
+// (sizeof(SnapshotRecord)) rounded up to the 4 byte EEPROM page. The 384
+// bytes go to more slots, so each is written less often.
+#define SNAPSHOT_EEPROM_START 256
+#define SNAPSHOT_SLOT_SIZE 24
+#define SNAPSHOT_SLOTS 16
+
+// First value of the CRC (CRC-16, as _crc16_update() in util/crc16.h)
+#define SNAPSHOT_CRC_INIT 0xFFFF
+
+typedef struct {
+	uint32_t seed;
+	uint16_t score;
+	uint16_t countdown;
+	uint8_t level;
+	uint8_t lives;
+	FieldState field;
+} Snapshot;
+
+// A snapshot as saved in EEPROM. The CRC covers everything before it.
+typedef struct {
+	uint16_t sequence;
+	uint8_t data[SNAPSHOT_SIZE];
+	uint16_t crc;
+} __attribute__ ((packed)) SnapshotRecord;
+
+// Find the latest valid snapshot in EEPROM. Reads the EEPROM directly so
+// must be called before any save has been started, e.g. while
+// initialising the hardware.
+void init_snapshots(void);
+
+// If the latest snapshot found by init_snapshots() is of a game still in
+// progress, unpack it into snapshot and return 1. Otherwise return 0.
+uint8_t snapshot_load_saved(Snapshot* snapshot);
+
+// Take a snapshot of the game as it is now
+void snapshot_take(Snapshot* snapshot);
+
+// Put the game into the state of a snapshot. snapshot_restore_game() sets
+// the level, seed, score and lives. snapshot_restore_field() sets the
+// field and countdown and needs the layout of the level to have been
+// loaded (by initialise_game()) first. snapshot_restore() does both.
+void snapshot_restore_game(const Snapshot* snapshot);
+void snapshot_restore_field(const Snapshot* snapshot);
+void snapshot_restore(const Snapshot* snapshot);
+
+// Pack or unpack a snapshot. snapshot_unpack() returns 0 if the data is
+// of a different format version or couldn't have come from a game: the
+// level must have started (levels carry on past the table, to 255), the
+// frog must be on the field (and on a filled hole or wall if in the
+// riverbank row), the riverbank must still have all of the level's walls
+// and no row can be further behind than the steps it has made by the
+// level time (at the level's own speeds).
+void snapshot_pack(const Snapshot* snapshot, uint8_t data[SNAPSHOT_SIZE]);
+uint8_t snapshot_unpack(const uint8_t data[SNAPSHOT_SIZE], Snapshot* snapshot);
+
+// Unpack a snapshot from SNAPSHOT_HEX_LENGTH hex digits. Returns 0 if
+// they aren't a valid snapshot.
+uint8_t snapshot_from_hex(const char* hex, Snapshot* snapshot);
+
+// Save a snapshot of the game as it is now to EEPROM (in the background)
+void snapshot_save(void);
+
+// Send a snapshot of the game as it is now on the serial port
+void snapshot_send(void);
+
+#endif /* SNAPSHOT_H_ */
@@ -4,9 +4,16 @@
  * Author: Peter Sutton
  */ 
 
+#ifndef SPI_USART1
+
 #include <avr/io.h>
 #include "spi.h"
 
+// Clock divider in use and bytes sent since reset (for the console, see
+// console.h)
+static uint8_t divider;
+static uint32_t bytes_sent;
+
 void spi_setup_master(uint8_t clockdivider) {
 	// Set up SPI communication as a master
 	// Make the SS, MOSI and SCK pins outputs. These are pins
@@ -26,6 +33,19 @@ void spi_setup_master(uint8_t clockdivider) {
 	// based on the given clock divider
 	// Invalid values default to the slowest speed
 	// We consider each bit in turn
+	switch(clockdivider) {
+		case 2:
+		case 4:
+		case 8:
+		case 16:
+		case 32:
+		case 64:
+			divider = clockdivider;
+			break;
+		default:
+			divider = 128;
+			break;
+	}
 	switch(clockdivider) {
 		case 2:
 		case 8:
@@ -62,8 +82,23 @@ uint8_t spi_send_byte(uint8_t byte) {
 	// will cause the SPIF bit to be reset to 0. See page 224 of the 
 	// ATmega324A datasheet.)
 	SPDR0 = byte;
+	bytes_sent++;
 	while((SPSR0 & (1<<SPIF0)) == 0) {
 		; // wait
 	}
 	return SPDR0;
-}
\ No newline at end of file
+}
+
+void spi_flush(void) {
+	// spi_send_byte() has already waited
+}
+
+uint8_t spi_clock_divider(void) {
+	return divider;
+}
+
+uint32_t spi_bytes_sent(void) {
+	return bytes_sent;
+}
+
+#endif /* SPI_USART1 */
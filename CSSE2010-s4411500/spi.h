@@ -2,17 +2,32 @@
  * spi.h
  *
  * Author: Peter Sutton
+ *
+ * The LED matrix is sent to over the SPI port (spi.c), or with
+ * SPI_USART1 defined over USART1 in Master SPI mode (spi_usart1.c) - see
+ * spi_usart1.c for the pins it needs.
  */ 
 
 #ifndef SPI_H_
 #define SPI_H_
 
+#include <stdint.h>
+
 // Set up SPI communication as a master.
 // clockdivider should be one of 2,4,8,16,32,64,128
 void spi_setup_master(uint8_t clockdivider);
 
 // Send and receive an SPI byte. This function will take at least 8 
-// cyles of the divided clock (i.e. will busy wait).
+// cyles of the divided clock (i.e. will busy wait). (With SPI_USART1 it
+// returns as soon as the byte is buffered, and returns 0.)
 uint8_t spi_send_byte(uint8_t byte);
 
+// Wait until every byte given to spi_send_byte() has been sent
+void spi_flush(void);
+
+// The clock divider set up by spi_setup_master() (128 if the one given
+// wasn't valid) and the number of bytes sent since reset
+uint8_t spi_clock_divider(void);
+uint32_t spi_bytes_sent(void);
+
 #endif /* SPI_H_ */
\ No newline at end of file
@@ -0,0 +1,149 @@
+/*
+ * spi_usart1.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * spi.h over USART1 in Master SPI mode (MSPIM), built in place of spi.c
+ * when SPI_USART1 is defined. USART1 has a transmit buffer as well as its
+ * shift register, so the next byte can be written while one is going out
+ * and bytes are sent back to back - the SPI port has to finish a byte and
+ * have its flag read before the next can be written.
+ *
+ * The matrix's data and clock go to TXD1 (PD3) and XCK1 (PD4) in place of
+ * MOSI (PB5) and SCK (PB7); slave select stays on PB4. Only the
+ * transmitter is enabled, so RXD1 (PD2) is left as the seven segment
+ * digit select (see timer0.c).
+ *
+ * With interrupts on, a byte which can't go straight into the transmit
+ * buffer is queued and sent by the data register empty interrupt, so
+ * spi_send_byte() only waits if the queue is full. With interrupts off
+ * (e.g. in an interrupt handler) the queue is sent and then the byte,
+ * polled.
+ */
+
+#ifdef SPI_USART1
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "spi.h"
+
+// Must be a power of 2 (no more than 128)
+#define SPI_QUEUE_SIZE 32
+
+static volatile uint8_t queue[SPI_QUEUE_SIZE];
+static volatile uint8_t queue_first;
+static volatile uint8_t queue_length;
+
+// Clock divider in use and bytes sent since reset (for the console, see
+// console.h)
+static uint8_t divider;
+static uint32_t bytes_sent;
+
+static void send_queue_polled(void);
+
+void spi_setup_master(uint8_t clockdivider) {
+	// Let anything sent at the old speed finish
+	spi_flush();
+
+	switch(clockdivider) {
+		case 2:
+		case 4:
+		case 8:
+		case 16:
+		case 32:
+		case 64:
+			divider = clockdivider;
+			break;
+		default:
+			divider = 128;
+			break;
+	}
+
+	// The baud rate register must be 0 while the mode is set (see the
+	// ATmega324A datasheet, USART in SPI Mode). XCK1 as an output makes
+	// us the master. Mode 0, most significant bit first, as spi.c.
+	UBRR1 = 0;
+	DDRD |= (1<<DDRD3)|(1<<DDRD4);
+	UCSR1C = (1<<UMSEL11)|(1<<UMSEL10);
+	UCSR1B = (1<<TXEN1);
+	// The clock is the system clock / (2 * (UBRR1 + 1))
+	UBRR1 = divider / 2 - 1;
+
+	// Slave select is an output, held low
+	DDRB |= (1<<4);
+	PORTB &= ~(1<<4);
+}
+
+uint8_t spi_send_byte(uint8_t byte) {
+	bytes_sent++;
+	if(bit_is_clear(SREG, SREG_I)) {
+		send_queue_polled();
+		loop_until_bit_is_set(UCSR1A, UDRE1);
+		UCSR1A = (1<<TXC1);
+		UDR1 = byte;
+		return 0;
+	}
+	// Only the interrupt takes from the queue, so once there is room there
+	// still is after interrupts are turned off
+	while(queue_length == SPI_QUEUE_SIZE) {
+		; // wait
+	}
+	cli();
+	if(!queue_length && bit_is_set(UCSR1A, UDRE1)) {
+		// Nothing waiting and room in the transmit buffer
+		UCSR1A = (1<<TXC1);
+		UDR1 = byte;
+	} else {
+		queue[(queue_first + queue_length) & (SPI_QUEUE_SIZE - 1)] = byte;
+		queue_length++;
+		UCSR1B |= (1<<UDRIE1);
+	}
+	sei();
+	return 0;
+}
+
+void spi_flush(void) {
+	if(bit_is_set(SREG, SREG_I)) {
+		while(queue_length) {
+			; // wait
+		}
+	} else {
+		send_queue_polled();
+	}
+	// The transmit complete flag is cleared as each byte is written, so
+	// it is set once the last one has left the shift register
+	if(bytes_sent) {
+		loop_until_bit_is_set(UCSR1A, TXC1);
+	}
+}
+
+uint8_t spi_clock_divider(void) {
+	return divider;
+}
+
+uint32_t spi_bytes_sent(void) {
+	return bytes_sent;
+}
+
+// Send the queue without the interrupt (interrupts must be off)
+static void send_queue_polled(void) {
+	while(queue_length) {
+		loop_until_bit_is_set(UCSR1A, UDRE1);
+		UCSR1A = (1<<TXC1);
+		UDR1 = queue[queue_first];
+		queue_first = (queue_first + 1) & (SPI_QUEUE_SIZE - 1);
+		queue_length--;
+	}
+	UCSR1B &= ~(1<<UDRIE1);
+}
+
+ISR(USART1_UDRE_vect) {
+	UCSR1A = (1<<TXC1);
+	UDR1 = queue[queue_first];
+	queue_first = (queue_first + 1) & (SPI_QUEUE_SIZE - 1);
+	if(--queue_length == 0) {
+		UCSR1B &= ~(1<<UDRIE1);
+	}
+}
+
+#endif /* SPI_USART1 */
@@ -0,0 +1,53 @@
+/*
+ * statebus.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+
+#include "statebus.h"
+
+static StateHandler handlers[STATEBUS_SUBSCRIBERS];
+static uint8_t interests[STATEBUS_SUBSCRIBERS];
+
+// STATE_* bits changed since the last dispatch
+static volatile uint8_t changed;
+
+void statebus_subscribe(uint8_t subscriber, uint8_t wanted, StateHandler handler) {
+	handlers[subscriber] = handler;
+	interests[subscriber] = wanted;
+}
+
+void state_changed(uint8_t changes) {
+	uint8_t interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	changed |= changes;
+	if(interrupts_on) {
+		sei();
+	}
+}
+
+void state_dispatch(void) {
+	uint8_t changes;
+	uint8_t interrupts_on;
+
+	// Nothing to do (the usual case) costs a load and a branch
+	if(!changed) {
+		return;
+	}
+	interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	changes = changed;
+	changed = 0;
+	if(interrupts_on) {
+		sei();
+	}
+	for(uint8_t i = 0; i < STATEBUS_SUBSCRIBERS; i++) {
+		if(handlers[i] && (interests[i] & changes)) {
+			handlers[i](interests[i] & changes);
+		}
+	}
+}
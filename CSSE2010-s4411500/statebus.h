@@ -0,0 +1,61 @@
+/*
+ * statebus.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Change notification for the game state shown on the outputs. The
+ * modules which keep the score, lives, level, countdown and frog call
+ * state_changed() with a STATE_* bit when it changes. The bits collect
+ * until state_dispatch() (called by the play loop and the other loops
+ * which wait) passes them to each subscriber with a handler for any of
+ * them, once - so several changes between dispatches are shown by one
+ * update, and nothing is done for an output whose state hasn't changed.
+ *
+ * The subscribers are the outputs:
+ *     lives LEDs (live.c)           STATE_LIVES
+ *     seven segment display         STATE_COUNTDOWN
+ *         (timer0.c)
+ *     terminal score, lives and     STATE_SCORE, STATE_LIVES, STATE_LEVEL,
+ *         level (project.c)         STATE_TERMINAL
+ *     frog on the LED matrix        STATE_FROG
+ *         (game.c)
+ *
+ * state_changed() can be used in interrupt handlers (the countdown
+ * changes in the TIMER0 interrupt). The handlers are only called from
+ * state_dispatch().
+ */
+
+#ifndef STATEBUS_H_
+#define STATEBUS_H_
+
+#include <stdint.h>
+
+// Parts of the state
+#define STATE_SCORE		(1<<0)
+#define STATE_LIVES		(1<<1)
+#define STATE_LEVEL		(1<<2)
+#define STATE_COUNTDOWN	(1<<3)	// the seconds shown
+#define STATE_FROG		(1<<4)	// the frog's position or death
+#define STATE_TERMINAL	(1<<5)	// the terminal was cleared - show it all again
+
+// Subscribers
+#define STATEBUS_LIVES_LEDS		0
+#define STATEBUS_SEVEN_SEGMENT	1
+#define STATEBUS_TERMINAL		2
+#define STATEBUS_MATRIX			3
+#define STATEBUS_SUBSCRIBERS	4
+
+// Called with the bits (of those subscribed to) which have changed since
+// the last dispatch
+typedef void (*StateHandler)(uint8_t changes);
+
+// Set the handler of a subscriber and the STATE_* bits it wants
+void statebus_subscribe(uint8_t subscriber, uint8_t interests, StateHandler handler);
+
+// Note a change to the given parts of the state
+void state_changed(uint8_t changes);
+
+// Pass the changes since the last dispatch to the subscribers
+void state_dispatch(void);
+
+#endif /* STATEBUS_H_ */
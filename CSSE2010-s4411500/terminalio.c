@@ -10,25 +10,26 @@
 #include <avr/pgmspace.h>
 
 #include "terminalio.h"
+#include "serialio.h"
 
 void move_cursor(int x, int y) {
     printf_P(PSTR("\x1b[%d;%dH"), y, x);
 }
 
 void normal_display_mode(void) {
-	printf_P(PSTR("\x1b[0m"));
+	serial_puts_P("\x1b[0m");
 }
 
 void reverse_video(void) {
-	printf_P(PSTR("\x1b[7m"));
+	serial_puts_P("\x1b[7m");
 }
 
 void clear_terminal(void) {
-	printf_P(PSTR("\x1b[2J"));
+	serial_puts_P("\x1b[2J");
 }
 
 void clear_to_end_of_line(void) {
-	printf_P(PSTR("\x1b[K"));
+	serial_puts_P("\x1b[K");
 }
 
 void set_display_attribute(DisplayParameter parameter) {
@@ -36,15 +37,15 @@ void set_display_attribute(DisplayParameter parameter) {
 }
 
 void hide_cursor() {
-	printf_P(PSTR("\x1b[?25l"));
+	serial_puts_P("\x1b[?25l");
 }
 
 void show_cursor() {
-	printf_P(PSTR("\x1b[?25h"));
+	serial_puts_P("\x1b[?25h");
 }
 
 void enable_scrolling_for_whole_display(void) {
-	printf_P(PSTR("\x1b[r"));
+	serial_puts_P("\x1b[r");
 }
 
 void set_scroll_region(int8_t y1, int8_t y2) {
@@ -52,11 +53,11 @@ void set_scroll_region(int8_t y1, int8_t y2) {
 }
 
 void scroll_down(void) {
-	printf_P(PSTR("\x1bM"));	// ESC-M
+	serial_puts_P("\x1bM");	// ESC-M
 }
 
 void scroll_up(void) {
-	printf_P(PSTR("\x1b\x44"));	// ESC-D
+	serial_puts_P("\x1b\x44");	// ESC-D
 }
 
 void draw_horizontal_line(int8_t y, int8_t start_x, int8_t end_x) {
@@ -79,7 +80,7 @@ void draw_vertical_line(int8_t x, int8_t start_y, int8_t end_y) {
 	for(i=start_y; i < end_y; i++) {
 		printf(" ");
 		/* Move down one and back to the left one */
-		printf_P(PSTR("\x1b[B\x1b[D"));
+		serial_puts_P("\x1b[B\x1b[D");
 	}
 	printf(" ");
 	normal_display_mode();
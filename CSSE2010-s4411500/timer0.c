@@ -12,6 +12,7 @@
 #include <avr/interrupt.h>
 
 #include "timer0.h"
+#include "statebus.h"
 
 /* Our internal clock tick count - incremented every 
  * millisecond. Will overflow every ~49 days. */
@@ -23,11 +24,23 @@ static uint16_t timer_count = 0;
 
 static volatile uint16_t count = 0;
 
+/* Milliseconds of count until the seconds shown change (count % 1000,
+ * kept without dividing in the interrupt handler) */
+static volatile uint16_t count_fraction = 0;
+
 static volatile uint8_t digit_counter = 0;
 
 /* Seven segment display segment values for 0 to 9 */
 static const uint8_t seven_seg_data[10] = {63,6,91,79,102,109,125,7,127,111};
 
+/* Segments shown on the right (units) and left (tens) digits - worked out
+ * by show_countdown() when the seconds change, so the interrupt handler
+ * only has to copy them out */
+static volatile uint8_t seven_seg_digits[2];
+
+static void show_countdown(uint8_t changes);
+static void count_down(void);
+
 /* Set up timer 0 to generate an interrupt every 1ms. 
  * We will divide the clock by 64 and count up to 124.
  * We will therefore get an interrupt every 64 x 125
@@ -66,6 +79,8 @@ void init_timer0(void) {
 	 * 1 to it.
 	 */
 	TIFR0 &= (1<<OCF0A);
+	
+	statebus_subscribe(STATEBUS_SEVEN_SEGMENT, STATE_COUNTDOWN, show_countdown);
 }
 
 uint32_t get_current_time(void) {
@@ -114,29 +129,60 @@ void init_count(void) {
 	DDRC = 0xFF;
 	DDRD |= (1 << DDRD2);
 	
-	count = 0;
+	count_set_ms(0);
 }
 
 void count_set(uint8_t start) {
-	count = start * 1000;
+	count_set_ms(start * 1000);
 }
 
 void count_clear(void) {
-	count = 0;
+	count_set_ms(0);
 }
 
 uint8_t count_end(void) {
 	return (count == 0);
 }
 
+uint16_t count_get_ms(void) {
+	uint16_t returnValue;
+	
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	cli();
+	returnValue = count;
+	if(interruptsOn) {
+		sei();
+	}
+	return returnValue;
+}
+
+void count_set_ms(uint16_t ms) {
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	cli();
+	count = ms;
+	count_fraction = ms % 1000;
+	state_changed(STATE_COUNTDOWN);
+	if(interruptsOn) {
+		sei();
+	}
+}
+
+#ifdef JOURNAL_REPLAY
+void count_tick(void) {
+	if(timer_count) {
+		count_down();
+	}
+}
+#endif
+
 ISR(TIMER0_COMPA_vect) {
 	clockTicks++;
 	
 	if(timer_count) {
 		timeClockTicks++;
-		if(count > 0) {
-			count--;
-		}
+#ifndef JOURNAL_REPLAY
+		count_down();
+#endif
 	}
 	
 	digit_counter++;
@@ -146,26 +192,9 @@ ISR(TIMER0_COMPA_vect) {
 	
 	uint8_t seven_seg_cc = digit_counter >> 1;
 	
-	//  Start countdown when game started
-	if(count > 0) { 
-		uint16_t to_display = count + 1000;
-		//led display
-		if(seven_seg_cc == 0) {
-			/* Display rightmost digit - tens of second */
-			PORTC = seven_seg_data[(to_display / 1000) % 10];
-			
-		} else {
-			/* Display leftmost digit - tens of seconds */
-			if (to_display > 10000) { 
-				PORTC = seven_seg_data[(to_display / 10000) % 10];
-			} else {
-				PORTC = 0;
-			}
-			
-		}
-	} else {
-		PORTC = 0;
-	}
+	/* Display the rightmost digit (seconds) or the leftmost (tens of
+	 * seconds) */
+	PORTC = seven_seg_digits[seven_seg_cc];
 	
 	/* Output the digit selection (CC) bit */
 	if (seven_seg_cc) {
@@ -174,3 +203,43 @@ ISR(TIMER0_COMPA_vect) {
 		PORTD &= ~(1 << PORTD2);
 	}
 }
+
+/* Count down a millisecond, if there's any time left */
+static void count_down(void) {
+	if(count > 0) {
+		count--;
+		/* The seconds shown change as count passes each whole
+		 * second and when it reaches 0 */
+		if(count_fraction) {
+			count_fraction--;
+		} else {
+			count_fraction = 999;
+			state_changed(STATE_COUNTDOWN);
+		}
+		if(count == 0) {
+			state_changed(STATE_COUNTDOWN);
+		}
+	}
+}
+
+/* Subscriber to STATE_COUNTDOWN (see statebus.h) - work out the digits for
+ * the seconds left (rounded up), or blank while the countdown is 0 */
+static void show_countdown(uint8_t changes) {
+	uint16_t ms = count_get_ms();
+	uint8_t seconds = ms / 1000 + 1;
+	uint8_t units = 0, tens = 0;
+	
+	if(ms > 0) {
+		units = seven_seg_data[seconds % 10];
+		if(seconds >= 10) {
+			tens = seven_seg_data[(seconds / 10) % 10];
+		}
+	}
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	cli();
+	seven_seg_digits[0] = units;
+	seven_seg_digits[1] = tens;
+	if(interruptsOn) {
+		sei();
+	}
+}
@@ -46,4 +46,18 @@ void count_clear(void);
 
 uint8_t count_end(void);
 
+/* Milliseconds left on the countdown, e.g. to save and restore it
+ */
+uint16_t count_get_ms(void);
+
+void count_set_ms(uint16_t ms);
+
+#ifdef JOURNAL_REPLAY
+/* When a journal is replayed the countdown follows the journal's clock
+ * (see journal.h) rather than the interrupt handler - this counts one
+ * millisecond of it (if counting).
+ */
+void count_tick(void);
+#endif
+
 #endif
\ No newline at end of file
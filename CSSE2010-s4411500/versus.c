@@ -0,0 +1,443 @@
+/*
+ * versus.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include "versus.h"
+
+#ifdef VERSUS_ENABLED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+#include <util/crc16.h>
+
+#include "game.h"
+#include "level.h"
+#include "serialio.h"
+
+// Moves as sent in a frame
+#define MOVE_NONE 0
+#define MOVE_LAST 4		// push button 3 (left)
+#define MOVE_HELLO 7
+
+#define FRAME_SIZE 4
+#define FRAME_START 0xC0
+#define FRAME_MORE 0x80
+#define FRAME_MARK_MASK 0xC0
+#define FRAME_DATA_MASK 0x3F
+
+// Frames received but not yet confirmed. (A board never gets more than
+// VERSUS_MAX_ROLLBACK ticks ahead of this one, so there are never more than
+// that waiting.) A power of two.
+#define RING_SIZE 32
+#define RING_MASK (RING_SIZE - 1)
+
+// Finish tick of a frog that hasn't filled its riverbank
+#define NO_TICK UINT32_MAX
+
+// TIMER1 free runs at clock/8 (see init_autopilot())
+#define TIMER1_PRESCALE 8
+
+static uint8_t state;
+
+// Ticks played by this board, ticks of the other board whose moves are
+// known and ticks confirmed (the ghost played with the known moves)
+static uint32_t local_tick;
+static uint32_t remote_tick;
+static uint32_t confirmed_tick;
+
+// Ghost as at the start of confirmed_tick, and as predicted at the start
+// of ghost_tick (which catches up with local_tick after every tick)
+static FrogContext confirmed;
+static FrogContext ghost;
+static uint32_t ghost_tick;
+
+// Moves and hashes from the frames received, by tick
+static uint8_t remote_move[RING_SIZE];
+static uint8_t remote_hash[RING_SIZE];
+
+// Ticks at which the riverbanks were filled
+static uint32_t local_finish;
+static uint32_t remote_finish;
+
+// Move to be sent at the next tick
+static uint8_t next_move;
+
+// Time the next tick is due, and of the last hello sent and the last
+// frame received (ms)
+static uint32_t next_tick_time;
+static uint32_t last_hello_time;
+static uint32_t last_heard_time;
+static uint8_t stalled;
+
+// Frame being received - bits so far and the number of bytes
+static uint32_t frame_bits;
+static uint8_t frame_length;
+
+static VersusStats stats;
+// Set when a rollback has put the ghost back, so that predict_ghost()
+// times the re-simulation
+static uint8_t rolled_back;
+
+static void race_tick(uint8_t move);
+static void play_tick(void);
+static void confirm_ticks(void);
+static void predict_ghost(void);
+static void decide_winner(void);
+static void draw_ghost(void);
+static void enter_ghost(FrogContext* context);
+static void leave_ghost(FrogContext* context);
+static uint8_t context_hash(const FrogContext* context);
+static uint8_t frame_check(uint8_t tick, uint8_t move, uint8_t hash);
+static void send_frame(uint8_t tick, uint8_t move, uint8_t hash);
+static void receive_frames(uint32_t now);
+static void receive_frame(uint32_t bits, uint32_t now);
+
+void versus_start(uint32_t now) {
+	set_level(1);
+	initialise_game();
+	set_game_quiet(GAME_QUIET_SCORE);
+	copy_frog_context(&confirmed);
+	ghost = confirmed;
+
+	local_tick = remote_tick = confirmed_tick = ghost_tick = 0;
+	local_finish = remote_finish = NO_TICK;
+	next_move = MOVE_NONE;
+	frame_length = 0;
+	stalled = 0;
+	rolled_back = 0;
+	memset(&stats, 0, sizeof(stats));
+
+	state = VERSUS_WAITING;
+	last_hello_time = now - VERSUS_HELLO_MS;
+	last_heard_time = now;
+}
+
+void versus_move(int8_t move) {
+	if(move >= 0 && move <= 3 && next_move == MOVE_NONE) {
+		next_move = move + 1;
+	}
+}
+
+uint8_t versus_run(uint32_t now) {
+	uint8_t ticked = 0;
+
+	receive_frames(now);
+	if(state == VERSUS_WAITING) {
+		if(now - last_hello_time >= VERSUS_HELLO_MS) {
+			last_hello_time = now;
+			send_frame(0, MOVE_HELLO, 0);
+		}
+		return state;
+	}
+	if(state != VERSUS_RACING) {
+		return state;
+	}
+
+	// Play a tick if one is due (catching up one a call after a stall)
+	if((int32_t)(now - next_tick_time) >= 0) {
+		if(local_tick - confirmed_tick >= VERSUS_MAX_ROLLBACK) {
+			if(!stalled) {
+				stalled = 1;
+				stats.stalls++;
+			}
+		} else {
+			stalled = 0;
+			play_tick();
+			next_tick_time += VERSUS_TICK_MS;
+			ticked = 1;
+		}
+	}
+
+	confirm_ticks();
+	if(state != VERSUS_RACING) {
+		return state;
+	}
+	predict_ghost();
+	if(ticked) {
+		draw_ghost();
+	}
+	decide_winner();
+	if(state == VERSUS_RACING && now - last_heard_time >= VERSUS_LINK_TIMEOUT) {
+		state = VERSUS_LINK_LOST;
+	}
+	return state;
+}
+
+void versus_get_stats(VersusStats* result) {
+	*result = stats;
+	result->ticks = local_tick;
+}
+
+void versus_finish(void) {
+	set_game_quiet(0);
+	show_ghost(-1, 0);
+}
+
+#ifdef BENCHMARK
+void benchmark_versus_rollback(uint8_t depth) {
+	ghost = confirmed;
+	enter_ghost(&ghost);
+	for(uint8_t i = 0; i < depth; i++) {
+		race_tick(MOVE_NONE);
+	}
+	leave_ghost(&ghost);
+}
+#endif
+
+// One tick of whichever frog's context is in the game - bring a dead or
+// finished frog back to the start, make the move and let the traffic
+// move. The same for both frogs on both boards.
+static void race_tick(uint8_t move) {
+	if(is_frog_dead() || frog_has_reached_riverbank()) {
+		put_frog_in_start_position();
+	}
+	if(!is_riverbank_full()) {
+		switch(move) {
+			case 4:
+				move_frog_to_left();
+				break;
+			case 3:
+				move_frog_forward();
+				break;
+			case 2:
+				move_frog_backward();
+				break;
+			case 1:
+				move_frog_to_right();
+				break;
+		}
+	}
+	update_traffic(VERSUS_TICK_MS);
+}
+
+// Send this board's move for the tick and play it
+static void play_tick(void) {
+	FrogContext now;
+	uint8_t move = (local_finish == NO_TICK) ? next_move : MOVE_NONE;
+
+	next_move = MOVE_NONE;
+	copy_frog_context(&now);
+	send_frame(local_tick, move, context_hash(&now));
+	race_tick(move);
+	if(local_finish == NO_TICK && is_riverbank_full()) {
+		local_finish = local_tick;
+	}
+	local_tick++;
+}
+
+// Play the confirmed ghost through the ticks whose moves have arrived,
+// checking it against the other board's hashes. If one of them is a move
+// the ghost was predicted not to make, the prediction is thrown away.
+static void confirm_ticks(void) {
+	uint32_t wrong_tick = NO_TICK;
+	uint8_t index;
+	FrogContext now;
+
+	if(confirmed_tick >= local_tick || confirmed_tick >= remote_tick) {
+		return;
+	}
+	enter_ghost(&confirmed);
+	while(confirmed_tick < local_tick && confirmed_tick < remote_tick) {
+		index = confirmed_tick & RING_MASK;
+		copy_frog_context(&now);
+		if(context_hash(&now) != remote_hash[index]) {
+			state = VERSUS_DESYNC;
+			break;
+		}
+		if(remote_move[index] != MOVE_NONE && confirmed_tick < ghost_tick &&
+				wrong_tick == NO_TICK) {
+			wrong_tick = confirmed_tick;
+		}
+		race_tick(remote_move[index]);
+		if(remote_finish == NO_TICK && is_riverbank_full()) {
+			remote_finish = confirmed_tick;
+		}
+		confirmed_tick++;
+	}
+	leave_ghost(&confirmed);
+
+	if(wrong_tick != NO_TICK) {
+		// Roll back (the ticks from wrong_tick are played again)
+		uint32_t depth = local_tick - wrong_tick;
+		stats.rollbacks++;
+		stats.resimulated += depth;
+		if(depth > stats.max_depth) {
+			stats.max_depth = depth;
+		}
+		rolled_back = 1;
+	}
+	if(wrong_tick != NO_TICK || ghost_tick < confirmed_tick) {
+		ghost = confirmed;
+		ghost_tick = confirmed_tick;
+	}
+}
+
+// Bring the predicted ghost up to the current tick, assuming it makes no
+// moves (the other board's moves for these ticks haven't arrived). After a
+// rollback this is the re-simulation, which is timed with TIMER1. A tick
+// takes far less than the 65ms TIMER1 takes to overflow, so checking for
+// an overflow after each one misses none.
+static void predict_ghost(void) {
+	uint8_t timed = rolled_back;
+	uint8_t overflows = 0;
+	uint16_t start_time;
+	uint16_t now;
+	uint32_t cycles;
+
+	rolled_back = 0;
+	if(ghost_tick >= local_tick) {
+		return;
+	}
+	TIFR1 = (1<<TOV1);
+	start_time = TCNT1;
+	enter_ghost(&ghost);
+	while(ghost_tick < local_tick) {
+		race_tick(MOVE_NONE);
+		ghost_tick++;
+		if(TIFR1 & (1<<TOV1)) {
+			TIFR1 = (1<<TOV1);
+			overflows++;
+		}
+	}
+	leave_ghost(&ghost);
+
+	if(timed) {
+		// An overflow flagged but not yet counted happened before TCNT1 was
+		// read if TCNT1 has only just started again
+		now = TCNT1;
+		if((TIFR1 & (1<<TOV1)) && now < 0x8000) {
+			overflows++;
+		}
+		cycles = (((uint32_t)overflows << 16) + now - start_time) * TIMER1_PRESCALE;
+		stats.rollback_cycles += cycles;
+		if(cycles > stats.max_rollback_cycles) {
+			stats.max_rollback_cycles = cycles;
+		}
+	}
+}
+
+// The first to fill their riverbank wins - which is known once the other
+// board's moves up to that tick have been played
+static void decide_winner(void) {
+	if(local_finish != NO_TICK &&
+			(remote_finish != NO_TICK || confirmed_tick > local_finish)) {
+		if(remote_finish == local_finish) {
+			state = VERSUS_DRAW;
+		} else if(remote_finish > local_finish) {
+			state = VERSUS_WON;
+		} else {
+			state = VERSUS_LOST;
+		}
+	} else if(remote_finish != NO_TICK && local_tick > remote_finish) {
+		state = VERSUS_LOST;
+	}
+}
+
+// Show the ghost where it is predicted to be (under this board's frog if
+// they are in the same place)
+static void draw_ghost(void) {
+	show_ghost(ghost.frog_row, ghost.frog_column);
+}
+
+// Swap a ghost into the game, off the display
+static void enter_ghost(FrogContext* context) {
+	swap_frog_context(context);
+	set_game_quiet(GAME_QUIET_SCORE | GAME_QUIET_DISPLAY);
+}
+
+// Swap this board's frog back into the game
+static void leave_ghost(FrogContext* context) {
+	swap_frog_context(context);
+	set_game_quiet(GAME_QUIET_SCORE);
+}
+
+static uint8_t context_hash(const FrogContext* context) {
+	uint8_t crc = 0;
+
+	crc = _crc8_ccitt_update(crc, context->frog_row);
+	crc = _crc8_ccitt_update(crc, context->frog_column);
+	crc = _crc8_ccitt_update(crc, context->frog_dead);
+	crc = _crc8_ccitt_update(crc, context->riverbank_status);
+	crc = _crc8_ccitt_update(crc, context->riverbank_status >> 8);
+	return crc;
+}
+
+static uint8_t frame_check(uint8_t tick, uint8_t move, uint8_t hash) {
+	uint8_t crc = 0;
+
+	crc = _crc8_ccitt_update(crc, tick);
+	crc = _crc8_ccitt_update(crc, move);
+	crc = _crc8_ccitt_update(crc, hash);
+	return crc & 0x1F;
+}
+
+static void send_frame(uint8_t tick, uint8_t move, uint8_t hash) {
+	uint32_t bits = tick | ((uint32_t)move << 8) | ((uint32_t)hash << 11) |
+			((uint32_t)frame_check(tick, move, hash) << 19);
+
+	fputc(FRAME_START | (bits & FRAME_DATA_MASK), stdout);
+	for(uint8_t i = 1; i < FRAME_SIZE; i++) {
+		bits >>= 6;
+		fputc(FRAME_MORE | (bits & FRAME_DATA_MASK), stdout);
+	}
+}
+
+// Read whatever has arrived on the serial port. Bytes that aren't part of
+// a frame (e.g. terminal output from the other board) are ignored.
+static void receive_frames(uint32_t now) {
+	uint8_t byte;
+
+	while(serial_input_available() && state <= VERSUS_RACING) {
+		byte = fgetc(stdin);
+		if((byte & FRAME_MARK_MASK) == FRAME_START) {
+			frame_bits = byte & FRAME_DATA_MASK;
+			frame_length = 1;
+		} else if((byte & FRAME_MARK_MASK) == FRAME_MORE && frame_length) {
+			frame_bits |= (uint32_t)(byte & FRAME_DATA_MASK) << (6 * frame_length);
+			if(++frame_length == FRAME_SIZE) {
+				frame_length = 0;
+				receive_frame(frame_bits, now);
+			}
+		}
+	}
+}
+
+static void receive_frame(uint32_t bits, uint32_t now) {
+	uint8_t tick = bits;
+	uint8_t move = (bits >> 8) & 0x07;
+	uint8_t hash = bits >> 11;
+	uint8_t index = remote_tick & RING_MASK;
+
+	if(frame_check(tick, move, hash) != ((bits >> 19) & 0x1F)) {
+		state = VERSUS_LINK_ERROR;
+		return;
+	}
+	last_heard_time = now;
+	if(state == VERSUS_WAITING) {
+		// The other board has started (or is waiting too, in which case
+		// it's told we've started)
+		if(move == MOVE_HELLO) {
+			send_frame(0, MOVE_HELLO, 0);
+		}
+		state = VERSUS_RACING;
+		next_tick_time = now;
+	}
+	if(move == MOVE_HELLO) {
+		// (Hellos sent before the other board heard ours)
+		return;
+	}
+	if(move > MOVE_LAST || tick != (uint8_t)remote_tick ||
+			remote_tick - confirmed_tick >= RING_SIZE) {
+		state = VERSUS_LINK_ERROR;
+		return;
+	}
+	remote_move[index] = move;
+	remote_hash[index] = hash;
+	remote_tick++;
+}
+
+#endif /* VERSUS_ENABLED */
@@ -0,0 +1,103 @@
+/*
+ * versus.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Head-to-head race between two boards joined by their serial ports (TX
+ * of each to RX of the other, or two simavr instances joined by a pty).
+ * Both frogs cross level 1 on the same field and the first to fill its
+ * riverbank wins. The other board's frog (the ghost) is shown in
+ * COLOUR_LIGHT_ORANGE.
+ *
+ * The race runs in ticks of VERSUS_TICK_MS. Each board plays its own frog
+ * as soon as a move is made and sends the move for each tick in a frame,
+ * so there is no added input latency locally. The ghost is played on this
+ * board by predicting that it doesn't move. When a frame arrives saying
+ * that it did, the ghost is rolled back to the last tick for which every
+ * move was known (the confirmed ghost) and re-simulated up to the current
+ * tick - with game.c itself, through swap_frog_context() with the display
+ * quiet. Each frame also carries a hash of the sender's frog at the start
+ * of the tick, checked when the tick is confirmed, so the boards notice if
+ * they disagree about what happened (a desync). A board that gets
+ * VERSUS_MAX_ROLLBACK ticks ahead of the frames it has received waits for
+ * the other.
+ *
+ * A frame is 4 bytes - 24 bits made of the tick number (8 bits, least
+ * significant first), the move (3 bits: 0 none, 1 to 4 a move numbered as
+ * the push buttons plus one, 7 hello), the hash (CRC-8 of the frog's row,
+ * column, death and riverbank, 8 bits) and a check (5 bits of the CRC-8 of
+ * the other fields). The first byte is 0xC0 plus 6 bits and the others
+ * 0x80 plus 6 bits, so frames can't be confused with terminal text or with
+ * each other.
+ *
+ * The winner is decided from the ticks at which the riverbanks were
+ * filled, once the other board's moves up to then are known, so both
+ * boards always agree on the result. Frogs have unlimited lives.
+ */
+
+#ifndef VERSUS_H_
+#define VERSUS_H_
+
+#include <stdint.h>
+
+#ifdef VERSUS_ENABLED
+
+// Length of a tick (ms)
+#define VERSUS_TICK_MS 10
+
+// Furthest a board runs ahead of the moves it knows (ticks)
+#define VERSUS_MAX_ROLLBACK 16
+
+// Time between hellos while waiting for the other board, and the time
+// after which it's given up for lost if nothing is heard (ms)
+#define VERSUS_HELLO_MS 100
+#define VERSUS_LINK_TIMEOUT 2000
+
+// States of the race (as returned by versus_run())
+#define VERSUS_WAITING		0	// for the other board to start
+#define VERSUS_RACING		1
+#define VERSUS_WON			2
+#define VERSUS_LOST			3
+#define VERSUS_DRAW			4
+#define VERSUS_LINK_LOST	5	// nothing heard for VERSUS_LINK_TIMEOUT
+#define VERSUS_LINK_ERROR	6	// a frame was corrupted or lost
+#define VERSUS_DESYNC		7	// the boards disagree about the ghost
+
+typedef struct {
+	uint32_t ticks;			// ticks played
+	uint16_t rollbacks;		// times the ghost was re-simulated
+	uint8_t max_depth;		// most ticks re-simulated by one rollback
+	uint32_t resimulated;	// ticks re-simulated in all
+	uint32_t rollback_cycles;		// CPU cycles spent re-simulating in all
+	uint32_t max_rollback_cycles;	// most CPU cycles taken by one rollback
+	uint16_t stalls;		// times this board waited for the other
+} VersusStats;
+
+// Set up the race on level 1 and start saying hello to the other board at
+// time now (ms). The level, score and countdown aren't put back
+// afterwards - the caller saves them if the game is to carry on.
+void versus_start(uint32_t now);
+
+// Make a move (numbered as the push buttons) at the next tick. Only the
+// first move made in a tick is used.
+void versus_move(int8_t move);
+
+// Read frames from the other board and play any ticks due by time now
+// (ms). Returns the state of the race (one of VERSUS_*).
+uint8_t versus_run(uint32_t now);
+
+void versus_get_stats(VersusStats* stats);
+
+// End the race and let the game draw and score normally again
+void versus_finish(void);
+
+#ifdef BENCHMARK
+// Roll the ghost back the given number of ticks and re-simulate them, as
+// when a frame shows a prediction was wrong, so it can be timed by
+// benchmark.c. The race must have been started.
+void benchmark_versus_rollback(uint8_t depth);
+#endif
+
+#endif /* VERSUS_ENABLED */
+
+#endif /* VERSUS_H_ */
@@ -0,0 +1,158 @@
+/*
+ * bench_compare.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Compares benchmark results (from simavr_bench) against the checked in
+ * baseline.csv and prints a table of the changes. A benchmark which has
+ * got slower by more than the tolerance (or has disappeared) is a
+ * regression and the exit status is 1. Faster results are reported so
+ * that the baseline can be updated (run_bench.sh -u).
+ *
+ * A result with no baseline to compare with is an error too, as is an
+ * empty baseline, so that nothing passes without being checked. With -n
+ * such results are only listed as new (for builds with extra flags, whose
+ * benchmarks the baseline doesn't have).
+ *
+ * Lines starting with # and the "function,cycles" header are ignored.
+ *
+ * Build: gcc -O2 -Wall -o bench_compare bench_compare.c
+ * Usage: bench_compare [-t tolerance_percent] [-n] baseline.csv results.csv
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_BENCHMARKS 64
+#define NAME_LENGTH 48
+#define DEFAULT_TOLERANCE 2.0	// percent
+
+typedef struct {
+	char name[NAME_LENGTH];
+	unsigned long cycles;
+} Result;
+
+typedef struct {
+	int count;
+	Result result[MAX_BENCHMARKS];
+} ResultSet;
+
+// Read a results file. Return 0 on success.
+static int read_results(const char* file_name, ResultSet* set) {
+	char line[128];
+	char* comma;
+	FILE* file = fopen(file_name, "r");
+
+	if(!file) {
+		perror(file_name);
+		return 1;
+	}
+	set->count = 0;
+	while(fgets(line, sizeof(line), file)) {
+		line[strcspn(line, "\r\n")] = 0;
+		comma = strchr(line, ',');
+		if(line[0] == '#' || !comma || strncmp(line, "function,", 9) == 0) {
+			continue;
+		}
+		if(set->count == MAX_BENCHMARKS || comma - line >= NAME_LENGTH) {
+			fprintf(stderr, "%s: too many benchmarks or name too long\n", file_name);
+			fclose(file);
+			return 1;
+		}
+		*comma = 0;
+		strcpy(set->result[set->count].name, line);
+		set->result[set->count].cycles = strtoul(comma + 1, NULL, 10);
+		set->count++;
+	}
+	fclose(file);
+	return 0;
+}
+
+static const Result* find_result(const ResultSet* set, const char* name) {
+	for(int i = 0; i < set->count; i++) {
+		if(strcmp(set->result[i].name, name) == 0) {
+			return &set->result[i];
+		}
+	}
+	return NULL;
+}
+
+int main(int argc, char** argv) {
+	static ResultSet baseline, results;
+	double tolerance = DEFAULT_TOLERANCE;
+	const Result* before;
+	double change;
+	int allow_new = 0;
+	int regressions = 0;
+	int unchecked = 0;
+	int i;
+
+	for(i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if(i + 1 < argc && strcmp(argv[i], "-t") == 0) {
+			tolerance = atof(argv[++i]);
+		} else if(strcmp(argv[i], "-n") == 0) {
+			allow_new = 1;
+		} else {
+			break;
+		}
+	}
+	if(argc - i != 2) {
+		fprintf(stderr, "usage: %s [-t tolerance_percent] [-n] baseline.csv results.csv\n",
+				argv[0]);
+		return 2;
+	}
+	if(read_results(argv[i], &baseline) || read_results(argv[i + 1], &results)) {
+		return 2;
+	}
+	if(!baseline.count) {
+		fprintf(stderr, "%s: no baseline results - create it with run_bench.sh -u\n", argv[i]);
+		return 1;
+	}
+	if(!results.count) {
+		fprintf(stderr, "%s: no results\n", argv[i + 1]);
+		return 1;
+	}
+
+	printf("%-28s %10s %10s %8s\n", "function", "baseline", "cycles", "change");
+	for(i = 0; i < results.count; i++) {
+		before = find_result(&baseline, results.result[i].name);
+		if(!before) {
+			printf("%-28s %10s %10lu %8s  %s\n", results.result[i].name, "-",
+					results.result[i].cycles, "-", allow_new ? "new" : "NO BASELINE");
+			if(!allow_new) {
+				unchecked++;
+			}
+			continue;
+		}
+		change = before->cycles ? 100.0 * ((double)results.result[i].cycles - before->cycles) /
+				before->cycles : 0.0;
+		printf("%-28s %10lu %10lu %+7.1f%%", results.result[i].name, before->cycles,
+				results.result[i].cycles, change);
+		if(change > tolerance || (!before->cycles && results.result[i].cycles)) {
+			printf("  REGRESSION\n");
+			regressions++;
+		} else if(change < -tolerance) {
+			printf("  faster\n");
+		} else {
+			printf("\n");
+		}
+	}
+	for(i = 0; i < baseline.count; i++) {
+		if(!find_result(&results, baseline.result[i].name)) {
+			printf("%-28s %10lu %10s %8s  MISSING\n", baseline.result[i].name,
+					baseline.result[i].cycles, "-", "-");
+			regressions++;
+		}
+	}
+
+	if(regressions) {
+		printf("%d regression%s (tolerance %.1f%%)\n", regressions, regressions == 1 ? "" : "s",
+				tolerance);
+	}
+	if(unchecked) {
+		printf("%d result%s not in the baseline (update it with run_bench.sh -u)\n", unchecked,
+				unchecked == 1 ? "" : "s");
+	}
+	return (regressions || unchecked) ? 1 : 0;
+}
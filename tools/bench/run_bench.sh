@@ -0,0 +1,67 @@
+#!/bin/sh
+#
+# run_bench.sh
+#
+# Written by Wu Lai Yin (Peter)
+#
+# Builds the benchmark firmware (the normal Debug build flags plus
+# -DBENCHMARK), runs it under simavr and compares the cycle counts with
+# baseline.csv. Exits with status 1 if anything has got slower by more
+# than the tolerance.
+#
+# Needs avr-gcc (avr-libc) and simavr (libsimavr and its headers).
+#
+# Usage: run_bench.sh [-t tolerance_percent] [-u] [-D flag ...]
+#     -u  replace baseline.csv with the new results instead of comparing
+#     -D  build with the given flag defined too (e.g. -D VERSUS_ENABLED) -
+#         results only in such builds are listed as new rather than failing
+
+set -e
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+SRC_DIR="$BENCH_DIR/../../CSSE2010-s4411500"
+BUILD_DIR="$BENCH_DIR/build"
+TOLERANCE=2
+UPDATE=0
+DEFINES=
+ALLOW_NEW=
+
+while [ $# -gt 0 ]; do
+	case "$1" in
+		-t) TOLERANCE="$2"; shift 2 ;;
+		-u) UPDATE=1; shift ;;
+		-D) DEFINES="$DEFINES -D$2"; ALLOW_NEW=-n; shift 2 ;;
+		*) echo "usage: $0 [-t tolerance_percent] [-u] [-D flag ...]" >&2; exit 2 ;;
+	esac
+done
+
+mkdir -p "$BUILD_DIR"
+
+# Same flags as Debug/Makefile
+avr-gcc -funsigned-char -funsigned-bitfields -O1 -ffunction-sections \
+	-fdata-sections -fpack-struct -fshort-enums -Wall -std=gnu99 \
+	-mmcu=atmega324a -DBENCHMARK $DEFINES -Wl,--gc-sections \
+	-o "$BUILD_DIR/bench.elf" "$SRC_DIR"/*.c -lm
+
+gcc -O2 -Wall -o "$BUILD_DIR/simavr_bench" "$BENCH_DIR/simavr_bench.c" -lsimavr -lelf
+gcc -O2 -Wall -o "$BUILD_DIR/bench_compare" "$BENCH_DIR/bench_compare.c"
+
+"$BUILD_DIR/simavr_bench" -o "$BUILD_DIR/results.csv" "$BUILD_DIR/bench.elf"
+
+if [ $UPDATE -eq 1 ]; then
+	# A run that timed nothing mustn't become the baseline
+	if ! grep -q -v '^#\|^function,' "$BUILD_DIR/results.csv"; then
+		echo "no results - baseline.csv left as it was" >&2
+		exit 1
+	fi
+	{
+		echo "# Cycle counts for the benchmark build (see run_bench.sh)."
+		echo "# Made by run_bench.sh -u with $(avr-gcc --version | head -n 1)"
+		echo "# Regenerate with: tools/bench/run_bench.sh -u"
+		cat "$BUILD_DIR/results.csv"
+	} > "$BENCH_DIR/baseline.csv"
+	echo "baseline.csv updated"
+else
+	"$BUILD_DIR/bench_compare" -t "$TOLERANCE" $ALLOW_NEW "$BENCH_DIR/baseline.csv" \
+		"$BUILD_DIR/results.csv"
+fi
@@ -0,0 +1,53 @@
+#!/bin/sh
+#
+# run_stack.sh
+#
+# Written by Wu Lai Yin (Peter)
+#
+# Builds the firmware with the normal Debug build flags, plays it under
+# simavr with the autopilot (see simavr_stack.c) and checks how close the
+# stack came to the static data. Exits with status 1 if less than the
+# threshold was never used. What avr-size makes of the build (flash, and
+# RAM as .data + .bss + .noinit out of the 2KB) and the per-module static
+# RAM from the build's map file (see ../ram_report.c) are printed first.
+#
+# Needs avr-gcc (avr-libc) and simavr (libsimavr and its headers).
+#
+# Usage: run_stack.sh [-s seconds] [-m min_stack_bytes] [-D flag ...]
+#     -s  simulated seconds of play (default 120)
+#     -m  fewest bytes the stack may leave unused (default 64)
+#     -D  build with the given flag defined too (e.g. -D LOG_ENABLED)
+
+set -e
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+SRC_DIR="$BENCH_DIR/../../CSSE2010-s4411500"
+BUILD_DIR="$BENCH_DIR/build"
+SECONDS_OF_PLAY=120
+MIN_STACK=64
+DEFINES=
+
+while [ $# -gt 0 ]; do
+	case "$1" in
+		-s) SECONDS_OF_PLAY="$2"; shift 2 ;;
+		-m) MIN_STACK="$2"; shift 2 ;;
+		-D) DEFINES="$DEFINES -D$2"; shift 2 ;;
+		*) echo "usage: $0 [-s seconds] [-m min_stack_bytes] [-D flag ...]" >&2; exit 2 ;;
+	esac
+done
+
+mkdir -p "$BUILD_DIR"
+
+# Same flags as Debug/Makefile
+avr-gcc -funsigned-char -funsigned-bitfields -O1 -ffunction-sections \
+	-fdata-sections -fpack-struct -fshort-enums -Wall -std=gnu99 \
+	-mmcu=atmega324a $DEFINES -Wl,--gc-sections \
+	-Wl,-Map="$BUILD_DIR/stack.map" \
+	-o "$BUILD_DIR/stack.elf" "$SRC_DIR"/*.c -lm
+
+gcc -O2 -Wall -o "$BUILD_DIR/simavr_stack" "$BENCH_DIR/simavr_stack.c" -lsimavr -lelf
+gcc -O2 -Wall -o "$BUILD_DIR/ram_report" "$BENCH_DIR/../ram_report.c"
+
+avr-size -C --mcu=atmega324a "$BUILD_DIR/stack.elf"
+"$BUILD_DIR/ram_report" "$BUILD_DIR/stack.map"
+"$BUILD_DIR/simavr_stack" -s "$SECONDS_OF_PLAY" -m "$MIN_STACK" "$BUILD_DIR/stack.elf"
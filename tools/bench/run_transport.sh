@@ -0,0 +1,79 @@
+#!/bin/sh
+#
+# run_transport.sh
+#
+# Written by Wu Lai Yin (Peter)
+#
+# Compares the two ways of sending to the LED matrix (see spi.h): builds
+# the benchmark firmware once for the SPI port and once with SPI_USART1,
+# at the same clock divider, runs both under simavr and prints the cycle
+# counts side by side (the SPI port build in the baseline column).
+#
+# frame_sent is the time for a whole frame to go out, so it shows the
+# throughput - it is also printed for each as the time per frame and the
+# bytes per second at 8MHz. The other drawing benchmarks (palette_swap,
+# redraw_whole_display, ...) are the time the CPU is held up, which with
+# SPI_USART1 leaves out whatever is still queued.
+#
+# Needs avr-gcc (avr-libc) and simavr (libsimavr and its headers).
+#
+# Usage: run_transport.sh [-d divider] [-D flag ...]
+#     -d  SPI clock divider for both builds (2 to 128, default 128)
+#     -D  build both with the given flag defined too
+
+set -e
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+SRC_DIR="$BENCH_DIR/../../CSSE2010-s4411500"
+BUILD_DIR="$BENCH_DIR/build"
+# A whole frame is CMD_UPDATE_ALL and a byte a pixel (see
+# ledmatrix_update_all_packed())
+FRAME_BYTES=129
+DIVIDER=128
+DEFINES=
+
+while [ $# -gt 0 ]; do
+	case "$1" in
+		-d) DIVIDER="$2"; shift 2 ;;
+		-D) DEFINES="$DEFINES -D$2"; shift 2 ;;
+		*) echo "usage: $0 [-d divider] [-D flag ...]" >&2; exit 2 ;;
+	esac
+done
+
+mkdir -p "$BUILD_DIR"
+
+gcc -O2 -Wall -o "$BUILD_DIR/simavr_bench" "$BENCH_DIR/simavr_bench.c" -lsimavr -lelf
+gcc -O2 -Wall -o "$BUILD_DIR/bench_compare" "$BENCH_DIR/bench_compare.c"
+
+# Same flags as run_bench.sh
+for TRANSPORT in spi0 usart1; do
+	if [ $TRANSPORT = usart1 ]; then
+		FLAGS="$DEFINES -DSPI_USART1"
+	else
+		FLAGS="$DEFINES"
+	fi
+	avr-gcc -funsigned-char -funsigned-bitfields -O1 -ffunction-sections \
+		-fdata-sections -fpack-struct -fshort-enums -Wall -std=gnu99 \
+		-mmcu=atmega324a -DBENCHMARK -DSPI_CLOCK_DIVIDER=$DIVIDER $FLAGS \
+		-Wl,--gc-sections -o "$BUILD_DIR/bench_$TRANSPORT.elf" "$SRC_DIR"/*.c -lm
+	"$BUILD_DIR/simavr_bench" -o "$BUILD_DIR/results_$TRANSPORT.csv" \
+		"$BUILD_DIR/bench_$TRANSPORT.elf"
+done
+
+echo "SPI port (baseline) against USART1 in Master SPI mode, clock / $DIVIDER"
+# (Differences either way are expected - only the table is wanted)
+"$BUILD_DIR/bench_compare" -t 1000 -n "$BUILD_DIR/results_spi0.csv" \
+	"$BUILD_DIR/results_usart1.csv" || true
+
+echo
+echo "Whole frame ($FRAME_BYTES bytes):"
+for TRANSPORT in spi0 usart1; do
+	awk -F, -v transport=$TRANSPORT -v bytes=$FRAME_BYTES '
+		$1 == "frame_sent" && $2 > 0 {
+			printf "%-6s %8d cycles  %6.2f ms a frame  %6.0f bytes/s\n", transport, $2,
+				$2 / 8000, bytes * 8000000 / $2
+			found = 1
+		}
+		END { if(!found) printf "%-6s no frame_sent result\n", transport }
+	' "$BUILD_DIR/results_$TRANSPORT.csv"
+done
@@ -0,0 +1,156 @@
+/*
+ * simavr_bench.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Runs a benchmark build of the firmware (built with -DBENCHMARK, see
+ * benchmark.h) on a simulated ATmega324A at 8MHz and writes the results
+ * as CSV:
+ *
+ *     function,cycles
+ *     redraw_whole_display,147000
+ *     ...
+ *
+ * The firmware prints "bench,<name>,<cycles>" lines to USART0 between
+ * "# benchmark begin" and "# benchmark end". The simulation is cycle
+ * accurate so the same firmware always gives the same numbers.
+ *
+ * Build: gcc -O2 -Wall -o simavr_bench simavr_bench.c -lsimavr -lelf
+ * Usage: simavr_bench [-o results.csv] [-c max_cycles] firmware.elf
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_irq.h>
+#include <simavr/avr_uart.h>
+
+#define MCU "atmega324a"
+#define FREQUENCY 8000000
+#define DEFAULT_MAX_CYCLES 400000000ULL	// 50 seconds of simulated time
+#define LINE_LENGTH 128
+
+typedef struct {
+	FILE* out;
+	char line[LINE_LENGTH];
+	int length;
+	int started;
+	int finished;
+	int results;
+} Capture;
+
+static void handle_line(Capture* capture) {
+	const char* name;
+	char* comma;
+
+	capture->line[capture->length] = 0;
+	if(strcmp(capture->line, "# benchmark begin") == 0) {
+		capture->started = 1;
+		fprintf(capture->out, "function,cycles\n");
+	} else if(strcmp(capture->line, "# benchmark end") == 0) {
+		capture->finished = capture->started;
+	} else if(capture->started && strncmp(capture->line, "bench,", 6) == 0) {
+		name = capture->line + 6;
+		comma = strchr(name, ',');
+		if(comma) {
+			*comma = 0;
+			fprintf(capture->out, "%s,%lu\n", name, strtoul(comma + 1, NULL, 10));
+			capture->results++;
+		}
+	}
+	capture->length = 0;
+}
+
+// Called by simavr for every byte written to the USART0 data register
+static void uart_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+	Capture* capture = param;
+	char c = value;
+
+	(void)irq;
+	if(c == '\r') {
+		return;
+	} else if(c == '\n') {
+		handle_line(capture);
+	} else if(capture->length < LINE_LENGTH - 1) {
+		capture->line[capture->length++] = c;
+	}
+}
+
+int main(int argc, char** argv) {
+	const char* output_name = NULL;
+	const char* firmware_name = NULL;
+	unsigned long long max_cycles = DEFAULT_MAX_CYCLES;
+	elf_firmware_t firmware;
+	Capture capture;
+	avr_t* avr;
+	uint32_t flags;
+	int state;
+
+	for(int i = 1; i < argc; i++) {
+		if(i + 1 < argc && strcmp(argv[i], "-o") == 0) {
+			output_name = argv[++i];
+		} else if(i + 1 < argc && strcmp(argv[i], "-c") == 0) {
+			max_cycles = strtoull(argv[++i], NULL, 0);
+		} else if(argv[i][0] != '-' && !firmware_name) {
+			firmware_name = argv[i];
+		} else {
+			firmware_name = NULL;
+			break;
+		}
+	}
+	if(!firmware_name) {
+		fprintf(stderr, "usage: %s [-o results.csv] [-c max_cycles] firmware.elf\n", argv[0]);
+		return 2;
+	}
+
+	memset(&firmware, 0, sizeof(firmware));
+	if(elf_read_firmware(firmware_name, &firmware) != 0) {
+		fprintf(stderr, "%s: can't read firmware\n", firmware_name);
+		return 2;
+	}
+	avr = avr_make_mcu_by_name(MCU);
+	if(!avr) {
+		fprintf(stderr, "simavr doesn't support the " MCU "\n");
+		return 2;
+	}
+	avr_init(avr);
+	firmware.frequency = FREQUENCY;
+	avr_load_firmware(avr, &firmware);
+
+	memset(&capture, 0, sizeof(capture));
+	capture.out = stdout;
+	if(output_name) {
+		capture.out = fopen(output_name, "w");
+		if(!capture.out) {
+			perror(output_name);
+			return 2;
+		}
+	}
+
+	// Take the UART output ourselves rather than have simavr print it
+	avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+	flags &= ~AVR_UART_FLAG_STDIO;
+	avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT),
+			uart_output, &capture);
+
+	do {
+		state = avr_run(avr);
+	} while(state != cpu_Done && state != cpu_Crashed && !capture.finished &&
+			avr->cycle < max_cycles);
+
+	if(output_name) {
+		fclose(capture.out);
+	}
+	if(!capture.finished) {
+		fprintf(stderr, "%s: benchmarks didn't finish (%s after %llu cycles)\n", firmware_name,
+				state == cpu_Crashed ? "crashed" : "stopped",
+				(unsigned long long)avr->cycle);
+		return 1;
+	}
+	fprintf(stderr, "%d benchmarks\n", capture.results);
+	return 0;
+}
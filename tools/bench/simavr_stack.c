@@ -0,0 +1,182 @@
+/*
+ * simavr_stack.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Plays a normal build of the firmware on a simulated ATmega324A at 8MHz
+ * and checks the stack high-water mark (see ramstats.h). Button B0 is
+ * pushed to leave the splash screen and 'a' turns the autopilot on, which
+ * plays game after game by itself. After the given time 'm' is sent and
+ * the worst case free stack is read from what print_ram_usage() prints:
+ *
+ *     Stack free: 873 min: 402
+ *
+ * Exits with status 1 if the margin is below the threshold, or if the
+ * firmware crashed or never answered.
+ *
+ * Build: gcc -O2 -Wall -o simavr_stack simavr_stack.c -lsimavr -lelf
+ * Usage: simavr_stack [-s seconds] [-m min_stack_bytes] firmware.elf
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_irq.h>
+#include <simavr/avr_uart.h>
+#include <simavr/avr_ioport.h>
+
+#define MCU "atmega324a"
+#define FREQUENCY 8000000
+#define MS (FREQUENCY / 1000)
+#define DEFAULT_SECONDS 120
+#define DEFAULT_MIN_STACK 64
+#define LINE_LENGTH 128
+
+// When the inputs are given (cycles from reset). The button is held for
+// BUTTON_HOLD so the pin change interrupt sees the push and the release.
+#define BUTTON_TIME (500UL * MS)
+#define BUTTON_HOLD (50UL * MS)
+#define AUTOPILOT_TIME (1500UL * MS)
+// 'm' is only read while a game is being played, so it is sent again at
+// this interval until the figures come back
+#define REPORT_INTERVAL (500UL * MS)
+#define REPORT_TRIES 20
+
+#define MARGIN_LABEL "min:"
+
+typedef struct {
+	char line[LINE_LENGTH];
+	int length;
+	long margin;	// -1 until read
+} Capture;
+
+// Called by simavr for every byte written to the USART0 data register.
+// The terminal output is mostly cursor movement, so rather than split it
+// into lines just look for the label the margin follows.
+static void uart_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+	Capture* capture = param;
+	char* label;
+	char* end;
+	long margin;
+
+	(void)irq;
+	if(capture->length == LINE_LENGTH - 1) {
+		memmove(capture->line, capture->line + LINE_LENGTH / 2, LINE_LENGTH / 2 - 1);
+		capture->length = LINE_LENGTH / 2 - 1;
+	}
+	capture->line[capture->length++] = value;
+	capture->line[capture->length] = 0;
+
+	// The number is complete once something other than a digit follows it
+	label = strstr(capture->line, MARGIN_LABEL);
+	if(label && (value < '0' || value > '9') && value != ' ') {
+		margin = strtol(label + strlen(MARGIN_LABEL), &end, 10);
+		if(end != label + strlen(MARGIN_LABEL)) {
+			capture->margin = margin;
+		}
+		capture->length = 0;
+	}
+}
+
+static void send_char(avr_t* avr, char c) {
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT), c);
+}
+
+static void set_button(avr_t* avr, int pushed) {
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 0), pushed);
+}
+
+int main(int argc, char** argv) {
+	const char* firmware_name = NULL;
+	unsigned long seconds = DEFAULT_SECONDS;
+	long min_stack = DEFAULT_MIN_STACK;
+	unsigned long long report_time;
+	elf_firmware_t firmware;
+	Capture capture;
+	avr_t* avr;
+	uint32_t flags;
+	int state;
+	int step = 0;
+	int tries = 0;
+
+	for(int i = 1; i < argc; i++) {
+		if(i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+			seconds = strtoul(argv[++i], NULL, 0);
+		} else if(i + 1 < argc && strcmp(argv[i], "-m") == 0) {
+			min_stack = strtol(argv[++i], NULL, 0);
+		} else if(argv[i][0] != '-' && !firmware_name) {
+			firmware_name = argv[i];
+		} else {
+			firmware_name = NULL;
+			break;
+		}
+	}
+	if(!firmware_name) {
+		fprintf(stderr, "usage: %s [-s seconds] [-m min_stack_bytes] firmware.elf\n", argv[0]);
+		return 2;
+	}
+
+	memset(&firmware, 0, sizeof(firmware));
+	if(elf_read_firmware(firmware_name, &firmware) != 0) {
+		fprintf(stderr, "%s: can't read firmware\n", firmware_name);
+		return 2;
+	}
+	avr = avr_make_mcu_by_name(MCU);
+	if(!avr) {
+		fprintf(stderr, "simavr doesn't support the " MCU "\n");
+		return 2;
+	}
+	avr_init(avr);
+	firmware.frequency = FREQUENCY;
+	avr_load_firmware(avr, &firmware);
+
+	memset(&capture, 0, sizeof(capture));
+	capture.margin = -1;
+
+	// Take the UART output ourselves rather than have simavr print it
+	avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+	flags &= ~AVR_UART_FLAG_STDIO;
+	avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT),
+			uart_output, &capture);
+
+	report_time = AUTOPILOT_TIME + seconds * 1000ULL * MS;
+	do {
+		state = avr_run(avr);
+		// The inputs, in order
+		if(step == 0 && avr->cycle >= BUTTON_TIME) {
+			set_button(avr, 1);
+			step++;
+		} else if(step == 1 && avr->cycle >= BUTTON_TIME + BUTTON_HOLD) {
+			set_button(avr, 0);
+			step++;
+		} else if(step == 2 && avr->cycle >= AUTOPILOT_TIME) {
+			send_char(avr, 'a');
+			step++;
+		} else if(step == 3 && avr->cycle >= report_time) {
+			if(tries++ == REPORT_TRIES) {
+				break;
+			}
+			send_char(avr, 'm');
+			report_time += REPORT_INTERVAL;
+		}
+	} while(state != cpu_Done && state != cpu_Crashed && capture.margin < 0);
+
+	if(capture.margin < 0) {
+		fprintf(stderr, "%s: no stack figures (%s after %llu cycles)\n", firmware_name,
+				state == cpu_Crashed ? "crashed" : "stopped",
+				(unsigned long long)avr->cycle);
+		return 1;
+	}
+	printf("stack never used: %ld bytes after %lu s of play (threshold %ld)\n",
+			capture.margin, seconds, min_stack);
+	if(capture.margin < min_stack) {
+		printf("FAIL - the stack has come within %ld bytes of the static data\n",
+				capture.margin);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * scroll_host.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Scrolls the game's messages through the real scrolling_char_display.c,
+ * compositor.c and ledmatrix.c on the host and counts the bytes sent to
+ * the LED matrix, on a blank matrix and over the start of level 1, at
+ * each scroll speed (see scrolling_char_display.h):
+ *
+ *     message,over,speed,steps,spi_bytes,bytes_per_step,spi_cycles_per_step
+ *
+ * At the matrix's clock (the system clock / 128) each byte keeps
+ * spi_send_byte() waiting 1024 cycles, which is most of the time a step
+ * takes, so spi_cycles_per_step (the bytes times 1024) is the frame time
+ * less the time spent working out what to send (the scroll_display
+ * benchmark, see ../bench/run_bench.sh). With -c the bytes are also
+ * captured for spidecode.
+ *
+ * Build: gcc -O2 -Wall -DHOST_LEDMATRIX -I../host -I../../CSSE2010-s4411500 \
+ *            -o scroll_host scroll_host.c ../host/host_stubs.c ../host/spi_host.c \
+ *            ../../CSSE2010-s4411500/scrolling_char_display.c \
+ *            ../../CSSE2010-s4411500/ledmatrix.c ../../CSSE2010-s4411500/game.c \
+ *            ../../CSSE2010-s4411500/level.c ../../CSSE2010-s4411500/level_data.c \
+ *            ../../CSSE2010-s4411500/score.c ../../CSSE2010-s4411500/live.c \
+ *            ../../CSSE2010-s4411500/motion.c ../../CSSE2010-s4411500/fieldsim.c \
+ *            ../../CSSE2010-s4411500/lanegen.c ../../CSSE2010-s4411500/statebus.c \
+ *            ../../CSSE2010-s4411500/framebuffer.c ../../CSSE2010-s4411500/compositor.c
+ * Usage: scroll_host [-c capture.spi]
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "scrolling_char_display.h"
+#include "compositor.h"
+#include "ledmatrix.h"
+#include "game.h"
+#include "level.h"
+#include "spi_host.h"
+
+static char* const messages[] = {"FROGGER 44115001", "LEVEL 10", "GAME OVER"};
+#define NUM_MESSAGES (sizeof(messages) / sizeof(messages[0]))
+
+// Cycles spi_send_byte() waits for a byte (8 bits at clock / 128)
+#define SPI_BYTE_CYCLES 1024
+
+// Draw what is under the message - nothing, or the start of level 1
+static void set_up(int over_game) {
+	compositor_clear();
+	if(over_game) {
+		init_level();
+		add_level();
+		initialise_game();
+	}
+	compositor_update();
+}
+
+int main(int argc, char** argv) {
+	FILE* capture = NULL;
+	uint32_t bytes;
+	uint32_t steps;
+
+	if(argc == 3 && strcmp(argv[1], "-c") == 0) {
+		capture = fopen(argv[2], "wb");
+		if(!capture) {
+			perror(argv[2]);
+			return 2;
+		}
+		spi_host_capture(capture);
+	} else if(argc != 1) {
+		fprintf(stderr, "usage: %s [-c capture.spi]\n", argv[0]);
+		return 2;
+	}
+
+	ledmatrix_setup();
+	printf("message,over,speed,steps,spi_bytes,bytes_per_step,spi_cycles_per_step\n");
+	for(int over_game = 0; over_game <= 1; over_game++) {
+		for(uint8_t speed = 1; speed <= SCROLL_MAX_SPEED; speed++) {
+			for(unsigned i = 0; i < NUM_MESSAGES; i++) {
+				set_up(over_game);
+				set_scrolling_display_speed(speed);
+				set_scrolling_display_text(messages[i], COLOUR_GREEN);
+				bytes = spi_host_bytes();
+				steps = 0;
+				do {
+					steps++;
+				} while(scroll_display());
+				bytes = spi_host_bytes() - bytes;
+				printf("%s,%s,%u,%u,%u,%.1f,%.0f\n", messages[i], over_game ? "game" : "blank",
+						speed, steps, bytes, (double)bytes / steps,
+						(double)bytes * SPI_BYTE_CYCLES / steps);
+			}
+		}
+	}
+
+	if(capture) {
+		fclose(capture);
+	}
+	return 0;
+}
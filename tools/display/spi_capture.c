@@ -0,0 +1,147 @@
+/*
+ * spi_capture.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Runs the firmware on a simulated ATmega324A at 8MHz (simavr) and
+ * records every byte it sends to the LED matrix over SPI in a capture
+ * file (see spicap.h) for spidecode. Push buttons can be pressed at
+ * given times, e.g. to get past the splash screen.
+ *
+ * Build: gcc -O2 -Wall -o spi_capture spi_capture.c -lsimavr -lelf
+ * Usage: spi_capture [-t seconds] [-b ms:button ...] [-u] -o capture.spi firmware.elf
+ *     -b  press push button B0 to B3 at the given time (held for 50ms)
+ *     -u  record the bytes sent by USART1 (firmware built with SPI_USART1,
+ *         see spi.h) instead of the SPI port
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_irq.h>
+#include <simavr/avr_spi.h>
+#include <simavr/avr_uart.h>
+#include <simavr/avr_ioport.h>
+
+#include "spicap.h"
+
+#define MCU "atmega324a"
+#define FREQUENCY 8000000
+#define CYCLES_PER_US (FREQUENCY / 1000000)
+#define DEFAULT_SECONDS 10
+#define MAX_PRESSES 64
+#define PRESS_MS 50
+
+typedef struct {
+	unsigned long at_ms;
+	int button;
+	int state;		// 0 not yet pushed, 1 held down, 2 released
+} Press;
+
+static FILE* capture;
+static avr_t* avr;
+
+// Called by simavr for every byte written to the SPI data register (or
+// sent by USART1)
+static void spi_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+	(void)irq;
+	(void)param;
+	spicap_write(capture, avr->cycle / CYCLES_PER_US, value);
+}
+
+int main(int argc, char** argv) {
+	const char* capture_name = NULL;
+	const char* firmware_name = NULL;
+	double seconds = DEFAULT_SECONDS;
+	Press presses[MAX_PRESSES];
+	int num_presses = 0;
+	int usart1 = 0;
+	elf_firmware_t firmware;
+	avr_irq_t* button_irq[4];
+	avr_cycle_count_t end_cycle;
+	int state;
+
+	for(int i = 1; i < argc; i++) {
+		if(i + 1 < argc && strcmp(argv[i], "-o") == 0) {
+			capture_name = argv[++i];
+		} else if(i + 1 < argc && strcmp(argv[i], "-t") == 0) {
+			seconds = atof(argv[++i]);
+		} else if(i + 1 < argc && strcmp(argv[i], "-b") == 0 && num_presses < MAX_PRESSES &&
+				sscanf(argv[i + 1], "%lu:%d", &presses[num_presses].at_ms,
+				&presses[num_presses].button) == 2 && presses[num_presses].button >= 0 &&
+				presses[num_presses].button <= 3) {
+			presses[num_presses++].state = 0;
+			i++;
+		} else if(strcmp(argv[i], "-u") == 0) {
+			usart1 = 1;
+		} else if(argv[i][0] != '-' && !firmware_name) {
+			firmware_name = argv[i];
+		} else {
+			firmware_name = NULL;
+			break;
+		}
+	}
+	if(!firmware_name || !capture_name) {
+		fprintf(stderr, "usage: %s [-t seconds] [-b ms:button ...] [-u] -o capture.spi firmware.elf\n",
+				argv[0]);
+		return 2;
+	}
+
+	memset(&firmware, 0, sizeof(firmware));
+	if(elf_read_firmware(firmware_name, &firmware) != 0) {
+		fprintf(stderr, "%s: can't read firmware\n", firmware_name);
+		return 2;
+	}
+	avr = avr_make_mcu_by_name(MCU);
+	if(!avr) {
+		fprintf(stderr, "simavr doesn't support the " MCU "\n");
+		return 2;
+	}
+	avr_init(avr);
+	firmware.frequency = FREQUENCY;
+	avr_load_firmware(avr, &firmware);
+
+	capture = fopen(capture_name, "wb");
+	if(!capture) {
+		perror(capture_name);
+		return 2;
+	}
+	if(usart1) {
+		avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('1'), UART_IRQ_OUTPUT),
+				spi_output, NULL);
+	} else {
+		avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ('0'), SPI_IRQ_OUTPUT),
+				spi_output, NULL);
+	}
+	for(int button = 0; button < 4; button++) {
+		button_irq[button] = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), button);
+	}
+
+	end_cycle = seconds * FREQUENCY;
+	do {
+		// Buttons are high while pushed
+		for(int i = 0; i < num_presses; i++) {
+			avr_cycle_count_t down = (avr_cycle_count_t)presses[i].at_ms * (FREQUENCY / 1000);
+			if(presses[i].state == 0 && avr->cycle >= down) {
+				avr_raise_irq(button_irq[presses[i].button], 1);
+				presses[i].state = 1;
+			} else if(presses[i].state == 1 &&
+					avr->cycle >= down + PRESS_MS * (FREQUENCY / 1000)) {
+				avr_raise_irq(button_irq[presses[i].button], 0);
+				presses[i].state = 2;
+			}
+		}
+		state = avr_run(avr);
+	} while(state != cpu_Done && state != cpu_Crashed && avr->cycle < end_cycle);
+
+	fclose(capture);
+	if(state == cpu_Crashed) {
+		fprintf(stderr, "%s: crashed after %llu cycles\n", firmware_name,
+				(unsigned long long)avr->cycle);
+		return 1;
+	}
+	return 0;
+}
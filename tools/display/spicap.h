@@ -0,0 +1,41 @@
+/*
+ * spicap.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Format of the SPI capture files used by the display tools. A capture
+ * is a sequence of 5 byte records, one per byte sent to the LED matrix:
+ * a 32 bit little-endian timestamp in microseconds followed by the byte.
+ * Captures are written by spi_capture (firmware running under simavr)
+ * and host/spi_host.c (host builds linked with the real ledmatrix.c),
+ * and read by spidecode.
+ */
+
+#ifndef SPICAP_H_
+#define SPICAP_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define SPICAP_RECORD_SIZE 5
+
+static inline int spicap_write(FILE* file, uint32_t time_us, uint8_t byte) {
+	uint8_t record[SPICAP_RECORD_SIZE] = {
+		time_us, time_us >> 8, time_us >> 16, time_us >> 24, byte
+	};
+	return fwrite(record, SPICAP_RECORD_SIZE, 1, file) == 1 ? 0 : -1;
+}
+
+// Return 0 if a record was read, -1 at the end of the file
+static inline int spicap_read(FILE* file, uint32_t* time_us, uint8_t* byte) {
+	uint8_t record[SPICAP_RECORD_SIZE];
+	if(fread(record, SPICAP_RECORD_SIZE, 1, file) != 1) {
+		return -1;
+	}
+	*time_us = record[0] | (uint32_t)record[1] << 8 | (uint32_t)record[2] << 16 |
+			(uint32_t)record[3] << 24;
+	*byte = record[4];
+	return 0;
+}
+
+#endif /* SPICAP_H_ */
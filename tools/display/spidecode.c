@@ -0,0 +1,395 @@
+/*
+ * spidecode.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Decodes an SPI capture (see spicap.h) of the LED matrix command set
+ * used by ledmatrix.c, rebuilding what the display shows. The capture is
+ * split into frames wherever the SPI bus has been idle for longer than
+ * the frame gap (a burst of updates from one pass of the game loop).
+ * For each frame it writes a line of statistics:
+ *
+ *     frame,time_us,bytes,update_all,pixel,row,col,shift,clear,unknown,
+ *         pixel_writes,redundant_writes,redundant_commands,changed_pixels
+ *
+ * where a redundant write sets a pixel to the colour it already had, a
+ * redundant command changes nothing at all and changed_pixels counts
+ * the pixels which differ from the end of the previous frame. It can
+ * also write each frame as a PPM image, which can be compared with a
+ * baseline set of images after a change to the drawing code.
+ *
+ * The display's own firmware isn't available, so shifts are assumed to
+ * fill the new row or column with black.
+ *
+ * Build: gcc -O2 -Wall -o spidecode spidecode.c
+ * Usage: spidecode [-g gap_us] [-s stats.csv] [-o ppm_dir] [-z scale] [-c]
+ *                  capture.spi
+ *     -c  only write images of frames which changed the display
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "spicap.h"
+
+// Display size and commands, as ledmatrix.h and ledmatrix.c
+#define MATRIX_NUM_COLUMNS 16
+#define MATRIX_NUM_ROWS 8
+
+#define CMD_UPDATE_ALL 0x00
+#define CMD_UPDATE_PIXEL 0x01
+#define CMD_UPDATE_ROW 0x02
+#define CMD_UPDATE_COL 0x03
+#define CMD_SHIFT_DISPLAY 0x04
+#define CMD_CLEAR_SCREEN 0x0F
+
+#define SHIFT_RIGHT 0x01
+#define SHIFT_LEFT 0x02
+#define SHIFT_DOWN 0x04
+#define SHIFT_UP 0x08
+
+#define DEFAULT_GAP_US 2000
+#define DEFAULT_SCALE 8
+#define MAX_ARGUMENTS (MATRIX_NUM_COLUMNS * MATRIX_NUM_ROWS)
+
+enum { TYPE_ALL, TYPE_PIXEL, TYPE_ROW, TYPE_COL, TYPE_SHIFT, TYPE_CLEAR, TYPE_UNKNOWN,
+	NUM_TYPES };
+static const char* type_names[NUM_TYPES] = {
+	"update_all", "pixel", "row", "col", "shift", "clear", "unknown"
+};
+
+// Indexed [y][x], y = 0 is the bottom row
+typedef uint8_t Display[MATRIX_NUM_ROWS][MATRIX_NUM_COLUMNS];
+
+typedef struct {
+	uint32_t start_us;
+	uint32_t bytes;
+	uint32_t commands[NUM_TYPES];
+	uint32_t pixel_writes;
+	uint32_t redundant_writes;
+	uint32_t redundant_commands;
+	uint32_t changed_pixels;
+} FrameStats;
+
+typedef struct {
+	Display display;
+	Display previous;		// at the end of the last frame
+	uint8_t command;
+	uint8_t arguments[MAX_ARGUMENTS];
+	int needed;
+	int received;
+	int in_command;
+	int changed;			// by the current command
+	FrameStats frame;
+	uint32_t frame_number;
+	// Totals over the capture
+	uint64_t bytes;
+	uint64_t pixel_writes;
+	uint64_t redundant_writes;
+	uint32_t max_frame_bytes;
+	uint32_t changed_frames;
+} Decoder;
+
+static FILE* stats_file;
+static const char* ppm_dir;
+static int scale = DEFAULT_SCALE;
+static int changed_only;
+
+static int command_type(uint8_t command) {
+	switch(command) {
+		case CMD_UPDATE_ALL:
+			return TYPE_ALL;
+		case CMD_UPDATE_PIXEL:
+			return TYPE_PIXEL;
+		case CMD_UPDATE_ROW:
+			return TYPE_ROW;
+		case CMD_UPDATE_COL:
+			return TYPE_COL;
+		case CMD_SHIFT_DISPLAY:
+			return TYPE_SHIFT;
+		case CMD_CLEAR_SCREEN:
+			return TYPE_CLEAR;
+	}
+	return TYPE_UNKNOWN;
+}
+
+// Number of bytes following each command
+static int argument_count(int type) {
+	switch(type) {
+		case TYPE_ALL:
+			return MATRIX_NUM_COLUMNS * MATRIX_NUM_ROWS;
+		case TYPE_PIXEL:
+			return 2;
+		case TYPE_ROW:
+			return 1 + MATRIX_NUM_COLUMNS;
+		case TYPE_COL:
+			return 1 + MATRIX_NUM_ROWS;
+		case TYPE_SHIFT:
+			return 1;
+	}
+	return 0;
+}
+
+static void write_pixel(Decoder* decoder, uint8_t x, uint8_t y, uint8_t colour) {
+	decoder->frame.pixel_writes++;
+	if(decoder->display[y][x] == colour) {
+		decoder->frame.redundant_writes++;
+	} else {
+		decoder->display[y][x] = colour;
+		decoder->changed = 1;
+	}
+}
+
+// Each pixel takes the colour of its neighbour in the opposite direction
+// to the shift
+static void shift_display(Decoder* decoder, uint8_t direction) {
+	Display before;
+	int dx = 0, dy = 0;
+	int x, y;
+
+	if(direction & SHIFT_LEFT) {
+		dx = 1;
+	} else if(direction & SHIFT_RIGHT) {
+		dx = -1;
+	}
+	if(direction & SHIFT_UP) {
+		dy = -1;
+	} else if(direction & SHIFT_DOWN) {
+		dy = 1;
+	}
+	memcpy(before, decoder->display, sizeof(Display));
+	for(y = 0; y < MATRIX_NUM_ROWS; y++) {
+		for(x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+			int from_x = x + dx, from_y = y + dy;
+			decoder->display[y][x] = (from_x >= 0 && from_x < MATRIX_NUM_COLUMNS &&
+					from_y >= 0 && from_y < MATRIX_NUM_ROWS) ? before[from_y][from_x] : 0;
+		}
+	}
+	if(memcmp(before, decoder->display, sizeof(Display)) != 0) {
+		decoder->changed = 1;
+	}
+}
+
+static void run_command(Decoder* decoder) {
+	uint8_t* argument = decoder->arguments;
+	int x, y;
+
+	decoder->changed = 0;
+	switch(command_type(decoder->command)) {
+		case TYPE_ALL:
+			for(y = 0; y < MATRIX_NUM_ROWS; y++) {
+				for(x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+					write_pixel(decoder, x, y, *argument++);
+				}
+			}
+			break;
+		case TYPE_PIXEL:
+			write_pixel(decoder, argument[0] & 0x0F, (argument[0] >> 4) & 0x07, argument[1]);
+			break;
+		case TYPE_ROW:
+			for(x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+				write_pixel(decoder, x, argument[0] & 0x07, argument[1 + x]);
+			}
+			break;
+		case TYPE_COL:
+			for(y = 0; y < MATRIX_NUM_ROWS; y++) {
+				write_pixel(decoder, argument[0] & 0x0F, y, argument[1 + y]);
+			}
+			break;
+		case TYPE_SHIFT:
+			shift_display(decoder, argument[0]);
+			break;
+		case TYPE_CLEAR:
+			for(y = 0; y < MATRIX_NUM_ROWS; y++) {
+				for(x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+					if(decoder->display[y][x]) {
+						decoder->display[y][x] = 0;
+						decoder->changed = 1;
+					}
+				}
+			}
+			break;
+		default:
+			// Can't tell what an unknown command would do
+			decoder->changed = 1;
+			break;
+	}
+	if(!decoder->changed) {
+		decoder->frame.redundant_commands++;
+	}
+}
+
+// Write the display as a PPM image. The red LED brightness is the low
+// nibble of the colour and the green the high nibble (see pixel_colour.h).
+static int write_ppm(const Display display, uint32_t frame_number) {
+	char name[4096];
+	FILE* file;
+	int x, y, i;
+
+	snprintf(name, sizeof(name), "%s/frame_%06u.ppm", ppm_dir, frame_number);
+	file = fopen(name, "wb");
+	if(!file) {
+		perror(name);
+		return -1;
+	}
+	fprintf(file, "P6\n%d %d\n255\n", MATRIX_NUM_COLUMNS * scale, MATRIX_NUM_ROWS * scale);
+	for(y = MATRIX_NUM_ROWS - 1; y >= 0; y--) {
+		for(i = 0; i < scale; i++) {
+			for(x = 0; x < MATRIX_NUM_COLUMNS * scale; x++) {
+				uint8_t colour = display[y][x / scale];
+				fputc((colour & 0x0F) * 17, file);
+				fputc((colour >> 4) * 17, file);
+				fputc(0, file);
+			}
+		}
+	}
+	return fclose(file);
+}
+
+static int end_frame(Decoder* decoder) {
+	FrameStats* frame = &decoder->frame;
+	int x, y, type;
+
+	if(frame->bytes == 0) {
+		return 0;
+	}
+	for(y = 0; y < MATRIX_NUM_ROWS; y++) {
+		for(x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+			frame->changed_pixels += decoder->display[y][x] != decoder->previous[y][x];
+		}
+	}
+
+	fprintf(stats_file, "%u,%u,%u", decoder->frame_number, frame->start_us, frame->bytes);
+	for(type = 0; type < NUM_TYPES; type++) {
+		fprintf(stats_file, ",%u", frame->commands[type]);
+	}
+	fprintf(stats_file, ",%u,%u,%u,%u\n", frame->pixel_writes, frame->redundant_writes,
+			frame->redundant_commands, frame->changed_pixels);
+
+	if(ppm_dir && (!changed_only || frame->changed_pixels) &&
+			write_ppm(decoder->display, decoder->frame_number) != 0) {
+		return -1;
+	}
+
+	decoder->bytes += frame->bytes;
+	decoder->pixel_writes += frame->pixel_writes;
+	decoder->redundant_writes += frame->redundant_writes;
+	decoder->changed_frames += frame->changed_pixels != 0;
+	if(frame->bytes > decoder->max_frame_bytes) {
+		decoder->max_frame_bytes = frame->bytes;
+	}
+	decoder->frame_number++;
+	memcpy(decoder->previous, decoder->display, sizeof(Display));
+	memset(frame, 0, sizeof(FrameStats));
+	return 0;
+}
+
+static void decode_byte(Decoder* decoder, uint32_t time_us, uint8_t byte) {
+	if(decoder->frame.bytes == 0) {
+		decoder->frame.start_us = time_us;
+	}
+	decoder->frame.bytes++;
+	if(!decoder->in_command) {
+		int type = command_type(byte);
+		decoder->command = byte;
+		decoder->needed = argument_count(type);
+		decoder->received = 0;
+		decoder->in_command = 1;
+		decoder->frame.commands[type]++;
+	} else {
+		decoder->arguments[decoder->received++] = byte;
+	}
+	if(decoder->received == decoder->needed) {
+		run_command(decoder);
+		decoder->in_command = 0;
+	}
+}
+
+int main(int argc, char** argv) {
+	static Decoder decoder;
+	const char* capture_name = NULL;
+	const char* stats_name = NULL;
+	uint32_t gap_us = DEFAULT_GAP_US;
+	uint32_t time_us, first_us = 0, last_us = 0;
+	uint8_t byte;
+	FILE* capture;
+
+	for(int i = 1; i < argc; i++) {
+		if(i + 1 < argc && strcmp(argv[i], "-g") == 0) {
+			gap_us = strtoul(argv[++i], NULL, 0);
+		} else if(i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+			stats_name = argv[++i];
+		} else if(i + 1 < argc && strcmp(argv[i], "-o") == 0) {
+			ppm_dir = argv[++i];
+		} else if(i + 1 < argc && strcmp(argv[i], "-z") == 0) {
+			scale = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "-c") == 0) {
+			changed_only = 1;
+		} else if(argv[i][0] != '-' && !capture_name) {
+			capture_name = argv[i];
+		} else {
+			capture_name = NULL;
+			break;
+		}
+	}
+	if(!capture_name || scale < 1) {
+		fprintf(stderr, "usage: %s [-g gap_us] [-s stats.csv] [-o ppm_dir] [-z scale] [-c] "
+				"capture.spi\n", argv[0]);
+		return 2;
+	}
+	capture = fopen(capture_name, "rb");
+	if(!capture) {
+		perror(capture_name);
+		return 2;
+	}
+	stats_file = stdout;
+	if(stats_name && !(stats_file = fopen(stats_name, "w"))) {
+		perror(stats_name);
+		return 2;
+	}
+
+	fprintf(stats_file, "frame,time_us,bytes");
+	for(int type = 0; type < NUM_TYPES; type++) {
+		fprintf(stats_file, ",%s", type_names[type]);
+	}
+	fprintf(stats_file, ",pixel_writes,redundant_writes,redundant_commands,changed_pixels\n");
+
+	while(spicap_read(capture, &time_us, &byte) == 0) {
+		if(decoder.bytes == 0 && decoder.frame.bytes == 0) {
+			first_us = time_us;
+		}
+		// A frame ends when the bus goes quiet (between commands)
+		if(!decoder.in_command && decoder.frame.bytes && time_us - last_us > gap_us &&
+				end_frame(&decoder) != 0) {
+			return 1;
+		}
+		decode_byte(&decoder, time_us, byte);
+		last_us = time_us;
+	}
+	if(end_frame(&decoder) != 0) {
+		return 1;
+	}
+	fclose(capture);
+	if(stats_name) {
+		fclose(stats_file);
+	}
+
+	if(decoder.in_command) {
+		fprintf(stderr, "capture ends part way through a command\n");
+	}
+	fprintf(stderr, "%u frames (%u changed the display), %llu bytes over %.3f s",
+			decoder.frame_number, decoder.changed_frames, (unsigned long long)decoder.bytes,
+			(last_us - first_us) / 1e6);
+	if(last_us > first_us) {
+		fprintf(stderr, " (%.0f bytes/s)", decoder.bytes * 1e6 / (last_us - first_us));
+	}
+	fprintf(stderr, "\n%.1f bytes/frame on average, %u at most; %.1f%% of %llu pixel writes "
+			"were redundant\n",
+			decoder.frame_number ? (double)decoder.bytes / decoder.frame_number : 0.0,
+			decoder.max_frame_bytes,
+			decoder.pixel_writes ? 100.0 * decoder.redundant_writes / decoder.pixel_writes : 0.0,
+			(unsigned long long)decoder.pixel_writes);
+	return 0;
+}
@@ -0,0 +1,423 @@
+/*
+ * frogenv.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * The per-game state is kept as one array per field (struct of arrays)
+ * and every array is 64-bit so that the loops in frogenv_step() work on
+ * the same number of games per vector register throughout. Branches
+ * inside those loops are written as masks: a condition becomes 0 or all
+ * ones and selects between two results with AND/OR.
+ *
+ * The arrays never overlap. As well as being restrict pointers, the loops
+ * are marked with "#pragma GCC ivdep" since GCC otherwise gives up on
+ * vectorizing loops which use this many arrays.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "frogenv.h"
+#include "level.h"
+#include "level_data.h"
+
+#define MOVING_ROWS 5		// lanes 0-2 (rows 1-3) then channels 0-1 (rows 5-6)
+#define FIRST_VEHICLE_ROW 1
+#define FIRST_RIVER_ROW 5
+#define RIVERBANK_ROW 7
+#define START_ROW 0
+#define START_COLUMN 7
+#define INITIAL_LIVES 3
+#define FROG_TIME_LIMIT 30000
+#define ACCEL_INTERVAL 1024
+#define ALIGNMENT 64
+
+// A level's layout, decoded from the level table once
+typedef struct {
+	uint16_t riverbank;
+	LaneDescriptor rows[MOVING_ROWS];
+} LevelLayout;
+
+static LevelLayout layouts[NUM_LEVEL_DESCRIPTORS];
+static uint8_t layouts_loaded;
+
+struct FrogEnv {
+	uint32_t n;
+	uint16_t step_ms;
+	uint8_t any_accel;
+	uint8_t* level;
+
+	// Per moving row
+	uint64_t* pattern[MOVING_ROWS];		// rotated so bit 0 is in column 0
+	uint64_t* width_mask[MOVING_ROWS];
+	uint64_t* top[MOVING_ROWS];			// width - 1
+	uint64_t* right[MOVING_ROWS];		// all ones if the row moves right
+	uint64_t* phase[MOVING_ROWS];
+	uint64_t* period[MOVING_ROWS];
+	uint64_t* rate[MOVING_ROWS];
+	int16_t* accel[MOVING_ROWS];
+	uint16_t* accel_time[MOVING_ROWS];
+	uint8_t* rate_limit[MOVING_ROWS];
+
+	// Per game
+	uint64_t* riverbank_status;
+	int64_t* lives;
+	int64_t* frog_time;
+	uint64_t* dead;
+	uint64_t* crossed;
+
+	FrogEnvObservation observation;
+	void* memory;
+};
+
+static void load_layouts(void) {
+	for(uint8_t level = 1; level <= NUM_LEVEL_DESCRIPTORS; level++) {
+		LevelLayout* layout = &layouts[level - 1];
+		const uint8_t* record = level_descriptor(level);
+		record = level_read_riverbank(record, &layout->riverbank);
+		for(uint8_t row = 0; row < MOVING_ROWS; row++) {
+			LaneDescriptor* lane = &layout->rows[row];
+			record = level_read_lane(record, lane);
+			// Repeat patterns narrower than the display so that the low 16
+			// bits are always what is on the display
+			while(lane->width < 16) {
+				lane->pattern |= lane->pattern << lane->width;
+				lane->width <<= 1;
+			}
+		}
+	}
+	layouts_loaded = 1;
+}
+
+// Hand out the next aligned piece of the memory block
+static void* take(uint8_t** cursor, size_t bytes) {
+	void* piece = *cursor;
+	*cursor += (bytes + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+	return piece;
+}
+
+// Lay out (or, with a NULL block, just measure) every array
+static size_t lay_out(FrogEnv* env, uint8_t* block) {
+	uint8_t* cursor = block;
+	uint32_t n = env->n;
+
+	env->level = take(&cursor, n);
+	for(uint8_t row = 0; row < MOVING_ROWS; row++) {
+		env->pattern[row] = take(&cursor, n * sizeof(uint64_t));
+		env->width_mask[row] = take(&cursor, n * sizeof(uint64_t));
+		env->top[row] = take(&cursor, n * sizeof(uint64_t));
+		env->right[row] = take(&cursor, n * sizeof(uint64_t));
+		env->phase[row] = take(&cursor, n * sizeof(uint64_t));
+		env->period[row] = take(&cursor, n * sizeof(uint64_t));
+		env->rate[row] = take(&cursor, n * sizeof(uint64_t));
+		env->accel[row] = take(&cursor, n * sizeof(int16_t));
+		env->accel_time[row] = take(&cursor, n * sizeof(uint16_t));
+		env->rate_limit[row] = take(&cursor, n);
+	}
+	env->riverbank_status = take(&cursor, n * sizeof(uint64_t));
+	env->lives = take(&cursor, n * sizeof(int64_t));
+	env->frog_time = take(&cursor, n * sizeof(int64_t));
+	env->dead = take(&cursor, n * sizeof(uint64_t));
+	env->crossed = take(&cursor, n * sizeof(uint64_t));
+	for(uint8_t row = 0; row < FROGENV_ROWS; row++) {
+		env->observation.danger[row] = take(&cursor, n * sizeof(uint16_t));
+	}
+	env->observation.frog_row = take(&cursor, n * sizeof(int64_t));
+	env->observation.frog_column = take(&cursor, n * sizeof(int64_t));
+	env->observation.reward = take(&cursor, n * sizeof(int32_t));
+	env->observation.done = take(&cursor, n);
+	return cursor - block;
+}
+
+static void observe(FrogEnv* env, uint32_t i) {
+	uint16_t** danger = env->observation.danger;
+	danger[0][i] = 0;
+	danger[4][i] = 0;
+	for(uint8_t lane = 0; lane < 3; lane++) {
+		danger[lane + FIRST_VEHICLE_ROW][i] = (uint16_t)env->pattern[lane][i];
+	}
+	for(uint8_t channel = 0; channel < 2; channel++) {
+		danger[channel + FIRST_RIVER_ROW][i] = ~(uint16_t)env->pattern[channel + 3][i];
+	}
+	danger[RIVERBANK_ROW][i] = (uint16_t)env->riverbank_status[i];
+}
+
+FrogEnv* frogenv_create(uint32_t n, uint8_t level, uint16_t step_ms) {
+	FrogEnv* env = calloc(1, sizeof(FrogEnv));
+	if(!env) {
+		return NULL;
+	}
+	env->n = n;
+	env->step_ms = step_ms;
+	size_t size = lay_out(env, NULL);
+	env->memory = aligned_alloc(ALIGNMENT, size);
+	if(!env->memory) {
+		free(env);
+		return NULL;
+	}
+	memset(env->memory, 0, size);
+	lay_out(env, env->memory);
+
+	if(!layouts_loaded) {
+		load_layouts();
+	}
+	for(uint32_t i = 0; i < n; i++) {
+		frogenv_reset(env, i, level);
+		observe(env, i);
+	}
+	return env;
+}
+
+void frogenv_destroy(FrogEnv* env) {
+	if(env) {
+		free(env->memory);
+		free(env);
+	}
+}
+
+void frogenv_reset(FrogEnv* env, uint32_t i, uint8_t level) {
+	if(level < 1) {
+		level = 1;
+	} else if(level > NUM_LEVEL_DESCRIPTORS) {
+		level = NUM_LEVEL_DESCRIPTORS;
+	}
+	const LevelLayout* layout = &layouts[level - 1];
+
+	env->level[i] = level;
+	for(uint8_t row = 0; row < MOVING_ROWS; row++) {
+		const LaneDescriptor* lane = &layout->rows[row];
+		env->pattern[row][i] = lane->pattern;
+		env->width_mask[row][i] = (lane->width == 64) ? ~0ULL : (1ULL << lane->width) - 1;
+		env->top[row][i] = lane->width - 1;
+		env->right[row][i] = (lane->direction > 0) ? ~0ULL : 0;
+		env->phase[row][i] = 0;
+		env->period[row][i] = lane->period;
+		env->rate[row][i] = lane->rate;
+		env->accel[row][i] = lane->accel;
+		env->accel_time[row][i] = 0;
+		env->rate_limit[row][i] = lane->rate_limit;
+		if(lane->accel) {
+			env->any_accel = 1;
+		}
+	}
+	env->riverbank_status[i] = layout->riverbank;
+	env->lives[i] = INITIAL_LIVES;
+	env->frog_time[i] = 0;
+	env->observation.frog_row[i] = START_ROW;
+	env->observation.frog_column[i] = START_COLUMN;
+}
+
+// Speed changes of rows which accelerate (as motion.c). Few levels use
+// this so it is done game by game, only when needed.
+static void accelerate(FrogEnv* env) {
+	for(uint8_t row = 0; row < MOVING_ROWS; row++) {
+		for(uint32_t i = 0; i < env->n; i++) {
+			int16_t accel = env->accel[row][i];
+			if(!accel) {
+				continue;
+			}
+			env->accel_time[row][i] += env->step_ms;
+			while(env->accel_time[row][i] >= ACCEL_INTERVAL && accel) {
+				int16_t rate = env->rate[row][i] + accel;
+				uint8_t limit = env->rate_limit[row][i];
+				env->accel_time[row][i] -= ACCEL_INTERVAL;
+				if((accel > 0 && rate >= limit) || (accel < 0 && rate <= limit)) {
+					rate = limit;
+					accel = 0;
+				}
+				env->rate[row][i] = rate;
+			}
+			env->accel[row][i] = accel;
+		}
+	}
+}
+
+// Make one step in one moving row of every game which has a step due.
+// Vehicles kill live frogs they move onto, logs carry live frogs along
+// (and off the edge). lane is all ones for a traffic lane and 0 for a log
+// channel, y the row on the display. Returns non-zero if any game still
+// has a step due.
+static uint64_t step_row(uint32_t n, uint64_t lane, int64_t y,
+		uint64_t* restrict pattern, const uint64_t* restrict width_mask,
+		const uint64_t* restrict top, const uint64_t* restrict right,
+		uint64_t* restrict phase, const uint64_t* restrict period,
+		const int64_t* restrict frog_row, int64_t* restrict frog_column,
+		uint64_t* restrict dead) {
+	uint64_t more = 0;
+
+	#pragma GCC ivdep
+	for(uint32_t i = 0; i < n; i++) {
+		uint64_t step = -(uint64_t)(phase[i] >= period[i]);
+		uint64_t p = pattern[i];
+		uint64_t to_right = ((p << 1) | (p >> top[i])) & width_mask[i];
+		uint64_t to_left = (p >> 1) | ((p & 1) << top[i]);
+		uint64_t rotated = (to_right & right[i]) | (to_left & ~right[i]);
+		uint64_t frog_here = step & -(uint64_t)(frog_row[i] == y) & (dead[i] - 1);
+		int64_t column = frog_column[i];
+		uint64_t hit = (rotated >> (column & 15)) & 1;
+		uint64_t at_edge = (right[i] & -(uint64_t)(column == 15)) |
+				(~right[i] & -(uint64_t)(column == 0));
+		int64_t direction = (int64_t)(right[i] & 2) - 1;
+
+		phase[i] -= period[i] & step;
+		pattern[i] = (rotated & step) | (p & ~step);
+		dead[i] |= frog_here & ((lane & hit) | (~lane & at_edge & 1));
+		frog_column[i] = column + (direction & (int64_t)(frog_here & ~at_edge & ~lane));
+		more |= -(uint64_t)(phase[i] >= period[i]);
+	}
+	return more;
+}
+
+// Let step_ms pass for one moving row of every game, making every step
+// due (usually at most one)
+static void move_row(FrogEnv* env, uint8_t row) {
+	uint32_t n = env->n;
+	uint64_t* restrict phase = env->phase[row];
+	const uint64_t* restrict period = env->period[row];
+	const uint64_t* restrict rate = env->rate[row];
+	uint64_t step_ms = env->step_ms;
+	uint64_t lane = -(uint64_t)(row < 3);
+	int64_t y = (row < 3) ? row + FIRST_VEHICLE_ROW : row - 3 + FIRST_RIVER_ROW;
+	uint64_t more = 0;
+
+	#pragma GCC ivdep
+	for(uint32_t i = 0; i < n; i++) {
+		phase[i] += rate[i] * step_ms;
+		more |= -(uint64_t)(phase[i] >= period[i]);
+	}
+	while(more) {
+		more = step_row(n, lane, y, env->pattern[row], env->width_mask[row], env->top[row],
+				env->right[row], phase, period, env->observation.frog_row,
+				env->observation.frog_column, env->dead);
+	}
+}
+
+// Make the moves. The frog's new square is checked against every row and
+// the result for the row it is in is kept (as will_frog_die_at_position()
+// in game.c).
+static void move_frogs(FrogEnv* env, const uint8_t* restrict actions) {
+	uint32_t n = env->n;
+	int64_t* restrict frog_row = env->observation.frog_row;
+	int64_t* restrict frog_column = env->observation.frog_column;
+	int32_t* restrict reward = env->observation.reward;
+	uint64_t* restrict status = env->riverbank_status;
+	uint64_t* restrict dead = env->dead;
+	uint64_t* restrict crossed = env->crossed;
+	const uint64_t* restrict lane0 = env->pattern[0];
+	const uint64_t* restrict lane1 = env->pattern[1];
+	const uint64_t* restrict lane2 = env->pattern[2];
+	const uint64_t* restrict channel0 = env->pattern[3];
+	const uint64_t* restrict channel1 = env->pattern[4];
+
+	#pragma GCC ivdep
+	for(uint32_t i = 0; i < n; i++) {
+		int64_t action = actions[i];
+		int64_t row_change = (action == FROGENV_FORWARD) - (action == FROGENV_BACKWARD);
+		int64_t column_change = (action == FROGENV_RIGHT) - (action == FROGENV_LEFT);
+		uint64_t moved = (row_change | column_change) != 0;
+		int64_t row = frog_row[i] + row_change;
+		int64_t column = frog_column[i] + column_change;
+		uint64_t shift = column & 15;
+		uint64_t off_field = (column < 0) | (column > 15) | (row < 0);
+		uint64_t hit = (-(uint64_t)(row == 1) & (lane0[i] >> shift)) |
+				(-(uint64_t)(row == 2) & (lane1[i] >> shift)) |
+				(-(uint64_t)(row == 3) & (lane2[i] >> shift)) |
+				(-(uint64_t)(row == 5) & ~(channel0[i] >> shift)) |
+				(-(uint64_t)(row == 6) & ~(channel1[i] >> shift)) |
+				(-(uint64_t)(row == RIVERBANK_ROW) & (status[i] >> shift));
+		uint64_t dies = moved & (off_field | (hit & 1));
+		uint64_t home = moved & (dies ^ 1) & (row == RIVERBANK_ROW);
+
+		frog_row[i] = row;
+		frog_column[i] = column;
+		dead[i] = dies;
+		crossed[i] = home;
+		status[i] |= home << shift;
+		reward[i] = ((row_change == 1) & (dies ^ 1)) + 10 * home;
+	}
+}
+
+// Frogs which died, ran out of time or got home start again. Episodes end
+// when the lives run out or the riverbank is full. Returns 1 if any did.
+static uint8_t finish_frogs(FrogEnv* env) {
+	uint32_t n = env->n;
+	int64_t* restrict frog_row = env->observation.frog_row;
+	int64_t* restrict frog_column = env->observation.frog_column;
+	uint8_t* restrict done = env->observation.done;
+	const uint64_t* restrict status = env->riverbank_status;
+	const uint64_t* restrict dead = env->dead;
+	const uint64_t* restrict crossed = env->crossed;
+	int64_t* restrict lives = env->lives;
+	int64_t* restrict frog_time = env->frog_time;
+	int64_t step_ms = env->step_ms;
+	uint8_t any_done = 0;
+
+	#pragma GCC ivdep
+	for(uint32_t i = 0; i < n; i++) {
+		int64_t time = frog_time[i] + step_ms;
+		uint64_t dies = dead[i] | (time >= FROG_TIME_LIMIT);
+		int64_t restart = -(int64_t)(dies | crossed[i]);
+		int64_t lives_left = lives[i] - dies;
+
+		lives[i] = lives_left;
+		frog_time[i] = time & ~restart;
+		frog_row[i] = (frog_row[i] & ~restart) | (START_ROW & restart);
+		frog_column[i] = (frog_column[i] & ~restart) | (START_COLUMN & restart);
+		done[i] = (lives_left == 0) | (status[i] == 0xFFFF);
+		any_done |= done[i];
+	}
+	return any_done;
+}
+
+static void observe_all(FrogEnv* env) {
+	uint32_t n = env->n;
+	const uint64_t* restrict lane0 = env->pattern[0];
+	const uint64_t* restrict lane1 = env->pattern[1];
+	const uint64_t* restrict lane2 = env->pattern[2];
+	const uint64_t* restrict channel0 = env->pattern[3];
+	const uint64_t* restrict channel1 = env->pattern[4];
+	const uint64_t* restrict status = env->riverbank_status;
+	uint16_t* restrict danger1 = env->observation.danger[1];
+	uint16_t* restrict danger2 = env->observation.danger[2];
+	uint16_t* restrict danger3 = env->observation.danger[3];
+	uint16_t* restrict danger5 = env->observation.danger[5];
+	uint16_t* restrict danger6 = env->observation.danger[6];
+	uint16_t* restrict danger7 = env->observation.danger[7];
+
+	#pragma GCC ivdep
+	for(uint32_t i = 0; i < n; i++) {
+		danger1[i] = (uint16_t)lane0[i];
+		danger2[i] = (uint16_t)lane1[i];
+		danger3[i] = (uint16_t)lane2[i];
+		danger5[i] = ~(uint16_t)channel0[i];
+		danger6[i] = ~(uint16_t)channel1[i];
+		danger7[i] = (uint16_t)status[i];
+	}
+}
+
+void frogenv_step(FrogEnv* env, const uint8_t* actions) {
+	move_frogs(env, actions);
+	if(env->any_accel) {
+		accelerate(env);
+	}
+	for(uint8_t row = 0; row < MOVING_ROWS; row++) {
+		move_row(env, row);
+	}
+	if(finish_frogs(env)) {
+		for(uint32_t i = 0; i < env->n; i++) {
+			if(env->observation.done[i]) {
+				frogenv_reset(env, i, env->level[i]);
+			}
+		}
+	}
+	observe_all(env);
+}
+
+const FrogEnvObservation* frogenv_observation(const FrogEnv* env) {
+	return &env->observation;
+}
+
+uint32_t frogenv_size(const FrogEnv* env) {
+	return env->n;
+}
@@ -0,0 +1,72 @@
+/*
+ * frogenv.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Batched Frogger environment for running very many independent games on
+ * a PC (e.g. for training bots). It follows the rules of game.c and
+ * project.c - same level descriptors, movement, collisions, log riding,
+ * riverbank and 30 second time limit - but keeps N games side by side in
+ * struct-of-arrays form so each part of a step is a simple loop across
+ * all the games that the compiler can turn into vector instructions.
+ *
+ * As in fieldsim.c, each lane pattern is kept rotated so that bit 0 is
+ * the bit in column 0; rotating a row and testing the frog's square are
+ * then plain shifts and masks.
+ *
+ * One call to frogenv_step() makes one move in every game (or none) and
+ * then lets step_ms pass. An episode is one level with 3 lives: it ends
+ * when the riverbank is full or the lives run out, and that game is then
+ * restarted at its level in the same call.
+ */
+
+#ifndef FROGENV_H_
+#define FROGENV_H_
+
+#include <stdint.h>
+
+// Actions use the push button numbers (as autopilot.h) plus FROGENV_STAY
+#define FROGENV_RIGHT 0
+#define FROGENV_BACKWARD 1
+#define FROGENV_FORWARD 2
+#define FROGENV_LEFT 3
+#define FROGENV_STAY 4
+
+#define FROGENV_ROWS 8
+
+typedef struct FrogEnv FrogEnv;
+
+// What each game looks like after a step. All arrays have one entry per
+// game. danger[row] has a bit set in every column of that row where the
+// frog would die (vehicles, water, edges of the riverbank and filled
+// holes). reward is the score the move earned (1 for a successful move
+// forward, 10 for reaching a hole, as in game.c and project.c) and done is
+// 1 if the episode ended with this step (the observation is then the
+// start of the next episode).
+typedef struct {
+	uint16_t* danger[FROGENV_ROWS];
+	int64_t* frog_row;
+	int64_t* frog_column;
+	int32_t* reward;
+	uint8_t* done;
+} FrogEnvObservation;
+
+// Create n games, all starting at the given level (1 to the number of
+// levels in the level table), moving step_ms each step. Returns NULL if
+// out of memory. All memory is allocated here - stepping allocates none.
+FrogEnv* frogenv_create(uint32_t n, uint8_t level, uint16_t step_ms);
+void frogenv_destroy(FrogEnv* env);
+
+// Restart game i at the given level
+void frogenv_reset(FrogEnv* env, uint32_t i, uint8_t level);
+
+// Make actions[i] in game i (FROGENV_RIGHT to FROGENV_STAY, anything else
+// is treated as STAY) then let step_ms pass in every game
+void frogenv_step(FrogEnv* env, const uint8_t* actions);
+
+// The observation arrays, valid until the next step
+const FrogEnvObservation* frogenv_observation(const FrogEnv* env);
+
+uint32_t frogenv_size(const FrogEnv* env);
+
+#endif /* FROGENV_H_ */
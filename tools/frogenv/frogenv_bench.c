@@ -0,0 +1,70 @@
+/*
+ * frogenv_bench.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Benchmark for the batched environment (frogenv.h). Steps n games with
+ * random actions on one core and reports environment steps (one game
+ * making one step) per second. The actions are generated before timing
+ * starts so only the environment is measured.
+ *
+ * Build: gcc -O3 -march=native -Wall -I../host -I../../CSSE2010-s4411500 \
+ *            -o frogenv_bench frogenv_bench.c frogenv.c ../host/host_stubs.c \
+ *            ../../CSSE2010-s4411500/level.c ../../CSSE2010-s4411500/level_data.c \
+ *            ../../CSSE2010-s4411500/statebus.c
+ * Usage: frogenv_bench [games] [steps]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "frogenv.h"
+
+#define ACTION_SETS 64
+
+int main(int argc, char** argv) {
+	uint32_t n = (argc > 1) ? strtoul(argv[1], NULL, 0) : 4096;
+	uint32_t steps = (argc > 2) ? strtoul(argv[2], NULL, 0) : 5000;
+	uint8_t* actions = malloc((size_t)ACTION_SETS * n);
+	FrogEnv* env = frogenv_create(n, 1, 100);
+	uint32_t random = 1;
+	uint64_t rewards = 0, episodes = 0;
+	struct timespec start, end;
+
+	if(!actions || !env) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	// Mostly forward, like a (bad) player would
+	for(size_t i = 0; i < (size_t)ACTION_SETS * n; i++) {
+		random ^= random << 13;
+		random ^= random >> 17;
+		random ^= random << 5;
+		uint8_t roll = random % 10;
+		actions[i] = (roll < 4) ? FROGENV_FORWARD : (roll < 9) ? FROGENV_STAY :
+				(random >> 8) % 4;
+	}
+
+	const FrogEnvObservation* observation = frogenv_observation(env);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(uint32_t step = 0; step < steps; step++) {
+		frogenv_step(env, &actions[(size_t)(step % ACTION_SETS) * n]);
+		// Touch the results as a trainer would
+		rewards += observation->reward[step % n];
+		episodes += observation->done[step % n];
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	double env_steps = (double)n * steps;
+	printf("%u games x %u steps in %.3f s\n", n, steps, seconds);
+	printf("%.2f M env-steps/s (%.1f ns per env-step)\n", env_steps / seconds / 1e6,
+			seconds * 1e9 / env_steps);
+	printf("(sampled reward %llu, episodes %llu)\n", (unsigned long long)rewards,
+			(unsigned long long)episodes);
+	frogenv_destroy(env);
+	free(actions);
+	return 0;
+}
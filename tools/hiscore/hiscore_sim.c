@@ -0,0 +1,350 @@
+/*
+ * hiscore_sim.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Runs the firmware on a simulated ATmega324A at 8MHz (simavr) and watches
+ * the high score table (see hiscore.h) being saved to EEPROM. The EEPROM
+ * is checked every EEPROM_POLL_CYCLES cycles - much less than the 3.4ms
+ * a byte takes to write, so every byte written is seen. After each byte
+ * written to the table's slots (other EEPROM writes, e.g. of game
+ * snapshots, are ignored and not counted) the slots are decoded the same
+ * way as init_high_scores() does and it is checked that
+ *   - the latest valid table never goes back to an earlier one or is lost
+ *     (i.e. a save cut short at this byte would leave the previous table),
+ *   - each new table has the sequence number after the previous one (so
+ *     the firmware carried on from the table it loaded at start-up).
+ *
+ * Power loss: -k stops the run (as if the power was cut) once the given
+ * number of EEPROM bytes have been written and -o saves the EEPROM as it
+ * was left. Running again with -e starts the firmware from that image.
+ * simavr writes each byte whole, so a byte torn part way through its own
+ * write isn't modelled - the CRC doesn't care which byte of a record is
+ * wrong, so this would be no different to the record being cut short at
+ * that byte.
+ *
+ * Push buttons can be pressed and serial input sent at given times, e.g.
+ * "-b 1000:0 -s 1500:a" starts a game and turns on the autopilot, which
+ * keeps playing (and saving scores at each game over) until the time runs
+ * out.
+ *
+ * Build: gcc -O2 -Wall -I../../CSSE2010-s4411500 -o hiscore_sim hiscore_sim.c -lsimavr -lelf
+ * Usage: hiscore_sim [-t seconds] [-e in.eep] [-o out.eep] [-k bytes]
+ *                    [-b ms:button ...] [-s ms:text ...] firmware.elf
+ *        hiscore_sim -d image.eep
+ *     -b  press push button B0 to B3 at the given time (held for 50ms)
+ *     -s  send text to the serial port at the given time (a character per ms)
+ *     -d  just decode an EEPROM image
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_irq.h>
+#include <simavr/avr_eeprom.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_uart.h>
+
+#include "hiscore.h"
+
+#define MCU "atmega324a"
+#define FREQUENCY 8000000
+#define CYCLES_PER_MS (FREQUENCY / 1000)
+#define EEPROM_SIZE 1024
+#define EEPROM_POLL_CYCLES 256
+#define DEFAULT_SECONDS 60
+#define MAX_INPUTS 64
+#define PRESS_MS 50
+
+typedef struct {
+	unsigned long at_ms;
+	int button;			// -1 for serial input
+	const char* text;
+	int state;			// buttons: 0 not yet pushed, 1 held down, 2 released
+						// serial: number of characters sent
+} Input;
+
+// The table init_high_scores() would load from an EEPROM image
+typedef struct {
+	int slot;			// -1 if there's no valid table
+	HighScoreRecord record;
+} Latest;
+
+static uint8_t eeprom[EEPROM_SIZE];
+
+// As _crc16_update() in avr-libc
+static uint16_t crc16_update(uint16_t crc, uint8_t byte) {
+	crc ^= byte;
+	for(int i = 0; i < 8; i++) {
+		crc = crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+	}
+	return crc;
+}
+
+static int record_valid(const HighScoreRecord* record) {
+	const uint8_t* byte = (const uint8_t*)record;
+	uint16_t crc = HISCORE_CRC_INIT;
+
+	for(size_t i = 0; i < offsetof(HighScoreRecord, crc); i++) {
+		crc = crc16_update(crc, byte[i]);
+	}
+	return crc == record->crc;
+}
+
+static Latest find_latest(const uint8_t* image) {
+	Latest latest;
+	HighScoreRecord record;
+
+	latest.slot = -1;
+	for(int slot = 0; slot < HISCORE_SLOTS; slot++) {
+		memcpy(&record, image + HISCORE_EEPROM_START + slot * HISCORE_SLOT_SIZE, sizeof(record));
+		if(record_valid(&record) && (latest.slot < 0 ||
+				(int16_t)(record.sequence - latest.record.sequence) > 0)) {
+			latest.slot = slot;
+			latest.record = record;
+		}
+	}
+	return latest;
+}
+
+static void print_table(const Latest* latest) {
+	if(latest->slot < 0) {
+		printf("no table\n");
+		return;
+	}
+	printf("sequence %u in slot %d:", latest->record.sequence, latest->slot);
+	for(int i = 0; i < HISCORE_ENTRIES && latest->record.entries[i].score; i++) {
+		printf(" %u/%u", latest->record.entries[i].score, latest->record.entries[i].level);
+	}
+	printf("\n");
+}
+
+static int decode(const char* name) {
+	HighScoreRecord record;
+	Latest latest;
+
+	for(int slot = 0; slot < HISCORE_SLOTS; slot++) {
+		memcpy(&record, eeprom + HISCORE_EEPROM_START + slot * HISCORE_SLOT_SIZE, sizeof(record));
+		printf("slot %d: sequence %5u, %s\n", slot, record.sequence,
+				record_valid(&record) ? "valid" : "bad CRC");
+	}
+	latest = find_latest(eeprom);
+	printf("%s: ", name);
+	print_table(&latest);
+	return 0;
+}
+
+static int read_image(const char* name) {
+	FILE* file = fopen(name, "rb");
+
+	if(!file) {
+		perror(name);
+		return -1;
+	}
+	memset(eeprom, 0xFF, sizeof(eeprom));
+	fread(eeprom, 1, sizeof(eeprom), file);
+	fclose(file);
+	return 0;
+}
+
+static int write_image(const char* name) {
+	FILE* file = fopen(name, "wb");
+
+	if(!file) {
+		perror(name);
+		return -1;
+	}
+	fwrite(eeprom, 1, sizeof(eeprom), file);
+	return fclose(file);
+}
+
+static void get_eeprom(avr_t* avr, uint8_t* image) {
+	avr_eeprom_desc_t desc;
+
+	desc.ee = image;
+	desc.offset = 0;
+	desc.size = EEPROM_SIZE;
+	avr_ioctl(avr, AVR_IOCTL_EEPROM_GET, &desc);
+}
+
+int main(int argc, char** argv) {
+	const char* firmware_name = NULL;
+	const char* in_name = NULL;
+	const char* out_name = NULL;
+	const char* decode_name = NULL;
+	double seconds = DEFAULT_SECONDS;
+	unsigned long kill_after = 0, bytes_written = 0;
+	Input inputs[MAX_INPUTS];
+	int num_inputs = 0, errors = 0, state;
+	elf_firmware_t firmware;
+	avr_t* avr;
+	avr_eeprom_desc_t desc;
+	avr_irq_t* button_irq[4];
+	avr_irq_t* uart_irq;
+	avr_cycle_count_t end_cycle, next_poll = 0;
+	uint8_t current[EEPROM_SIZE];
+	uint32_t flags;
+	Latest latest, now_latest;
+
+	for(int i = 1; i < argc; i++) {
+		if(i + 1 < argc && strcmp(argv[i], "-t") == 0) {
+			seconds = atof(argv[++i]);
+		} else if(i + 1 < argc && strcmp(argv[i], "-e") == 0) {
+			in_name = argv[++i];
+		} else if(i + 1 < argc && strcmp(argv[i], "-o") == 0) {
+			out_name = argv[++i];
+		} else if(i + 1 < argc && strcmp(argv[i], "-k") == 0) {
+			kill_after = strtoul(argv[++i], NULL, 10);
+		} else if(i + 1 < argc && strcmp(argv[i], "-d") == 0) {
+			decode_name = argv[++i];
+		} else if(i + 1 < argc && strcmp(argv[i], "-b") == 0 && num_inputs < MAX_INPUTS &&
+				sscanf(argv[i + 1], "%lu:%d", &inputs[num_inputs].at_ms,
+				&inputs[num_inputs].button) == 2 && inputs[num_inputs].button >= 0 &&
+				inputs[num_inputs].button <= 3) {
+			inputs[num_inputs++].state = 0;
+			i++;
+		} else if(i + 1 < argc && strcmp(argv[i], "-s") == 0 && num_inputs < MAX_INPUTS &&
+				sscanf(argv[i + 1], "%lu:", &inputs[num_inputs].at_ms) == 1 &&
+				strchr(argv[i + 1], ':')) {
+			inputs[num_inputs].button = -1;
+			inputs[num_inputs].text = strchr(argv[i + 1], ':') + 1;
+			inputs[num_inputs++].state = 0;
+			i++;
+		} else if(argv[i][0] != '-' && !firmware_name) {
+			firmware_name = argv[i];
+		} else {
+			firmware_name = decode_name = NULL;
+			break;
+		}
+	}
+	if(decode_name && argc == 3) {
+		return read_image(decode_name) == 0 ? decode(decode_name) : 2;
+	}
+	if(!firmware_name) {
+		fprintf(stderr, "usage: %s [-t seconds] [-e in.eep] [-o out.eep] [-k bytes]\n"
+				"           [-b ms:button ...] [-s ms:text ...] firmware.elf\n"
+				"       %s -d image.eep\n", argv[0], argv[0]);
+		return 2;
+	}
+
+	memset(eeprom, 0xFF, sizeof(eeprom));
+	if(in_name && read_image(in_name) != 0) {
+		return 2;
+	}
+	memset(&firmware, 0, sizeof(firmware));
+	if(elf_read_firmware(firmware_name, &firmware) != 0) {
+		fprintf(stderr, "%s: can't read firmware\n", firmware_name);
+		return 2;
+	}
+	avr = avr_make_mcu_by_name(MCU);
+	if(!avr) {
+		fprintf(stderr, "simavr doesn't support the " MCU "\n");
+		return 2;
+	}
+	avr_init(avr);
+	firmware.frequency = FREQUENCY;
+	avr_load_firmware(avr, &firmware);
+
+	desc.ee = eeprom;
+	desc.offset = 0;
+	desc.size = EEPROM_SIZE;
+	avr_ioctl(avr, AVR_IOCTL_EEPROM_SET, &desc);
+
+	avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+	flags &= ~AVR_UART_FLAG_STDIO;
+	avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+	uart_irq = avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+	for(int button = 0; button < 4; button++) {
+		button_irq[button] = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), button);
+	}
+
+	latest = find_latest(eeprom);
+	printf("start: ");
+	print_table(&latest);
+
+	end_cycle = seconds * FREQUENCY;
+	do {
+		for(int i = 0; i < num_inputs; i++) {
+			avr_cycle_count_t at = (avr_cycle_count_t)inputs[i].at_ms * CYCLES_PER_MS;
+			if(inputs[i].button < 0) {
+				if(inputs[i].text[inputs[i].state] &&
+						avr->cycle >= at + (avr_cycle_count_t)inputs[i].state * CYCLES_PER_MS) {
+					avr_raise_irq(uart_irq, inputs[i].text[inputs[i].state++]);
+				}
+			} else if(inputs[i].state == 0 && avr->cycle >= at) {
+				// Buttons are high while pushed
+				avr_raise_irq(button_irq[inputs[i].button], 1);
+				inputs[i].state = 1;
+			} else if(inputs[i].state == 1 && avr->cycle >= at + PRESS_MS * CYCLES_PER_MS) {
+				avr_raise_irq(button_irq[inputs[i].button], 0);
+				inputs[i].state = 2;
+			}
+		}
+		state = avr_run(avr);
+
+		if(avr->cycle < next_poll) {
+			continue;
+		}
+		next_poll = avr->cycle + EEPROM_POLL_CYCLES;
+		get_eeprom(avr, current);
+		for(int address = 0; address < EEPROM_SIZE; address++) {
+			if(current[address] == eeprom[address]) {
+				continue;
+			}
+			eeprom[address] = current[address];
+			if(address < HISCORE_EEPROM_START ||
+					address >= HISCORE_EEPROM_START + HISCORE_SLOTS * HISCORE_SLOT_SIZE) {
+				// Not part of the table (e.g. a game snapshot)
+				continue;
+			}
+			bytes_written++;
+
+			now_latest = find_latest(eeprom);
+			if(latest.slot >= 0 && (now_latest.slot < 0 ||
+					(int16_t)(now_latest.record.sequence - latest.record.sequence) < 0)) {
+				printf("%.3fs: byte %lu at %d lost the table\n",
+						(double)avr->cycle / FREQUENCY, bytes_written, address);
+				errors++;
+			} else if(now_latest.slot >= 0 && (latest.slot < 0 ||
+					now_latest.record.sequence != latest.record.sequence)) {
+				if(latest.slot >= 0 &&
+						now_latest.record.sequence != (uint16_t)(latest.record.sequence + 1)) {
+					printf("%.3fs: sequence %u doesn't follow %u\n",
+							(double)avr->cycle / FREQUENCY, now_latest.record.sequence,
+							latest.record.sequence);
+					errors++;
+				}
+				printf("%.3fs: saved after %lu bytes, ", (double)avr->cycle / FREQUENCY,
+						bytes_written);
+				print_table(&now_latest);
+			}
+			latest = now_latest;
+			if(kill_after && bytes_written == kill_after) {
+				break;
+			}
+		}
+	} while(state != cpu_Done && state != cpu_Crashed && avr->cycle < end_cycle &&
+			(!kill_after || bytes_written < kill_after));
+
+	if(kill_after && bytes_written == kill_after) {
+		printf("%.3fs: power cut after %lu bytes\n", (double)avr->cycle / FREQUENCY,
+				bytes_written);
+	}
+	printf("end: ");
+	print_table(&latest);
+	printf("%lu bytes written\n", bytes_written);
+	if(out_name && write_image(out_name) != 0) {
+		return 2;
+	}
+	if(state == cpu_Crashed) {
+		fprintf(stderr, "%s: crashed after %llu cycles\n", firmware_name,
+				(unsigned long long)avr->cycle);
+		return 1;
+	}
+	return errors ? 1 : 0;
+}
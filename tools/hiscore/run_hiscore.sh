@@ -0,0 +1,62 @@
+#!/bin/sh
+#
+# run_hiscore.sh
+#
+# Written by Wu Lai Yin (Peter)
+#
+# Power loss test for the high score table. Plays with the autopilot under
+# simavr until the first save has been written, then for each byte of that
+# save: cuts the power just after the byte is written and starts the
+# firmware again from the EEPROM as it was left. hiscore_sim checks at
+# every byte that the table is never lost and that the firmware carries on
+# from the latest table.
+#
+# Needs avr-gcc (avr-libc) and simavr (libsimavr and its headers).
+#
+# Usage: run_hiscore.sh [seconds]
+#     seconds  how long to play for in each run (default 300)
+
+set -e
+
+PLAY_SECONDS=${1:-300}
+HISCORE_DIR=$(cd "$(dirname "$0")" && pwd)
+SRC_DIR="$HISCORE_DIR/../../CSSE2010-s4411500"
+BUILD_DIR="$HISCORE_DIR/build"
+# Start a game and turn on the autopilot
+INPUTS="-b 1000:0 -s 1500:a"
+
+mkdir -p "$BUILD_DIR"
+
+# Same flags as Debug/Makefile
+avr-gcc -funsigned-char -funsigned-bitfields -O1 -ffunction-sections \
+	-fdata-sections -fpack-struct -fshort-enums -Wall -std=gnu99 \
+	-mmcu=atmega324a -I"$SRC_DIR" -Wl,--gc-sections \
+	-o "$BUILD_DIR/hiscore.elf" "$SRC_DIR"/*.c -lm
+gcc -O2 -Wall -I"$SRC_DIR" -o "$BUILD_DIR/hiscore_sim" "$HISCORE_DIR/hiscore_sim.c" \
+	-lsimavr -lelf
+
+"$BUILD_DIR/hiscore_sim" -t "$PLAY_SECONDS" $INPUTS "$BUILD_DIR/hiscore.elf" \
+	> "$BUILD_DIR/first.log"
+SAVE_BYTES=$(awk '/saved after/ { print $4; exit }' "$BUILD_DIR/first.log")
+if [ -z "$SAVE_BYTES" ]; then
+	echo "no game finished in $PLAY_SECONDS seconds" >&2
+	exit 1
+fi
+echo "first save is $SAVE_BYTES bytes"
+
+FAILED=0
+BYTE=1
+while [ "$BYTE" -le "$SAVE_BYTES" ]; do
+	"$BUILD_DIR/hiscore_sim" -t "$PLAY_SECONDS" -k "$BYTE" $INPUTS -o "$BUILD_DIR/cut.eep" \
+		"$BUILD_DIR/hiscore.elf" > "$BUILD_DIR/cut.log" || FAILED=1
+	if "$BUILD_DIR/hiscore_sim" -t "$PLAY_SECONDS" -e "$BUILD_DIR/cut.eep" $INPUTS \
+			"$BUILD_DIR/hiscore.elf" > "$BUILD_DIR/resume.log"; then
+		echo "cut after byte $BYTE: $(grep '^start' "$BUILD_DIR/resume.log"), ok"
+	else
+		echo "cut after byte $BYTE: failed"
+		cat "$BUILD_DIR/cut.log" "$BUILD_DIR/resume.log"
+		FAILED=1
+	fi
+	BYTE=$((BYTE + 1))
+done
+exit $FAILED
@@ -0,0 +1,17 @@
+/*
+ * avr/eeprom.h (host)
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Stand-in for the AVR EEPROM header. The EEPROM reads as erased (see
+ * host_stubs.c).
+ */
+
+#ifndef HOST_AVR_EEPROM_H_
+#define HOST_AVR_EEPROM_H_
+
+#include <stddef.h>
+
+void eeprom_read_block(void* destination, const void* source, size_t size);
+
+#endif /* HOST_AVR_EEPROM_H_ */
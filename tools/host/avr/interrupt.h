@@ -0,0 +1,16 @@
+/*
+ * avr/interrupt.h (host)
+ *
+ * Author: Wu Lai Yin (Peter)
+ */
+
+#ifndef HOST_AVR_INTERRUPT_H_
+#define HOST_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define sei()
+#define cli()
+#define ISR(vector) void vector(void)
+
+#endif /* HOST_AVR_INTERRUPT_H_ */
@@ -0,0 +1,34 @@
+/*
+ * avr/io.h (host)
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Stand-in for the AVR I/O header so the hardware independent game logic
+ * can be compiled and run on a PC by the tools. Registers are plain
+ * variables defined in host_stubs.c. Only the registers touched by the
+ * game logic modules are provided. TCNT1 never runs, and TIFR1 doesn't
+ * clear the flags written to it, so the autopilot's cycle counts mean
+ * nothing on the host.
+ */
+
+#ifndef HOST_AVR_IO_H_
+#define HOST_AVR_IO_H_
+
+#include <stdint.h>
+
+extern volatile uint8_t PORTA, DDRA;
+extern volatile uint8_t TCCR1A, TCCR1B;
+extern volatile uint16_t TCNT1;
+extern volatile uint8_t TIFR1;
+extern volatile uint8_t SREG;
+
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define TOV1 0
+#define SREG_I 7
+
+#define _BV(bit) (1 << (bit))
+#define bit_is_set(reg, bit) ((reg) & _BV(bit))
+
+#endif /* HOST_AVR_IO_H_ */
@@ -0,0 +1,26 @@
+/*
+ * avr/pgmspace.h (host)
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * On the host there is only one address space, so flash reads are plain
+ * memory reads. Terminal output from the game logic (printf_P) is thrown
+ * away - the tools report their own results.
+ */
+
+#ifndef HOST_AVR_PGMSPACE_H_
+#define HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+#define pgm_read_dword(address) (*(const uint32_t*)(address))
+#define pgm_read_ptr(address) (*(const void* const*)(address))
+#define memcpy_P memcpy
+#define printf_P(...) ((void)0)
+
+#endif /* HOST_AVR_PGMSPACE_H_ */
@@ -0,0 +1,57 @@
+/*
+ * host_stubs.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Do-nothing versions of the hardware modules (LED matrix, terminal), the
+ * registers from avr/io.h and an erased EEPROM, so that game.c, level.c, score.c, live.c
+ * and the modules they use can be linked into host tools. Tools built
+ * with HOST_LEDMATRIX defined link the real ledmatrix.c and spi_host.c
+ * instead of the LED matrix functions here.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include "ledmatrix.h"
+#include "terminalio.h"
+
+volatile uint8_t PORTA, DDRA;
+volatile uint8_t TCCR1A, TCCR1B;
+volatile uint16_t TCNT1;
+volatile uint8_t TIFR1;
+volatile uint8_t SREG;
+
+#ifndef HOST_LEDMATRIX
+void ledmatrix_update_pixel(uint8_t x, uint8_t y, PixelColour pixel) {
+}
+
+void ledmatrix_update_row(uint8_t y, MatrixRow row) {
+}
+
+void ledmatrix_clear(void) {
+}
+
+void ledmatrix_update_row_packed(uint8_t y, const MatrixPackedRow row,
+		const PixelColour* palette) {
+}
+
+void ledmatrix_update_all_packed(const MatrixPackedData data, const PixelColour* palette) {
+}
+
+void ledmatrix_update_column(uint8_t x, MatrixColumn col) {
+}
+
+void ledmatrix_shift_display_left(void) {
+}
+#endif
+
+void move_cursor(int x, int y) {
+}
+
+void eeprom_read_block(void* destination, const void* source, size_t size) {
+	(void)source;
+	memset(destination, 0xFF, size);
+}
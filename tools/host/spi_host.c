@@ -0,0 +1,48 @@
+/*
+ * spi_host.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "spi.h"
+#include "spi_host.h"
+#include "../display/spicap.h"
+
+#define SPI_BYTE_US 128
+
+static FILE* capture;
+static uint32_t next_time_us;
+static uint32_t bytes_sent;
+
+void spi_host_capture(FILE* file) {
+	capture = file;
+}
+
+void spi_host_set_time(uint32_t time_us) {
+	// Bytes can't be sent before the previous one has finished
+	if(time_us > next_time_us) {
+		next_time_us = time_us;
+	}
+}
+
+uint32_t spi_host_bytes(void) {
+	return bytes_sent;
+}
+
+void spi_setup_master(uint8_t clockdivider) {
+}
+
+uint8_t spi_send_byte(uint8_t byte) {
+	if(capture) {
+		spicap_write(capture, next_time_us, byte);
+	}
+	next_time_us += SPI_BYTE_US;
+	bytes_sent++;
+	return 0;
+}
+
+void spi_flush(void) {
+}
@@ -0,0 +1,29 @@
+/*
+ * spi_host.h
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Host version of spi.c for tools which link the real ledmatrix.c (in
+ * place of the do-nothing LED matrix functions in host_stubs.c). Every
+ * byte sent is recorded in an SPI capture (see display/spicap.h) so the
+ * display can be rebuilt with spidecode.
+ */
+
+#ifndef SPI_HOST_H_
+#define SPI_HOST_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Record the bytes sent from now on in file (NULL to stop recording)
+void spi_host_capture(FILE* file);
+
+// Set the time (in microseconds of game time) of the next byte sent. Each
+// byte takes 128us (8 bits at 8MHz/128, as ledmatrix_setup()) so later
+// bytes are timed from this.
+void spi_host_set_time(uint32_t time_us);
+
+// Number of bytes sent so far (whether or not they were recorded)
+uint32_t spi_host_bytes(void);
+
+#endif /* SPI_HOST_H_ */
@@ -0,0 +1,32 @@
+/*
+ * util/crc16.h (host)
+ *
+ * Author: Wu Lai Yin (Peter)
+ *
+ * Stand-in for the avr-libc CRC header - the same CRC-16 (polynomial
+ * 0xA001, bit reversed) as _crc16_update() and CRC-8 (polynomial 0x07) as
+ * _crc8_ccitt_update().
+ */
+
+#ifndef HOST_UTIL_CRC16_H_
+#define HOST_UTIL_CRC16_H_
+
+#include <stdint.h>
+
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t byte) {
+	crc ^= byte;
+	for(int i = 0; i < 8; i++) {
+		crc = crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+	}
+	return crc;
+}
+
+static inline uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t byte) {
+	crc ^= byte;
+	for(int i = 0; i < 8; i++) {
+		crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+	}
+	return crc;
+}
+
+#endif /* HOST_UTIL_CRC16_H_ */
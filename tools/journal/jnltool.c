@@ -0,0 +1,318 @@
+/*
+ * jnltool.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Tool for input journals (see journal.h).
+ *
+ *   jnltool extract [-n game] serial.log out.jnl
+ *       Pull the journal of a game (the first by default) out of a serial
+ *       log from a JOURNAL_RECORD build. If the log stops part way
+ *       through the game the journal is ended at the last input.
+ *   jnltool dump in.jnl
+ *       List the inputs in a journal.
+ *   jnltool cfile in.jnl journal_replay_data.c
+ *       Write the journal as C source for a JOURNAL_REPLAY build.
+ *   jnltool autopilot [-s seed] [-t ms] out.jnl
+ *       Make up a journal without a board: a few seconds of random moves
+ *       along the starting bank and a pause, then the autopilot
+ *       is turned on and plays until the journal ends after the given
+ *       time (10 minutes by default). For checking replays, e.g. with
+ *       replay_host -k.
+ *
+ * Build: gcc -O2 -Wall -I../../CSSE2010-s4411500 -o jnltool jnltool.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "journal.h"
+
+#define MAX_JOURNAL_SIZE 65536
+#define ESCAPE_CHAR 27
+
+typedef struct {
+	uint8_t data[MAX_JOURNAL_SIZE];
+	size_t size;
+} Journal;
+
+static Journal journal;
+
+// Read an entry from data[*position]. Return 0 on success or -1 if the
+// journal ends part way through the entry.
+static int read_entry(const uint8_t* data, size_t size, size_t* position, uint32_t* delta,
+		uint8_t* token) {
+	uint8_t byte;
+	int shift = 0;
+
+	*delta = 0;
+	do {
+		if(*position >= size || shift > 28) {
+			return -1;
+		}
+		byte = data[(*position)++];
+		*delta |= (uint32_t)(byte & 0x7F) << shift;
+		shift += 7;
+	} while(byte & 0x80);
+	if(*position >= size) {
+		return -1;
+	}
+	*token = data[(*position)++];
+	return 0;
+}
+
+// Check the journal is complete. Return the number of inputs or -1.
+static long check_journal(const Journal* j) {
+	size_t position = JOURNAL_HEADER_SIZE;
+	uint32_t delta;
+	uint8_t token;
+	long inputs = 0;
+
+	if(j->size < JOURNAL_HEADER_SIZE || j->data[0] != 'J' || j->data[1] != JOURNAL_VERSION) {
+		return -1;
+	}
+	while(read_entry(j->data, j->size, &position, &delta, &token) == 0) {
+		if(token == JOURNAL_END) {
+			return position == j->size ? inputs : -1;
+		}
+		inputs++;
+	}
+	return -1;
+}
+
+static int add_bytes(const char* hex) {
+	unsigned int byte;
+
+	while(hex[0] && hex[1]) {
+		if(sscanf(hex, "%2x", &byte) != 1 || journal.size == MAX_JOURNAL_SIZE) {
+			return -1;
+		}
+		journal.data[journal.size++] = byte;
+		hex += 2;
+	}
+	return 0;
+}
+
+// Write the journal, ending it at the last complete entry if needed
+static int write_journal(const char* name) {
+	size_t position = JOURNAL_HEADER_SIZE, end = JOURNAL_HEADER_SIZE;
+	uint32_t delta;
+	uint8_t token = 0;
+	FILE* file;
+
+	while(token != JOURNAL_END &&
+			read_entry(journal.data, journal.size, &position, &delta, &token) == 0) {
+		end = position;
+	}
+	journal.size = end;
+	if(token != JOURNAL_END) {
+		if(journal.size + 2 > MAX_JOURNAL_SIZE) {
+			return -1;
+		}
+		journal.data[journal.size++] = 0;
+		journal.data[journal.size++] = JOURNAL_END;
+		fprintf(stderr, "journal didn't finish - ended at the last input\n");
+	}
+	file = fopen(name, "wb");
+	if(!file) {
+		perror(name);
+		return -1;
+	}
+	fwrite(journal.data, 1, journal.size, file);
+	return fclose(file);
+}
+
+static int extract(int game, const char* log_name, const char* journal_name) {
+	static char payload[256];
+	size_t length = 0;
+	int c, in_string = 0, games = 0;
+	FILE* log = fopen(log_name, "rb");
+
+	if(!log) {
+		perror(log_name);
+		return 2;
+	}
+	// Journal data is in APC strings: ESC _ <type> <hex> ESC backslash
+	while((c = fgetc(log)) != EOF) {
+		if(c == ESCAPE_CHAR) {
+			c = fgetc(log);
+			if(c == '_') {
+				in_string = 1;
+				length = 0;
+			} else if(c == '\\' && in_string) {
+				in_string = 0;
+				payload[length] = 0;
+				if(payload[0] == 'S' && ++games == game) {
+					journal.size = 0;
+				}
+				if(games == game && (payload[0] == 'S' || payload[0] == 'J') &&
+						add_bytes(payload + 1) != 0) {
+					fprintf(stderr, "%s: bad journal data\n", log_name);
+					return 1;
+				}
+			}
+		} else if(in_string && length < sizeof(payload) - 1) {
+			payload[length++] = c;
+		}
+		if(games > game) {
+			break;
+		}
+	}
+	fclose(log);
+	if(games < game) {
+		fprintf(stderr, "%s: only %d game%s in the log\n", log_name, games, games == 1 ? "" : "s");
+		return 1;
+	}
+	return write_journal(journal_name) == 0 ? 0 : 1;
+}
+
+static int read_journal(const char* name) {
+	FILE* file = fopen(name, "rb");
+	if(!file) {
+		perror(name);
+		return -1;
+	}
+	journal.size = fread(journal.data, 1, MAX_JOURNAL_SIZE, file);
+	fclose(file);
+	if(check_journal(&journal) < 0) {
+		fprintf(stderr, "%s: not a complete journal\n", name);
+		return -1;
+	}
+	return 0;
+}
+
+static void print_token(uint8_t token) {
+	static const char* directions[4] = { "up", "right", "down", "left" };
+
+	if(token <= JOURNAL_SERIAL_MAX) {
+		if(token >= ' ' && token < 0x7F) {
+			printf("serial '%c'\n", token);
+		} else {
+			printf("serial 0x%02X\n", token);
+		}
+	} else if(token < JOURNAL_JOYSTICK) {
+		printf("button B%d\n", token - JOURNAL_BUTTON);
+	} else if(token < JOURNAL_REPEAT) {
+		printf("joystick %s\n", directions[token - JOURNAL_JOYSTICK]);
+	} else if(token < JOURNAL_REPEAT + 4) {
+		printf("repeat B%d\n", token - JOURNAL_REPEAT);
+	} else if(token == JOURNAL_SYNC) {
+		printf("level starts\n");
+	} else if(token == JOURNAL_END) {
+		printf("end\n");
+	} else {
+		printf("unknown 0x%02X\n", token);
+	}
+}
+
+static int dump(void) {
+	size_t position = JOURNAL_HEADER_SIZE;
+	uint32_t delta, time = 0;
+	uint8_t token;
+
+	printf("seed %u, %zu bytes, %ld inputs\n", journal.data[2] | journal.data[3] << 8 |
+			journal.data[4] << 16 | (uint32_t)journal.data[5] << 24, journal.size,
+			check_journal(&journal));
+	while(read_entry(journal.data, journal.size, &position, &delta, &token) == 0) {
+		time += delta;
+		printf("%10u ms  ", time);
+		print_token(token);
+	}
+	return 0;
+}
+
+static void add_entry(uint32_t delta, uint8_t token) {
+	while(delta > 0x7F) {
+		journal.data[journal.size++] = (delta & 0x7F) | 0x80;
+		delta >>= 7;
+	}
+	journal.data[journal.size++] = delta;
+	journal.data[journal.size++] = token;
+}
+
+static int make_autopilot(uint32_t seed, uint32_t time, const char* name) {
+	uint32_t now = 0, delta;
+
+	srand(seed);
+	journal.size = 0;
+	journal.data[journal.size++] = 'J';
+	journal.data[journal.size++] = JOURNAL_VERSION;
+	for(int i = 0; i < 4; i++) {
+		journal.data[journal.size++] = seed >> (8 * i);
+	}
+	// A button push leaves the splash screen, then the level starts
+	add_entry(1000, JOURNAL_BUTTON);
+	add_entry(2000, JOURNAL_SYNC);
+	now = 3000;
+	// Only along the starting bank, so the frog isn't just run over
+	for(int i = 0; i < 20; i++) {
+		delta = 150 + rand() % 400;
+		if(rand() & 1) {
+			add_entry(delta, JOURNAL_BUTTON + (rand() & 1 ? 0 : 3));
+		} else {
+			add_entry(delta, JOURNAL_JOYSTICK + (rand() & 1 ? 1 : 3));
+		}
+		now += delta;
+	}
+	add_entry(300, 'p');
+	add_entry(1000, 'p');
+	add_entry(200, 'a');
+	now += 1500;
+	add_entry(time > now ? time - now : 0, JOURNAL_END);
+	return write_journal(name) == 0 ? 0 : 1;
+}
+
+static int write_c_file(const char* journal_name, const char* c_name) {
+	FILE* file = fopen(c_name, "w");
+
+	if(!file) {
+		perror(c_name);
+		return 2;
+	}
+	fprintf(file, "/*\n * %s\n *\n * Generated by jnltool from %s - do not edit.\n */\n\n",
+			c_name, journal_name);
+	fprintf(file, "#include <avr/pgmspace.h>\n#include <stdint.h>\n\n");
+	fprintf(file, "const uint8_t journal_replay_data[] PROGMEM = {");
+	for(size_t i = 0; i < journal.size; i++) {
+		fprintf(file, "%s0x%02X,", i % 12 ? " " : "\n\t", journal.data[i]);
+	}
+	fprintf(file, "\n};\n");
+	return fclose(file) == 0 ? 0 : 2;
+}
+
+int main(int argc, char** argv) {
+	int game;
+	uint32_t seed = 1, time = 600000;
+	int i;
+
+	if(argc == 4 && strcmp(argv[1], "extract") == 0) {
+		return extract(1, argv[2], argv[3]);
+	} else if(argc == 6 && strcmp(argv[1], "extract") == 0 && strcmp(argv[2], "-n") == 0 &&
+			(game = atoi(argv[3])) >= 1) {
+		return extract(game, argv[4], argv[5]);
+	} else if(argc == 3 && strcmp(argv[1], "dump") == 0) {
+		return read_journal(argv[2]) == 0 ? dump() : 1;
+	} else if(argc == 4 && strcmp(argv[1], "cfile") == 0) {
+		return read_journal(argv[2]) == 0 ? write_c_file(argv[2], argv[3]) : 1;
+	} else if(argc >= 3 && strcmp(argv[1], "autopilot") == 0) {
+		for(i = 2; i + 2 < argc; i += 2) {
+			if(strcmp(argv[i], "-s") == 0) {
+				seed = strtoul(argv[i + 1], NULL, 0);
+			} else if(strcmp(argv[i], "-t") == 0) {
+				time = strtoul(argv[i + 1], NULL, 0);
+			} else {
+				break;
+			}
+		}
+		if(i + 1 == argc) {
+			return make_autopilot(seed, time, argv[i]);
+		}
+	}
+	fprintf(stderr, "usage: %s extract [-n game] serial.log out.jnl\n"
+			"       %s dump in.jnl\n"
+			"       %s cfile in.jnl journal_replay_data.c\n"
+			"       %s autopilot [-s seed] [-t ms] out.jnl\n", argv[0], argv[0], argv[0], argv[0]);
+	return 2;
+}
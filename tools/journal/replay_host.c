@@ -0,0 +1,399 @@
+/*
+ * replay_host.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Replays an input journal (see journal.h) through the game logic on the
+ * host, following the same rules as main(), next_level() and play_game()
+ * in project.c, with each pass of the game loop taking -l milliseconds of
+ * real time (1 by default). As in the JOURNAL_REPLAY firmware build the
+ * game is played by the journal's clock, so the game played is the same
+ * whatever the period. The real ledmatrix.c is linked with
+ * host/spi_host.c so the bytes that would be sent to the display are
+ * counted (and optionally captured for display/spidecode). Prints a
+ * summary line in the same form as the JOURNAL_REPLAY firmware build:
+ *
+ *     time_ms,loops,score,lives,level,spi_bytes
+ *
+ * With -k the journal is replayed again with a pass taking that many
+ * milliseconds, and the final state of the game (the summary less the
+ * loops and SPI bytes, the frog, riverbank, lanes and logs and the
+ * countdown) compared with the first replay. Exits with status 1 if they
+ * differ.
+ *
+ * Build: gcc -O2 -Wall -DHOST_LEDMATRIX -I../host -I../../CSSE2010-s4411500 \
+ *            -o replay_host replay_host.c ../host/host_stubs.c ../host/spi_host.c \
+ *            ../../CSSE2010-s4411500/ledmatrix.c ../../CSSE2010-s4411500/game.c \
+ *            ../../CSSE2010-s4411500/level.c ../../CSSE2010-s4411500/level_data.c \
+ *            ../../CSSE2010-s4411500/score.c ../../CSSE2010-s4411500/live.c \
+ *            ../../CSSE2010-s4411500/motion.c ../../CSSE2010-s4411500/fieldsim.c \
+ *            ../../CSSE2010-s4411500/lanegen.c ../../CSSE2010-s4411500/autopilot.c \
+ *            ../../CSSE2010-s4411500/statebus.c ../../CSSE2010-s4411500/framebuffer.c \
+ *            ../../CSSE2010-s4411500/compositor.c \
+ *            ../../CSSE2010-s4411500/scrolling_char_display.c
+ * Usage: replay_host [-c capture.spi] [-l ms per pass] [-k ms per pass] journal.jnl
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "journal.h"
+#include "game.h"
+#include "level.h"
+#include "live.h"
+#include "score.h"
+#include "lanegen.h"
+#include "autopilot.h"
+#include "statebus.h"
+#include "compositor.h"
+#include "scrolling_char_display.h"
+#include "ledmatrix.h"
+#include "spi_host.h"
+
+#define MAX_JOURNAL_SIZE 65536
+#define INIT_TIME 30		// seconds, as project.c
+#define ESCAPE_CHAR 27
+
+static uint8_t journal[MAX_JOURNAL_SIZE];
+static size_t journal_size;
+
+// As journal.c
+static size_t position;
+static uint32_t next_time;
+static uint8_t next_token;
+
+// Game time (milliseconds) - the journal's clock - and the countdown (as
+// timer0.c)
+static uint32_t now;
+static uint16_t count;
+static uint8_t counting;
+static uint32_t loops;
+
+// Real time taken by a pass of the game loop (ms), and whether the
+// journal's clock has run since the level started
+static uint32_t loop_ms = 1;
+static uint8_t clock_running;
+
+// What is compared between replays with different periods
+typedef struct {
+	uint32_t time;
+	uint32_t score;
+	uint8_t lives;
+	uint8_t level;
+	uint16_t count;
+	FrogContext frog;
+} FinalState;
+
+static void read_entry(void) {
+	uint32_t delta = 0;
+	uint8_t byte;
+	int shift = 0;
+
+	do {
+		byte = position < journal_size ? journal[position++] : 0;
+		delta |= (uint32_t)(byte & 0x7F) << shift;
+		shift += 7;
+	} while(byte & 0x80);
+	next_time += delta;
+	next_token = position < journal_size ? journal[position++] : JOURNAL_END;
+}
+
+static int16_t replay_next(uint8_t first, uint8_t last) {
+	uint8_t token = next_token;
+	if(token != JOURNAL_END && now >= next_time && token >= first && token <= last) {
+		read_entry();
+		return token;
+	}
+	return JOURNAL_NO_INPUT;
+}
+
+static int replay_finished(void) {
+	return next_token == JOURNAL_END && now >= next_time;
+}
+
+// As journal_replay_target(), with a pass of the loop taking loop_ms
+static uint32_t replay_target(void) {
+	uint32_t target = clock_running ? now + loop_ms : now;
+	uint32_t limit = next_time > now ? next_time : now + 1;
+
+	clock_running = 1;
+	return target > limit ? limit : target;
+}
+
+static void make_move(int8_t move) {
+	switch(move) {
+		case AUTOPILOT_LEFT:
+			move_frog_to_left();
+			break;
+		case AUTOPILOT_FORWARD:
+			move_frog_forward();
+			break;
+		case AUTOPILOT_BACKWARD:
+			move_frog_backward();
+			break;
+		case AUTOPILOT_RIGHT:
+			move_frog_to_right();
+			break;
+	}
+}
+
+// One millisecond passes
+static void tick(void) {
+	now++;
+	if(counting && count > 0) {
+		count--;
+	}
+	spi_host_set_time(now * 1000);
+}
+
+// As replay_play_on() in project.c (there's no rewinding here)
+static void play_on(uint32_t target, uint8_t moving, uint32_t last_autopilot_time) {
+	while(now < target) {
+		tick();
+		if(moving) {
+			update_traffic(1);
+			if(is_frog_dead() || frog_has_reached_riverbank() || count == 0 || no_more_live() ||
+					(autopilot_enabled() && now - last_autopilot_time >= AUTOPILOT_STEP_MS)) {
+				break;
+			}
+		}
+	}
+}
+
+// Returns 0 when the journal has run out
+static int play_level(void) {
+	int16_t button, serial, joystick;
+	int8_t move;
+	char serial_input, escape_sequence_char;
+	uint8_t characters_into_escape_sequence = 0;
+	uint8_t game_paused = 0;
+	uint32_t last_autopilot_time = now;
+
+	redraw_whole_display();
+	put_frog_in_start_position();
+	count = INIT_TIME * 1000;
+
+	// journal_sync()
+	while(next_token != JOURNAL_SYNC && next_token != JOURNAL_END) {
+		read_entry();
+	}
+	if(next_token == JOURNAL_SYNC) {
+		next_time = now;
+		read_entry();
+	}
+	clock_running = 0;
+
+	while(!no_more_live() && !is_riverbank_full()) {
+		loops++;
+		if(replay_finished()) {
+			return 0;
+		}
+		if(!is_frog_dead() && frog_has_reached_riverbank()) {
+			add_to_score(10);
+			(void)queue_scrolling_text_P("+10", COLOUR_LIGHT_YELLOW);
+			if(autopilot_enabled()) {
+				autopilot_frog_crossed();
+			}
+			put_frog_in_start_position();
+			count = INIT_TIME * 1000;
+		}
+		if(count == 0) {
+			kill_frog();
+		}
+		if(is_frog_dead()) {
+			if(autopilot_enabled()) {
+				autopilot_frog_died();
+			}
+			reduce_lives();
+			put_frog_in_start_position();
+		}
+
+		serial_input = -1;
+		escape_sequence_char = -1;
+		button = replay_next(JOURNAL_BUTTON, JOURNAL_BUTTON + 3);
+		if(button != JOURNAL_NO_INPUT) {
+			button -= JOURNAL_BUTTON;
+		} else {
+			serial = replay_next(0, JOURNAL_SERIAL_MAX);
+			if(serial != JOURNAL_NO_INPUT) {
+				serial_input = serial;
+				if(characters_into_escape_sequence == 0 && serial_input == ESCAPE_CHAR) {
+					characters_into_escape_sequence++;
+					serial_input = -1;
+				} else if(characters_into_escape_sequence == 1 && serial_input == '[') {
+					characters_into_escape_sequence++;
+					serial_input = -1;
+				} else if(characters_into_escape_sequence == 2) {
+					escape_sequence_char = serial_input;
+					serial_input = -1;
+					characters_into_escape_sequence = 0;
+				} else {
+					characters_into_escape_sequence = 0;
+				}
+			}
+		}
+		joystick = replay_next(JOURNAL_JOYSTICK, JOURNAL_JOYSTICK + 3);
+		if(joystick != JOURNAL_NO_INPUT) {
+			joystick -= JOURNAL_JOYSTICK;
+		}
+
+		if(button==3 || escape_sequence_char=='D' || serial_input=='L' || serial_input=='l' || joystick==3) {
+			move = 3;
+		} else if(button==2 || escape_sequence_char=='A' || serial_input=='U' || serial_input=='u' || joystick==0) {
+			move = 2;
+		} else if(button==1 || escape_sequence_char=='B' || serial_input=='D' || serial_input=='d' || joystick==2) {
+			move = 1;
+		} else if(button==0 || escape_sequence_char=='C' || serial_input=='R' || serial_input=='r' || joystick==1) {
+			move = 0;
+		} else {
+			move = replay_next(JOURNAL_REPEAT, JOURNAL_REPEAT + 3);
+			if(move != JOURNAL_NO_INPUT) {
+				move -= JOURNAL_REPEAT;
+			}
+		}
+		if(!game_paused) {
+			make_move(move);
+		}
+
+		if(serial_input == 'p' || serial_input == 'P') {
+			game_paused = !game_paused;
+			counting = !game_paused;
+		}
+		if(serial_input == 'a' || serial_input == 'A') {
+			toggle_autopilot();
+		}
+
+		play_on(replay_target(), !game_paused, last_autopilot_time);
+		if(autopilot_enabled() && !game_paused && !is_frog_dead() &&
+				!frog_has_reached_riverbank() && now - last_autopilot_time >= AUTOPILOT_STEP_MS) {
+			last_autopilot_time = now;
+			make_move(autopilot_next_move());
+		}
+		state_dispatch();
+		update_scrolling_display(now);
+		compositor_update();
+	}
+	return 1;
+}
+
+// Replay the whole journal from the start and fill in the final state
+static void replay(FinalState* state) {
+	uint32_t seed;
+	char level_txt[SCROLL_MESSAGE_SIZE];
+
+	// new_game()
+	now = 0;
+	loops = 0;
+	next_time = 0;
+	clock_running = 0;
+	seed = journal[2] | journal[3] << 8 | journal[4] << 16 | (uint32_t)journal[5] << 24;
+	position = JOURNAL_HEADER_SIZE;
+	read_entry();
+	ledmatrix_setup();
+	init_autopilot();
+	init_level();
+	lanegen_set_seed(seed);
+	init_score();
+	init_lives();
+	counting = 1;
+
+	while(!no_more_live()) {
+		// next_level()
+		add_level();
+		if(get_level() > 1) {
+			add_lives();
+		}
+		initialise_game();
+		snprintf(level_txt, sizeof(level_txt), "LEVEL %u", get_level());
+		replace_queued_scrolling_text(level_txt, COLOUR_YELLOW);
+		if(!play_level()) {
+			break;
+		}
+	}
+
+	memset(state, 0, sizeof(*state));
+	state->time = now;
+	state->score = get_score();
+	state->lives = get_lives();
+	state->level = get_level();
+	state->count = count;
+	copy_frog_context(&state->frog);
+}
+
+int main(int argc, char** argv) {
+	const char* journal_name = NULL;
+	const char* capture_name = NULL;
+	FILE* capture = NULL;
+	FILE* file;
+	uint32_t check_ms = 0;
+	FinalState first, second;
+
+	for(int i = 1; i < argc; i++) {
+		if(i + 1 < argc && strcmp(argv[i], "-c") == 0) {
+			capture_name = argv[++i];
+		} else if(i + 1 < argc && strcmp(argv[i], "-l") == 0) {
+			loop_ms = strtoul(argv[++i], NULL, 0);
+		} else if(i + 1 < argc && strcmp(argv[i], "-k") == 0) {
+			check_ms = strtoul(argv[++i], NULL, 0);
+		} else if(argv[i][0] != '-' && !journal_name) {
+			journal_name = argv[i];
+		} else {
+			journal_name = NULL;
+			break;
+		}
+	}
+	if(!journal_name || loop_ms == 0) {
+		fprintf(stderr, "usage: %s [-c capture.spi] [-l ms per pass] [-k ms per pass] "
+				"journal.jnl\n", argv[0]);
+		return 2;
+	}
+	file = fopen(journal_name, "rb");
+	if(!file) {
+		perror(journal_name);
+		return 2;
+	}
+	journal_size = fread(journal, 1, MAX_JOURNAL_SIZE, file);
+	fclose(file);
+	if(journal_size < JOURNAL_HEADER_SIZE || journal[0] != 'J' ||
+			journal[1] != JOURNAL_VERSION) {
+		fprintf(stderr, "%s: not a journal\n", journal_name);
+		return 2;
+	}
+	if(capture_name) {
+		capture = fopen(capture_name, "wb");
+		if(!capture) {
+			perror(capture_name);
+			return 2;
+		}
+		spi_host_capture(capture);
+	}
+
+	replay(&first);
+
+	if(capture) {
+		spi_host_capture(NULL);
+		fclose(capture);
+	}
+	printf("time_ms,loops,score,lives,level,spi_bytes\n");
+	printf("%u,%u,%u,%u,%u,%u\n", now, loops, get_score(), get_lives(), get_level(),
+			spi_host_bytes());
+
+	if(check_ms) {
+		uint32_t first_loops = loops;
+
+		loop_ms = check_ms;
+		replay(&second);
+		if(memcmp(&first, &second, sizeof(first)) != 0) {
+			printf("FAIL - with %u ms per pass the game ended at %u ms, score %u, lives %u, "
+					"level %u, frog at row %d column %d\n", check_ms, second.time,
+					second.score, second.lives, second.level, second.frog.frog_row,
+					second.frog.frog_column);
+			return 1;
+		}
+		printf("same final state with %u ms per pass (%u passes, not %u)\n", check_ms,
+				loops, first_loops);
+	}
+	return 0;
+}
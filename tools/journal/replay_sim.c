@@ -0,0 +1,134 @@
+/*
+ * replay_sim.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Runs a JOURNAL_REPLAY build of the firmware (see journal.h and
+ * run_replay.sh) on a simulated ATmega324A at 8MHz until the journal has
+ * been replayed, counting the bytes sent to the LED matrix. Prints
+ *
+ *     cycles,time_ms,loops,cycles_per_loop,score,lives,level,spi_bytes
+ *
+ * The game loop never waits, so a faster build gets through more passes
+ * of the loop in the same game time - cycles_per_loop is the figure to
+ * compare between builds. score, lives and level should be the same for
+ * every build; if not, the replay didn't follow the recorded game.
+ *
+ * Build: gcc -O2 -Wall -o replay_sim replay_sim.c -lsimavr -lelf
+ * Usage: replay_sim [-c max_seconds] firmware.elf
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_irq.h>
+#include <simavr/avr_uart.h>
+#include <simavr/avr_spi.h>
+
+#define MCU "atmega324a"
+#define FREQUENCY 8000000
+#define DEFAULT_MAX_SECONDS 3600
+#define ESCAPE_CHAR 27
+#define SUMMARY_LENGTH 128
+
+typedef struct {
+	int escape;			// last character was ESC
+	int in_string;		// inside an APC string
+	char summary[SUMMARY_LENGTH];
+	int length;
+	int finished;
+	unsigned long spi_bytes;
+} Replay;
+
+// Watch the UART for the summary: ESC _ R <values> ESC backslash
+static void uart_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+	Replay* replay = param;
+	char c = value;
+
+	(void)irq;
+	if(replay->escape && c == '_') {
+		replay->in_string = 1;
+		replay->length = 0;
+	} else if(replay->escape && c == '\\' && replay->in_string) {
+		replay->in_string = 0;
+		replay->summary[replay->length] = 0;
+		if(replay->summary[0] == 'R') {
+			replay->finished = 1;
+		}
+	} else if(replay->in_string && c != ESCAPE_CHAR && replay->length < SUMMARY_LENGTH - 1) {
+		replay->summary[replay->length++] = c;
+	}
+	replay->escape = (c == ESCAPE_CHAR);
+}
+
+static void spi_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+	Replay* replay = param;
+
+	(void)irq;
+	(void)value;
+	replay->spi_bytes++;
+}
+
+int main(int argc, char** argv) {
+	const char* firmware_name = NULL;
+	double max_seconds = DEFAULT_MAX_SECONDS;
+	elf_firmware_t firmware;
+	Replay replay;
+	avr_t* avr;
+	uint32_t flags;
+	unsigned long time_ms, loops, score;
+	unsigned int lives, level;
+	int state;
+
+	if(argc == 2) {
+		firmware_name = argv[1];
+	} else if(argc == 4 && strcmp(argv[1], "-c") == 0) {
+		max_seconds = atof(argv[2]);
+		firmware_name = argv[3];
+	} else {
+		fprintf(stderr, "usage: %s [-c max_seconds] firmware.elf\n", argv[0]);
+		return 2;
+	}
+
+	memset(&firmware, 0, sizeof(firmware));
+	if(elf_read_firmware(firmware_name, &firmware) != 0) {
+		fprintf(stderr, "%s: can't read firmware\n", firmware_name);
+		return 2;
+	}
+	avr = avr_make_mcu_by_name(MCU);
+	if(!avr) {
+		fprintf(stderr, "simavr doesn't support the " MCU "\n");
+		return 2;
+	}
+	avr_init(avr);
+	firmware.frequency = FREQUENCY;
+	avr_load_firmware(avr, &firmware);
+
+	memset(&replay, 0, sizeof(replay));
+	avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+	flags &= ~AVR_UART_FLAG_STDIO;
+	avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT),
+			uart_output, &replay);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ('0'), SPI_IRQ_OUTPUT),
+			spi_output, &replay);
+
+	do {
+		state = avr_run(avr);
+	} while(state != cpu_Done && state != cpu_Crashed && !replay.finished &&
+			avr->cycle < max_seconds * FREQUENCY);
+
+	if(!replay.finished || sscanf(replay.summary, "R%lu,%lu,%lu,%u,%u", &time_ms, &loops,
+			&score, &lives, &level) != 5) {
+		fprintf(stderr, "%s: replay didn't finish (%s after %llu cycles)\n", firmware_name,
+				state == cpu_Crashed ? "crashed" : "stopped", (unsigned long long)avr->cycle);
+		return 1;
+	}
+	printf("cycles,time_ms,loops,cycles_per_loop,score,lives,level,spi_bytes\n");
+	printf("%llu,%lu,%lu,%.1f,%lu,%u,%u,%lu\n", (unsigned long long)avr->cycle, time_ms, loops,
+			loops ? (double)avr->cycle / loops : 0.0, score, lives, level, replay.spi_bytes);
+	return 0;
+}
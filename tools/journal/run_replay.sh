@@ -0,0 +1,51 @@
+#!/bin/sh
+#
+# run_replay.sh
+#
+# Written by Wu Lai Yin (Peter)
+#
+# Replays an input journal against the firmware in the current tree, both
+# under simavr (cycles and SPI bytes for the real build) and on the host
+# (SPI bytes only). Run it on each build to be compared with the same
+# journal. The host replay is also played again with a slow pass of the
+# game loop (16 ms) to check the same game is played.
+#
+# Needs avr-gcc (avr-libc) and simavr (libsimavr and its headers).
+#
+# Usage: run_replay.sh game.jnl
+
+set -e
+
+if [ $# -ne 1 ]; then
+	echo "usage: $0 game.jnl" >&2
+	exit 2
+fi
+
+JOURNAL_DIR=$(cd "$(dirname "$0")" && pwd)
+SRC_DIR="$JOURNAL_DIR/../../CSSE2010-s4411500"
+HOST_DIR="$JOURNAL_DIR/../host"
+BUILD_DIR="$JOURNAL_DIR/build"
+
+mkdir -p "$BUILD_DIR"
+
+gcc -O2 -Wall -I"$SRC_DIR" -o "$BUILD_DIR/jnltool" "$JOURNAL_DIR/jnltool.c"
+"$BUILD_DIR/jnltool" cfile "$1" "$BUILD_DIR/journal_replay_data.c"
+
+# Same flags as Debug/Makefile
+avr-gcc -funsigned-char -funsigned-bitfields -O1 -ffunction-sections \
+	-fdata-sections -fpack-struct -fshort-enums -Wall -std=gnu99 \
+	-mmcu=atmega324a -DJOURNAL_REPLAY -I"$SRC_DIR" -Wl,--gc-sections \
+	-o "$BUILD_DIR/replay.elf" "$SRC_DIR"/*.c "$BUILD_DIR/journal_replay_data.c" -lm
+
+gcc -O2 -Wall -o "$BUILD_DIR/replay_sim" "$JOURNAL_DIR/replay_sim.c" -lsimavr -lelf
+gcc -O2 -Wall -DHOST_LEDMATRIX -I"$HOST_DIR" -I"$SRC_DIR" -o "$BUILD_DIR/replay_host" \
+	"$JOURNAL_DIR/replay_host.c" "$HOST_DIR/host_stubs.c" "$HOST_DIR/spi_host.c" \
+	"$SRC_DIR/ledmatrix.c" "$SRC_DIR/game.c" "$SRC_DIR/level.c" "$SRC_DIR/level_data.c" \
+	"$SRC_DIR/score.c" "$SRC_DIR/live.c" "$SRC_DIR/motion.c" "$SRC_DIR/fieldsim.c" \
+	"$SRC_DIR/lanegen.c" "$SRC_DIR/autopilot.c" "$SRC_DIR/statebus.c" \
+	"$SRC_DIR/framebuffer.c" "$SRC_DIR/compositor.c" "$SRC_DIR/scrolling_char_display.c"
+
+echo "simavr:"
+"$BUILD_DIR/replay_sim" "$BUILD_DIR/replay.elf"
+echo "host:"
+"$BUILD_DIR/replay_host" -k 16 "$1"
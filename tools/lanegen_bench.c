@@ -0,0 +1,169 @@
+/*
+ * lanegen_bench.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Host benchmark for the procedural lane generator. Generates and checks
+ * patterns for a range of levels and seeds using the same lanegen.c,
+ * fieldsim.c and motion.c as the firmware and reports how many levels are
+ * generated and verified per second, how many candidates each needed and
+ * how often generation gave up.
+ *
+ * First it checks that candidates are really checked: a fixed candidate
+ * with no logs (so the river can't be crossed) must be rejected and one
+ * with solid logs and empty lanes accepted. With rows fast enough that
+ * some random candidates are unsolvable, a level must be found which was
+ * only generated after a rejected candidate (and what it gave must be
+ * solvable), and rows too fast to cross must make generation give up
+ * and leave the patterns alone. The exit status is 1 if any of these
+ * fail.
+ *
+ * Build: gcc -O2 -Wall -I../CSSE2010-s4411500 -o lanegen_bench lanegen_bench.c \
+ *            ../CSSE2010-s4411500/lanegen.c ../CSSE2010-s4411500/fieldsim.c \
+ *            ../CSSE2010-s4411500/motion.c
+ * Usage: lanegen_bench [games]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "lanegen.h"
+#include "motion.h"
+
+#define FIRST_LEVEL 6
+#define LAST_LEVEL 30
+#define RIVERBANK 0xDDDD
+
+// Periods (ms) of rows fast enough that some candidates are unsolvable,
+// and of rows too fast for any to be solvable
+#define RETRY_PERIOD 60
+#define HOPELESS_PERIOD 40
+#define CHECK_LEVEL 20
+#define CHECK_SEEDS 2000
+
+static void set_speeds(RowMotion motion[5], uint16_t period) {
+	for(uint8_t row = 0; row < 5; row++) {
+		motion_init(&motion[row], period + row * 37, 1, 0, 1, (row & 1) ? -1 : 1);
+	}
+}
+
+// Check that the generator rejects unsolvable candidates and retries.
+// Returns the number of failures.
+static int check_rejection(void) {
+	RowMotion motion[5];
+	uint64_t lanes[3];
+	uint32_t logs[2];
+	uint64_t patterns[5];
+	int failures = 0;
+	long seed;
+
+	set_speeds(motion, 1000);
+	// No logs - nothing can get over the river
+	patterns[0] = patterns[1] = patterns[2] = 0;
+	patterns[3] = patterns[4] = 0;
+	if(lanegen_solvable(motion, RIVERBANK, patterns)) {
+		printf("FAIL: a river with no logs was accepted\n");
+		failures++;
+	}
+	// No vehicles and solid logs - every hole can be reached
+	patterns[3] = patterns[4] = 0xFFFFFFFFUL;
+	if(!lanegen_solvable(motion, RIVERBANK, patterns)) {
+		printf("FAIL: an empty road and solid logs were rejected\n");
+		failures++;
+	}
+
+	// Fast rows - find a level which needed more than one candidate
+	set_speeds(motion, RETRY_PERIOD);
+	for(seed = 0; seed < CHECK_SEEDS; seed++) {
+		lanegen_set_seed(0x12345678UL + seed * 7919);
+		if(lanegen_generate(CHECK_LEVEL, motion, RIVERBANK, lanes, logs) &&
+				lanegen_attempts() > 1) {
+			break;
+		}
+	}
+	if(seed == CHECK_SEEDS) {
+		printf("FAIL: no level at %u ms periods was generated after a rejection\n",
+				RETRY_PERIOD);
+		failures++;
+	} else {
+		patterns[0] = lanes[0];
+		patterns[1] = lanes[1];
+		patterns[2] = lanes[2];
+		patterns[3] = logs[0];
+		patterns[4] = logs[1];
+		if(!lanegen_solvable(motion, RIVERBANK, patterns)) {
+			printf("FAIL: the patterns after a retry aren't solvable\n");
+			failures++;
+		} else {
+			printf("retry: seed %ld accepted candidate %u at %u ms periods\n", seed,
+					lanegen_attempts(), RETRY_PERIOD);
+		}
+	}
+
+	// Rows too fast to cross - every candidate fails and nothing changes
+	set_speeds(motion, HOPELESS_PERIOD);
+	lanes[0] = lanes[1] = lanes[2] = 0x1234;
+	logs[0] = logs[1] = 0x5678;
+	lanegen_set_seed(0x12345678UL);
+	if(lanegen_generate(CHECK_LEVEL, motion, RIVERBANK, lanes, logs) ||
+			lanegen_attempts() != LANEGEN_MAX_ATTEMPTS || lanes[0] != 0x1234 ||
+			lanes[1] != 0x1234 || lanes[2] != 0x1234 || logs[0] != 0x5678 ||
+			logs[1] != 0x5678) {
+		printf("FAIL: generation at %u ms periods didn't give up cleanly\n", HOPELESS_PERIOD);
+		failures++;
+	}
+	return failures;
+}
+
+int main(int argc, char** argv) {
+	long games = (argc > 1) ? atol(argv[1]) : 2000;
+	RowMotion motion[5];
+	uint64_t lanes[3];
+	uint32_t logs[2];
+	long generated = 0, failed = 0, candidates = 0;
+	long attempts_histogram[LANEGEN_MAX_ATTEMPTS + 1] = { 0 };
+	struct timespec start, end;
+	int failures = check_rejection();
+
+	// Speeds of the last level in the table (levels/level5.txt)
+	motion_init(&motion[0], 1500, 1, 0, 1, 1);
+	motion_init(&motion[1], 1350, 1, 0, 1, -1);
+	motion_init(&motion[2], 1050, 1, 0, 1, 1);
+	motion_init(&motion[3], 1150, 1, 0, 1, -1);
+	motion_init(&motion[4], 1400, 1, 0, 1, 1);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(long game = 0; game < games; game++) {
+		lanegen_set_seed(0x12345678UL + game * 7919);
+		for(uint8_t level = FIRST_LEVEL; level <= LAST_LEVEL; level++) {
+			if(lanegen_generate(level, motion, RIVERBANK, lanes, logs)) {
+				generated++;
+				attempts_histogram[lanegen_attempts()]++;
+			} else {
+				failed++;
+			}
+			candidates += lanegen_attempts();
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	long levels = generated + failed;
+	printf("levels %ld (%d-%d x %ld seeds) in %.3f s\n", levels, FIRST_LEVEL, LAST_LEVEL,
+			games, seconds);
+	printf("generated and verified: %ld (%.1f%%), gave up: %ld\n", generated,
+			100.0 * generated / levels, failed);
+	printf("levels per second: %.0f, candidates per second: %.0f\n", levels / seconds,
+			candidates / seconds);
+	printf("mean candidates per level: %.2f\n", (double)candidates / levels);
+	for(int i = 1; i <= LANEGEN_MAX_ATTEMPTS; i++) {
+		printf("  %d candidate%s: %ld\n", i, i == 1 ? " " : "s", attempts_histogram[i]);
+	}
+	if(failures) {
+		printf("%d rejection check%s failed\n", failures, failures == 1 ? "" : "s");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,372 @@
+/*
+ * levelc.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Level compiler. Reads human readable level files (see
+ * CSSE2010-s4411500/levels/) and writes level_data.c and level_data.h
+ * containing the packed PROGMEM level table read by level.c.
+ *
+ * Build: gcc -O2 -Wall -o levelc levelc.c
+ * Usage: levelc -o <output dir> level1.txt level2.txt ...
+ *
+ * Level file format - one line per row of the game field, from the top
+ * (riverbank) down to the first traffic lane. Blank lines and lines
+ * starting with # are ignored.
+ *
+ *     bank                          <pattern>
+ *     log   <left|right> <speed> <accel> <colour> <pattern>     (2 lines)
+ *     lane  <left|right> <speed> <accel> <colour> <pattern>     (3 lines)
+ *
+ * speed is "steps/period": the row moves that many columns every period
+ * milliseconds, e.g. 1/1100 or 3/2000. accel is 0 for a constant speed or
+ * "+n:limit" / "-n:limit" to add n to the steps count every 1024ms until
+ * it reaches limit. colour is one of the names in pixel_colour.h without
+ * the COLOUR_ prefix. A pattern is drawn as it appears on the display at
+ * the start of the level: the first character is column 0 (left hand
+ * side), '#' is a vehicle, a log or a riverbank edge and '.' is empty.
+ * Lane patterns may be 1 to 64 characters wide, log patterns 1 to 32 and
+ * the riverbank exactly 16.
+ *
+ * Packed record for each level (multi-byte values are little endian):
+ *     riverbank mask                 2 bytes
+ *     5 x row (lanes 0-2 then log channels 0-1, i.e. bottom to top)
+ *         direction/width            1 byte (bit 7 set = moves right,
+ *                                            bits 0-6 = width in bits)
+ *         period                     2 bytes
+ *         steps per period           1 byte
+ *         acceleration               1 byte (signed)
+ *         steps limit                1 byte
+ *         colour                     1 byte
+ *         pattern                    (width + 7) / 8 bytes, bit 0 first
+ *
+ * After writing the table the compiler decodes every record again,
+ * checks it matches the source and reports the flash footprint and host
+ * decode time of each level.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#define MAX_LEVELS 64
+#define MAX_RECORD 80
+#define NUM_ROWS 5		// 3 traffic lanes then 2 log channels
+#define NUM_LANES 3
+#define MAX_LANE_WIDTH 64
+#define MAX_LOG_WIDTH 32
+#define RIVERBANK_WIDTH 16
+
+typedef struct {
+	uint64_t pattern;
+	uint16_t period;
+	uint8_t rate;
+	int8_t accel;
+	uint8_t rate_limit;
+	uint8_t width;
+	uint8_t right;
+	char colour[16];
+} Row;
+
+typedef struct {
+	const char* source;
+	uint16_t riverbank;
+	Row rows[NUM_ROWS];
+	uint8_t record[MAX_RECORD];
+	int record_size;
+} Level;
+
+static const struct {
+	const char* name;
+	uint8_t value;
+} colours[] = {
+	{ "BLACK", 0x00 }, { "RED", 0x0F }, { "GREEN", 0xF0 }, { "YELLOW", 0xDF },
+	{ "ORANGE", 0x3C }, { "LIGHT_ORANGE", 0x13 }, { "LIGHT_YELLOW", 0x35 },
+	{ "LIGHT_GREEN", 0x11 }
+};
+#define NUM_COLOURS (sizeof(colours) / sizeof(colours[0]))
+
+static Level levels[MAX_LEVELS];
+
+static void fail(const char* file, int line, const char* message) {
+	fprintf(stderr, "%s:%d: %s\n", file, line, message);
+	exit(1);
+}
+
+static int colour_value(const char* name) {
+	for(unsigned i = 0; i < NUM_COLOURS; i++) {
+		if(strcmp(colours[i].name, name) == 0) {
+			return colours[i].value;
+		}
+	}
+	return -1;
+}
+
+// Convert a '#'/'.' pattern into bits. Returns the width or -1 if invalid.
+static int parse_pattern(const char* text, uint64_t* bits, int max_width) {
+	int width = 0;
+	*bits = 0;
+	for(; *text && !isspace((unsigned char)*text); text++, width++) {
+		if(width == max_width || (*text != '#' && *text != '.')) {
+			return -1;
+		}
+		if(*text == '#') {
+			*bits |= (uint64_t)1 << width;
+		}
+	}
+	return width;
+}
+
+static void parse_level(const char* path, Level* level) {
+	FILE* f = fopen(path, "r");
+	char line[256], kind[16], direction[16], accel[16], colour[16], pattern[128];
+	int line_number = 0, banks = 0, logs = 0, lanes = 0;
+	unsigned rate, period;
+
+	if(!f) {
+		perror(path);
+		exit(1);
+	}
+	level->source = path;
+	while(fgets(line, sizeof(line), f)) {
+		line_number++;
+		if(line[0] == '#' || sscanf(line, "%15s", kind) != 1) {
+			continue;
+		}
+		if(strcmp(kind, "bank") == 0) {
+			uint64_t bits;
+			if(sscanf(line, "%*s %127s", pattern) != 1 ||
+					parse_pattern(pattern, &bits, RIVERBANK_WIDTH) != RIVERBANK_WIDTH) {
+				fail(path, line_number, "riverbank must be 16 characters of # and .");
+			}
+			level->riverbank = (uint16_t)bits;
+			banks++;
+			continue;
+		}
+		int is_log = (strcmp(kind, "log") == 0);
+		if(!is_log && strcmp(kind, "lane") != 0) {
+			fail(path, line_number, "expected bank, log or lane");
+		}
+		if(sscanf(line, "%*s %15s %u/%u %15s %15s %127s", direction, &rate, &period,
+				accel, colour, pattern) != 6) {
+			fail(path, line_number, "expected <direction> <speed> <accel> <colour> <pattern>");
+		}
+		// Rows are listed top down; the record stores them bottom up
+		Row* row;
+		if(is_log) {
+			if(logs == 2) {
+				fail(path, line_number, "too many log channels");
+			}
+			row = &level->rows[NUM_ROWS - 1 - logs++];
+		} else {
+			if(lanes == NUM_LANES) {
+				fail(path, line_number, "too many traffic lanes");
+			}
+			row = &level->rows[NUM_LANES - 1 - lanes++];
+		}
+		if(strcmp(direction, "left") && strcmp(direction, "right")) {
+			fail(path, line_number, "direction must be left or right");
+		}
+		row->right = (strcmp(direction, "right") == 0);
+		if(period == 0 || period > 0xFFFF) {
+			fail(path, line_number, "period must be 1 to 65535 ms");
+		}
+		row->period = period;
+		if(rate == 0 || rate > 0xFF) {
+			fail(path, line_number, "steps must be 1 to 255");
+		}
+		row->rate = rate;
+		row->accel = 0;
+		row->rate_limit = rate;
+		if(strcmp(accel, "0") != 0) {
+			int delta, limit;
+			if(sscanf(accel, "%d:%d", &delta, &limit) != 2 || delta == 0 ||
+					delta < -127 || delta > 127 || limit < 1 || limit > 0xFF ||
+					(delta > 0) != (limit > (int)rate)) {
+				fail(path, line_number, "accel must be 0 or +n:limit / -n:limit");
+			}
+			row->accel = delta;
+			row->rate_limit = limit;
+		}
+		if(colour_value(colour) < 0) {
+			fail(path, line_number, "unknown colour");
+		}
+		strcpy(row->colour, colour);
+		int width = parse_pattern(pattern, &row->pattern, is_log ? MAX_LOG_WIDTH : MAX_LANE_WIDTH);
+		if(width <= 0) {
+			fail(path, line_number, "invalid or too wide pattern");
+		}
+		row->width = width;
+	}
+	fclose(f);
+	if(banks != 1 || logs != 2 || lanes != NUM_LANES) {
+		fail(path, line_number, "need 1 bank, 2 log and 3 lane rows");
+	}
+}
+
+static void pack_level(Level* level) {
+	uint8_t* p = level->record;
+	*p++ = level->riverbank & 0xFF;
+	*p++ = level->riverbank >> 8;
+	for(int i = 0; i < NUM_ROWS; i++) {
+		Row* row = &level->rows[i];
+		*p++ = (row->right ? 0x80 : 0) | row->width;
+		*p++ = row->period & 0xFF;
+		*p++ = row->period >> 8;
+		*p++ = row->rate;
+		*p++ = (uint8_t)row->accel;
+		*p++ = row->rate_limit;
+		*p++ = colour_value(row->colour);
+		for(int b = 0; b < (row->width + 7) / 8; b++) {
+			*p++ = (row->pattern >> (8 * b)) & 0xFF;
+		}
+	}
+	level->record_size = p - level->record;
+}
+
+// Mirror of the decoding in level.c. Returns the number of bytes consumed.
+static int decode_level(const uint8_t* record, uint16_t* riverbank, Row* rows) {
+	const uint8_t* p = record;
+	*riverbank = p[0] | (p[1] << 8);
+	p += 2;
+	for(int i = 0; i < NUM_ROWS; i++) {
+		uint8_t width_dir = *p++;
+		rows[i].right = (width_dir & 0x80) != 0;
+		rows[i].width = width_dir & 0x7F;
+		rows[i].period = p[0] | (p[1] << 8);
+		rows[i].rate = p[2];
+		rows[i].accel = (int8_t)p[3];
+		rows[i].rate_limit = p[4];
+		p += 6;
+		rows[i].pattern = 0;
+		for(uint8_t b = 0; b < rows[i].width; b += 8) {
+			rows[i].pattern |= (uint64_t)*p++ << b;
+		}
+	}
+	return p - record;
+}
+
+static void verify_level(const Level* level) {
+	uint16_t riverbank;
+	Row rows[NUM_ROWS];
+	if(decode_level(level->record, &riverbank, rows) != level->record_size ||
+			riverbank != level->riverbank) {
+		fail(level->source, 0, "decoded record does not match");
+	}
+	for(int i = 0; i < NUM_ROWS; i++) {
+		if(rows[i].pattern != level->rows[i].pattern || rows[i].width != level->rows[i].width ||
+				rows[i].period != level->rows[i].period || rows[i].right != level->rows[i].right ||
+				rows[i].rate != level->rows[i].rate || rows[i].accel != level->rows[i].accel ||
+				rows[i].rate_limit != level->rows[i].rate_limit) {
+			fail(level->source, 0, "decoded row does not match");
+		}
+	}
+}
+
+static double decode_time_ns(const Level* level) {
+	const int iterations = 1000000;
+	uint16_t riverbank;
+	Row rows[NUM_ROWS];
+	volatile uint64_t sink = 0;
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(int i = 0; i < iterations; i++) {
+		decode_level(level->record, &riverbank, rows);
+		sink += rows[i % NUM_ROWS].pattern;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	(void)sink;
+	return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / iterations;
+}
+
+static FILE* open_output(const char* dir, const char* name) {
+	char path[512];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	FILE* f = fopen(path, "w");
+	if(!f) {
+		perror(path);
+		exit(1);
+	}
+	return f;
+}
+
+static void write_output(const char* dir, int num_levels) {
+	FILE* h = open_output(dir, "level_data.h");
+	fprintf(h, "/*\n * level_data.h\n *\n * Generated by tools/levelc - do not edit.\n */\n\n");
+	fprintf(h, "#ifndef LEVEL_DATA_H_\n#define LEVEL_DATA_H_\n\n#include <stdint.h>\n\n");
+	fprintf(h, "#define NUM_LEVEL_DESCRIPTORS %d\n\n", num_levels);
+	fprintf(h, "// Packed level records (see tools/levelc.c for the format) and the\n");
+	fprintf(h, "// offset of each level's record in the table. Both live in flash.\n");
+	fprintf(h, "extern const uint8_t level_table[];\n");
+	fprintf(h, "extern const uint16_t level_offsets[NUM_LEVEL_DESCRIPTORS];\n\n");
+	fprintf(h, "#endif /* LEVEL_DATA_H_ */\n");
+	fclose(h);
+
+	FILE* c = open_output(dir, "level_data.c");
+	fprintf(c, "/*\n * level_data.c\n *\n * Generated by tools/levelc - do not edit.\n */\n\n");
+	fprintf(c, "#include <avr/pgmspace.h>\n\n#include \"level_data.h\"\n#include \"pixel_colour.h\"\n\n");
+	fprintf(c, "const uint8_t level_table[] PROGMEM = {\n");
+	int offset = 0;
+	for(int l = 0; l < num_levels; l++) {
+		const Level* level = &levels[l];
+		const uint8_t* p = level->record;
+		const char* name = strrchr(level->source, '/') ? strrchr(level->source, '/') + 1 : level->source;
+		fprintf(c, "\t// Level %d (%s), %d bytes\n", l + 1, name, level->record_size);
+		fprintf(c, "\t0x%02X, 0x%02X,\n", p[0], p[1]);
+		p += 2;
+		for(int i = 0; i < NUM_ROWS; i++) {
+			const Row* row = &level->rows[i];
+			fprintf(c, "\t0x%02X, 0x%02X, 0x%02X, 0x%02X, 0x%02X, 0x%02X, COLOUR_%s,",
+					p[0], p[1], p[2], p[3], p[4], p[5], row->colour);
+			p += 7;
+			for(int b = 0; b < (row->width + 7) / 8; b++) {
+				fprintf(c, " 0x%02X,", *p++);
+			}
+			fprintf(c, "\n");
+		}
+		offset += level->record_size;
+	}
+	fprintf(c, "};\n\nconst uint16_t level_offsets[NUM_LEVEL_DESCRIPTORS] PROGMEM = {");
+	offset = 0;
+	for(int l = 0; l < num_levels; l++) {
+		fprintf(c, "%s%d", l ? ", " : " ", offset);
+		offset += levels[l].record_size;
+	}
+	fprintf(c, " };\n");
+	fclose(c);
+}
+
+int main(int argc, char** argv) {
+	const char* out_dir = ".";
+	int num_levels = 0;
+
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			out_dir = argv[++i];
+		} else if(num_levels < MAX_LEVELS) {
+			parse_level(argv[i], &levels[num_levels]);
+			pack_level(&levels[num_levels]);
+			verify_level(&levels[num_levels]);
+			num_levels++;
+		}
+	}
+	if(num_levels == 0) {
+		fprintf(stderr, "usage: %s -o <output dir> level1.txt level2.txt ...\n", argv[0]);
+		return 2;
+	}
+	write_output(out_dir, num_levels);
+
+	int total = 2 * num_levels;	// offset table
+	printf("%-5s %-24s %6s %12s\n", "level", "source", "bytes", "decode (ns)");
+	for(int l = 0; l < num_levels; l++) {
+		printf("%-5d %-24s %6d %12.1f\n", l + 1, levels[l].source, levels[l].record_size,
+				decode_time_ns(&levels[l]));
+		total += levels[l].record_size;
+	}
+	printf("total flash: %d bytes\n", total);
+	return 0;
+}
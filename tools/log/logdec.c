@@ -0,0 +1,254 @@
+/*
+ * logdec.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Decoder for the binary event log (see log.h). Reads a capture of the
+ * serial port from a LOG_ENABLED build (a file, or stdin - e.g. from the
+ * serial device or the simavr UART) and prints each event with its format
+ * from log_events.h, which is built into this tool. The formats are
+ * checked against the argument types at start-up.
+ *
+ *   logdec [-t] [capture]
+ *       Print the events, one per line. With -t the terminal text around
+ *       them is passed through too (without its escape sequences, which
+ *       would otherwise move the cursor about).
+ *   logdec -l
+ *       List the events - number, name, argument bytes and format.
+ *
+ * Build: gcc -O2 -Wall -I../../CSSE2010-s4411500 -o logdec logdec.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "log.h"
+
+#define MAX_ARGS 3
+#define ESCAPE_CHAR 27
+
+typedef struct {
+	const char* name;
+	const char* format;
+	uint8_t num_args;
+	uint8_t size[MAX_ARGS];
+	uint8_t is_signed[MAX_ARGS];
+} Event;
+
+// The same list of events as the firmware's. ((type)-1 < 0) is true for
+// the signed types.
+#define ARG(t) sizeof(t)
+#define SIGNED(t) ((t)-1 < 0)
+#define LOG_EVENT0(name, format) {#name, format, 0, {0}, {0}},
+#define LOG_EVENT1(name, format, t1) {#name, format, 1, {ARG(t1)}, {SIGNED(t1)}},
+#define LOG_EVENT2(name, format, t1, t2) \
+	{#name, format, 2, {ARG(t1), ARG(t2)}, {SIGNED(t1), SIGNED(t2)}},
+#define LOG_EVENT3(name, format, t1, t2, t3) \
+	{#name, format, 3, {ARG(t1), ARG(t2), ARG(t3)}, {SIGNED(t1), SIGNED(t2), SIGNED(t3)}},
+static const Event events[LOG_NUM_EVENTS] = {
+#include "log_events.h"
+};
+
+// Find the next conversion in a format from *position, leaving *position
+// just after it. The conversion (without any length modifier) is copied
+// to spec. Returns the conversion character, or 0 if there are no more.
+static char next_conversion(const char* format, size_t* position, char* spec, size_t spec_size) {
+	const char* p = format + *position;
+	size_t length = 0;
+
+	while(*p && !(p[0] == '%' && p[1] != '%')) {
+		p += (p[0] == '%') ? 2 : 1;
+	}
+	if(!*p) {
+		*position = p - format;
+		return 0;
+	}
+	spec[length++] = *p++;
+	while(*p && strchr("-+ #0123456789.", *p) && length < spec_size - 1) {
+		spec[length++] = *p++;
+	}
+	while(*p && strchr("hlLqjzt", *p)) {
+		p++;
+	}
+	spec[length] = 0;
+	*position = p - format + (*p ? 1 : 0);
+	return *p;
+}
+
+// Check that each format has a conversion for each argument and only
+// integer conversions. Returns 0 if they're all right.
+static int check_events(void) {
+	char spec[32];
+	int errors = 0;
+
+	for(int i = 0; i < LOG_NUM_EVENTS; i++) {
+		size_t position = 0;
+		int count = 0;
+		char conversion;
+		while((conversion = next_conversion(events[i].format, &position, spec,
+				sizeof(spec)))) {
+			if(!strchr("diouxXc", conversion)) {
+				fprintf(stderr, "%s: %%%c can't be used in a log format\n", events[i].name,
+						conversion);
+				errors++;
+			}
+			count++;
+		}
+		if(count != events[i].num_args) {
+			fprintf(stderr, "%s: format has %d conversions for %d arguments\n",
+					events[i].name, count, events[i].num_args);
+			errors++;
+		}
+	}
+	return errors;
+}
+
+// Print an event's format with the given argument values
+static void print_event(const Event* event, const int64_t* values) {
+	const char* p = event->format;
+	char spec[40];
+	char conversion;
+	int arg = 0;
+
+	printf("[%s] ", event->name);
+	while(*p) {
+		if(p[0] != '%') {
+			putchar(*p++);
+		} else if(p[1] == '%') {
+			putchar('%');
+			p += 2;
+		} else {
+			size_t position = p - event->format;
+			size_t length;
+			conversion = next_conversion(event->format, &position, spec, sizeof(spec) - 3);
+			p = event->format + position;
+			length = strlen(spec);
+			if(conversion == 'c') {
+				spec[length++] = 'c';
+				spec[length] = 0;
+				printf(spec, (int)values[arg]);
+			} else {
+				// Every argument is printed as a long long
+				spec[length++] = 'l';
+				spec[length++] = 'l';
+				spec[length++] = conversion;
+				spec[length] = 0;
+				if(conversion == 'd' || conversion == 'i') {
+					printf(spec, (long long)values[arg]);
+				} else {
+					printf(spec, (unsigned long long)values[arg]);
+				}
+			}
+			arg++;
+		}
+	}
+	putchar('\n');
+}
+
+static void list_events(void) {
+	for(int i = 0; i < LOG_NUM_EVENTS; i++) {
+		int bytes = 2;
+		for(int arg = 0; arg < events[i].num_args; arg++) {
+			bytes += events[i].size[arg];
+		}
+		printf("%3d  %-16s %2d bytes  \"%s\"\n", i, events[i].name, bytes, events[i].format);
+	}
+}
+
+// Read an event's arguments (least significant byte first). Returns 0 if
+// the capture ends part way through.
+static int read_args(FILE* in, const Event* event, int64_t* values) {
+	for(int arg = 0; arg < event->num_args; arg++) {
+		uint64_t value = 0;
+		for(int byte = 0; byte < event->size[arg]; byte++) {
+			int c = fgetc(in);
+			if(c == EOF) {
+				return 0;
+			}
+			value |= (uint64_t)c << (8 * byte);
+		}
+		if(event->is_signed[arg] && event->size[arg] < 8 &&
+				(value & ((uint64_t)1 << (8 * event->size[arg] - 1)))) {
+			value |= ~(uint64_t)0 << (8 * event->size[arg]);
+		}
+		values[arg] = (int64_t)value;
+	}
+	return 1;
+}
+
+int main(int argc, char** argv) {
+	const char* capture_name = NULL;
+	int show_text = 0;
+	int at_line_start = 1;
+	int in_escape = 0;
+	unsigned long decoded = 0, bad = 0;
+	FILE* in = stdin;
+	int c;
+
+	if(check_events()) {
+		return 1;
+	}
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "-l") == 0) {
+			list_events();
+			return 0;
+		} else if(strcmp(argv[i], "-t") == 0) {
+			show_text = 1;
+		} else if(argv[i][0] != '-' && !capture_name) {
+			capture_name = argv[i];
+		} else {
+			fprintf(stderr, "usage: %s [-t] [capture] | -l\n", argv[0]);
+			return 2;
+		}
+	}
+	if(capture_name && !(in = fopen(capture_name, "rb"))) {
+		perror(capture_name);
+		return 1;
+	}
+
+	while((c = fgetc(in)) != EOF) {
+		if(c == LOG_FRAME_START) {
+			int64_t values[MAX_ARGS];
+			int event = fgetc(in);
+			if(event == EOF) {
+				break;
+			}
+			if(!at_line_start) {
+				putchar('\n');
+				at_line_start = 1;
+			}
+			if(event >= LOG_NUM_EVENTS) {
+				// Not one of ours - carry on from the next frame
+				printf("[?] unknown event %d\n", event);
+				bad++;
+				continue;
+			}
+			if(!read_args(in, &events[event], values)) {
+				printf("[%s] (capture ends part way through)\n", events[event].name);
+				bad++;
+				break;
+			}
+			print_event(&events[event], values);
+			decoded++;
+		} else if(show_text) {
+			// Terminal text, without escape sequences (ESC [ ... letter)
+			if(c == ESCAPE_CHAR) {
+				in_escape = 1;
+			} else if(in_escape) {
+				if(c != '[' && (c < '0' || c > '?')) {
+					in_escape = 0;
+				}
+			} else if(c == '\n' || (c >= ' ' && c < 0x7F)) {
+				putchar(c);
+				at_line_start = (c == '\n');
+			}
+		}
+	}
+	if(!at_line_start) {
+		putchar('\n');
+	}
+	fprintf(stderr, "%lu events decoded, %lu bad\n", decoded, bad);
+	return 0;
+}
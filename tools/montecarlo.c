@@ -0,0 +1,418 @@
+/*
+ * montecarlo.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Host tool for tuning the difficulty of the levels. Plays thousands of
+ * seeded games with a simulated player, using the real game logic
+ * (game.c, level.c, score.c, live.c and the modules they use) linked
+ * against the do-nothing hardware in host/. For each level it reports
+ * how many games got there (the survival curve), how long crossings
+ * took and a heatmap of where frogs died.
+ *
+ * Games are shared out over a pool of worker processes (one per core by
+ * default). The game logic keeps its state in static variables, so each
+ * worker is a separate process with its own copy which is reused for
+ * every game it plays - nothing is allocated while games are running.
+ * Workers take the next chunk of games from a shared counter whenever
+ * they finish one, so faster workers take more of the work. Each game's
+ * random numbers come from the seed and the game number only, so the
+ * results don't depend on the number of workers.
+ *
+ * Build: gcc -O2 -Wall -Ihost -I../CSSE2010-s4411500 -o montecarlo montecarlo.c \
+ *            host/host_stubs.c ../CSSE2010-s4411500/game.c ../CSSE2010-s4411500/level.c \
+ *            ../CSSE2010-s4411500/level_data.c ../CSSE2010-s4411500/score.c \
+ *            ../CSSE2010-s4411500/live.c ../CSSE2010-s4411500/motion.c \
+ *            ../CSSE2010-s4411500/fieldsim.c ../CSSE2010-s4411500/lanegen.c \
+ *            ../CSSE2010-s4411500/autopilot.c ../CSSE2010-s4411500/statebus.c \
+ *            ../CSSE2010-s4411500/framebuffer.c ../CSSE2010-s4411500/compositor.c
+ * Usage: montecarlo [-g games] [-j workers] [-s seed] [-l max_level]
+ *                   [-p random|cautious|autopilot]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "game.h"
+#include "level.h"
+#include "live.h"
+#include "score.h"
+#include "lanegen.h"
+#include "fieldsim.h"
+#include "autopilot.h"
+
+#define MAX_LEVELS 30
+#define MAX_WORKERS 64
+#define CHUNK 16
+#define FROG_TIME_LIMIT 30000	// ms, as count_set(INIT_TIME) in project.c
+#define TIME_BUCKETS 31			// 1 second buckets, the last is 30 s or more
+
+enum { PLAYER_RANDOM, PLAYER_CAUTIOUS, PLAYER_AUTOPILOT };
+static const char* player_names[] = { "random", "cautious", "autopilot" };
+
+typedef struct {
+	uint64_t games;
+	uint64_t play_ms;
+	uint64_t started[MAX_LEVELS + 1];
+	uint64_t cleared[MAX_LEVELS + 1];
+	uint64_t crossings[MAX_LEVELS + 1];
+	uint64_t crossing_ms[MAX_LEVELS + 1];
+	uint32_t crossing_times[MAX_LEVELS + 1][TIME_BUCKETS];
+	uint32_t timeouts[MAX_LEVELS + 1];
+	uint32_t deaths[MAX_LEVELS + 1][8][16];
+} Results;
+
+typedef struct {
+	uint64_t next_game;
+	Results worker[MAX_WORKERS];
+} Shared;
+
+static Shared* shared;
+static Results total;
+
+// Moves are numbered as the push buttons are (see autopilot.h)
+static void make_move(int8_t move) {
+	switch(move) {
+		case AUTOPILOT_LEFT:
+			move_frog_to_left();
+			break;
+		case AUTOPILOT_FORWARD:
+			move_frog_forward();
+			break;
+		case AUTOPILOT_BACKWARD:
+			move_frog_backward();
+			break;
+		case AUTOPILOT_RIGHT:
+			move_frog_to_right();
+			break;
+	}
+}
+
+// xorshift64
+static uint64_t next_random(uint64_t* state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+// Random player: thinks for 150 to 400 ms then makes a move, mostly
+// forward
+static int8_t random_player(uint64_t* random, uint16_t* think_ms) {
+	uint8_t roll = next_random(random) % 100;
+	*think_ms = 150 + next_random(random) % 251;
+	if(roll < 50) {
+		return AUTOPILOT_FORWARD;
+	} else if(roll < 65) {
+		return AUTOPILOT_LEFT;
+	} else if(roll < 80) {
+		return AUTOPILOT_RIGHT;
+	} else if(roll < 85) {
+		return AUTOPILOT_BACKWARD;
+	}
+	return AUTOPILOT_STAY;
+}
+
+// Cautious player: every 200 ms goes forward if the square ahead is safe
+// right now, otherwise stays put if that's safe or sidesteps
+static int8_t cautious_player(uint16_t* think_ms) {
+	static const int8_t moves[] = { AUTOPILOT_FORWARD, AUTOPILOT_STAY, AUTOPILOT_LEFT,
+			AUTOPILOT_RIGHT };
+	static const int8_t row_change[] = { 1, 0, 0, 0 };
+	static const int8_t column_change[] = { 0, 0, -1, 1 };
+	FieldSim sim;
+
+	*think_ms = 200;
+	get_field_prediction(&sim);
+	for(uint8_t i = 0; i < 4; i++) {
+		int8_t row = get_frog_row() + row_change[i];
+		int8_t column = get_frog_column() + column_change[i];
+		if(column >= 0 && column < 16 &&
+				((fieldsim_safe_columns(&sim, row) >> column) & 1)) {
+			return moves[i];
+		}
+	}
+	return AUTOPILOT_STAY;
+}
+
+static void record_crossing(Results* results, uint8_t level, uint32_t frog_time) {
+	uint32_t bucket = frog_time / 1000;
+	results->crossings[level]++;
+	results->crossing_ms[level] += frog_time;
+	results->crossing_times[level][bucket < TIME_BUCKETS ? bucket : TIME_BUCKETS - 1]++;
+}
+
+static void record_death(Results* results, uint8_t level) {
+	uint8_t row = get_frog_row();
+	uint8_t column = get_frog_column();
+	// Frogs which died jumping off the field are counted at the edge
+	if(row > 7) {
+		row = 0;
+	}
+	if(column > 15) {
+		column = (column == 16) ? 15 : 0;
+	}
+	results->deaths[level][row][column]++;
+}
+
+// Play one game, following the same rules as main() and play_game() in
+// project.c, until the frogs run out or max_level has been cleared
+static void play_game(uint64_t game, uint64_t seed, int player, uint8_t max_level,
+		Results* results) {
+	uint64_t random = (seed ^ (game * 0x9E3779B97F4A7C15ULL)) | 1;
+
+	next_random(&random);
+	init_level();
+	lanegen_set_seed((uint32_t)next_random(&random));
+	init_score();
+	init_lives();
+	results->games++;
+
+	while(!no_more_live() && get_level() < max_level) {
+		add_level();
+		if(get_level() > 1) {
+			add_lives();
+		}
+		initialise_game();
+
+		uint8_t level = get_level();
+		uint32_t frog_time = 0;
+		results->started[level]++;
+
+		while(!no_more_live() && !is_riverbank_full()) {
+			uint16_t think_ms = AUTOPILOT_STEP_MS;
+			int8_t move;
+
+			if(!is_frog_dead() && frog_has_reached_riverbank()) {
+				record_crossing(results, level, frog_time);
+				put_frog_in_start_position();
+				frog_time = 0;
+			}
+			if(frog_time >= FROG_TIME_LIMIT) {
+				kill_frog();
+				results->timeouts[level]++;
+			} else if(is_frog_dead()) {
+				record_death(results, level);
+			}
+			if(is_frog_dead()) {
+				reduce_lives();
+				put_frog_in_start_position();
+				frog_time = 0;
+				continue;
+			}
+
+			switch(player) {
+				case PLAYER_RANDOM:
+					move = random_player(&random, &think_ms);
+					break;
+				case PLAYER_CAUTIOUS:
+					move = cautious_player(&think_ms);
+					break;
+				default:
+					move = autopilot_next_move();
+					break;
+			}
+			make_move(move);
+			update_traffic(think_ms);
+			frog_time += think_ms;
+			results->play_ms += think_ms;
+		}
+		if(is_riverbank_full()) {
+			// The frog which filled the last hole
+			record_crossing(results, level, frog_time);
+			results->cleared[level]++;
+		}
+	}
+}
+
+static void run_worker(int worker, uint64_t games, uint64_t seed, int player,
+		uint8_t max_level) {
+	Results* results = &shared->worker[worker];
+	while(1) {
+		uint64_t first = __atomic_fetch_add(&shared->next_game, CHUNK, __ATOMIC_RELAXED);
+		if(first >= games) {
+			break;
+		}
+		for(uint64_t game = first; game < first + CHUNK && game < games; game++) {
+			play_game(game, seed, player, max_level, results);
+		}
+	}
+}
+
+static void add_results(Results* to, const Results* from) {
+	const uint64_t* from64 = (const uint64_t*)from;
+	uint64_t* to64 = (uint64_t*)to;
+	size_t count64 = offsetof(Results, crossing_times) / sizeof(uint64_t);
+	for(size_t i = 0; i < count64; i++) {
+		to64[i] += from64[i];
+	}
+	const uint32_t* from32 = (const uint32_t*)&from->crossing_times;
+	uint32_t* to32 = (uint32_t*)&to->crossing_times;
+	size_t count32 = (sizeof(Results) - offsetof(Results, crossing_times)) / sizeof(uint32_t);
+	for(size_t i = 0; i < count32; i++) {
+		to32[i] += from32[i];
+	}
+}
+
+// Crossing time (seconds) below which the given fraction of crossings fall
+static unsigned percentile(const uint32_t* histogram, uint64_t count, double fraction) {
+	uint64_t seen = 0;
+	if(!count) {
+		return 0;
+	}
+	for(unsigned bucket = 0; bucket < TIME_BUCKETS; bucket++) {
+		seen += histogram[bucket];
+		if(seen >= fraction * count) {
+			return bucket + 1;
+		}
+	}
+	return TIME_BUCKETS;
+}
+
+static void print_heatmap(uint8_t level) {
+	uint32_t busiest = 0;
+	uint64_t deaths = 0;
+	for(int row = 0; row < 8; row++) {
+		for(int column = 0; column < 16; column++) {
+			uint32_t count = total.deaths[level][row][column];
+			deaths += count;
+			if(count > busiest) {
+				busiest = count;
+			}
+		}
+	}
+	if(!deaths) {
+		return;
+	}
+	printf("\nlevel %u: %llu deaths, busiest square %u ('1'-'9' tenths of that, "
+			"'#' busiest)\n", level, (unsigned long long)deaths, busiest);
+	for(int row = 7; row >= 0; row--) {
+		printf("  %d ", row);
+		for(int column = 0; column < 16; column++) {
+			uint32_t count = total.deaths[level][row][column];
+			if(!count) {
+				putchar('.');
+			} else if(count == busiest) {
+				putchar('#');
+			} else {
+				putchar('1' + (count * 9 / busiest > 8 ? 8 : count * 9 / busiest));
+			}
+		}
+		putchar('\n');
+	}
+}
+
+int main(int argc, char** argv) {
+	uint64_t games = 10000;
+	uint64_t seed = 1;
+	long workers = sysconf(_SC_NPROCESSORS_ONLN);
+	int player = PLAYER_AUTOPILOT;
+	int max_level = 10;
+
+	for(int i = 1; i < argc; i++) {
+		if(i + 1 < argc && strcmp(argv[i], "-g") == 0) {
+			games = strtoull(argv[++i], NULL, 0);
+		} else if(i + 1 < argc && strcmp(argv[i], "-j") == 0) {
+			workers = strtol(argv[++i], NULL, 0);
+		} else if(i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+			seed = strtoull(argv[++i], NULL, 0);
+		} else if(i + 1 < argc && strcmp(argv[i], "-l") == 0) {
+			max_level = atoi(argv[++i]);
+		} else if(i + 1 < argc && strcmp(argv[i], "-p") == 0) {
+			i++;
+			for(player = 0; player < 3 && strcmp(argv[i], player_names[player]); player++) {
+			}
+		} else {
+			player = -1;
+			break;
+		}
+	}
+	if(player < 0 || player > 2 || max_level < 1 || max_level > MAX_LEVELS) {
+		fprintf(stderr, "usage: %s [-g games] [-j workers] [-s seed] [-l max_level 1-%d] "
+				"[-p random|cautious|autopilot]\n", argv[0], MAX_LEVELS);
+		return 2;
+	}
+	if(workers < 1) {
+		workers = 1;
+	} else if(workers > MAX_WORKERS) {
+		workers = MAX_WORKERS;
+	}
+
+	shared = mmap(NULL, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+			-1, 0);
+	if(shared == MAP_FAILED) {
+		perror("mmap");
+		return 2;
+	}
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(int worker = 0; worker < workers; worker++) {
+		pid_t pid = fork();
+		if(pid < 0) {
+			perror("fork");
+			return 2;
+		} else if(pid == 0) {
+			run_worker(worker, games, seed, player, max_level);
+			_exit(0);
+		}
+	}
+	int failed = 0;
+	for(int worker = 0; worker < workers; worker++) {
+		int status;
+		if(wait(&status) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+			failed = 1;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if(failed) {
+		fprintf(stderr, "a worker failed\n");
+		return 1;
+	}
+
+	for(int worker = 0; worker < workers; worker++) {
+		add_results(&total, &shared->worker[worker]);
+	}
+	double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	printf("player %s, %llu games, seed %llu, %ld workers, levels 1-%d\n",
+			player_names[player], (unsigned long long)total.games,
+			(unsigned long long)seed, workers, max_level);
+	printf("%.3f s, %.0f games/s, %.0f hours of play simulated\n", seconds,
+			total.games / seconds, total.play_ms / 3.6e6);
+	printf("games per worker:");
+	for(int worker = 0; worker < workers; worker++) {
+		printf(" %llu", (unsigned long long)shared->worker[worker].games);
+	}
+	printf("\n\n%5s %8s %8s %8s %9s %7s %6s %6s %7s %8s\n", "level", "started", "survival",
+			"cleared", "crossings", "mean_s", "p50_s", "p90_s", "deaths", "timeouts");
+	for(int level = 1; level <= max_level; level++) {
+		uint64_t deaths = 0;
+		for(int row = 0; row < 8; row++) {
+			for(int column = 0; column < 16; column++) {
+				deaths += total.deaths[level][row][column];
+			}
+		}
+		printf("%5d %8llu %7.1f%% %8llu %9llu %7.1f %6u %6u %7llu %8u\n", level,
+				(unsigned long long)total.started[level],
+				100.0 * total.started[level] / total.games,
+				(unsigned long long)total.cleared[level],
+				(unsigned long long)total.crossings[level],
+				total.crossings[level] ? total.crossing_ms[level] / 1000.0 /
+				total.crossings[level] : 0.0,
+				percentile(total.crossing_times[level], total.crossings[level], 0.5),
+				percentile(total.crossing_times[level], total.crossings[level], 0.9),
+				(unsigned long long)deaths, total.timeouts[level]);
+	}
+	for(int level = 1; level <= max_level; level++) {
+		print_heatmap(level);
+	}
+	return 0;
+}
@@ -0,0 +1,233 @@
+/*
+ * motion_check.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Checks the closed form lane movement (see motion.h) on the host against
+ * the obvious way of doing it: a phase accumulator which gains the rate
+ * every ms and makes a step each time it reaches the period, with the
+ * pattern position wrapping round the row's width.
+ *
+ * Every moving row of every level in the table is followed a ms at a time
+ * for -t ms (an hour by default), checking at every ms the steps made
+ * (motion_steps_at()), the time of each step (motion_step_time()) and the
+ * position in the pattern (motion_position()). So is every period from 1
+ * to -p ms at rates 1 to 4, steady and accelerating, for 20 periods
+ * each. Then times up to the 2^32 / rate ms limit are checked against
+ * 64 bit arithmetic, and divider_divide() against / and % for every
+ * divisor.
+ *
+ * Build: gcc -O2 -Wall -I../host -I../../CSSE2010-s4411500 -o motion_check \
+ *            motion_check.c ../host/host_stubs.c \
+ *            ../../CSSE2010-s4411500/motion.c ../../CSSE2010-s4411500/level.c \
+ *            ../../CSSE2010-s4411500/level_data.c ../../CSSE2010-s4411500/statebus.c
+ * Usage: motion_check [-t ms per level row] [-p largest period swept]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "motion.h"
+#include "level.h"
+#include "level_data.h"
+
+#define SWEEP_RATES 4
+#define SWEEP_PERIODS 20
+#define FAR_CHECKS 200000
+#define DIVIDENDS_PER_DIVISOR 64
+
+static uint64_t random_state = 0x2545F4914F6CDD1DULL;
+
+static uint32_t random32(void) {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 7;
+	random_state ^= random_state << 17;
+	return random_state >> 32;
+}
+
+// The rate during the given ms, as motion.h describes it
+static uint32_t rate_at(uint8_t rate, int8_t accel, uint8_t rate_limit, uint32_t ms) {
+	int64_t now = rate + (int64_t)(ms >> MOTION_ACCEL_SHIFT) * accel;
+
+	if(accel > 0 && now > rate_limit) {
+		now = rate_limit;
+	} else if(accel < 0 && now < rate_limit) {
+		now = rate_limit;
+	}
+	return now;
+}
+
+// Follow a row a ms at a time for the given time, comparing with the
+// closed form. Returns 0 (having said why) if they ever differ.
+static int check_row(const char* name, uint16_t period, uint8_t rate, int8_t accel,
+		uint8_t rate_limit, int8_t direction, uint8_t width, uint32_t time) {
+	RowMotion motion;
+	Divider width_divider;
+	uint32_t phase = 0;
+	uint32_t steps = 0;
+	uint8_t position = 0;
+	uint32_t step_time;
+
+	motion_init(&motion, period, rate, accel, rate_limit, direction);
+	divider_init(&width_divider, width);
+	for(uint32_t ms = 0; ms <= time; ms++) {
+		if(motion_steps_at(&motion, ms) != steps) {
+			printf("%s: %u steps at %u ms, should be %u\n", name,
+					motion_steps_at(&motion, ms), ms, steps);
+			return 0;
+		}
+		if(motion_position(&motion, &width_divider, steps) != position) {
+			printf("%s: position %u after %u steps, should be %u\n", name,
+					motion_position(&motion, &width_divider, steps), steps, position);
+			return 0;
+		}
+		// The steps made at the end of this ms
+		phase += rate_at(rate, accel, rate_limit, ms);
+		while(phase >= period) {
+			phase -= period;
+			steps++;
+			// Moving right brings lower bits into column 0
+			position = direction > 0 ? (position ? position - 1 : width - 1)
+					: (position + 1 == width ? 0 : position + 1);
+			step_time = motion_step_time(&motion, steps);
+			if(step_time != ms + 1) {
+				printf("%s: step %u at %u ms, should be %u\n", name, steps, step_time, ms + 1);
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+// Every moving row of every level in the table
+static int check_levels(uint32_t time, uint32_t* rows) {
+	const uint8_t* record;
+	LaneDescriptor lane;
+	uint16_t riverbank;
+	char name[32];
+
+	for(uint8_t level = 1; level <= NUM_LEVEL_DESCRIPTORS; level++) {
+		record = level_read_riverbank(level_descriptor(level), &riverbank);
+		for(uint8_t row = 0; row < 5; row++) {
+			record = level_read_lane(record, &lane);
+			snprintf(name, sizeof(name), "level %u row %u", level, row);
+			if(!check_row(name, lane.period, lane.rate, lane.accel, lane.rate_limit,
+					lane.direction, lane.width, time)) {
+				return 0;
+			}
+			(*rows)++;
+		}
+	}
+	return 1;
+}
+
+// Every period up to the given one (as the "period" console tunable can
+// set), steady and accelerating up and down
+static int check_sweep(uint16_t max_period, uint32_t* rows) {
+	char name[48];
+
+	for(uint32_t period = 1; period <= max_period; period++) {
+		for(uint8_t rate = 1; rate <= SWEEP_RATES; rate++) {
+			snprintf(name, sizeof(name), "period %u rate %u", period, rate);
+			if(!check_row(name, period, rate, 0, rate, period & 1 ? 1 : -1, 16 + period % 49,
+					20 * period / rate) ||
+					!check_row(name, period, rate, 1, rate + 5, -1, 32, 20 * period / rate) ||
+					!check_row(name, period, rate + 5, -1, rate, 1, 64, 20 * period / rate)) {
+				return 0;
+			}
+			*rows += 3;
+		}
+	}
+	return 1;
+}
+
+// Times up to the limit (2^32 / rate ms) against 64 bit arithmetic
+static int check_far(uint32_t* checks) {
+	RowMotion motion;
+	uint16_t period;
+	uint8_t rate;
+	uint32_t time;
+	uint64_t expected;
+
+	for(uint32_t i = 0; i < FAR_CHECKS; i++) {
+		period = 1 + random32() % 65535;
+		rate = 1 + random32() % 255;
+		motion_init(&motion, period, rate, 0, rate, 1);
+		time = i & 1 ? random32() % (UINT32_MAX / rate) : UINT32_MAX / rate - i % 64;
+		expected = (uint64_t)rate * time / period;
+		if(motion_steps_at(&motion, time) != expected) {
+			printf("period %u rate %u: %u steps at %u ms, should be %llu\n", period, rate,
+					motion_steps_at(&motion, time), time, (unsigned long long)expected);
+			return 0;
+		}
+		// The first ms at which that many steps have been made
+		if(expected && motion_step_time(&motion, expected) !=
+				((uint64_t)expected * period + rate - 1) / rate) {
+			printf("period %u rate %u: step %llu at %u ms\n", period, rate,
+					(unsigned long long)expected, motion_step_time(&motion, expected));
+			return 0;
+		}
+		(*checks)++;
+	}
+	return 1;
+}
+
+// divider_divide() against / and % for every divisor, with the ends of
+// the range, exact multiples and random dividends
+static int check_divider(uint32_t* checks) {
+	Divider divider;
+	uint32_t n;
+	uint32_t quotient;
+	uint16_t remainder;
+
+	for(uint32_t divisor = 1; divisor <= 0xFFFF; divisor++) {
+		divider_init(&divider, divisor);
+		for(uint32_t i = 0; i < DIVIDENDS_PER_DIVISOR; i++) {
+			switch(i & 3) {
+				case 0: n = UINT32_MAX - i; break;
+				case 1: n = divisor * (i + random32() % 1000); break;
+				case 2: n = random32(); break;
+				default: n = random32() >> (random32() % 32); break;
+			}
+			quotient = divider_divide(&divider, n, &remainder);
+			if(quotient != n / divisor || remainder != n % divisor) {
+				printf("%u / %u gave %u remainder %u\n", n, divisor, quotient, remainder);
+				return 0;
+			}
+			(*checks)++;
+		}
+	}
+	return 1;
+}
+
+int main(int argc, char** argv) {
+	uint32_t time = 3600000;
+	uint32_t max_period = 2000;
+	uint32_t level_rows = 0, sweep_rows = 0, far = 0, divisions = 0;
+
+	for(int i = 1; i < argc; i++) {
+		if(i + 1 < argc && strcmp(argv[i], "-t") == 0) {
+			time = strtoul(argv[++i], NULL, 0);
+		} else if(i + 1 < argc && strcmp(argv[i], "-p") == 0) {
+			max_period = strtoul(argv[++i], NULL, 0);
+		} else {
+			fprintf(stderr, "usage: %s [-t ms per level row] [-p largest period swept]\n",
+					argv[0]);
+			return 2;
+		}
+	}
+	if(max_period > 0xFFFF) {
+		max_period = 0xFFFF;
+	}
+
+	if(!check_levels(time, &level_rows) || !check_sweep(max_period, &sweep_rows) ||
+			!check_far(&far) || !check_divider(&divisions)) {
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("passed: %u level rows for %u ms, %u swept rows, %u far times, %u divisions\n",
+			level_rows, time, sweep_rows, far, divisions);
+	return 0;
+}
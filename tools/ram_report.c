@@ -0,0 +1,176 @@
+/*
+ * ram_report.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Host tool which reads the GNU linker map file produced by the AVR
+ * build (e.g. Debug/CSSE2010-s4411500.map) and prints how much of the
+ * ATmega324A's SRAM each object file uses in .data, .bss and .noinit.
+ * The RAM left over is what the stack has to work with.
+ *
+ * Build: gcc -O2 -Wall -o ram_report ram_report.c
+ * Usage: ram_report [-m min_stack_bytes] file.map
+ *
+ * If -m is given the tool exits with status 1 when less than that many
+ * bytes remain for the stack, so it can be used as a build check.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SRAM_SIZE 2048
+// Data space addresses in the map file are offset by 0x800000
+#define DATA_BASE 0x800000UL
+#define DATA_END 0x810000UL
+
+#define MAX_MODULES 64
+#define MAX_LINE 1024
+
+enum { SEC_DATA, SEC_BSS, SEC_NOINIT, NUM_SECTIONS, SEC_OTHER };
+
+static const char* section_names[NUM_SECTIONS] = { ".data", ".bss", ".noinit" };
+
+typedef struct {
+	char name[64];
+	unsigned long size[NUM_SECTIONS];
+} Module;
+
+static Module modules[MAX_MODULES];
+static int num_modules;
+
+// Reduce an object path (possibly an archive member) to a short name
+static const char* module_name(const char* path) {
+	const char* name = path;
+	for(const char* p = path; *p; p++) {
+		if(*p == '/' || *p == '\\') {
+			name = p + 1;
+		}
+	}
+	return name;
+}
+
+static Module* find_module(const char* path) {
+	const char* name = module_name(path);
+	for(int i = 0; i < num_modules; i++) {
+		if(strncmp(modules[i].name, name, sizeof(modules[i].name) - 1) == 0) {
+			return &modules[i];
+		}
+	}
+	if(num_modules == MAX_MODULES) {
+		return &modules[MAX_MODULES - 1];
+	}
+	Module* m = &modules[num_modules++];
+	strncpy(m->name, name, sizeof(m->name) - 1);
+	return m;
+}
+
+// Parse "addr size file" from the given text. Returns 1 on success.
+static int parse_entry(const char* text, unsigned long* addr,
+		unsigned long* size, char* file) {
+	int offset;
+	if(sscanf(text, " 0x%lx 0x%lx %n", addr, size, &offset) < 2) {
+		return 0;
+	}
+	strncpy(file, text + offset, MAX_LINE - 1);
+	file[strcspn(file, "\r\n")] = 0;
+	return file[0] != 0;
+}
+
+static void add_entry(int section, unsigned long addr, unsigned long size,
+		const char* file) {
+	if(section >= NUM_SECTIONS || size == 0 || addr < DATA_BASE || addr >= DATA_END) {
+		return;
+	}
+	find_module(file)->size[section] += size;
+}
+
+int main(int argc, char** argv) {
+	long min_stack = -1;
+	const char* path = NULL;
+
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+			min_stack = strtol(argv[++i], NULL, 0);
+		} else {
+			path = argv[i];
+		}
+	}
+	if(!path) {
+		fprintf(stderr, "usage: %s [-m min_stack_bytes] file.map\n", argv[0]);
+		return 2;
+	}
+	FILE* f = fopen(path, "r");
+	if(!f) {
+		perror(path);
+		return 2;
+	}
+
+	char line[MAX_LINE], file[MAX_LINE];
+	int in_memory_map = 0;
+	int section = SEC_OTHER;
+	int have_pending = 0;
+	unsigned long addr, size;
+
+	while(fgets(line, sizeof(line), f)) {
+		if(!in_memory_map) {
+			in_memory_map = (strncmp(line, "Linker script and memory map", 28) == 0);
+			continue;
+		}
+		if(line[0] == '.') {
+			// Start of an output section
+			section = SEC_OTHER;
+			for(int s = 0; s < NUM_SECTIONS; s++) {
+				size_t len = strlen(section_names[s]);
+				if(strncmp(line, section_names[s], len) == 0 &&
+						(line[len] == ' ' || line[len] == '\n' || line[len] == '\r')) {
+					section = s;
+				}
+			}
+			have_pending = 0;
+			continue;
+		}
+		if(have_pending) {
+			// Input section name was too long - the details are on this line
+			have_pending = 0;
+			if(parse_entry(line, &addr, &size, file)) {
+				add_entry(section, addr, size, file);
+				continue;
+			}
+		}
+		if(line[0] == ' ' && (line[1] == '.' || strncmp(line + 1, "COMMON", 6) == 0)) {
+			// Input section: " name addr size file" or " name" on its own
+			char* rest = line + 1 + strcspn(line + 1, " \t\r\n");
+			if(parse_entry(rest, &addr, &size, file)) {
+				add_entry(section, addr, size, file);
+			} else {
+				have_pending = 1;
+			}
+		}
+	}
+	fclose(f);
+
+	unsigned long totals[NUM_SECTIONS] = { 0 };
+	printf("%-32s %7s %7s %7s %7s\n", "module", ".data", ".bss", ".noinit", "total");
+	for(int i = 0; i < num_modules; i++) {
+		unsigned long total = 0;
+		for(int s = 0; s < NUM_SECTIONS; s++) {
+			totals[s] += modules[i].size[s];
+			total += modules[i].size[s];
+		}
+		printf("%-32s %7lu %7lu %7lu %7lu\n", modules[i].name, modules[i].size[SEC_DATA],
+				modules[i].size[SEC_BSS], modules[i].size[SEC_NOINIT], total);
+	}
+	unsigned long static_total = totals[SEC_DATA] + totals[SEC_BSS] + totals[SEC_NOINIT];
+	printf("%-32s %7lu %7lu %7lu %7lu\n", "TOTAL", totals[SEC_DATA], totals[SEC_BSS],
+			totals[SEC_NOINIT], static_total);
+
+	long stack = SRAM_SIZE - (long)static_total;
+	printf("\nSRAM %d bytes, static %lu bytes, %ld bytes left for the stack\n",
+			SRAM_SIZE, static_total, stack);
+	if(min_stack >= 0 && stack < min_stack) {
+		printf("FAIL: less than %ld bytes left for the stack\n", min_stack);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,307 @@
+/*
+ * rewind_check.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Checks rewinding (see rewind.h) on the host. Each game plays a level
+ * with random moves, the same way as play_game() does, keeping a full copy
+ * of the game and the LED matrix every time a delta is recorded. It then
+ * rewinds as far as the history goes, checking every step gives back
+ * exactly the game and display that were recorded on the way forward,
+ * and plays forward again from there with the same moves, checking the
+ * game passes through the same states once more. The bytes of history
+ * per second of play are printed at the end.
+ *
+ * Build: gcc -O2 -Wall -DHOST_LEDMATRIX -I../host -I../../CSSE2010-s4411500 \
+ *            -o rewind_check rewind_check.c ../host/host_stubs.c \
+ *            ../../CSSE2010-s4411500/rewind.c ../../CSSE2010-s4411500/game.c \
+ *            ../../CSSE2010-s4411500/level.c ../../CSSE2010-s4411500/level_data.c \
+ *            ../../CSSE2010-s4411500/score.c ../../CSSE2010-s4411500/live.c \
+ *            ../../CSSE2010-s4411500/motion.c ../../CSSE2010-s4411500/fieldsim.c \
+ *            ../../CSSE2010-s4411500/lanegen.c ../../CSSE2010-s4411500/statebus.c \
+ *            ../../CSSE2010-s4411500/framebuffer.c ../../CSSE2010-s4411500/compositor.c
+ * Usage: rewind_check [-g games] [-s seed] [-t ms of play per game]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "rewind.h"
+#include "game.h"
+#include "level.h"
+#include "live.h"
+#include "score.h"
+#include "lanegen.h"
+#include "ledmatrix.h"
+#include "statebus.h"
+#include "compositor.h"
+
+#define MAX_STEPS 20000
+#define MAX_RECORDS 2000
+#define INIT_COUNTDOWN 30000
+
+// The inputs of one time through the play loop
+typedef struct {
+	int8_t move;
+	uint8_t elapsed;
+} Input;
+
+// Everything the game shows
+typedef struct {
+	FieldState field;
+	uint16_t countdown;
+	uint32_t score;
+	uint8_t lives;
+	MatrixData display;
+} Recorded;
+
+static Input inputs[MAX_STEPS];
+static Recorded records[MAX_RECORDS];
+static uint32_t record_step[MAX_RECORDS];
+
+// The LED matrix and countdown (in place of ledmatrix.c and timer0.c)
+static MatrixData display;
+static uint16_t countdown;
+
+void ledmatrix_update_pixel(uint8_t x, uint8_t y, PixelColour pixel) {
+	// (Positions off the display are ignored, as ledmatrix.c)
+	if(x < MATRIX_NUM_COLUMNS && y < MATRIX_NUM_ROWS) {
+		display[x][y] = pixel;
+	}
+}
+
+void ledmatrix_update_row(uint8_t y, MatrixRow row) {
+	for(uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+		display[x][y] = row[x];
+	}
+}
+
+void ledmatrix_update_row_packed(uint8_t y, const MatrixPackedRow row,
+		const PixelColour* palette) {
+	for(uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+		display[x][y] = palette[(x & 1) ? row[x >> 1] >> 4 : row[x >> 1] & 0x0F];
+	}
+}
+
+void ledmatrix_update_all_packed(const MatrixPackedData data, const PixelColour* palette) {
+	for(uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+		ledmatrix_update_row_packed(y, data[y], palette);
+	}
+}
+
+void ledmatrix_update_column(uint8_t x, MatrixColumn col) {
+	memcpy(display[x], col, MATRIX_NUM_ROWS);
+}
+
+void ledmatrix_shift_display_left(void) {
+	memmove(display[0], display[1], sizeof(display) - sizeof(display[0]));
+	memset(display[MATRIX_NUM_COLUMNS - 1], 0, MATRIX_NUM_ROWS);
+}
+
+void ledmatrix_clear(void) {
+	memset(display, 0, sizeof(display));
+}
+
+uint16_t count_get_ms(void) {
+	return countdown;
+}
+
+void count_set_ms(uint16_t ms) {
+	countdown = ms;
+}
+
+// xorshift64
+static uint64_t next_random(uint64_t* state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+// The display is recorded as redrawn in full from the field state (which
+// mustn't change it). Going forwards a dead frog stays on the display
+// until its row is next drawn, which a rewind doesn't repeat.
+static void record(Recorded* recorded) {
+	get_field_state(&recorded->field);
+	set_field_state(&recorded->field);
+	compositor_update();
+	recorded->countdown = countdown;
+	recorded->score = get_score();
+	recorded->lives = get_lives();
+	memcpy(recorded->display, display, sizeof(display));
+}
+
+static int same(const Recorded* a, const Recorded* b) {
+	// (Compared field by field - FieldState has padding)
+	return a->field.frog_row == b->field.frog_row &&
+			a->field.frog_column == b->field.frog_column &&
+			a->field.frog_dead == b->field.frog_dead &&
+			a->field.riverbank_status == b->field.riverbank_status &&
+			a->field.level_time == b->field.level_time &&
+			memcmp(a->field.steps_behind, b->field.steps_behind, 5) == 0 &&
+			a->countdown == b->countdown && a->score == b->score &&
+			a->lives == b->lives && memcmp(a->display, b->display, sizeof(MatrixData)) == 0;
+}
+
+// The start of each time through the loop, as play_game(): deal with a
+// crossing or death, then record a delta. Returns 1 if one was recorded.
+static int loop_start(uint32_t* crossings, uint32_t* deaths) {
+	if(!is_frog_dead() && frog_has_reached_riverbank()) {
+		add_to_score(10);
+		put_frog_in_start_position();
+		countdown = INIT_COUNTDOWN;
+		(*crossings)++;
+	}
+	if(countdown == 0) {
+		kill_frog();
+	}
+	if(is_frog_dead()) {
+		reduce_lives();
+		put_frog_in_start_position();
+		(*deaths)++;
+	}
+	return rewind_capture();
+}
+
+// The rest of the loop - the move, then the traffic and countdown
+static void loop_end(const Input* input) {
+	switch(input->move) {
+		case 0:
+			move_frog_to_right();
+			break;
+		case 1:
+			move_frog_backward();
+			break;
+		case 2:
+			move_frog_forward();
+			break;
+		case 3:
+			move_frog_to_left();
+			break;
+	}
+	update_traffic(input->elapsed);
+	countdown = countdown > input->elapsed ? countdown - input->elapsed : 0;
+	state_dispatch();
+	compositor_update();
+}
+
+// Play one game. Returns 0 if rewinding or replaying went wrong.
+static int check_game(uint64_t* random, uint32_t play_ms, uint64_t* history_bytes,
+		uint64_t* history_ms, uint32_t* crossings, uint32_t* deaths) {
+	Recorded now;
+	uint32_t steps = 0;
+	uint32_t count = 0;
+	uint32_t time = 0;
+	uint32_t rewound;
+	uint32_t at;
+	uint32_t replay_crossings = 0, replay_deaths = 0;
+
+	// A random level of a random lane generator seed, as next_level()
+	set_level(1 + next_random(random) % 20);
+	lanegen_set_seed(next_random(random));
+	set_score(next_random(random) % 1000);
+	set_lives(4);
+	initialise_game();
+	put_frog_in_start_position();
+	countdown = INIT_COUNTDOWN;
+	rewind_clear();
+	record(&records[count++]);
+	record_step[0] = 0;
+
+	// Forwards, recording every state a delta is made of
+	while(time < play_ms && steps < MAX_STEPS && count < MAX_RECORDS &&
+			!no_more_live() && !is_riverbank_full()) {
+		Input* input = &inputs[steps];
+		uint8_t roll = next_random(random) % 100;
+		input->elapsed = 1 + next_random(random) % 40;
+		input->move = roll < 6 ? 2 : (roll < 8 ? 3 : (roll < 10 ? 0 : (roll < 11 ? 1 : -1)));
+		if(loop_start(crossings, deaths)) {
+			record_step[count] = steps;
+			record(&records[count++]);
+		}
+		loop_end(input);
+		time += input->elapsed;
+		steps++;
+	}
+	*history_bytes += rewind_history_bytes();
+	*history_ms += rewind_history_ms();
+
+	// Backwards as far as the history goes
+	for(rewound = 0; rewind_step(); rewound++) {
+		record(&now);
+		if(rewound + 1 >= count || !same(&now, &records[count - 2 - rewound])) {
+			fprintf(stderr, "rewind step %u of %u doesn't match\n", rewound + 1, count - 1);
+			return 0;
+		}
+	}
+	if(rewound == 0 && count > 1) {
+		fprintf(stderr, "no history\n");
+		return 0;
+	}
+
+	// Forwards again from there with the same inputs. (Delta 0 is the
+	// state before the first time through the loop.)
+	at = count - 1 - rewound;
+	uint32_t step = 0;
+	if(at > 0) {
+		step = record_step[at];
+		loop_end(&inputs[step++]);
+	}
+	for(; step < steps; step++) {
+		if(loop_start(&replay_crossings, &replay_deaths)) {
+			record(&now);
+			if(++at >= count || record_step[at] != step || !same(&now, &records[at])) {
+				fprintf(stderr, "replay doesn't match at delta %u\n", at);
+				return 0;
+			}
+		}
+		loop_end(&inputs[step]);
+	}
+	if(at != count - 1) {
+		fprintf(stderr, "replay made %u deltas, not %u\n", at, count - 1);
+		return 0;
+	}
+	return 1;
+}
+
+int main(int argc, char** argv) {
+	uint64_t games = 1000;
+	uint64_t seed = 1;
+	uint32_t play_ms = 20000;
+	uint64_t history_bytes = 0, history_ms = 0;
+	uint32_t crossings = 0, deaths = 0;
+
+	for(int i = 1; i < argc; i++) {
+		if(i + 1 < argc && strcmp(argv[i], "-g") == 0) {
+			games = strtoull(argv[++i], NULL, 0);
+		} else if(i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+			seed = strtoull(argv[++i], NULL, 0);
+		} else if(i + 1 < argc && strcmp(argv[i], "-t") == 0) {
+			play_ms = strtoul(argv[++i], NULL, 0);
+		} else {
+			fprintf(stderr, "usage: %s [-g games] [-s seed] [-t ms of play per game]\n",
+					argv[0]);
+			return 2;
+		}
+	}
+
+	uint64_t random = seed ? seed : 1;
+	for(uint64_t game = 0; game < games; game++) {
+		if(!check_game(&random, play_ms, &history_bytes, &history_ms, &crossings, &deaths)) {
+			fprintf(stderr, "game %llu (seed %llu) failed\n", (unsigned long long)game,
+					(unsigned long long)seed);
+			return 1;
+		}
+	}
+	printf("%llu games passed (%u crossings, %u deaths)\n", (unsigned long long)games,
+			crossings, deaths);
+	if(history_bytes) {
+		printf("history: %.1f bytes per second of play, %.1f s in the %u byte ring\n",
+				1000.0 * history_bytes / history_ms,
+				(double)REWIND_BUFFER_SIZE * history_ms / history_bytes / 1000.0,
+				REWIND_BUFFER_SIZE);
+	}
+	return 0;
+}
@@ -0,0 +1,303 @@
+/*
+ * snaptool.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Makes and decodes game state snapshots (see snapshot.h), e.g. to start
+ * a test at row 6 of level 5 by sending "!<hex>" followed by return to
+ * the firmware.
+ *
+ *   snaptool make [name=value ...]
+ *       Start the level, move the traffic to where it is after time ms,
+ *       then put the frog at row, column and print the snapshot in hex. Names (and
+ *       defaults) are level (1), lives (3), score (0), seed (1),
+ *       countdown (30000 ms), time (0 ms), row (0) and column (7). A
+ *       warning is given if the frog would be hit or in the water there,
+ *       with the columns of that row which are safe.
+ *   snaptool dump hex
+ *       Print the values in a snapshot.
+ *   snaptool check
+ *       Check snapshot_unpack() on the host. Snapshots of every level
+ *       (as make does, with the frog on every row, in the riverbank in a
+ *       hole or dead on the wall) must unpack to the values packed. Each is then spoilt in turn with a
+ *       value the game can't have - level 0, a column off the field, a
+ *       frog in a hole which isn't filled, a riverbank with a wall
+ *       missing, a row further behind than the steps it has made - or
+ *       another version, and must be rejected, both unpacked and from hex.
+ *       Exits with status 1 if any check fails.
+ *
+ * Build: gcc -O2 -Wall -I../host -I../../CSSE2010-s4411500 -o snaptool snaptool.c \
+ *            ../host/host_stubs.c ../../CSSE2010-s4411500/snapshot.c \
+ *            ../../CSSE2010-s4411500/game.c ../../CSSE2010-s4411500/level.c \
+ *            ../../CSSE2010-s4411500/level_data.c ../../CSSE2010-s4411500/score.c \
+ *            ../../CSSE2010-s4411500/live.c ../../CSSE2010-s4411500/motion.c \
+ *            ../../CSSE2010-s4411500/fieldsim.c ../../CSSE2010-s4411500/lanegen.c \
+ *            ../../CSSE2010-s4411500/statebus.c ../../CSSE2010-s4411500/framebuffer.c \
+ *            ../../CSSE2010-s4411500/compositor.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "snapshot.h"
+#include "eewriter.h"
+#include "game.h"
+#include "fieldsim.h"
+#include "level.h"
+#include "live.h"
+#include "score.h"
+#include "lanegen.h"
+
+// The countdown and EEPROM writer aren't linked - the countdown is just a
+// variable here and nothing is saved
+static uint16_t countdown;
+
+uint16_t count_get_ms(void) {
+	return countdown;
+}
+
+void count_set_ms(uint16_t ms) {
+	countdown = ms;
+}
+
+void eewriter_register(uint8_t client, EewriterFill fill) {
+	(void)client;
+	(void)fill;
+}
+
+void eewriter_request(uint8_t client) {
+	(void)client;
+}
+
+static int make(int argc, char** argv) {
+	unsigned long level = 1, lives = 3, score = 0, seed = 1, time = 0, row = 0, column = 7;
+	unsigned long count = 30000;
+	char name[16];
+	unsigned long value;
+	Snapshot snapshot;
+	FieldState field;
+	FieldSim sim;
+	uint8_t data[SNAPSHOT_SIZE];
+	uint16_t safe;
+
+	for(int i = 0; i < argc; i++) {
+		if(sscanf(argv[i], "%15[a-z]=%lu", name, &value) != 2) {
+			fprintf(stderr, "bad value: %s\n", argv[i]);
+			return 2;
+		}
+		if(strcmp(name, "level") == 0 && value >= 1 && value <= 255) {
+			level = value;
+		} else if(strcmp(name, "lives") == 0 && value >= 1 && value <= 4) {
+			lives = value;
+		} else if(strcmp(name, "score") == 0 && value <= UINT16_MAX) {
+			score = value;
+		} else if(strcmp(name, "seed") == 0 && value <= UINT32_MAX) {
+			seed = value;
+		} else if(strcmp(name, "countdown") == 0 && value <= 0x7FFF) {
+			count = value;
+		} else if(strcmp(name, "time") == 0 && value <= UINT32_MAX) {
+			time = value;
+		} else if(strcmp(name, "row") == 0 && value <= 6) {
+			row = value;
+		} else if(strcmp(name, "column") == 0 && value <= 15) {
+			column = value;
+		} else {
+			fprintf(stderr, "bad value: %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	// As next_level() and play_game()
+	set_level(level);
+	lanegen_set_seed(seed);
+	set_score(score);
+	set_lives(lives);
+	initialise_game();
+	seek_traffic(time);
+
+	get_field_state(&field);
+	field.frog_row = row;
+	field.frog_column = column;
+	field.frog_dead = 0;
+	set_field_state(&field);
+	count_set_ms(count);
+
+	get_field_prediction(&sim);
+	safe = fieldsim_safe_columns(&sim, row);
+	if(!(safe & (1 << column))) {
+		fprintf(stderr, "warning: the frog isn't safe there - safe columns in row %lu:", row);
+		for(int c = 0; c < 16; c++) {
+			if(safe & (1 << c)) {
+				fprintf(stderr, " %d", c);
+			}
+		}
+		fprintf(stderr, "\n");
+	}
+
+	snapshot_take(&snapshot);
+	snapshot_pack(&snapshot, data);
+	for(int i = 0; i < SNAPSHOT_SIZE; i++) {
+		printf("%02X", data[i]);
+	}
+	printf("\n");
+	return 0;
+}
+
+static int dump(const char* hex) {
+	Snapshot snapshot;
+	const FieldState* field = &snapshot.field;
+
+	if(strlen(hex) != SNAPSHOT_HEX_LENGTH || !snapshot_from_hex(hex, &snapshot)) {
+		fprintf(stderr, "not a version %d snapshot\n", SNAPSHOT_VERSION);
+		return 1;
+	}
+	printf("level %u, lives %u, score %u, countdown %u ms, seed %u\n", snapshot.level,
+			snapshot.lives, snapshot.score, snapshot.countdown, snapshot.seed);
+	printf("frog at row %d column %d%s, riverbank %04X\n", field->frog_row,
+			field->frog_column, field->frog_dead ? " (dead)" : "", field->riverbank_status);
+	printf("level time %lu ms, steps behind", (unsigned long)field->level_time);
+	for(int row = 0; row < 5; row++) {
+		printf(" %u", field->steps_behind[row]);
+	}
+	printf("\n");
+	return 0;
+}
+
+// Return 1 if the snapshot is rejected, packed and in hex
+static int rejected(const Snapshot* snapshot) {
+	uint8_t data[SNAPSHOT_SIZE];
+	char hex[SNAPSHOT_HEX_LENGTH + 1];
+	Snapshot unpacked;
+
+	snapshot_pack(snapshot, data);
+	for(int i = 0; i < SNAPSHOT_SIZE; i++) {
+		sprintf(hex + 2 * i, "%02X", data[i]);
+	}
+	return !snapshot_unpack(data, &unpacked) && !snapshot_from_hex(hex, &unpacked);
+}
+
+// Spoil a good snapshot in each way in turn. Returns 0 (having said why)
+// if any is accepted.
+static int check_bad(const Snapshot* good, uint16_t riverbank, unsigned long* bad) {
+	static const int8_t bad_columns[] = { -1, 16, 17, 30 };
+	uint8_t first_wall = __builtin_ctz(riverbank);
+	uint8_t first_hole = __builtin_ctz(~riverbank);
+	Snapshot snapshot;
+	uint8_t data[SNAPSHOT_SIZE];
+	const char* why;
+
+	for(int i = 0; i < 10; i++) {
+		snapshot = *good;
+		switch(i) {
+			case 0:
+				snapshot.level = 0;
+				why = "level 0";
+				break;
+			case 1: case 2: case 3: case 4:
+				snapshot.field.frog_column = bad_columns[i - 1];
+				why = "the frog off the side of the field";
+				break;
+			case 5: case 6:
+				// (Dead or alive - jumping into a hole fills it)
+				snapshot.field.frog_row = 7;
+				snapshot.field.frog_column = first_hole;
+				snapshot.field.frog_dead = i & 1;
+				snapshot.field.riverbank_status = riverbank;
+				why = "the frog in a hole that isn't filled";
+				break;
+			case 7:
+				snapshot.field.riverbank_status &= ~(1 << first_wall);
+				why = "a riverbank wall missing";
+				break;
+			case 8:
+				// No steps have been made at the start of a level
+				snapshot.field.level_time = 0;
+				memset(snapshot.field.steps_behind, 0, sizeof(snapshot.field.steps_behind));
+				snapshot.field.steps_behind[*bad % 5] = 1;
+				why = "a row behind at the start of the level";
+				break;
+			default:
+				snapshot_pack(&snapshot, data);
+				data[0] = SNAPSHOT_VERSION + 1;
+				if(snapshot_unpack(data, &snapshot)) {
+					printf("level %u: accepted another version\n", good->level);
+					return 0;
+				}
+				(*bad)++;
+				continue;
+		}
+		if(!rejected(&snapshot)) {
+			printf("level %u: accepted a snapshot with %s\n", good->level, why);
+			return 0;
+		}
+		(*bad)++;
+	}
+	return 1;
+}
+
+static int check(void) {
+	Snapshot snapshot, unpacked;
+	FieldState field;
+	uint8_t data[SNAPSHOT_SIZE];
+	uint16_t riverbank;
+	unsigned long good = 0, bad = 0;
+
+	for(unsigned level = 1; level <= 255; level++) {
+		level_read_riverbank(level_descriptor(level), &riverbank);
+		set_level(level);
+		lanegen_set_seed(level * 7919);
+		set_score(level * 10);
+		set_lives(1 + level % 4);
+		initialise_game();
+		seek_traffic(level * 1234);
+		count_set_ms(level * 100);
+		// Every row, then (as row 8) dead on the riverbank wall
+		for(int8_t row = 0; row <= 8; row++) {
+			get_field_state(&field);
+			field.frog_row = row > 7 ? 7 : row;
+			field.frog_column = (level + row) % 16;
+			field.frog_dead = row & 1;
+			if(row == 7) {
+				field.frog_column = __builtin_ctz(~riverbank);
+				field.riverbank_status |= 1 << field.frog_column;
+			} else if(row == 8) {
+				field.frog_column = __builtin_ctz(riverbank);
+			}
+			// Behind by at most the steps made
+			field.steps_behind[row % 5] = row % 8;
+			set_field_state(&field);
+			snapshot_take(&snapshot);
+			snapshot_pack(&snapshot, data);
+			if(!snapshot_unpack(data, &unpacked) ||
+					memcmp(&unpacked.field, &snapshot.field, sizeof(FieldState)) != 0 ||
+					unpacked.level != snapshot.level || unpacked.lives != snapshot.lives ||
+					unpacked.score != snapshot.score || unpacked.seed != snapshot.seed ||
+					unpacked.countdown != snapshot.countdown) {
+				printf("level %u row %d: snapshot didn't come back the same\n", level, row);
+				return 1;
+			}
+			good++;
+			if(!check_bad(&snapshot, riverbank, &bad)) {
+				return 1;
+			}
+		}
+	}
+	printf("%lu good snapshots unpacked, %lu bad ones rejected\n", good, bad);
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	if(argc >= 2 && strcmp(argv[1], "make") == 0) {
+		return make(argc - 2, argv + 2);
+	} else if(argc == 3 && strcmp(argv[1], "dump") == 0) {
+		return dump(argv[2]);
+	} else if(argc == 2 && strcmp(argv[1], "check") == 0) {
+		return check();
+	}
+	fprintf(stderr, "usage: %s make [name=value ...]\n"
+			"       %s dump hex\n"
+			"       %s check\n", argv[0], argv[0], argv[0]);
+	return 2;
+}
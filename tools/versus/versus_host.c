@@ -0,0 +1,332 @@
+/*
+ * versus_host.c
+ *
+ * Written by Wu Lai Yin (Peter)
+ *
+ * Races two copies of the game against each other on the host (see
+ * versus.h). The two boards are two processes joined by a socket pair,
+ * each running versus.c against its own game.c on a virtual 1 ms clock.
+ * They swap what they sent each ms, so the link can be given a latency,
+ * random jitter and the 19200 baud byte time (520 us) deterministically.
+ * The frogs are played by the autopilot with random moves mixed in (so
+ * they also die and make moves the other board can't predict).
+ *
+ * Each race is checked - both boards must finish with opposite results
+ * (or both a draw) and no desync or link failure. The rollbacks and stalls
+ * are summed over the races, and the host time to re-simulate a tick
+ * (with benchmark_versus_rollback()) is printed at the end. (The AVR
+ * cycles come from tools/bench/run_bench.sh -D VERSUS_ENABLED.)
+ *
+ * Build: gcc -O2 -Wall -DVERSUS_ENABLED -DBENCHMARK -I../host \
+ *            -I../../CSSE2010-s4411500 -o versus_host versus_host.c \
+ *            ../host/host_stubs.c ../../CSSE2010-s4411500/versus.c \
+ *            ../../CSSE2010-s4411500/game.c ../../CSSE2010-s4411500/level.c \
+ *            ../../CSSE2010-s4411500/level_data.c ../../CSSE2010-s4411500/score.c \
+ *            ../../CSSE2010-s4411500/motion.c ../../CSSE2010-s4411500/fieldsim.c \
+ *            ../../CSSE2010-s4411500/lanegen.c ../../CSSE2010-s4411500/autopilot.c \
+ *            ../../CSSE2010-s4411500/statebus.c ../../CSSE2010-s4411500/framebuffer.c \
+ *            ../../CSSE2010-s4411500/compositor.c
+ * Usage: versus_host [-g races] [-s seed] [-l latency ms] [-j jitter ms]
+ *            [-r random moves per minute]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "versus.h"
+#include "autopilot.h"
+#include "serialio.h"
+#include "statebus.h"
+#include "compositor.h"
+
+// Longest race (virtual ms) before it's counted as a failure
+#define MAX_RACE_MS 3600000
+
+// 10 bits at 19200 baud (us)
+#define BYTE_TIME_US 520
+
+#define QUEUE_SIZE 4096
+#define MAX_SENT 256
+
+// Bytes on their way to this board, with the time (us) each arrives
+static uint8_t queue[QUEUE_SIZE];
+static uint64_t queue_time[QUEUE_SIZE];
+static uint32_t queue_head, queue_tail;
+static uint64_t last_arrival;
+
+// Bytes sent by this board in the current ms
+static uint8_t sent[MAX_SENT];
+static uint32_t sent_length;
+
+static uint64_t now_us;
+
+// What a board reports at the end of a race
+typedef struct {
+	uint8_t state;
+	VersusStats stats;
+} Result;
+
+// Link settings
+static uint32_t latency_ms = 20;
+static uint32_t jitter_ms = 10;
+static uint32_t random_rate = 30;
+
+// xorshift64
+static uint64_t next_random(uint64_t* state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+// The serial port (in place of serialio.c) - stdin and stdout of a board
+// are replaced by these
+int8_t serial_input_available(void) {
+	return queue_head != queue_tail && queue_time[queue_head % QUEUE_SIZE] <= now_us;
+}
+
+void clear_serial_input_buffer(void) {
+}
+
+static ssize_t link_read(void* cookie, char* buffer, size_t size) {
+	if(!size || !serial_input_available()) {
+		return 0;
+	}
+	buffer[0] = queue[queue_head++ % QUEUE_SIZE];
+	return 1;
+}
+
+static ssize_t link_write(void* cookie, const char* buffer, size_t size) {
+	for(size_t i = 0; i < size; i++) {
+		if(sent_length < MAX_SENT) {
+			sent[sent_length++] = buffer[i];
+		}
+	}
+	return size;
+}
+
+// Not linked - the countdown isn't used in a race
+uint16_t count_get_ms(void) {
+	return 0;
+}
+
+void count_set_ms(uint16_t ms) {
+}
+
+static int write_all(int fd, const void* data, size_t size) {
+	const uint8_t* bytes = data;
+	while(size) {
+		ssize_t done = write(fd, bytes, size);
+		if(done <= 0) {
+			return 0;
+		}
+		bytes += done;
+		size -= done;
+	}
+	return 1;
+}
+
+static int read_all(int fd, void* data, size_t size) {
+	uint8_t* bytes = data;
+	while(size) {
+		ssize_t done = read(fd, bytes, size);
+		if(done <= 0) {
+			return 0;
+		}
+		bytes += done;
+		size -= done;
+	}
+	return 1;
+}
+
+// Race one board. Every ms the bytes sent are swapped with the other board
+// (as a count then the bytes, plus whether this board has finished) and
+// the other board's bytes queued to arrive after the latency and jitter,
+// one byte time apart. Returns 0 if the link broke.
+static int race(int fd, uint64_t seed, Result* result) {
+	cookie_io_functions_t functions = {link_read, link_write, NULL, NULL};
+	FILE* real_stdin = stdin;
+	FILE* real_stdout = stdout;
+	uint64_t random = seed ? seed : 1;
+	uint32_t last_autopilot_time = 0;
+	uint8_t state = VERSUS_WAITING;
+	uint8_t done = 0, other_done = 0;
+	int ok = 1;
+
+	queue_head = queue_tail = 0;
+	last_arrival = 0;
+	stdin = fopencookie(NULL, "r", functions);
+	stdout = fopencookie(NULL, "w", functions);
+	setvbuf(stdin, NULL, _IONBF, 0);
+	setvbuf(stdout, NULL, _IONBF, 0);
+
+	versus_start(0);
+	for(uint32_t now = 0; ok && !(done && other_done); now++) {
+		now_us = (uint64_t)now * 1000;
+		sent_length = 0;
+		if(!done) {
+			clearerr(stdin);
+			state = versus_run(now);
+			state_dispatch();
+			compositor_update();
+			if(state == VERSUS_RACING) {
+				if(next_random(&random) % 60000 < random_rate) {
+					versus_move(next_random(&random) % 4);
+				} else if(now - last_autopilot_time >= AUTOPILOT_STEP_MS) {
+					last_autopilot_time = now;
+					versus_move(autopilot_next_move());
+				}
+			}
+			done = state > VERSUS_RACING || now >= MAX_RACE_MS;
+		}
+
+		// Swap this ms's bytes with the other board
+		uint8_t header[2] = {sent_length, done};
+		uint8_t other[2];
+		uint8_t bytes[MAX_SENT];
+		ok = write_all(fd, header, 2) && write_all(fd, sent, sent_length) &&
+				read_all(fd, other, 2) && read_all(fd, bytes, other[0]);
+		other_done = other[1];
+		uint64_t arrival = now_us + (latency_ms + next_random(&random) % (jitter_ms + 1)) * 1000;
+		for(uint32_t i = 0; ok && i < other[0]; i++) {
+			if(arrival < last_arrival + BYTE_TIME_US) {
+				arrival = last_arrival + BYTE_TIME_US;
+			}
+			last_arrival = arrival;
+			queue[queue_tail % QUEUE_SIZE] = bytes[i];
+			queue_time[queue_tail++ % QUEUE_SIZE] = arrival;
+		}
+	}
+	versus_finish();
+	result->state = state;
+	versus_get_stats(&result->stats);
+
+	fclose(stdin);
+	fclose(stdout);
+	stdin = real_stdin;
+	stdout = real_stdout;
+	return ok;
+}
+
+static int opposite(uint8_t a, uint8_t b) {
+	return (a == VERSUS_WON && b == VERSUS_LOST) || (a == VERSUS_LOST && b == VERSUS_WON) ||
+			(a == VERSUS_DRAW && b == VERSUS_DRAW);
+}
+
+// Nanoseconds to re-simulate one tick on this host
+static double time_rollback(void) {
+	struct timespec start, end;
+	const int repeats = 20000;
+
+	versus_start(0);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(int i = 0; i < repeats; i++) {
+		benchmark_versus_rollback(VERSUS_MAX_ROLLBACK);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	versus_finish();
+	return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) /
+			repeats / VERSUS_MAX_ROLLBACK;
+}
+
+int main(int argc, char** argv) {
+	uint64_t races = 20;
+	uint64_t seed = 1;
+	uint64_t rollbacks = 0, resimulated = 0, ticks = 0, stalls = 0;
+	uint32_t max_depth = 0;
+	uint32_t wins[2] = {0, 0}, draws = 0;
+
+	for(int i = 1; i < argc; i++) {
+		if(i + 1 < argc && strcmp(argv[i], "-g") == 0) {
+			races = strtoull(argv[++i], NULL, 0);
+		} else if(i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+			seed = strtoull(argv[++i], NULL, 0);
+		} else if(i + 1 < argc && strcmp(argv[i], "-l") == 0) {
+			latency_ms = strtoul(argv[++i], NULL, 0);
+		} else if(i + 1 < argc && strcmp(argv[i], "-j") == 0) {
+			jitter_ms = strtoul(argv[++i], NULL, 0);
+		} else if(i + 1 < argc && strcmp(argv[i], "-r") == 0) {
+			random_rate = strtoul(argv[++i], NULL, 0);
+		} else {
+			fprintf(stderr, "usage: %s [-g races] [-s seed] [-l latency ms] [-j jitter ms]"
+					" [-r random moves per minute]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	init_autopilot();
+	for(uint64_t n = 0; n < races; n++) {
+		int fds[2];
+		Result results[2];
+		uint64_t race_seed = seed * 1000003 + n * 2;
+		pid_t child;
+		int status;
+
+		if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+			perror("socketpair");
+			return 1;
+		}
+		fflush(stdout);
+		child = fork();
+		if(child < 0) {
+			perror("fork");
+			return 1;
+		}
+		if(child == 0) {
+			// The second board sends its result to the first
+			close(fds[0]);
+			if(!race(fds[1], race_seed + 1, &results[1]) ||
+					!write_all(fds[1], &results[1], sizeof(Result))) {
+				_exit(1);
+			}
+			_exit(0);
+		}
+		close(fds[1]);
+		if(!race(fds[0], race_seed, &results[0]) ||
+				!read_all(fds[0], &results[1], sizeof(Result))) {
+			fprintf(stderr, "race %llu: link between the boards broke\n", (unsigned long long)n);
+			return 1;
+		}
+		close(fds[0]);
+		waitpid(child, &status, 0);
+
+		if(!opposite(results[0].state, results[1].state)) {
+			fprintf(stderr, "race %llu (seed %llu): results %u and %u don't agree\n",
+					(unsigned long long)n, (unsigned long long)seed, results[0].state,
+					results[1].state);
+			return 1;
+		}
+		if(results[0].state == VERSUS_DRAW) {
+			draws++;
+		} else {
+			wins[results[0].state == VERSUS_WON ? 0 : 1]++;
+		}
+		for(int board = 0; board < 2; board++) {
+			const VersusStats* stats = &results[board].stats;
+			ticks += stats->ticks;
+			rollbacks += stats->rollbacks;
+			resimulated += stats->resimulated;
+			stalls += stats->stalls;
+			if(stats->max_depth > max_depth) {
+				max_depth = stats->max_depth;
+			}
+		}
+	}
+
+	printf("%llu races agreed (%u/%u wins, %u draws), latency %u ms + up to %u ms jitter\n",
+			(unsigned long long)races, wins[0], wins[1], draws, latency_ms, jitter_ms);
+	printf("%llu ticks, %llu rollbacks, deepest %u ticks, mean %.1f ticks, "
+			"%.2f re-simulated ticks per tick, %llu stalls\n", (unsigned long long)ticks,
+			(unsigned long long)rollbacks, max_depth,
+			rollbacks ? (double)resimulated / rollbacks : 0.0,
+			ticks ? (double)resimulated / ticks : 0.0, (unsigned long long)stalls);
+	printf("re-simulating a tick: %.0f ns on this host\n", time_rollback());
+	return 0;
+}